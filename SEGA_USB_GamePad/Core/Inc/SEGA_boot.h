@@ -0,0 +1,61 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_boot.h
+ *  @brief Быстрый старт и журнал времени загрузки
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Порядок старта (main.c), чтоб от подачи питания до готового геймпада прошло меньше времени:
+ *  1. Кварц HSE запускается первым делом (CMSIS_RCC_HSE_Start), без ожидания.
+ *     Пока он раскачивается (~1-2 мс), настраиваются ножки (отладка, светодиод, геймпад).
+ *  2. PLL 72 МГц и счетчик микросекунд. Ожидание HSERDY к этому моменту короче или вовсе не нужно.
+ *  3. Сразу USB (MX_USB_DEVICE_Init). Подтяжка D+ на плате постоянная, хост видит
+ *     устройство с подачи питания и шлет сброс шины не раньше, чем через ~100 мс.
+ *     Всё, что ниже, успевает до сброса, и на запросы хоста уже есть кому отвечать.
+ *  4. Таймеры опроса и внеочередной первый опрос (TIM2 UG). Пока хост читает дескрипторы,
+ *     опрос идет в прерываниях, и к SET_CONFIGURATION переменная Buttons уже заполнена.
+ *  5. По SET_CONFIGURATION (CUSTOM_HID_Init_FS) запускается еще один внеочередной опрос,
+ *     и первый отчет встает в точку IN через ~0,2 мс, а не через период опроса (до 4,2 мс).
+ *
+ *  Журнал: при первом прохождении каждого этапа (SEGA_Boot_Mark) запоминается время в мкс
+ *  от входа в main. Отсчет по DWT CYCCNT: он идет с самого начала, когда TIM4 + TIM1 еще
+ *  не запущены. До этапа SEGA_BOOT_CLOCK ядро работает от HSI 8 МГц, после - от PLL 72 МГц.
+ *  Прочитать журнал можно отладчиком (переменная SEGA_Boot_trace) или командой "boot"
+ *  в виртуальном COM-порте (см. SEGA_cdc.h).
+ *
+ *  Время от подачи питания до входа в main (запуск регулятора, Reset_Handler, копирование
+ *  .data) в журнал не попадает.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_BOOT_H
+#define __SEGA_BOOT_H
+
+#include "main.h"
+
+/*Этапы загрузки*/
+#define SEGA_BOOT_MAIN         0 //Вход в main
+#define SEGA_BOOT_CLOCK        1 //PLL 72 МГц
+#define SEGA_BOOT_USB          2 //USB запущен
+#define SEGA_BOOT_PAD          3 //Опрос геймпада запущен
+#define SEGA_BOOT_FIRST_POLL   4 //Первый опрос закончен, Buttons заполнена
+#define SEGA_BOOT_USB_RESET    5 //Первый сброс шины от хоста
+#define SEGA_BOOT_CONFIGURED   6 //SET_CONFIGURATION
+#define SEGA_BOOT_FIRST_REPORT 7 //Первый отчет геймпада принят в точку IN
+#define SEGA_BOOT_STAGES       8
+
+struct SEGA_Boot_Trace_name {
+    uint32_t done; //Биты пройденных этапов (1 << SEGA_BOOT_...)
+    uint32_t us[SEGA_BOOT_STAGES]; //Время этапа, мкс от входа в main
+};
+
+extern struct SEGA_Boot_Trace_name SEGA_Boot_trace;
+
+void SEGA_Boot_Init(void); //Запуск отсчета времени. Первой строкой в main
+void SEGA_Boot_Mark(uint8_t stage); //Отметка этапа (повторные отметки не учитываются)
+
+#endif /* __SEGA_BOOT_H */
@@ -0,0 +1,46 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_cdc.h
+ *  @brief Диагностика и настройка через виртуальный COM-порт (CDC-ACM)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Текстовые команды, по одной в строке (конец строки - '\r' или '\n'):
+ *
+ * | Команда        | Действие                                                   |
+ * | stat           | состояние: протокол, режим записи, переполнение, кнопки    |
+ * | tas stop       | SEGA_TAS_CMD_STOP                                          |
+ * | tas rec        | SEGA_TAS_CMD_RECORD                                        |
+ * | tas flash      | SEGA_TAS_CMD_RECORD_FLASH                                  |
+ * | tas play       | SEGA_TAS_CMD_PLAY                                          |
+ * | tm on / tm off | дублировать поток SEGA_telemetry в COM-порт                |
+ * | boot           | журнал загрузки: мкс от входа в main по этапам SEGA_BOOT_  |
+ * | cfg K          | значение настройки K (SEGA_CONFIG_..., см. SEGA_config.h)  |
+ * | cfg K V        | записать V в настройку K (во Flash - из главного цикла)    |
+ * | macro N C HEX  | макрос N: сочетание C, байт-код HEX (см. SEGA_macro.h)     |
+ *
+ *  Ответ: "OK", "ERR" или строка состояния, с "\r\n" в конце.
+ *  Пока ответ не ушел, следующая команда не читается, так что
+ *  поток команд сам подстраивается под скорость передачи.
+ *
+ *  Все выполняется в главном цикле, прерывание USB только складывает
+ *  принятые байты в буфер (см. usbd_cdc_acm.h).
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_CDC_H
+#define __SEGA_CDC_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_CDC_LINE_SIZE  80 //Максимальная длина команды
+#define SEGA_CDC_REPLY_SIZE 64 //Максимальная длина ответа
+
+void SEGA_CDC_Process(void); //Разбор команд из COM-порта. Вызывать в главном цикле
+
+#endif /* __SEGA_CDC_H */
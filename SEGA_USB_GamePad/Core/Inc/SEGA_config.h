@@ -0,0 +1,86 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_config.h
+ *  @brief Настройки во Flash (эмуляция EEPROM на двух страницах)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Настройка - 16-битное значение с номером (ключом) 0..SEGA_CONFIG_KEYS-1.
+ *  При старте (SEGA_Config_Init) все значения один раз читаются из Flash в RAM,
+ *  дальше SEGA_Config_Get просто берет элемент массива.
+ *
+ *  Во Flash под настройки отведены две последние страницы (SEGA_CONFIG_PAGE_A, SEGA_CONFIG_PAGE_B).
+ *  Одна из них активная, вторая - запасная. Заголовок страницы (8 байт):
+ *
+ * | Полуслово | Назначение                                                         |
+ * | 0         | статус: 0xFFFF - стерта, 0xEEEE - идет перенос, 0x0000 - активная  |
+ * | 1         | поколение (растет на 1 при каждом переносе)                        |
+ * | 2         | поколение XOR 0xFFFF (проверка)                                    |
+ * | 3         | резерв, 0xFFFF                                                     |
+ *
+ *  Дальше записи по 4 байта, каждая новая - в первое свободное место (0xFFFFFFFF):
+ *
+ * | Полуслово | Назначение                                                         |
+ * | 0         | ключ (старший байт), CRC-8 ключа и значения (младший байт)         |
+ * | 1         | значение                                                           |
+ *
+ *  Побеждает последняя запись ключа. Сначала пишется значение, потом заголовок записи,
+ *  поэтому при пропадании питания запись либо есть целиком, либо ее нет
+ *  (недописанная отбрасывается по CRC), и ключ сохраняет прежнее значение.
+ *
+ *  Когда активная страница заполнена, последние значения переносятся на запасную:
+ *  стирание, поколение, статус "перенос", записи, статус "активная". Старая страница
+ *  не стирается до следующего переноса. При старте активной считается страница
+ *  со статусом 0x0000 и большим поколением, незаконченный перенос не учитывается.
+ *
+ *  SEGA_Config_Set меняет значение в RAM сразу, а во Flash оно уходит из главного цикла
+ *  (SEGA_Config_Process), по одной операции за вызов и только между опросами геймпада:
+ *  пока идет запись или стирание, выборка команд из Flash стоит (стирание ~20 мс),
+ *  и прерывание TIM3 посреди стробов SELECT сбило бы опрос. Запрет прерываний на время
+ *  проверки TIM3 гарантирует, что опрос не начнется между проверкой и стартом операции.
+ *  Опрос, пришедшийся на стирание, просто начнется позже.
+ *
+ *  Ресурс: 254 записи на страницу, одна запись = одно изменение настройки.
+ *  Перенос копирует только ключи, которые хоть раз записывались (не больше SEGA_CONFIG_KEYS).
+ *  На модели Flash (tools/test_config) при 20 записанных ключах выходит ~2,2 байта Flash
+ *  на байт значения и ~4 стирания на 1000 изменений, то есть ~5 млн изменений до износа.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_CONFIG_H
+#define __SEGA_CONFIG_H
+
+#include "main.h"
+
+/*Макросы*/
+#define SEGA_CONFIG_PAGE_A    0x0800F800 //Страница 62 (сразу за областью SEGA_TAS_FLASH)
+#define SEGA_CONFIG_PAGE_B    0x0800FC00 //Страница 63
+#define SEGA_CONFIG_PAGE_SIZE 1024
+#define SEGA_CONFIG_KEYS      64 //Количество настроек
+
+/*Ключи*/
+#define SEGA_CONFIG_POLL_HZ 0 //Частота опроса геймпада, Гц (60..1000). Применяется после перезагрузки
+#define SEGA_CONFIG_REMAP_0 1 //Переназначение кнопок, биты 0-3 (см. SEGA_remap.h)
+#define SEGA_CONFIG_REMAP_1 2 //Биты 4-7
+#define SEGA_CONFIG_REMAP_2 3 //Биты 8-11
+#define SEGA_CONFIG_REMAP_3 4 //Биты 12-13
+#define SEGA_CONFIG_SOCD    5 //Правило для UP+DOWN и LEFT+RIGHT (см. SEGA_socd.h)
+#define SEGA_CONFIG_TURBO_0 6 //Турбо, биты 0-1 (см. SEGA_turbo.h). Дальше по 2 бита на ключ
+#define SEGA_CONFIG_TURBO_6 12 //Турбо, биты 12-13
+#define SEGA_CONFIG_USB_MODE 13 //Геймпад, клавиатура, XInput или геймпад с метками (см. SEGA_keyboard.h). Применяется после переподключения
+#define SEGA_CONFIG_POINTER 14 //Режим указателя: сочетание включения, бит 15 - включен при старте (см. SEGA_pointer.h)
+#define SEGA_CONFIG_POINTER_CURVE 15 //Кривая разгона указателя
+#define SEGA_CONFIG_MACRO_0 16 //Макросы: 3 по 16 ключей, до ключа 63 (см. SEGA_macro.h)
+
+void SEGA_Config_Init(void); //Загрузка настроек из Flash в RAM. При старте
+uint16_t SEGA_Config_Get(uint8_t key); //Значение настройки
+uint32_t SEGA_Config_Version(void); //Счетчик изменений (пересчет таблиц по изменению)
+bool SEGA_Config_Set(uint8_t key, uint16_t value); //Новое значение (во Flash уйдет из главного цикла)
+void SEGA_Config_Process(void); //Запись изменений во Flash. Вызывать в главном цикле
+bool SEGA_Config_Busy(void); //Есть не записанные во Flash изменения (главному циклу нельзя спать)
+
+#endif /* __SEGA_CONFIG_H */
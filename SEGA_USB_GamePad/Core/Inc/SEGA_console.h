@@ -0,0 +1,93 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_console.h
+ *  @brief Эмуляция 6-кнопочного геймпада для приставки SEGA Mega Drive
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Обратный режим: МК подключается к приставке вместо геймпада, а состояние
+ *  кнопок приходит с ПК по USART1 (PA9 - TX, PA10 - RX, 115200 8N1).
+ *
+ *  Внимание! Штатная плата для этого не подходит: SN74HC14 работает только
+ *  в сторону МК. Нужен отдельный кабель к порту приставки:
+ *  PA0-PA5 напрямую на PIN1-PIN4, PIN6, PIN9 (3.3 В приставка читает как 1),
+ *  SELECT (PIN7) на PA6 через делитель 1 кОм / 2 кОм (PA6 не толерантна к 5 В).
+ *
+ *  Ответ на SELECT дает железо, без прерываний: PA6 - это еще и вход TIM3_CH1.
+ *  TIM3 в режиме сброса от TI1F_ED (оба фронта) на каждом фронте SELECT выдает
+ *  запрос DMA (TIM3_TRIG), и канал 6 DMA1 пишет в GPIOA->BSRR следующее слово
+ *  из кольца ответов (по одному на фронт, см. таблицу фаз ниже). Ядро в ответе
+ *  не участвует: задержку не увеличивают ни вход в прерывание, ни другие
+ *  прерывания, ни участки с запрещенными прерываниями.
+ *
+ *  Бюджет тактов (72 МГц, 13.9 нс на такт), от фронта SELECT до записи BSRR:
+ *
+ * | Этап                                                        | Тактов   |
+ * | синхронизация TI1 и детектор фронта TI1F_ED (72 МГц)        | 3-4      |
+ * | событие триггера -> запрос DMA                              | 1-2      |
+ * | арбитраж DMA, ожидание шины, если ее держит ядро            | 1-5      |
+ * | чтение слова кольца из SRAM (AHB)                           | 2        |
+ * | запись GPIOA->BSRR через мост APB2                          | 3-4      |
+ * | Итого                                                       | 10-17    |
+ *
+ *  То есть 0.14-0.24 мкс (плюс ~25 нс фронт на ножке). Приставка (68000, 7.67 МГц,
+ *  такт 130 нс) по рекомендации SEGA читает порт через две команды NOP после
+ *  записи SELECT (~12 тактов 68000, 1.56 мкс), а игры без NOP - через ~4 такта
+ *  (0.52 мкс). Обоим хватает. Прежний ответ из обработчика EXTI6 в RAM занимал
+ *  51-60 тактов (0.71-0.83 мкс) и игры без NOP не обслуживал.
+ *  Модель с повтором фронтов SELECT и проверкой окна чтения - tools/test_console.c.
+ *
+ *  Прерывание EXTI6 осталось только для таймаута фаз (перезапуск TIM2).
+ *  Внимание! Канал 6 DMA1 и TIM3 в этом режиме заняты (I2C1 через DMA недоступен).
+ *
+ *  Фазы (p - счетчик спадов SELECT по модулю 4):
+ *
+ * | SELECT | p |   PIN1   |   PIN2   |   PIN3   |   PIN4   |   PIN6   |   PIN9   |
+ * | HIGH   | 0 |    UP    |   DOWN   |   LEFT   |  RIGHT   |    B     |    C     |
+ * | LOW    | 1 |    UP    |   DOWN   |    0     |    0     |    A     |  START   |
+ * | HIGH   | 1 |    UP    |   DOWN   |   LEFT   |  RIGHT   |    B     |    C     |
+ * | LOW    | 2 |    UP    |   DOWN   |    0     |    0     |    A     |  START   |
+ * | HIGH   | 2 |    UP    |   DOWN   |   LEFT   |  RIGHT   |    B     |    C     |
+ * | LOW    | 3 |    0     |    0     |    0     |    0     |    A     |  START   |
+ * | HIGH   | 3 |    Z     |    Y     |    X     |   MODE   |    B     |    C     |
+ * | LOW    | 0 |    1     |    1     |    1     |    1     |    A     |  START   |
+ *
+ *  (0 - низкий уровень, кнопка нажата; без SEGA_CONSOLE_6BUTTON фазы 3 и 0
+ *  повторяют обычные, как у 3-кнопочного геймпада.)
+ *
+ *  Если SELECT не менялся дольше SEGA_CONSOLE_RESET_US, счетчик фаз
+ *  сбрасывается, как у настоящего геймпада. Для отсчета используется TIM2
+ *  в режиме одного импульса: если он успел остановиться - таймаут прошел.
+ *  Сброс перезапускает кольцо DMA с ответа на первый фронт: при SELECT
+ *  в покое (HIGH) первый фронт - спад (LOW p1), при SELECT = LOW - фронт (HIGH p0).
+ *
+ *  Новые кнопки пишутся прямо в кольцо, по слову: опрос, во время которого
+ *  пришла посылка, может увидеть часть фаз со старыми кнопками, как у настоящего
+ *  геймпада при нажатии во время опроса.
+ *
+ *  Формат посылки с ПК: 0xA5, младший байт, старший байт переменной Buttons
+ *  (биты как в SEGA_gamepad.h, 1 - кнопка нажата).
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_CONSOLE_H
+#define __SEGA_CONSOLE_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_CONSOLE_6BUTTON 1 //1 - отвечать как 6-кнопочный геймпад, 0 - как 3-кнопочный
+#define SEGA_CONSOLE_RESET_US 1500 //Таймаут сброса счетчика фаз, мкс
+#define SEGA_CONSOLE_SYNC     0xA5 //Первый байт посылки с ПК
+#define SEGA_CONSOLE_EDGES    8 //Фронтов SELECT в полном цикле фаз (длина кольца DMA)
+#define SEGA_CONSOLE_USART_BRR ((39 << USART_BRR_DIV_Mantissa_Pos) | (1 << USART_BRR_DIV_Fraction_Pos)) //115200 при PCLK2 = 72 МГц
+
+void SEGA_Console_Init(void); //Настройка режима эмуляции геймпада
+void SEGA_Console_Set_Buttons(uint16_t buttons); //Новое состояние кнопок (1 - нажата)
+void SEGA_Console_Timeout(void); //Сброс фаз по таймауту (вызывается из TIM2)
+
+#endif /* __SEGA_CONSOLE_H */
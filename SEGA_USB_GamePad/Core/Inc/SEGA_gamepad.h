@@ -40,9 +40,11 @@
  * | 7        |  4	       |   LOW      |     –	    |    –      |    –      |     –     |     A     |	START   |
  * | 8        |  4/0(idle) |   HIGH	    |     UP	|   DOWN	|   LEFT	|    RIGHT	|     B	    |    C      |
  *  
- * Создана переменная uint16_t Buttons; //Переменная под 12 кнопок
+ * Создана переменная uint16_t Buttons; //Переменная под 12 кнопок (14 у геймпада Saturn)
  * Биты:
- *      15-12 Не используются
+ *      15-14 Не используются
+ *      13 - R (только Saturn)
+ *      12 - L (только Saturn)
  *      11 - A
  *      10 - B
  *       9 - C
@@ -63,10 +65,24 @@
  ******************************************************************************
  */
 
+#ifndef __SEGA_GAMEPAD_H
+#define __SEGA_GAMEPAD_H
+
 #include <stm32f1xx.h>
 #include <stm32f103xx_CMSIS.h>
 #include <stdbool.h>
 
+/*Выбор устройства, подключенного к порту DB-9*/
+#define SEGA_PROTOCOL_MEGADRIVE 0 //3/6-кнопочный геймпад Mega Drive
+#define SEGA_PROTOCOL_MOUSE     1 //Sega Mega Mouse (требует вывод TR, см. SEGA_mouse.h)
+#define SEGA_PROTOCOL_SATURN    2 //Цифровой геймпад Saturn (требует вывод TR, см. SEGA_saturn.h)
+#define SEGA_PROTOCOL_AUTO      3 //Mega Drive или Saturn, определяется при каждом опросе
+#define SEGA_PROTOCOL_CONSOLE   4 //Обратный режим: МК сам отвечает приставке как геймпад (см. SEGA_console.h)
+
+#ifndef SEGA_PROTOCOL
+#define SEGA_PROTOCOL SEGA_PROTOCOL_MEGADRIVE
+#endif
+
 /*Макросы*/
 #define SEGA_PIN1 GPIO_IDR_IDR0
 #define SEGA_PIN2 GPIO_IDR_IDR1
@@ -75,6 +91,8 @@
 #define SEGA_PIN6 GPIO_IDR_IDR4
 #define SEGA_PIN9 GPIO_IDR_IDR5
 
+#define SEGA_R_Pos     (1 << 13)
+#define SEGA_L_Pos     (1 << 12)
 #define SEGA_A_Pos     (1 << 11)
 #define SEGA_B_Pos     (1 << 10)
 #define SEGA_C_Pos     (1 << 9)
@@ -90,7 +108,22 @@
 
 #define SEGA_SELECT_ON  GPIOA->BSRR = GPIO_BSRR_BS6
 #define SEGA_SELECT_OFF GPIOA->BSRR = GPIO_BSRR_BR6
+#define SEGA_TR_ON      GPIOA->BSRR = GPIO_BSRR_BS7
+#define SEGA_TR_OFF     GPIOA->BSRR = GPIO_BSRR_BR7
 #define SEGA_LED_ON     GPIOC->BSRR = GPIO_BSRR_BS13
 #define SEGA_LED_OFF    GPIOC->BSRR = GPIO_BSRR_BR13
 
-void SEGA_GPIO_Init(void); //Настройка ножек для работы с геймпадом
\ No newline at end of file
+#define SEGA_HAT_NEUTRAL 8 //Крестовина отпущена (null state)
+#define SEGA_AXIS_MIN    (-128) //Ось отчета: LEFT или UP
+#define SEGA_AXIS_MAX    127 //Ось отчета: RIGHT или DOWN
+
+#define SEGA_POLL_TIM2_HZ  240000 //TIM2 тактируется 240 кГц (72 МГц / 300)
+#define SEGA_POLL_HZ_MIN   60 //Границы частоты опроса из настроек, Гц
+#define SEGA_POLL_HZ_MAX   1000
+
+void SEGA_GPIO_Init(void); //Настройка ножек для работы с геймпадом
+void SEGA_TR_Output_Init(void); //Настройка ножки PA7 на выход TR (PIN9)
+void SEGA_Poll_Rate(uint16_t hz); //Частота опроса геймпада (после CMSIS_TIM2_init)
+bool SEGA_Gamepad_Send(uint16_t buttons); //Отправка отчета геймпада в USB
+
+#endif /* __SEGA_GAMEPAD_H */
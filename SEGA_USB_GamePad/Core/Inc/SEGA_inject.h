@@ -0,0 +1,59 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_inject.h
+ *  @brief Подача нажатий с ПК через OUT отчеты USB (тесты задержки ввода)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  ПК шлет OUT отчет USB_REPORT_ID_INJECT (6 байт после Report ID):
+ *
+ * | Байт | Назначение                                                         |
+ * | 0    | seq - номер посылки (0..255, по кругу)                             |
+ * | 1    | режим: 0 - заменить геймпад, 1 - сложить (ИЛИ) с геймпадом,        |
+ * |      |        2 - отпустить (дальше снова только живой геймпад)            |
+ * | 2-3  | через сколько кадров (мс) после предыдущей посылки применить       |
+ * | 4-5  | кнопки, биты как в переменной Buttons (1 - нажата)                 |
+ *
+ *  Посылки складываются в jitter buffer на SEGA_INJECT_SIZE кадров и применяются
+ *  в прерывании SOF. Первая посылка потока применяется через SEGA_INJECT_LATENCY кадров
+ *  после прихода, следующие - строго через заданное число кадров друг за другом.
+ *  Так неравномерность доставки OUT отчетов не влияет на время нажатий.
+ *
+ *  Управление потоком: устройство шлет IN отчет USB_REPORT_ID_INJECT (4 байта):
+ *
+ * | Байт | Назначение                                                         |
+ * | 0    | credits - сколько посылок еще можно отправить                      |
+ * | 1    | seq последней принятой посылки                                     |
+ * | 2    | underrun - посылка пришла позже своего кадра (буфер опустел)       |
+ * | 3    | overrun - посылка отброшена, буфер был полон                       |
+ *
+ *  Отчет уходит после каждого изменения, в первом кадре, где точку IN не занял
+ *  отчет геймпада или мыши. ПК не должен отправлять больше посылок, чем последнее
+ *  значение credits.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_INJECT_H
+#define __SEGA_INJECT_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_INJECT_SIZE    32 //Размер jitter buffer (степень двойки)
+#define SEGA_INJECT_LATENCY 8 //Задержка первой посылки потока, кадров (мс)
+
+/*Режимы посылки*/
+#define SEGA_INJECT_OVERRIDE 0 //Заменить живой геймпад
+#define SEGA_INJECT_MERGE    1 //Сложить (ИЛИ) с живым геймпадом
+#define SEGA_INJECT_RELEASE  2 //Вернуть управление живому геймпаду
+
+void SEGA_Inject_Receive(uint8_t *report); //Прием OUT отчета (вызывается из OutEvent)
+uint16_t SEGA_Inject_Filter(uint16_t buttons); //Подмена/сложение кнопок перед отправкой
+bool SEGA_Inject_SOF(void); //Применение посылок (вызывается по SOF). true - нужен отчет геймпада
+bool SEGA_Inject_Send(void); //Отчет о credits в свободном кадре (вызывается по SOF)
+
+#endif /* __SEGA_INJECT_H */
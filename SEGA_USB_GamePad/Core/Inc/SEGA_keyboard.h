@@ -0,0 +1,97 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_keyboard.h
+ *  @brief Режим клавиатуры: геймпад представляется хосту HID клавиатурой
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Многие оболочки эмуляторов и MAME управляются с клавиатуры. В режиме клавиатуры
+ *  устройство отдает хосту другой дескриптор отчета (вместо CUSTOM_HID_ReportDesc_FS),
+ *  и каждый бит Buttons - своя клавиша. Режим задается настройкой SEGA_CONFIG_USB_MODE
+ *  (см. SEGA_config.h):
+ *
+ * | Значение | Режим                                                                  |
+ * | 0        | SEGA_KEYBOARD_OFF - геймпад (как было)                                 |
+ * | 1        | SEGA_KEYBOARD_6KRO - boot клавиатура: модификаторы + 6 клавиш, 8 байт  |
+ * | 2        | SEGA_KEYBOARD_NKRO - битовая карта: бит отчета = бит Buttons, 2 байта  |
+ * | 3        | SEGA_XINPUT_MODE - геймпад Xbox 360 (см. SEGA_xinput.h)                |
+ * | 4        | SEGA_STAMP_MODE - геймпад с номером и возрастом отчета (SEGA_stamp.h)  |
+ *
+ *  START, зажатый при подключении, меняет режим на этот раз: из геймпада -
+ *  в NKRO клавиатуру, из любой клавиатуры, XInput или меток - в геймпад. Кнопка проверяется по первому
+ *  опросу, который идет сразу после запуска USB и заканчивается задолго до того,
+ *  как хост (не раньше чем через 100 мс после подключения) прочитает дескрипторы.
+ *  В режиме клавиатуры меняется PID (SEGA_KEYBOARD_PID_OFFSET), чтобы хост
+ *  не путал сохраненные данные геймпада и клавиатуры.
+ *
+ *  Клавиши по умолчанию - раскладка игрока 1 в MAME:
+ *
+ * | Кнопка | Клавиша  | Кнопка | Клавиша  | Кнопка | Клавиша     |
+ * | UP     | вверх    | A      | L Ctrl   | X      | L Shift     |
+ * | DOWN   | вниз     | B      | L Alt    | Y      | Z           |
+ * | LEFT   | влево    | C      | Пробел   | Z      | X           |
+ * | RIGHT  | вправо   | L      | C        | START  | 1           |
+ * | MODE   | 5        | R      | V        |        |             |
+ *
+ *  Другие клавиши на те же кнопки - через переназначение (SEGA_remap.h): клавиатура
+ *  получает кнопки уже после переназначения, SOCD, макросов и турбо.
+ *
+ *  Интерфейс в обоих режимах объявлен boot клавиатурой (подкласс 1, протокол 1),
+ *  так что BIOS и загрузчики тоже видят клавиши. Если хост переключил boot протокол
+ *  (SET_PROTOCOL 0), в режиме NKRO уходит отчет 6KRO. Интервал опроса точки IN - 1 мс.
+ *
+ *  Отчет 6KRO не собирается заново на каждом опросе: для каждого бита заранее известна
+ *  его клавиша и, для модификаторов, бит в байте модификаторов. Обрабатываются только
+ *  изменившиеся биты (changed = buttons ^ прошлые): отпущенная клавиша освобождает
+ *  свое место в отчете, нажатая занимает первое свободное. Больше 6 обычных клавиш -
+ *  лишние ждут свободного места, а в отчет уходит ErrorRollOver, как у настоящей
+ *  клавиатуры. Отчет NKRO - сами биты Buttons.
+ *
+ *  Выход хоста (светодиоды Num/Caps/Scroll Lock) принимается и игнорируется.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_KEYBOARD_H
+#define __SEGA_KEYBOARD_H
+
+#include "SEGA_gamepad.h"
+
+/*Режимы*/
+#define SEGA_KEYBOARD_OFF  0
+#define SEGA_KEYBOARD_6KRO 1
+#define SEGA_KEYBOARD_NKRO 2
+
+/*Макросы*/
+#define SEGA_KEYBOARD_BITS       14 //Бит в Buttons
+#define SEGA_KEYBOARD_SLOTS      6 //Клавиш в отчете 6KRO
+#define SEGA_KEYBOARD_ROLLOVER   0x01 //ErrorRollOver: нажато больше клавиш, чем мест в отчете
+#define SEGA_KEYBOARD_MODIFIER   0xE0 //Первая клавиша-модификатор (L Ctrl)
+#define SEGA_KEYBOARD_PID_OFFSET 1 //PID клавиатуры = PID геймпада + 1
+#define SEGA_KEYBOARD_HOLD       SEGA_START_Pos //Кнопка смены режима при подключении
+
+/*Клавиши (HID Usage Page 0x07) для битов Buttons*/
+#define SEGA_KEYBOARD_RIGHT 0x4F //Стрелка вправо
+#define SEGA_KEYBOARD_LEFT  0x50 //Стрелка влево
+#define SEGA_KEYBOARD_DOWN  0x51 //Стрелка вниз
+#define SEGA_KEYBOARD_UP    0x52 //Стрелка вверх
+#define SEGA_KEYBOARD_MODE  0x22 //5
+#define SEGA_KEYBOARD_START 0x1E //1
+#define SEGA_KEYBOARD_Z     0x1B //X
+#define SEGA_KEYBOARD_Y     0x1D //Z
+#define SEGA_KEYBOARD_X     0xE1 //L Shift
+#define SEGA_KEYBOARD_C     0x2C //Пробел
+#define SEGA_KEYBOARD_B     0xE2 //L Alt
+#define SEGA_KEYBOARD_A     0xE0 //L Ctrl
+#define SEGA_KEYBOARD_L     0x06 //C
+#define SEGA_KEYBOARD_R     0x19 //V
+
+void SEGA_Keyboard_Select(uint16_t buttons); //Выбор режима по настройке и кнопке (по первому опросу)
+uint8_t SEGA_Keyboard_Mode(void); //Текущий режим
+bool SEGA_Keyboard_Send(uint16_t buttons); //Отчет клавиатуры. true - принят в точку IN
+uint8_t *SEGA_Keyboard_Report(uint16_t *len); //Текущий отчет клавиатуры, без обновления (GET_REPORT)
+
+#endif /* __SEGA_KEYBOARD_H */
@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_macro.h
+ *  @brief Макросы: последовательность нажатий по кнопке или сочетанию, с точностью до кадра
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Макросов SEGA_MACRO_COUNT, каждый занимает SEGA_MACRO_KEYS ключей настроек
+ *  начиная с SEGA_CONFIG_MACRO_0 + n * SEGA_MACRO_KEYS (см. SEGA_config.h):
+ *
+ * | Ключ  | Назначение                                                           |
+ * | +0    | биты 0-13: сочетание кнопок (биты Buttons), 0 - макрос выключен      |
+ * |       | бит 15: 0 - сложить с живым геймпадом, 1 - заменить его              |
+ * | +1..  | байт-код, по 2 байта на ключ (сначала младший), SEGA_MACRO_CODE_SIZE |
+ *
+ *  Байт-код:
+ *
+ * | Байт       | Действие                                                        |
+ * | 0x00       | конец макроса (кнопки макроса отпускаются)                      |
+ * | 0x01-0x7F  | держать текущее состояние N кадров (мс)                         |
+ * | 10xxxxxx   | биты 0-5 состояния: RIGHT LEFT DOWN UP MODE START               |
+ * | 11xxxxxx   | биты 6-11 состояния: Z Y X C B A                                |
+ *
+ *  Пример, четверть круга вперед + A (по 3 кадра на шаг):
+ *      84 03 85 03 81 E0 03 80 C0 00
+ *  DOWN, DOWN+RIGHT, RIGHT+A, все отпустить, конец. Задается командой CDC
+ *  "macro 0 2048 8403850381E00380C000" (сочетание 2048 = кнопка A, см. SEGA_cdc.h).
+ *
+ *  Запуск: в конце опроса, когда сочетание нажато полностью (в прошлом опросе не было).
+ *  Первый шаг выполняется сразу и уходит в этом же отчете. Дальше шаги отсчитываются
+ *  в прерывании SOF по USB->FNR (как в SEGA_tas.h), и каждое изменение сразу уходит
+ *  отдельным отчетом, так что время шагов точное до кадра.
+ *  Пока идет макрос, кнопки сочетания в отчет не попадают. Остальной живой геймпад
+ *  складывается с макросом (или игнорируется, если бит 15) и уходит как обычно,
+ *  в конце каждого опроса: макрос его не задерживает.
+ *  Повторный запуск - только после окончания макроса.
+ *  Турбо (SEGA_turbo.h) действует после макроса, в том числе на его кнопки.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_MACRO_H
+#define __SEGA_MACRO_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_MACRO_COUNT     3 //Количество макросов
+#define SEGA_MACRO_KEYS      16 //Ключей настроек на макрос: сочетание + байт-код
+#define SEGA_MACRO_CODE_SIZE ((SEGA_MACRO_KEYS - 1) * 2) //Байт-код, байт
+#define SEGA_MACRO_CHORD     0x3FFF //Биты сочетания в первом ключе
+#define SEGA_MACRO_OVERRIDE  0x8000 //Макрос заменяет живой геймпад
+
+uint16_t SEGA_Macro_Filter(uint16_t buttons); //Запуск по сочетанию и сложение с живым геймпадом (в конце опроса)
+bool SEGA_Macro_SOF(void); //Шаги макроса. true - кнопки изменились, нужен отчет
+
+#endif /* __SEGA_MACRO_H */
@@ -0,0 +1,68 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_mouse.h
+ *  @brief Библиотека для работы с мышью Sega Mega Mouse через порт DB-9
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Мышь общается с приставкой по рукопожатию (handshake):
+ *  TH (PIN7 SELECT) - начало/конец посылки, TR (PIN9) - запрос очередного полубайта,
+ *  TL (PIN6) - подтверждение от мыши, что полубайт выставлен на PIN1-PIN4.
+ *
+ *  Внимание! В штатной схеме PIN9 заведен только на вход (через SN74HC14 на PA5).
+ *  Для работы с мышью нужна доработка платы: PA7 через резистор 1 кОм на PIN9 DB-9.
+ *  Резистор нужен, чтоб не было конфликта с выходом обычного геймпада.
+ *
+ *  Последовательность (TH, TR - выходы МК, TL - вход):
+ *
+ * | ШАГ |  TH  |  TR  |  ЖДЕМ TL  |   PIN4..PIN1 (D3..D0)                      |
+ * | 0   |  0   |  1   |     -     |  0000                                      |
+ * | 1   |  0   |  0   |     0     |  1011 (ID мыши)                            |
+ * | 2   |  0   |  1   |     1     |  1111                                      |
+ * | 3   |  0   |  0   |     0     |  1111                                      |
+ * | 4   |  0   |  1   |     1     |  Y over | X over | Y sign | X sign         |
+ * | 5   |  0   |  0   |     0     |  START  | MIDDLE | RIGHT  | LEFT           |
+ * | 6   |  0   |  1   |     1     |  X старший полубайт                        |
+ * | 7   |  0   |  0   |     0     |  X младший полубайт                        |
+ * | 8   |  0   |  1   |     1     |  Y старший полубайт                        |
+ * | 9   |  0   |  0   |     0     |  Y младший полубайт                        |
+ * | end |  1   |  1   |     -     |  Посылка окончена                          |
+ *
+ *  Сигналы после триггера Шмитта инвертированы, это учитывается при чтении.
+ *
+ *  Опрос запускает TIM2 (по умолчанию 1000 раз в секунду), шаги рукопожатия
+ *  выполняются в прерывании TIM3 (каждые 10 мкс). Если мышь не ответила за
+ *  SEGA_MOUSE_TIMEOUT_TICKS тиков, посылка прерывается. Ожидания в цикле нет,
+ *  поэтому USB стек никогда не блокируется.
+ *
+ *  Перемещения копятся между отправками отчетов, так что если USB занят
+ *  и отчеты "склеиваются", то движение не теряется.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_MOUSE_H
+#define __SEGA_MOUSE_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_MOUSE_POLL_HZ       1000 //Частота опроса мыши, Гц
+#define SEGA_MOUSE_TIM2_ARR      (240000 / SEGA_MOUSE_POLL_HZ - 1) //TIM2 тактируется 240 кГц (72 МГц / 300)
+#define SEGA_MOUSE_TIMEOUT_TICKS 20 //Таймаут ожидания TL: 20 тиков TIM3 = 200 мкс
+#define SEGA_MOUSE_ID            0x0B //Полубайт ID мыши на шаге 1
+
+#define SEGA_MOUSE_LEFT_Pos   (1 << 0)
+#define SEGA_MOUSE_RIGHT_Pos  (1 << 1)
+#define SEGA_MOUSE_MIDDLE_Pos (1 << 2)
+#define SEGA_MOUSE_START_Pos  (1 << 3)
+
+void SEGA_Mouse_Init(void); //Настройка ножек и частоты опроса под мышь
+void SEGA_Mouse_Start(void); //Начало посылки (вызывается из TIM2)
+bool SEGA_Mouse_Tick(void); //Шаг рукопожатия (вызывается из TIM3). true - посылка окончена
+bool SEGA_Mouse_Connected(void); //Отвечает ли мышь
+
+#endif /* __SEGA_MOUSE_H */
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_pointer.h
+ *  @brief Режим указателя: крестовина двигает курсор мыши, A/B/C - кнопки мыши
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Для навигации по меню оболочек геймпад может работать мышью. Отчет мыши -
+ *  Report ID 2 (USB_REPORT_ID_MOUSE), он уже есть в CUSTOM_HID_ReportDesc_FS рядом
+ *  с геймпадом, поэтому режим включается и выключается на ходу, без переподключения.
+ *  Настройки (см. SEGA_config.h):
+ *
+ * | Ключ                      | Назначение                                             |
+ * | SEGA_CONFIG_POINTER       | биты 0-13: сочетание кнопок, включающее и выключающее  |
+ * |                           | режим (0 - режима нет), бит 15: включен при старте     |
+ * | SEGA_CONFIG_POINTER_CURVE | кривая разгона: 0 - линейная, 1 - квадратичная,        |
+ * |                           | 2 - постоянная скорость                                |
+ *
+ *  Пример: MODE+START (биты 4 и 5) - "cfg 14 48".
+ *
+ *  В режиме указателя крестовина и A, B, C в отчет геймпада не попадают:
+ *
+ * | Кнопка             | Мышь                         |
+ * | UP/DOWN/LEFT/RIGHT | перемещение                  |
+ * | A                  | левая кнопка                 |
+ * | B                  | правая кнопка                |
+ * | C                  | средняя кнопка               |
+ *
+ *  Сочетание, пока нажато, в геймпад тоже не попадает. Противоположные направления
+ *  сразу (UP+DOWN, LEFT+RIGHT) - ось стоит: указатель получает кнопки до SOCD.
+ *
+ *  Перемещение считается в прерывании SOF, каждый кадр USB (1 мс), с отсчетом кадров
+ *  по USB->FNR, как в SEGA_tas.h: движение равномерное, независимо от частоты опроса.
+ *  Скорость по каждой оси - из заранее рассчитанной таблицы по времени удержания
+ *  направления (шаг SEGA_POINTER_STEP кадров, SEGA_POINTER_STEPS шагов до полной
+ *  скорости), в пикселях за кадр с 8 дробными битами. Дробная часть копится
+ *  от кадра к кадру, так что медленное движение тоже плавное (0.25 пикселя за кадр -
+ *  пиксель каждые 4 кадра).
+ *
+ *  Отчеты мыши и геймпада делят одну точку IN (один отчет за кадр). Если в кадре
+ *  нужны оба, они уходят по очереди. Перемещение, не ушедшее в этом кадре, копится
+ *  и уходит следующим отчетом, как в SEGA_mouse.h.
+ *
+ *  Только в режиме геймпада: в режимах клавиатуры и XInput (SEGA_keyboard.h,
+ *  SEGA_xinput.h) отчета мыши нет, с SEGA_PROTOCOL_MOUSE Report ID 2 занят мышью.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_POINTER_H
+#define __SEGA_POINTER_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_POINTER_CHORD  0x3FFF //Биты сочетания в SEGA_CONFIG_POINTER
+#define SEGA_POINTER_START  0x8000 //Режим включен при старте
+#define SEGA_POINTER_CURVES 3 //Кривых разгона
+#define SEGA_POINTER_STEPS  32 //Шагов в кривой
+#define SEGA_POINTER_STEP   16 //Кадров на шаг: полная скорость через 32 * 16 = 512 мс
+#define SEGA_POINTER_BUTTONS (SEGA_UP_Pos | SEGA_DOWN_Pos | SEGA_LEFT_Pos | SEGA_RIGHT_Pos | SEGA_A_Pos | SEGA_B_Pos | SEGA_C_Pos)
+
+void SEGA_Pointer_Init(void); //Начальное состояние режима по настройкам. После SEGA_Config_Init
+uint16_t SEGA_Pointer_Filter(uint16_t buttons); //Переключение режима и забор кнопок мыши (в конце опроса)
+bool SEGA_Pointer_SOF(void); //Перемещение за кадр. true - нужен отчет мыши
+bool SEGA_Pointer_Send(void); //Отчет мыши. true - принят в точку IN
+uint8_t *SEGA_Pointer_Report(uint16_t *len); //Состояние мыши без перемещения (GET_REPORT)
+
+#endif /* __SEGA_POINTER_H */
@@ -0,0 +1,88 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_power.h
+ *  @brief Сон между событиями и режим пониженного потребления при USB suspend
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Вся работа делается в прерываниях (опрос TIM2/TIM3, USB, DMA), главный цикл
+ *  только досылает накопившееся. Поэтому в конце главного цикла ядро засыпает
+ *  в WFI (SEGA_Power_Idle) и просыпается по любому прерыванию. Если какому-то модулю
+ *  нужно работать без прерываний (например, сброс записи TAS во Flash), он передает busy = true.
+ *
+ *  USB suspend (хост усыпил шину, 3 мс без SOF): через SEGA_POWER_SUSPEND_DELAY_MS
+ *  опрос геймпада останавливается (TIM2), МК уходит в Stop (регулятор в режиме
+ *  пониженного потребления, все тактирование выключено). Будят его (только события EXTI, WFE):
+ *  - EXTI18 (USB wakeup) - хост возобновил работу шины (resume или reset);
+ *  - EXTI0-EXTI5 (PA0-PA5) - фронт на линии геймпада (1 - кнопка нажата);
+ *  - EXTI17 (будильник RTC от LSI) - проба геймпада раз в SEGA_POWER_PROBE_MS.
+ *
+ *  Проба: при SELECT в покое видны UP, DOWN, LEFT, RIGHT, B, C, при SELECT = 0 -
+ *  UP, DOWN, A, START. По будильнику SELECT переключается, и МК снова засыпает (все на HSI,
+ *  несколько микросекунд работы). Так любая кнопка 3-кнопочного набора будит МК
+ *  не позже, чем через SEGA_POWER_PROBE_MS. X, Y, Z, MODE в Stop не видны.
+ *  Проба только для Mega Drive (SEGA_POWER_PAD_WAKE): у Saturn часть линий - постоянные
+ *  биты идентификатора, у мыши линии в покое не отражают кнопки.
+ *  LSI и RTC запускаются при первом входе в Stop (~0,26 мс ожиданий LSIRDY, RSF, RTOFF)
+ *  и дальше работают, каждый следующий вход только переставляет будильник (~0,08 мс).
+ *  Средний ток МК в Stop с пробами по модели - ~35 мкА, за 1 с suspend вместе
+ *  с SEGA_POWER_SUSPEND_DELAY_MS перед входом - ~0,23 мА.
+ *
+ *  После пробуждения МК работает от HSI 8 МГц: заново запускаются HSE и PLL
+ *  (CMSIS_RCC_SystemClock_72MHz, ~1-2 мс на запуск кварца), сразу запускается
+ *  внеочередной опрос геймпада. Если хост так и не возобновил шину, через
+ *  SEGA_POWER_SUSPEND_DELAY_MS МК снова уходит в Stop. При resume от хоста МК готов
+ *  отправить отчет через ~2,3 мс, раньше, чем хост закончит resume (20 мс).
+ *
+ *  Remote wakeup: в дескрипторе конфигурации выставлен бит Remote Wakeup (bmAttributes 0xE0).
+ *  Если хост разрешил его (SET_FEATURE DEVICE_REMOTE_WAKEUP), нажатие во время suspend
+ *  (SEGA_Power_Filter в конце опроса) запускает сигнал RESUME на SEGA_POWER_RESUME_MS
+ *  (по стандарту 1-15 мс). Нажатие запоминается и уходит первым отчетом после resume,
+ *  даже если кнопку уже отпустили. Пока отчет не принят в точку IN (повтор из SOF),
+ *  нажатие держится.
+ *  Задержка нажатие -> RESUME: запуск кварца и PLL (~1-2 мс) + опрос (~0,1 мс)
+ *  для кнопок, видимых сразу, и до SEGA_POWER_PROBE_MS больше для остальных
+ *  (модель и замер - tools/test_power.c).
+ *
+ *  Внимание! В Stop счетчик CMSIS_Micros (TIM4 + TIM1) стоит, время сна в нем не учитывается.
+ *  Отладчик в Stop отваливается (если не включен DBGMCU_CR_DBG_STOP).
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_POWER_H
+#define __SEGA_POWER_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_POWER_SUSPEND_DELAY_MS 10 //Сколько ждать после suspend или пробуждения перед уходом в Stop
+#define SEGA_POWER_PROBE_MS 20 //Период пробы геймпада в Stop
+#define SEGA_POWER_RESUME_MS 10 //Длительность сигнала RESUME (remote wakeup)
+#define SEGA_POWER_LSI_HZ 40000 //Типовая частота LSI (тактирование RTC)
+
+#ifndef SEGA_POWER_PAD_WAKE
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_MEGADRIVE)
+#define SEGA_POWER_PAD_WAKE 1 //1 - будить МК нажатием кнопок геймпада
+#else
+#define SEGA_POWER_PAD_WAKE 0 //Saturn и мышь: линии в покое не отражают кнопки
+#endif
+#endif
+
+#define SEGA_POWER_PAD_LINES (EXTI_IMR_MR0 | EXTI_IMR_MR1 | EXTI_IMR_MR2 | EXTI_IMR_MR3 | EXTI_IMR_MR4 | EXTI_IMR_MR5) //PIN1-PIN4, PIN6, PIN9
+#define SEGA_POWER_USB_LINE  EXTI_IMR_MR18 //USB wakeup event
+#define SEGA_POWER_RTC_LINE  EXTI_IMR_MR17 //RTC alarm event
+#define SEGA_POWER_PAD_IDLE_MASK  (SEGA_PIN1 | SEGA_PIN2 | SEGA_PIN3 | SEGA_PIN4 | SEGA_PIN6 | SEGA_PIN9) //Кнопки при SELECT в покое
+#define SEGA_POWER_PAD_PROBE_MASK (SEGA_PIN1 | SEGA_PIN2 | SEGA_PIN6 | SEGA_PIN9) //Кнопки при SELECT = 0 (PIN3, PIN4 = 0 от геймпада)
+
+void SEGA_Power_Suspend(void); //USB ушел в suspend (вызывается из HAL_PCD_SuspendCallback)
+void SEGA_Power_Resume(void); //USB вышел из suspend (вызывается из HAL_PCD_ResumeCallback)
+void SEGA_Power_Idle(bool busy); //Сон до следующего прерывания. Вызывать в конце главного цикла
+uint16_t SEGA_Power_Filter(uint16_t buttons); //Нажатия во время suspend: remote wakeup и доставка после resume
+void SEGA_Power_Sent(void); //Отчет принят в USB (вызывается из SEGA_Gamepad_Send)
+bool SEGA_Power_Suspended(void); //Шина USB в suspend
+
+#endif /* __SEGA_POWER_H */
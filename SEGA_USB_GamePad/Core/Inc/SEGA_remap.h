@@ -0,0 +1,47 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_remap.h
+ *  @brief Переназначение кнопок через таблицы подстановки
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Переназначение задается настройками SEGA_CONFIG_REMAP_0..3 (см. SEGA_config.h):
+ *  по 4 бита на каждый бит Buttons, младшая тетрада SEGA_CONFIG_REMAP_0 - бит 0 (RIGHT),
+ *  старшая тетрада SEGA_CONFIG_REMAP_3 - бит 15. Значение тетрады - номер бита,
+ *  в который уходит кнопка (0..13, как в SEGA_gamepad.h), 0xF - кнопка отключена.
+ *  Несколько кнопок можно направить в один бит, тогда они работают как ИЛИ.
+ *
+ *  Пример: поменять местами A (бит 11) и B (бит 10). SEGA_CONFIG_REMAP_2 отвечает
+ *  за биты 8-11, по умолчанию 0xBA98. Нужно 0xAB98 = 43928, команда "cfg 3 43928".
+ *
+ *  Любое переназначение заранее раскладывается в две таблицы по 128 элементов:
+ *  для младших 7 бит Buttons (крестовина, MODE, START, Z) и для старших 7 (Y..R).
+ *  Элемент таблицы - готовое переназначенное слово для этого сочетания нажатых кнопок.
+ *  В конце каждого опроса: две выборки из таблиц и ИЛИ, независимо от переназначения.
+ *
+ *  Таблицы пересчитываются только при изменении настроек (SEGA_Remap_Process в главном цикле),
+ *  в запасную пару, после чего пары меняются одной записью. Прерывание опроса
+ *  всегда видит целую таблицу, старую или новую.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_REMAP_H
+#define __SEGA_REMAP_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_REMAP_BITS     14 //Бит в Buttons (с L и R геймпада Saturn)
+#define SEGA_REMAP_HALF     7 //Бит на одну таблицу
+#define SEGA_REMAP_LUT_SIZE (1 << SEGA_REMAP_HALF)
+#define SEGA_REMAP_OFF      0xF //Тетрада: кнопка отключена
+
+void SEGA_Remap_Init(void); //Построение таблиц по настройкам. После SEGA_Config_Init
+void SEGA_Remap_Process(void); //Пересчет таблиц при изменении настроек. Вызывать в главном цикле
+uint16_t SEGA_Remap(uint16_t buttons); //Переназначение кнопок (в конце опроса)
+
+#endif /* __SEGA_REMAP_H */
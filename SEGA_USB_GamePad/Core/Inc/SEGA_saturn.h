@@ -0,0 +1,53 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_saturn.h
+ *  @brief Библиотека для работы с цифровым геймпадом SEGA Saturn
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Геймпад Saturn выдает 13 кнопок через 4 линии данных, а выбор
+ *  выдаваемой группы делается двумя линиями: TH (PIN7 SELECT) и TR (PIN9).
+ *  Как и для мыши, нужна доработка платы: PA7 через резистор 1 кОм на PIN9 DB-9
+ *  (см. SEGA_mouse.h).
+ *
+ *  Используется тот же движок опроса, что и для Mega Drive: TIM2 запускает
+ *  TIM3, на нечетных тиках TIM3 переключаются линии выбора, на четных - читаются данные.
+ *
+ *  Таблица истинности (после триггера Шмитта: 1 - кнопка нажата):
+ *
+ * | COUNTER  |  TH  |  TR  |   PIN1   |   PIN2   |   PIN3   |   PIN4   |
+ * | 0        |  1   |  1   |   1(ID)  |   1(ID)  |   0(ID)  |    L     |
+ * | 1        |  0   |  0   |          переключение                     |
+ * | 2        |  0   |  0   |    Z     |    Y     |    X     |    R     |
+ * | 3        |  1   |  0   |          переключение                     |
+ * | 4        |  1   |  0   |    B     |    C     |    A     |  START   |
+ * | 5        |  0   |  1   |          переключение                     |
+ * | 6        |  0   |  1   |    UP    |   DOWN   |   LEFT   |  RIGHT   |
+ * | 7        |  1   |  1   |          возврат в idle                   |
+ *
+ *  ID на PIN1-PIN3 в idle у геймпада Mega Drive выглядит как одновременно
+ *  нажатые UP и DOWN, чего крестовина физически не допускает. По этому
+ *  признаку в режиме SEGA_PROTOCOL_AUTO определяется тип геймпада.
+ *
+ *  Результат пишется в ту же переменную Buttons, L и R - в биты 12 и 13.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_SATURN_H
+#define __SEGA_SATURN_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_SATURN_ID          0x03 //ID цифрового геймпада на PIN1-PIN3 в idle (после инверсии)
+#define SEGA_SATURN_ID_MASK     0x07
+#define SEGA_SATURN_COUNTER_END 7 //Последний шаг опроса
+
+bool SEGA_Saturn_Detect(void); //Проверка ID. Вызывать в idle (TH = 1, TR = 1)
+void SEGA_Saturn_Strobe(uint8_t counter); //Шаг опроса (вызывается из TIM3)
+
+#endif /* __SEGA_SATURN_H */
@@ -0,0 +1,50 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_socd.h
+ *  @brief Разрешение одновременных противоположных направлений крестовины (SOCD)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  SOCD (Simultaneous Opposite Cardinal Directions) - одновременно нажаты UP и DOWN
+ *  или LEFT и RIGHT. На обычной крестовине так почти не бывает, а на аркадных
+ *  контроллерах с кнопками вместо стика - постоянно. Правило выбирается настройкой
+ *  SEGA_CONFIG_SOCD (см. SEGA_config.h):
+ *
+ * | Значение | Правило                                                           |
+ * | 0        | SEGA_SOCD_NEUTRAL - оба направления гасятся (как было раньше)     |
+ * | 1        | SEGA_SOCD_LAST - побеждает нажатое последним                      |
+ * | 2        | SEGA_SOCD_FIRST - побеждает нажатое первым                        |
+ * | 3        | SEGA_SOCD_UP - UP+DOWN = UP, LEFT+RIGHT = нейтраль (hitbox)       |
+ *
+ *  Для каждой оси запоминается, какое направление нажато первым и какое последним.
+ *  Порядок определяется по опросам: фронт нажатия виден в том опросе, в котором
+ *  кнопку нажали. Если оба направления нажаты в одном опросе, их порядок неизвестен,
+ *  и для LAST и FIRST ось остается в нейтрали, пока одно из них не отпустят.
+ *  Когда одно из двух направлений отпущено, ось сразу переходит на оставшееся.
+ *
+ *  Разрешение - последний шаг перед отправкой отчета (SEGA_Gamepad_Output), для любого
+ *  источника кнопок: живой геймпад, макросы, турбо, запись TAS, посылки с ПК. Вызывается
+ *  в конце того же опроса, в котором изменились кнопки, так что лишнего кадра задержки нет,
+ *  и из SOF; повтор с теми же кнопками дает тот же результат. Из результата (биты 0-3)
+ *  считаются и оси X/Y, и положение крестовины (hat) отчета - своего правила у них нет.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_SOCD_H
+#define __SEGA_SOCD_H
+
+#include "SEGA_gamepad.h"
+
+/*Правила*/
+#define SEGA_SOCD_NEUTRAL 0
+#define SEGA_SOCD_LAST    1
+#define SEGA_SOCD_FIRST   2
+#define SEGA_SOCD_UP      3
+
+uint16_t SEGA_SOCD_Filter(uint16_t buttons); //Разрешение SOCD (перед отправкой отчета)
+
+#endif /* __SEGA_SOCD_H */
@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_stamp.h
+ *  @brief Номер и возраст отчета геймпада для компенсации задержки в эмуляторах
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Эмулятор с run-ahead или rollback может учесть, насколько устарели кнопки,
+ *  если знает их возраст. В режиме SEGA_STAMP_MODE (SEGA_CONFIG_USB_MODE = 4,
+ *  см. SEGA_keyboard.h) отчет геймпада (Report ID 1) длиннее на 3 байта:
+ *
+ * | Байт | Назначение                                                           |
+ * | 0    | Report ID 1                                                          |
+ * | 1-2  | крестовина осями X, Y                                                |
+ * | 3    | крестовина положением (hat)                                          |
+ * | 4-5  | кнопки                                                               |
+ * | 6    | номер отчета: +1 на каждый отчет в точку IN, 0..255 по кругу         |
+ * | 7-8  | возраст кнопок в мкс: от конца опроса до передачи отчета             |
+ *
+ *  Возраст = время загрузки отчета в точку IN (USBD_LL_Transmit) - время окончания
+ *  опроса (SEGA_Poll_End), оба по CMSIS_Micros. Больше 65535 мкс - 65535 (такое бывает
+ *  только при повторе по SET_IDLE или до первого опроса). Отчет, собранный в SOF
+ *  (макрос, турбо), несет возраст кнопок последнего опроса. Время от загрузки в точку IN
+ *  до прихода на хост (не больше интервала точки, 1 мс) хост видит сам.
+ *
+ *  Новые поля описаны в дескрипторе отчета как vendor (Usage Page 0xFF00, Usage 1 и 2)
+ *  внутри коллекции геймпада, так что драйверы геймпадов их пропускают, а через hidraw
+ *  они читаются как есть: read() из /dev/hidrawN отдает эти 9 байт, и возраст кнопок
+ *  на хосте = возраст из отчета + время от начала кадра USB до прихода отчета.
+ *  tools/stamp_reader /dev/hidrawN печатает по каждому отчету номер, пропуски номеров
+ *  и возраст.
+ *  Отчет по-прежнему один за кадр и помещается в точку IN (16 байт): частота отчетов
+ *  та же, что и без меток. VID/PID не меняются, так что настройки геймпада на хосте
+ *  подходят и к этому режиму.
+ *
+ *  START, зажатый при подключении, - обычный геймпад, без меток.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_STAMP_H
+#define __SEGA_STAMP_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_STAMP_MODE    4 //Значение SEGA_CONFIG_USB_MODE
+#define SEGA_STAMP_BYTES   3 //Добавка к отчету геймпада: номер и возраст
+#define SEGA_STAMP_AGE_MAX 0xFFFF //Предел возраста, мкс
+
+void SEGA_Stamp_Init(void); //Включение режима: дескриптор отчета с номером и возрастом. До чтения дескрипторов хостом
+bool SEGA_Stamp_Active(void); //Отчет геймпада с номером и возрастом
+void SEGA_Stamp_Sample(void); //Время окончания опроса (из SEGA_Poll_End)
+uint16_t SEGA_Stamp_Size(void); //Длина отчета геймпада
+void SEGA_Stamp_Transmit(uint8_t ep_addr, uint8_t *pbuf, uint16_t size); //Номер и возраст в отчет (из USBD_LL_Transmit)
+
+#endif /* __SEGA_STAMP_H */
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_tas.h
+ *  @brief Запись и воспроизведение нажатий геймпада с привязкой к кадрам USB
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Запись: после сборки переменной Buttons (конец опроса) состояние сравнивается
+ *  с предыдущим. Если оно изменилось, в кольцевой буфер пишется запись:
+ *
+ *      varint(кадров с прошлой записи) varint(Buttons XOR прошлое состояние)
+ *
+ *  varint - 7 бит на байт, старший бит = "будет еще байт" (как LEB128).
+ *  Кадр - это USB кадр (SOF, 1 мс). Время считается по регистру USB->FNR,
+ *  поэтому пропущенное прерывание SOF не сбивает отсчет.
+ *  Пока кнопки не меняются, ничего не пишется. Типичная запись - 2-3 байта,
+ *  так что даже изменение каждый кадр (1 кГц) дает ~3 Кбайт/с.
+ *
+ *  Воспроизведение: в прерывании SOF записи применяются в тот же кадр, в котором
+ *  были записаны, и уходят отчетом в USB через общую цепочку (SEGA_TAS_Filter),
+ *  с повтором в следующем кадре, если точка IN занята. Пока идет воспроизведение,
+ *  реальный геймпад игнорируется. Последнее состояние держится один кадр.
+ *
+ *  Сброс во Flash (необязательно): если запись запущена с командой
+ *  SEGA_TAS_CMD_RECORD_FLASH, то из главного цикла буфер понемногу переписывается
+ *  во Flash (SEGA_TAS_FLASH_START, SEGA_TAS_FLASH_PAGES страниц), только между
+ *  опросами геймпада. Страницы стираются заранее: после команды идет режим
+ *  SEGA_TAS_RECORD_ERASE, по одной странице за вызов SEGA_TAS_Process, тоже только
+ *  между опросами, а запись начинается после последней страницы (~0.6 с).
+ *  Данные, еще не сброшенные во Flash, остаются в RAM, и воспроизведение читает их оттуда.
+ *
+ *  Управление: OUT отчет USB_REPORT_ID_CONTROL, байт команды (SEGA_TAS_CMD_...).
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_TAS_H
+#define __SEGA_TAS_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_TAS_RAM_SIZE    4096 //Размер кольцевого буфера в RAM (степень двойки)
+#define SEGA_TAS_FLASH_START 0x08008000 //Начало области под запись во Flash
+#define SEGA_TAS_FLASH_PAGES 30 //Количество страниц по 1 Кбайт
+#define SEGA_TAS_FLASH_SIZE  (SEGA_TAS_FLASH_PAGES * 1024)
+#define SEGA_TAS_RECORD_MAX  8 //Максимальная длина одной записи: 5 байт кадров + 3 байта кнопок
+
+/*Команды*/
+#define SEGA_TAS_CMD_STOP         0 //Остановить запись/воспроизведение
+#define SEGA_TAS_CMD_RECORD       1 //Запись только в RAM
+#define SEGA_TAS_CMD_RECORD_FLASH 2 //Запись со сбросом во Flash
+#define SEGA_TAS_CMD_PLAY         3 //Воспроизведение последней записи
+
+/*Режимы*/
+#define SEGA_TAS_IDLE         0
+#define SEGA_TAS_RECORD       1
+#define SEGA_TAS_PLAY         2
+#define SEGA_TAS_RECORD_ERASE 3 //Стирание Flash перед записью (SEGA_TAS_CMD_RECORD_FLASH)
+
+void SEGA_TAS_Command(uint8_t cmd); //Команда управления (можно из прерывания)
+void SEGA_TAS_Process(void); //Обработка команд и сброс во Flash. Вызывать в главном цикле
+bool SEGA_TAS_Busy(void); //Есть несброшенные во Flash данные (главному циклу нельзя спать)
+uint16_t SEGA_TAS_Filter(uint16_t buttons); //Запись/подмена кнопок в конце опроса
+bool SEGA_TAS_SOF(void); //Отсчет кадров и воспроизведение (вызывается по SOF). true - нужен отчет
+uint8_t SEGA_TAS_Get_Mode(void); //Текущий режим
+bool SEGA_TAS_Overflow(void); //Запись остановлена из-за нехватки места
+
+#endif /* __SEGA_TAS_H */
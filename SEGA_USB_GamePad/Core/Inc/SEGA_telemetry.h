@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_telemetry.h
+ *  @brief Поток изменений кнопок с метками времени по USART1 (для захвата видео и замеров задержки)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  В конце каждого опроса геймпада (TIM3) новое значение Buttons сравнивается
+ *  с предыдущим. Если оно изменилось, в очередь кладется событие: время по счетчику
+ *  микросекунд CMSIS_Micros() (TIM4 + TIM1) и состояние кнопок. Больше в прерывании ничего
+ *  не делается, так что его время не зависит от загрузки линии.
+ *
+ *  Главный цикл (SEGA_Telemetry_Process) собирает накопившиеся события в один пакет
+ *  и отдает его DMA (CMSIS_USART_Transmit_DMA). Пока DMA занят, события ждут в очереди.
+ *
+ *  USART1: PA9 - TX, SEGA_TELEMETRY_BAUDRATE 8N1. Кадр:
+ *
+ * | Байт     | Назначение                                                       |
+ * | 0        | 0x5A - изменение, 0x5B - полное состояние                        |
+ * | 1..      | varint: мкс с прошлого кадра                                     |
+ * | ..       | varint: 0x5A - маска изменившихся битов, 0x5B - Buttons целиком  |
+ * | последний| CRC-8 (полином 0x07, начальное 0) всех предыдущих байт кадра     |
+ *
+ *  varint - 7 бит на байт, старший бит = "будет еще байт" (как в SEGA_tas.h).
+ *  Биты кнопок как в SEGA_gamepad.h. Типичный кадр - 5-6 байт.
+ *
+ *  Полное состояние отправляется первым кадром и после переполнения очереди,
+ *  после него ПК восстанавливает кнопки, складывая маски через XOR.
+ *  Если изменений нет дольше SEGA_TELEMETRY_KEEPALIVE_MS, уходит кадр 0x5A с нулевой
+ *  маской, чтоб ПК не терял отсчет времени (32-битный счетчик мкс переполняется через ~71,6 мин).
+ *
+ *  Пропускная способность: 1 кГц изменений * 6 байт = 6 Кбайт/с, на 921600 бод
+ *  линия занята примерно на 6,5%. Без потерь проходит до ~15 тыс. изменений в секунду,
+ *  дальше упирается в линию (замер - tools/test_telemetry). Очередь на
+ *  SEGA_TELEMETRY_QUEUE событий сглаживает пачки изменений.
+ *
+ *  Тот же поток можно дублировать в виртуальный COM-порт (SEGA_Telemetry_CDC,
+ *  команда "tm on", см. SEGA_cdc.h). Тогда следующий пакет собирается только
+ *  после того, как предыдущий ушел и по USART, и по USB.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_TELEMETRY_H
+#define __SEGA_TELEMETRY_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#ifndef SEGA_TELEMETRY
+#define SEGA_TELEMETRY 1 //1 - передавать поток изменений по USART1, 0 - выключено
+#endif
+#define SEGA_TELEMETRY_BAUDRATE     921600 //Скорость USART1, бод
+#define SEGA_TELEMETRY_QUEUE        64 //Размер очереди событий (степень двойки)
+#define SEGA_TELEMETRY_PACKET       128 //Размер пакета на одну отправку DMA, байт
+#define SEGA_TELEMETRY_FRAME_MAX    10 //Максимальная длина кадра: 1 + 5 + 3 + 1
+#define SEGA_TELEMETRY_KEEPALIVE_MS 10000 //Кадр без изменений, если долго было тихо
+
+/*Тип кадра*/
+#define SEGA_TELEMETRY_DELTA 0x5A //Маска изменившихся битов
+#define SEGA_TELEMETRY_STATE 0x5B //Полное состояние кнопок
+
+void SEGA_Telemetry_Init(void); //Настройка USART1, DMA и счетчика тактов
+void SEGA_Telemetry_Push(uint16_t buttons); //Новое значение Buttons (вызывается в конце опроса)
+void SEGA_Telemetry_Process(void); //Сборка и отправка кадров. Вызывать в главном цикле
+void SEGA_Telemetry_CDC(bool enable); //Дублировать поток в виртуальный COM-порт
+
+#endif /* __SEGA_TELEMETRY_H */
@@ -0,0 +1,59 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_turbo.h
+ *  @brief Турбо (автоматическое повторение нажатий) с привязкой к кадрам USB
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Турбо настраивается для каждого бита Buttons отдельно, настройками
+ *  SEGA_CONFIG_TURBO_0..6 (см. SEGA_config.h), по байту на бит: младший байт
+ *  SEGA_CONFIG_TURBO_0 - бит 0, старший - бит 1, и т.д. до бита 13.
+ *
+ * | Биты байта | Назначение                                                       |
+ * | 0-3        | частота, шаг SEGA_TURBO_RATE_STEP Гц (0 - турбо выключено)       |
+ * | 4-7        | фаза, шаг SEGA_TURBO_PHASE_STEP кадров                           |
+ *
+ *  Пример: турбо 10 Гц на A (бит 11) и 15 Гц на B (бит 10): SEGA_CONFIG_TURBO_5 (биты 10 и 11),
+ *  младший байт 0x03, старший 0x02 -> 0x0203 = 515, команда "cfg 11 515".
+ *
+ *  Время отсчитывается кадрами USB (SOF, 1 мс) по регистру USB->FNR, как в SEGA_tas.h.
+ *  Все частоты - целое число периодов за SEGA_TURBO_PERIOD кадров, поэтому вся картина
+ *  повторяется каждые SEGA_TURBO_PERIOD кадров и заранее раскладывается в таблицу:
+ *  элемент таблицы - биты кнопок, которые в этом кадре "нажаты". Переключения внутри
+ *  периода распределены равномерно (30 Гц = 17/16/17 мс), так что картина не плывет
+ *  относительно кадров. В кадре: одна выборка из таблицы и маски, для всех кнопок сразу.
+ *
+ *  Картина идет непрерывно от кадров USB, а не от момента нажатия: одинаковые настройки
+ *  дают одинаковую последовательность, и несколько кнопок с разной фазой не совпадают.
+ *
+ *  Каждое переключение уходит отдельным отчетом: в прерывании SOF, если турбо изменило
+ *  кнопки, отчет отправляется сразу, не дожидаясь опроса. Если точка IN занята,
+ *  отчет повторяется в следующем кадре. Наименьший полупериод (75 Гц) - 6 кадров,
+ *  так что переключение не может потеряться между двумя отчетами.
+ *
+ *  Таблицы пересчитываются только при изменении настроек (SEGA_Turbo_Process),
+ *  в запасную таблицу, как в SEGA_remap.h.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_TURBO_H
+#define __SEGA_TURBO_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_TURBO_BITS        14 //Бит в Buttons
+#define SEGA_TURBO_PERIOD      200 //Период всей картины, кадров (мс)
+#define SEGA_TURBO_RATE_STEP   (1000 / SEGA_TURBO_PERIOD) //Шаг частоты, Гц: 1 период за SEGA_TURBO_PERIOD
+#define SEGA_TURBO_PHASE_STEP  2 //Шаг фазы, кадров
+
+void SEGA_Turbo_Init(void); //Построение таблицы по настройкам. После SEGA_Config_Init
+void SEGA_Turbo_Process(void); //Пересчет таблицы при изменении настроек. Вызывать в главном цикле
+uint16_t SEGA_Turbo_Filter(uint16_t buttons); //Турбо для удерживаемых кнопок (в конце опроса)
+bool SEGA_Turbo_SOF(void); //Отсчет кадров. true - турбо переключило кнопки, нужен отчет
+
+#endif /* __SEGA_TURBO_H */
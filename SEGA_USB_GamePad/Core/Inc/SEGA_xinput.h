@@ -0,0 +1,83 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_xinput.h
+ *  @brief Режим XInput: геймпад представляется хосту проводным геймпадом Xbox 360
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Многие игры на ПК понимают только XInput, и без этого режима приходится ставить
+ *  программу-переводчик HID -> XInput, которая добавляет задержку. В режиме XInput
+ *  (SEGA_CONFIG_USB_MODE = SEGA_XINPUT_MODE, см. SEGA_keyboard.h) интерфейс 0 вместо HID
+ *  становится vendor интерфейсом проводного геймпада Xbox 360 (класс 0xFF, подкласс 0x5D,
+ *  протокол 0x01), а в дескрипторе устройства - VID/PID этого геймпада. Драйвер xpad
+ *  в Linux и драйвер XInput в Windows подхватывают его сами, без программ.
+ *  CDC (виртуальный COM-порт) остается, так что режим можно сменить обратно командой "cfg".
+ *
+ *  Точки: IN 0x81 (отчет 20 байт, интервал 1 мс), OUT 0x01 (вибрация и светодиоды,
+ *  принимаются и игнорируются), по 32 байта.
+ *
+ *  Отчет IN:
+ *
+ * | Байт  | Назначение                                                         |
+ * | 0     | тип сообщения, 0x00                                                |
+ * | 1     | длина, 0x14                                                        |
+ * | 2-3   | кнопки (SEGA_XINPUT_...)                                           |
+ * | 4     | левый курок, 0..255                                                |
+ * | 5     | правый курок, 0..255                                               |
+ * | 6-13  | стики LX, LY, RX, RY (int16), всегда 0                             |
+ * | 14-19 | резерв                                                             |
+ *
+ *  Кнопки:
+ *
+ * | SEGA  | XInput | SEGA  | XInput | SEGA  | XInput        |
+ * | UP    | UP     | A     | A      | X     | X             |
+ * | DOWN  | DOWN   | B     | B      | Y     | Y             |
+ * | LEFT  | LEFT   | C     | RB     | Z     | LB            |
+ * | RIGHT | RIGHT  | START | START  | MODE  | BACK          |
+ * | L     | LT     | R     | RT     |       |               |
+ *
+ *  Перевод из Buttons - две выборки из таблиц (для младших и старших 7 бит, как
+ *  в SEGA_remap.h) и два курка по битам L и R: одно и то же время на любое сочетание,
+ *  отчет - одна статическая структура, без выделения памяти.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SEGA_XINPUT_H
+#define __SEGA_XINPUT_H
+
+#include "SEGA_gamepad.h"
+
+/*Макросы*/
+#define SEGA_XINPUT_MODE     3 //Значение SEGA_CONFIG_USB_MODE
+#define SEGA_XINPUT_VID      0x045E //Проводной геймпад Xbox 360
+#define SEGA_XINPUT_PID      0x028E
+#define SEGA_XINPUT_BCD      0x0114 //bcdDevice
+#define SEGA_XINPUT_HALF     7 //Бит Buttons на одну таблицу
+#define SEGA_XINPUT_LUT_SIZE (1 << SEGA_XINPUT_HALF)
+
+/*Кнопки отчета XInput*/
+#define SEGA_XINPUT_UP     (1 << 0)
+#define SEGA_XINPUT_DOWN   (1 << 1)
+#define SEGA_XINPUT_LEFT   (1 << 2)
+#define SEGA_XINPUT_RIGHT  (1 << 3)
+#define SEGA_XINPUT_START  (1 << 4)
+#define SEGA_XINPUT_BACK   (1 << 5)
+#define SEGA_XINPUT_LS     (1 << 6)
+#define SEGA_XINPUT_RS     (1 << 7)
+#define SEGA_XINPUT_LB     (1 << 8)
+#define SEGA_XINPUT_RB     (1 << 9)
+#define SEGA_XINPUT_GUIDE  (1 << 10)
+#define SEGA_XINPUT_A      (1 << 12)
+#define SEGA_XINPUT_B      (1 << 13)
+#define SEGA_XINPUT_X      (1 << 14)
+#define SEGA_XINPUT_Y      (1 << 15)
+
+void SEGA_XInput_Init(void); //Включение режима XInput. До чтения дескрипторов хостом
+bool SEGA_XInput_Active(void); //Устройство подключено как XInput
+bool SEGA_XInput_Send(uint16_t buttons); //Отчет XInput. true - принят в точку IN
+
+#endif /* __SEGA_XINPUT_H */
@@ -9,12 +9,55 @@ extern "C" {
 #include "stm32f1xx_hal.h"
 #include <stm32f103xx_CMSIS.h>
 
+#define USB_REPORT_ID_GAMEPAD 1 //Report ID геймпада
+#define USB_REPORT_ID_MOUSE   2 //Report ID мыши
+#define USB_REPORT_ID_CONTROL 3 //Report ID управления (OUT, 1 байт команды)
+#define USB_REPORT_ID_INJECT  4 //Report ID подачи нажатий с ПК (OUT - посылки, IN - credits)
+
 	typedef struct __attribute__((packed)) {
-		int8_t x;
+		uint8_t report_id;
+		int8_t x; //Крестовина осями: -128 - LEFT/UP, 127 - RIGHT/DOWN, 0 - отпущена
 		int8_t y;
-		uint8_t buttons;
+		uint8_t hat; //Она же положением (hat): биты 0-3, 0..7 по часовой от UP, 8 - отпущена
+		uint16_t buttons;
+		uint8_t seq; //Номер и возраст отчета - только в режиме SEGA_STAMP_MODE (см. SEGA_stamp.h)
+		uint16_t age;
 	}USB_Custom_HID_Gamepad;
 
+	typedef struct __attribute__((packed)) {
+		uint8_t report_id;
+		uint8_t buttons;
+		int8_t x;
+		int8_t y;
+	}USB_Custom_HID_Mouse;
+
+	typedef struct __attribute__((packed)) {
+		uint8_t report_id;
+		uint8_t credits;
+		uint8_t seq;
+		uint8_t underrun;
+		uint8_t overrun;
+	}USB_Custom_HID_Inject;
+
+	typedef struct __attribute__((packed)) {
+		uint8_t modifiers; //Биты клавиш L Ctrl..R GUI
+		uint8_t reserved;
+		uint8_t keys[6]; //Нажатые клавиши, 0 - место свободно
+	}USB_Custom_HID_Keyboard;
+
+	typedef struct __attribute__((packed)) {
+		uint8_t type; //Тип сообщения, 0x00 - состояние кнопок
+		uint8_t size; //Длина отчета, 0x14
+		uint16_t buttons;
+		uint8_t lt; //Курки 0..255
+		uint8_t rt;
+		int16_t lx; //Стики
+		int16_t ly;
+		int16_t rx;
+		int16_t ry;
+		uint8_t reserved[6];
+	}USB_XInput_Gamepad;
+
 #ifdef __cplusplus
 }
 #endif
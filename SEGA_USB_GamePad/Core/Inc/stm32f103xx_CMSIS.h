@@ -39,11 +39,100 @@ extern "C" {
 		uint16_t rx_len; //Количество принятых байт после сработки флага IDLE
 	};
 
+	//Программный таймер (см. CMSIS_Timer_Start)
+	struct CMSIS_Timer_name {
+		uint32_t deadline; //Время срабатывания по CMSIS_Micros
+		uint32_t period; //Период повторения, мкс. 0 - однократно
+		void (*Callback)(struct CMSIS_Timer_name* timer); //Вызывается из прерывания TIM4. Может быть NULL
+		struct CMSIS_Timer_name* next; //Следующий в списке запущенных
+		volatile bool active; //Таймер запущен
+	};
+
+#define USART_DMA_TX_QUEUE 8 //Количество кадров в очереди на передачу по DMA (степень двойки)
+
+	//Структура по передаче USART через DMA
+	struct USART_DMA_TX_name {
+		USART_TypeDef* USART;
+		DMA_Channel_TypeDef* Channel; //Канал DMA1 на передачу
+		uint8_t Channel_number; //Номер канала DMA1 (для флагов и прерывания)
+		const uint8_t* frame_data[USART_DMA_TX_QUEUE]; //Кадры в очереди
+		uint16_t frame_size[USART_DMA_TX_QUEUE];
+		volatile uint8_t head; //Сюда кладем следующий кадр
+		volatile uint8_t tail; //Этот кадр сейчас передается
+		volatile bool busy; //DMA занят
+	};
+
+	extern struct USART_DMA_TX_name husart1_dma_tx;
+	extern struct USART_DMA_TX_name husart2_dma_tx;
+
+#define USART_DMA_RX_SIZE 256 //Размер кольцевого буфера приема по DMA
+
+	//Структура по приему USART через DMA
+	struct USART_DMA_RX_name {
+		USART_TypeDef* USART;
+		DMA_Channel_TypeDef* Channel; //Канал DMA1 на прием
+		uint8_t Channel_number; //Номер канала DMA1 (для флагов и прерывания)
+		bool active; //Прием идет через DMA
+		uint8_t buffer[USART_DMA_RX_SIZE]; //Кольцевой буфер, в него пишет DMA
+		uint16_t read_pos; //До сюда данные уже отданы в Callback
+		void (*Callback)(const uint8_t* data, uint16_t Size, bool Frame_end); //Получатель данных
+	};
+
+	extern struct USART_DMA_RX_name husart1_dma_rx;
+	extern struct USART_DMA_RX_name husart2_dma_rx;
+
+#define I2C_ASYNC_QUEUE      8 //Количество транзакций в очереди I2C1 (степень двойки)
+#define I2C_ASYNC_TIMEOUT_MS 10 //Транзакция без продвижения дольше этого считается зависшей
+
+	/*Статус асинхронной транзакции I2C*/
+#define I2C_ASYNC_PENDING 0 //В очереди или выполняется
+#define I2C_ASYNC_OK      1 //Выполнена
+#define I2C_ASYNC_NACK    2 //Устройство не ответило
+#define I2C_ASYNC_ERROR   3 //Ошибка шины, арбитража, DMA или таймаут
+
+	//Структура асинхронной транзакции I2C
+	struct I2C_Transaction_name {
+		uint8_t Adress_Device; //7-битный адрес устройства
+		uint16_t Adress_data; //Адрес памяти (регистра) внутри устройства
+		uint8_t Size_adress; //Размер адреса памяти: 0 - без адреса, 1 или 2 байта
+		bool Read; //true - чтение, false - запись
+		uint8_t* data; //Данные. Не менять до окончания транзакции
+		uint16_t Size_data; //Сколько байт передать/принять
+		void (*Callback)(struct I2C_Transaction_name* transaction); //Вызывается по окончании (из прерывания)
+		volatile uint8_t Status; //I2C_ASYNC_...
+	};
+
+#define SPI_DMA_QUEUE 8 //Количество транзакций в очереди SPI1 (степень двойки)
+
+	/*Статус транзакции SPI*/
+#define SPI_DMA_PENDING 0 //В очереди или выполняется
+#define SPI_DMA_OK      1 //Выполнена
+#define SPI_DMA_ERROR   2 //Ошибка DMA
+
+	//Структура транзакции SPI через DMA
+	struct SPI_Transaction_name {
+		GPIO_TypeDef* GPIO; //Порт ножки NSS
+		uint8_t NSS_pin; //Номер ножки NSS
+		bool NSS_logic; //Уровень NSS, при котором ведомый выбран
+		const uint8_t* tx_data; //Данные на передачу. NULL - передавать 0xFF (только прием)
+		uint8_t* rx_data; //Буфер приема. NULL - принятое не нужно
+		uint16_t Size_data; //Сколько байт
+		void (*Callback)(struct SPI_Transaction_name* transaction); //Вызывается по окончании (из прерывания)
+		volatile uint8_t Status; //SPI_DMA_...
+	};
+
 	void CMSIS_Debug_init(void); //Настройка Debug (Serial Wire)
+	void CMSIS_RCC_HSE_Start(void); //Ранний запуск HSE без ожидания готовности
 	void CMSIS_RCC_SystemClock_72MHz(void); //Настрока тактирования микроконтроллера на частоту 72MHz
 	void CMSIS_SysTick_Timer_init(void); //Инициализация системного таймера
-	void Delay_ms(uint32_t Milliseconds); //Функция задержки
+	void Delay_ms(uint32_t Milliseconds); //Функция задержки (ядро спит в WFI)
+	void Delay_us(uint32_t Microseconds); //Функция задержки в микросекундах (ядро спит в WFI)
 	void SysTick_Handler(void); //Прерывания от системного таймера
+	void CMSIS_Timebase_Init(void); //Счетчик микросекунд на TIM4 + TIM1
+	uint32_t CMSIS_Micros(void); //Время в микросекундах
+	uint32_t CMSIS_Millis(void); //Время в миллисекундах (аналог HAL_GetTick())
+	void CMSIS_Timer_Start(struct CMSIS_Timer_name* timer, uint32_t Delay_us, uint32_t Period_us); //Запуск программного таймера
+	void CMSIS_Timer_Stop(struct CMSIS_Timer_name* timer); //Остановка программного таймера
 	void CMSIS_PC13_OUTPUT_Push_Pull_init(void); //Пример настройки ножки PC13 в режим Push-Pull 50 MHz
 	void CMSIS_Blink_PC13(uint32_t ms); //Обычный blink
 	void CMSIS_PA8_MCO_init(void); //Пример настройки ножки PA8 в выход тактирующего сигнала c MCO
@@ -64,6 +153,11 @@ extern "C" {
 	void CMSIS_USART2_Init(void); //Инициализация USART2
 	bool CMSIS_USART_Transmit(USART_TypeDef* USART, uint8_t* data, uint16_t Size, uint32_t Timeout_ms); //Отправка данных по USART
 	void USART1_IRQHandler(void); //Прерывание по USART1
+	void CMSIS_USART_Set_Baudrate(USART_TypeDef* USART, uint32_t Baudrate); //Установка скорости USART
+	void CMSIS_USART_DMA_TX_Init(struct USART_DMA_TX_name* husart_dma); //Настройка передачи USART через DMA
+	bool CMSIS_USART_Transmit_DMA(struct USART_DMA_TX_name* husart_dma, const uint8_t* data, uint16_t Size); //Отправка кадра без ожидания (без копирования)
+	bool CMSIS_USART_DMA_TX_Busy(struct USART_DMA_TX_name* husart_dma); //Есть ли неотправленные кадры
+	void CMSIS_USART_DMA_RX_Init(struct USART_DMA_RX_name* husart_dma, void (*Callback)(const uint8_t* data, uint16_t Size, bool Frame_end)); //Настройка приема USART через DMA
 	void CMSIS_I2C_Reset(void); //Сброс настроек I2C
 	void CMSIS_I2C1_Init(void); //Функция инициализации шины I2C1. Sm.
 	bool CMSIS_I2C_Adress_Device_Scan(I2C_TypeDef* I2C, uint8_t Adress_Device, uint32_t Timeout_ms); //Функция сканирования устройства по заданному 7-битному адресу
@@ -71,6 +165,10 @@ extern "C" {
 	bool CMSIS_I2C_Data_Receive(I2C_TypeDef* I2C, uint8_t Adress_Device, uint8_t* data, uint16_t Size_data, uint32_t Timeout_ms); //Функция приема данных по I2C
 	bool CMSIS_I2C_MemWrite(I2C_TypeDef* I2C, uint8_t Adress_Device, uint16_t Adress_data, uint8_t Size_adress, uint8_t* data, uint16_t Size_data, uint32_t Timeout_ms); //Функция записи в память по указанному адресу
 	bool CMSIS_I2C_MemRead(I2C_TypeDef* I2C, uint8_t Adress_Device, uint16_t Adress_data, uint8_t Size_adress, uint8_t* data, uint16_t Size_data, uint32_t Timeout_ms); //Функция чтения из памяти по указанному адресу
+	void CMSIS_I2C1_Async_Init(void); //Настройка асинхронного обмена по I2C1 (прерывания + DMA)
+	bool CMSIS_I2C1_Async_Submit(struct I2C_Transaction_name* transaction); //Постановка транзакции в очередь
+	bool CMSIS_I2C1_Async_Busy(void); //Есть ли невыполненные транзакции
+	void CMSIS_I2C1_Async_Poll(void); //Таймаут, восстановление шины, следующая транзакция. Вызывать в главном цикле
 	void CMSIS_SPI1_init(void); //Инициализация SPI1
 	bool CMSIS_SPI_Data_Transmit_8BIT(SPI_TypeDef* SPI, uint8_t* data, uint16_t Size_data, uint32_t Timeout_ms); //Функция отправки данных по SPI
 	bool CMSIS_SPI_Data_Transmit_16BIT(SPI_TypeDef* SPI, uint16_t* data, uint16_t Size_data, uint32_t Timeout_ms); //Функция отправки данных по SPI
@@ -78,6 +176,15 @@ extern "C" {
 	bool CMSIS_SPI_Data_Receive_16BIT(SPI_TypeDef* SPI, uint16_t* data, uint16_t Size_data, uint32_t Timeout_ms); //Функция приема данных по SPI
 	bool CMSIS_SPI_Data_Transmit_fast(SPI_TypeDef* SPI, GPIO_TypeDef* GPIO, uint8_t NSS_pin, bool NSS_logic, uint8_t* data, uint16_t Size_data, uint32_t Timeout_ms); //Функция передачи данных по SPI(быстрая. CS уже включен в нее)
 	bool CMSIS_SPI_Data_Receive_fast(SPI_TypeDef* SPI, GPIO_TypeDef* GPIO, uint8_t NSS_pin, bool NSS_logic, uint8_t* data, uint16_t Size_data, uint32_t Timeout_ms); //Функция приема данных по SPI(быстрая. CS уже включен в нее)
+	void CMSIS_SPI1_DMA_Init(void); //Настройка обмена по SPI1 через DMA
+	bool CMSIS_SPI1_DMA_Submit(struct SPI_Transaction_name* transaction); //Постановка транзакции в очередь
+	bool CMSIS_SPI1_DMA_Busy(void); //Есть ли невыполненные транзакции
+	bool CMSIS_SPI1_DMA_Stream_Start(GPIO_TypeDef* GPIO, uint8_t NSS_pin, bool NSS_logic, uint8_t* buffer, uint16_t Size_half, void (*Callback)(uint8_t* half)); //Поточная передача (двойной буфер)
+	void CMSIS_SPI1_DMA_Stream_Stop(void); //Остановка поточной передачи
+	void CMSIS_FLASH_Unlock(void); //Разблокировка записи во Flash
+	void CMSIS_FLASH_Lock(void); //Блокировка записи во Flash
+	bool CMSIS_FLASH_Page_Erase(uint32_t Adress); //Стирание страницы Flash
+	bool CMSIS_FLASH_Program_HalfWord(uint32_t Adress, uint16_t Data); //Запись полуслова во Flash
 #ifdef __cplusplus
 }
 #endif
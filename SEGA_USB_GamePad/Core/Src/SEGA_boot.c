@@ -0,0 +1,61 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_boot.c
+ *  @brief Быстрый старт и журнал времени загрузки
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Порядок старта и этапы журнала см. в SEGA_boot.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_boot.h"
+
+struct SEGA_Boot_Trace_name SEGA_Boot_trace;
+
+static uint32_t Boot_base_cycles; //CYCCNT на момент смены частоты
+static uint32_t Boot_base_us; //Время на момент смены частоты, мкс
+static uint8_t Boot_mhz = 8; //Частота ядра, МГц: HSI до SEGA_BOOT_CLOCK, PLL после
+
+/**
+ ***************************************************************************************
+ *  @breif Запуск отсчета времени по DWT CYCCNT. Первой строкой в main.
+ ***************************************************************************************
+ */
+void SEGA_Boot_Init(void) {
+    SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
+    DWT->CYCCNT = 0;
+    SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+    SEGA_Boot_Mark(SEGA_BOOT_MAIN);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Отметка этапа загрузки. Можно из прерывания.
+ *  @param  stage - SEGA_BOOT_...
+ ***************************************************************************************
+ */
+void SEGA_Boot_Mark(uint8_t stage) {
+    uint32_t primask;
+    uint32_t cycles;
+
+    if (READ_BIT(SEGA_Boot_trace.done, 1UL << stage)) {
+        return; //Этап уже пройден. Обычный путь после загрузки
+    }
+    primask = __get_PRIMASK();
+    __disable_irq();
+    cycles = DWT->CYCCNT;
+    SEGA_Boot_trace.us[stage] = Boot_base_us + (cycles - Boot_base_cycles) / Boot_mhz;
+    SET_BIT(SEGA_Boot_trace.done, 1UL << stage);
+    if (stage == SEGA_BOOT_CLOCK) {
+        //Дальше такты идут в 9 раз чаще
+        Boot_base_cycles = cycles;
+        Boot_base_us = SEGA_Boot_trace.us[stage];
+        Boot_mhz = 72;
+    }
+    __set_PRIMASK(primask);
+}
@@ -0,0 +1,282 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_cdc.c
+ *  @brief Диагностика и настройка через виртуальный COM-порт (CDC-ACM)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Список команд см. в SEGA_cdc.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_cdc.h"
+#include "SEGA_tas.h"
+#include "SEGA_telemetry.h"
+#include "SEGA_boot.h"
+#include "SEGA_config.h"
+#include "SEGA_macro.h"
+#include "usbd_cdc_acm.h"
+#include <string.h>
+
+#if USBD_CDC_ACM
+
+extern uint16_t Buttons;
+
+static char CDC_line[SEGA_CDC_LINE_SIZE]; //Собираемая команда
+static uint8_t CDC_line_len;
+static bool CDC_line_overflow; //Строка длиннее буфера, будет ответ ERR
+static uint8_t CDC_reply[SEGA_CDC_REPLY_SIZE]; //Буфер передачи. Меняется только когда передача закончена
+static uint8_t CDC_reply_len; //Ответ ждет отправки
+
+/**
+ ***************************************************************************************
+ *  @breif Добавить строку к ответу
+ ***************************************************************************************
+ */
+static void SEGA_CDC_Put(const char *str) {
+    while (*str && CDC_reply_len < SEGA_CDC_REPLY_SIZE) {
+        CDC_reply[CDC_reply_len++] = (uint8_t)*str++;
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Добавить число к ответу
+ *  @param  value - число
+ *  @param  hex - true: 4 шестнадцатеричные цифры, false: десятичное
+ ***************************************************************************************
+ */
+static void SEGA_CDC_Put_Number(uint32_t value, bool hex) {
+    char buf[11];
+    uint8_t n = sizeof(buf) - 1;
+
+    buf[n] = 0;
+    if (hex) {
+        for (uint8_t i = 0; i < 4; i++) {
+            buf[--n] = "0123456789ABCDEF"[value & 0xF];
+            value >>= 4;
+        }
+    }
+    else {
+        do {
+            buf[--n] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value);
+    }
+    SEGA_CDC_Put(&buf[n]);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Чтение десятичного числа из команды
+ *  @param  **str - текущая позиция, сдвигается за число
+ *  @param  *value - прочитанное число
+ *  @retval false - на текущей позиции нет числа или оно больше 65535
+ ***************************************************************************************
+ */
+static bool SEGA_CDC_Get_Number(const char **str, uint16_t *value) {
+    uint32_t result = 0;
+    const char *p = *str;
+
+    if (*p < '0' || *p > '9') {
+        return false;
+    }
+    while (*p >= '0' && *p <= '9') {
+        result = result * 10 + (uint32_t)(*p++ - '0');
+        if (result > 0xFFFF) {
+            return false;
+        }
+    }
+    *value = (uint16_t)result;
+    *str = p;
+    return true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Команда "cfg <ключ>" - чтение, "cfg <ключ> <значение>" - запись настройки
+ *  @retval false - ошибка в команде
+ ***************************************************************************************
+ */
+static bool SEGA_CDC_Config(const char *args) {
+    uint16_t key, value;
+
+    if (!SEGA_CDC_Get_Number(&args, &key) || key >= SEGA_CONFIG_KEYS) {
+        return false;
+    }
+    if (!*args) {
+        SEGA_CDC_Put_Number(SEGA_Config_Get((uint8_t)key), false);
+        SEGA_CDC_Put("\r\n");
+        return true;
+    }
+    if (*args++ != ' ' || !SEGA_CDC_Get_Number(&args, &value) || *args) {
+        return false;
+    }
+    SEGA_Config_Set((uint8_t)key, value);
+    SEGA_CDC_Put("OK\r\n");
+    return true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Команда "macro <номер> <сочетание> <байт-код hex>" - запись макроса (см. SEGA_macro.h)
+ *  @retval false - ошибка в команде
+ ***************************************************************************************
+ */
+static bool SEGA_CDC_Macro(const char *args) {
+    uint8_t code[SEGA_MACRO_CODE_SIZE] = { 0 };
+    uint16_t index, chord;
+    uint8_t size = 0, digit;
+    uint8_t key;
+
+    if (!SEGA_CDC_Get_Number(&args, &index) || index >= SEGA_MACRO_COUNT || *args++ != ' ') {
+        return false;
+    }
+    if (!SEGA_CDC_Get_Number(&args, &chord)) {
+        return false;
+    }
+    if (*args == ' ') {
+        args++;
+    }
+    for (; *args; args++) {
+        if (*args >= '0' && *args <= '9') digit = *args - '0';
+        else if (*args >= 'A' && *args <= 'F') digit = *args - 'A' + 10;
+        else if (*args >= 'a' && *args <= 'f') digit = *args - 'a' + 10;
+        else return false;
+        if (size / 2 >= SEGA_MACRO_CODE_SIZE) {
+            return false;
+        }
+        code[size / 2] = (uint8_t)(code[size / 2] << 4) | digit;
+        size++;
+    }
+    if (size % 2) {
+        return false;
+    }
+
+    key = SEGA_CONFIG_MACRO_0 + index * SEGA_MACRO_KEYS;
+    SEGA_Config_Set(key, 0); //Пока байт-код меняется, макрос выключен
+    for (uint8_t i = 0; i < SEGA_MACRO_CODE_SIZE; i += 2) {
+        SEGA_Config_Set(key + 1 + i / 2, code[i] | (code[i + 1] << 8));
+    }
+    SEGA_Config_Set(key, chord);
+    SEGA_CDC_Put("OK\r\n");
+    return true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Выполнение команды
+ *  @retval true - команда известна
+ ***************************************************************************************
+ */
+static bool SEGA_CDC_Execute(const char *cmd) {
+    if (!strcmp(cmd, "stat")) {
+        SEGA_CDC_Put("proto=");
+        SEGA_CDC_Put_Number(SEGA_PROTOCOL, false);
+        SEGA_CDC_Put(" tas=");
+        SEGA_CDC_Put_Number(SEGA_TAS_Get_Mode(), false);
+        SEGA_CDC_Put(" ovf=");
+        SEGA_CDC_Put_Number(SEGA_TAS_Overflow(), false);
+        SEGA_CDC_Put(" btn=");
+        SEGA_CDC_Put_Number(Buttons, true);
+        SEGA_CDC_Put("\r\n");
+        return true;
+    }
+    if (!strncmp(cmd, "cfg ", 4)) {
+        return SEGA_CDC_Config(cmd + 4);
+    }
+    if (!strncmp(cmd, "macro ", 6)) {
+        return SEGA_CDC_Macro(cmd + 6);
+    }
+    if (!strcmp(cmd, "boot")) {
+        //Время этапов загрузки в мкс, "-" - этап не пройден
+        for (uint8_t i = 0; i < SEGA_BOOT_STAGES; i++) {
+            SEGA_CDC_Put(i ? " " : "");
+            if (READ_BIT(SEGA_Boot_trace.done, 1UL << i)) {
+                SEGA_CDC_Put_Number(SEGA_Boot_trace.us[i], false);
+            }
+            else {
+                SEGA_CDC_Put("-");
+            }
+        }
+        SEGA_CDC_Put("\r\n");
+        return true;
+    }
+    if (!strcmp(cmd, "tas stop")) {
+        SEGA_TAS_Command(SEGA_TAS_CMD_STOP);
+    }
+    else if (!strcmp(cmd, "tas rec")) {
+        SEGA_TAS_Command(SEGA_TAS_CMD_RECORD);
+    }
+    else if (!strcmp(cmd, "tas flash")) {
+        SEGA_TAS_Command(SEGA_TAS_CMD_RECORD_FLASH);
+    }
+    else if (!strcmp(cmd, "tas play")) {
+        SEGA_TAS_Command(SEGA_TAS_CMD_PLAY);
+    }
+    else if (!strcmp(cmd, "tm on") && SEGA_TELEMETRY) {
+        SEGA_Telemetry_CDC(true);
+    }
+    else if (!strcmp(cmd, "tm off") && SEGA_TELEMETRY) {
+        SEGA_Telemetry_CDC(false);
+    }
+    else {
+        return false;
+    }
+    SEGA_CDC_Put("OK\r\n");
+    return true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Разбор команд из COM-порта. Вызывать в главном цикле.
+ ***************************************************************************************
+ */
+void SEGA_CDC_Process(void) {
+    uint8_t data;
+
+    if (USBD_CDC_ACM_Busy()) {
+        return; //Точка CDC IN занята (ответ или поток телеметрии)
+    }
+    if (CDC_reply_len) {
+        //Ответ ждет, пока освободятся точки CDC и HID
+        if (USBD_CDC_ACM_Transmit(CDC_reply, CDC_reply_len) == USBD_BUSY) {
+            return;
+        }
+        CDC_reply_len = 0; //Ответ ушел (или USB не подключен - тогда выбрасываем)
+        return;
+    }
+
+    while (USBD_CDC_ACM_Read(&data, 1)) {
+        if (data != '\r' && data != '\n') {
+            if (CDC_line_len < SEGA_CDC_LINE_SIZE - 1) {
+                CDC_line[CDC_line_len++] = (char)data;
+            }
+            else {
+                CDC_line_overflow = true;
+            }
+            continue;
+        }
+        if (!CDC_line_len && !CDC_line_overflow) {
+            continue; //Пустая строка или вторая половина "\r\n"
+        }
+        CDC_line[CDC_line_len] = 0;
+        if (CDC_line_overflow || !SEGA_CDC_Execute(CDC_line)) {
+            SEGA_CDC_Put("ERR\r\n");
+        }
+        CDC_line_len = 0;
+        CDC_line_overflow = false;
+        return; //Сначала отправим ответ
+    }
+}
+
+#else
+
+void SEGA_CDC_Process(void) {
+}
+
+#endif /* USBD_CDC_ACM */
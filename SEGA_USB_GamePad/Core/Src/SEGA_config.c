@@ -0,0 +1,338 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_config.c
+ *  @brief Настройки во Flash (эмуляция EEPROM на двух страницах)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат страниц и записей см. в SEGA_config.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_config.h"
+
+/*Статус страницы*/
+#define CONFIG_PAGE_ERASED  0xFFFF
+#define CONFIG_PAGE_RECEIVE 0xEEEE
+#define CONFIG_PAGE_VALID   0x0000
+
+#define CONFIG_HEADER_SIZE 8 //Заголовок страницы
+#define CONFIG_RECORD_SIZE 4 //Запись: ключ + CRC, значение
+
+/*Шаги переноса на запасную страницу*/
+#define CONFIG_IDLE  0 //Изменения пишутся в активную страницу
+#define CONFIG_ERASE 1 //Стирание запасной страницы
+#define CONFIG_COPY  2 //Перенос последних значений
+
+/*Значения по умолчанию (пока ключ ни разу не записан)*/
+static const uint16_t Config_default[SEGA_CONFIG_KEYS] = {
+    [SEGA_CONFIG_POLL_HZ] = 240,
+    [SEGA_CONFIG_REMAP_0] = 0x3210, //Без переназначения: каждая кнопка на своем месте
+    [SEGA_CONFIG_REMAP_1] = 0x7654,
+    [SEGA_CONFIG_REMAP_2] = 0xBA98,
+    [SEGA_CONFIG_REMAP_3] = 0xFFDC,
+};
+
+static uint16_t Config_value[SEGA_CONFIG_KEYS]; //Копия настроек в RAM
+static uint64_t Config_stored; //Биты ключей, которые есть во Flash
+static volatile uint64_t Config_dirty; //Биты ключей, которые нужно записать во Flash
+static volatile uint32_t Config_version; //Растет при каждом изменении настроек
+
+static uint32_t Config_page; //Адрес активной страницы
+static uint16_t Config_gen; //Поколение активной страницы
+static uint32_t Config_free; //Смещение первой свободной записи в активной странице
+static uint8_t Config_step = CONFIG_IDLE;
+static uint8_t Config_copy_key; //Перенос: следующий ключ
+static uint32_t Config_copy_free; //Перенос: смещение следующей записи на запасной странице
+static bool Config_flash_locked; //Flash была заблокирована до начала операции
+
+/**
+ ***************************************************************************************
+ *  @breif Чтение полуслова из Flash
+ ***************************************************************************************
+ */
+static inline uint16_t SEGA_Config_Read(uint32_t adress) {
+    return *(const volatile uint16_t *)adress;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif CRC-8 записи (полином 0x07, начальное значение 0, как в SEGA_telemetry.c)
+ ***************************************************************************************
+ */
+static uint8_t SEGA_Config_CRC8(uint8_t key, uint16_t value) {
+    uint8_t data[3] = { key, (uint8_t)value, (uint8_t)(value >> 8) };
+    uint8_t crc = 0;
+
+    for (uint8_t i = 0; i < sizeof(data); i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Страница активная и ее заголовок цел
+ ***************************************************************************************
+ */
+static bool SEGA_Config_Page_Valid(uint32_t page) {
+    return SEGA_Config_Read(page) == CONFIG_PAGE_VALID
+        && (uint16_t)(SEGA_Config_Read(page + 2) ^ SEGA_Config_Read(page + 4)) == 0xFFFF;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запасная страница
+ ***************************************************************************************
+ */
+static inline uint32_t SEGA_Config_Spare(void) {
+    return (Config_page == SEGA_CONFIG_PAGE_A) ? SEGA_CONFIG_PAGE_B : SEGA_CONFIG_PAGE_A;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Загрузка настроек из Flash в RAM. Вызывать при старте, до использования настроек.
+ *  @attention Flash только читается, так что можно еще на HSI, пока запускается кварц.
+ ***************************************************************************************
+ */
+void SEGA_Config_Init(void) {
+    bool valid_a = SEGA_Config_Page_Valid(SEGA_CONFIG_PAGE_A);
+    bool valid_b = SEGA_Config_Page_Valid(SEGA_CONFIG_PAGE_B);
+    uint16_t header, value;
+    uint8_t key;
+
+    for (key = 0; key < SEGA_CONFIG_KEYS; key++) {
+        Config_value[key] = Config_default[key];
+    }
+
+    if (valid_a && valid_b) {
+        //Перенос закончился, но старая страница еще не стерта: берем более новую
+        Config_page = ((int16_t)(SEGA_Config_Read(SEGA_CONFIG_PAGE_B + 2) - SEGA_Config_Read(SEGA_CONFIG_PAGE_A + 2)) > 0) ? SEGA_CONFIG_PAGE_B : SEGA_CONFIG_PAGE_A;
+    }
+    else if (valid_a || valid_b) {
+        Config_page = valid_a ? SEGA_CONFIG_PAGE_A : SEGA_CONFIG_PAGE_B;
+    }
+    else {
+        //Настройки ни разу не записывались. Первая запись начнется с переноса
+        Config_page = SEGA_CONFIG_PAGE_B;
+        Config_gen = 0;
+        Config_free = SEGA_CONFIG_PAGE_SIZE;
+        return;
+    }
+    Config_gen = SEGA_Config_Read(Config_page + 2);
+
+    for (Config_free = CONFIG_HEADER_SIZE; Config_free < SEGA_CONFIG_PAGE_SIZE; Config_free += CONFIG_RECORD_SIZE) {
+        header = SEGA_Config_Read(Config_page + Config_free);
+        value = SEGA_Config_Read(Config_page + Config_free + 2);
+        if (header == 0xFFFF && value == 0xFFFF) {
+            break; //Дальше пусто
+        }
+        key = header >> 8;
+        if (key < SEGA_CONFIG_KEYS && (uint8_t)header == SEGA_Config_CRC8(key, value)) {
+            Config_value[key] = value;
+            Config_stored |= 1ULL << key;
+        }
+        //Недописанная запись занимает место, но не учитывается
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Значение настройки
+ *  @param  key - SEGA_CONFIG_...
+ ***************************************************************************************
+ */
+uint16_t SEGA_Config_Get(uint8_t key) {
+    return (key < SEGA_CONFIG_KEYS) ? Config_value[key] : 0;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Счетчик изменений настроек. Модули сравнивают его с запомненным,
+ *  чтоб пересчитать свои таблицы только когда что-то поменялось.
+ ***************************************************************************************
+ */
+uint32_t SEGA_Config_Version(void) {
+    return Config_version;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Новое значение настройки. Во Flash уйдет из главного цикла (SEGA_Config_Process).
+ *  @param  key - SEGA_CONFIG_...
+ *  @param  value - значение
+ *  @retval false - нет такого ключа
+ ***************************************************************************************
+ */
+bool SEGA_Config_Set(uint8_t key, uint16_t value) {
+    if (key >= SEGA_CONFIG_KEYS) {
+        return false;
+    }
+    __disable_irq();
+    if (Config_value[key] != value) {
+        Config_value[key] = value;
+        Config_dirty |= 1ULL << key;
+        Config_version++;
+    }
+    __enable_irq();
+    return true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Начало операции с Flash: только если сейчас не идет опрос геймпада.
+ *  @retval true - можно писать/стирать, прерывания запрещены до SEGA_Config_Flash_End
+ ***************************************************************************************
+ */
+static bool SEGA_Config_Flash_Begin(void) {
+    __disable_irq();
+    if (READ_BIT(TIM3->CR1, TIM_CR1_CEN)) {
+        __enable_irq();
+        return false; //Идут стробы SELECT, подождем конца опроса
+    }
+    Config_flash_locked = READ_BIT(FLASH->CR, FLASH_CR_LOCK);
+    CMSIS_FLASH_Unlock();
+    return true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Конец операции с Flash. Блокировка возвращается как была (Flash может писать SEGA_tas)
+ ***************************************************************************************
+ */
+static void SEGA_Config_Flash_End(void) {
+    if (Config_flash_locked) {
+        CMSIS_FLASH_Lock();
+    }
+    __enable_irq();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запись ключа: сначала значение, потом заголовок с CRC
+ *  @retval false - ошибка записи
+ ***************************************************************************************
+ */
+static bool SEGA_Config_Write(uint32_t adress, uint8_t key) {
+    uint16_t value = Config_value[key];
+
+    if (!CMSIS_FLASH_Program_HalfWord(adress + 2, value)
+        || !CMSIS_FLASH_Program_HalfWord(adress, (uint16_t)(key << 8) | SEGA_Config_CRC8(key, value))) {
+        Config_dirty |= 1ULL << key; //Повторим в следующий раз
+        return false;
+    }
+    Config_dirty &= ~(1ULL << key);
+    Config_stored |= 1ULL << key;
+    return true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запасная страница уже стерта
+ ***************************************************************************************
+ */
+static bool SEGA_Config_Spare_Blank(void) {
+    const uint32_t *data = (const uint32_t *)SEGA_Config_Spare();
+
+    for (uint32_t i = 0; i < SEGA_CONFIG_PAGE_SIZE / 4; i++) {
+        if (data[i] != 0xFFFFFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Один шаг переноса на запасную страницу
+ ***************************************************************************************
+ */
+static void SEGA_Config_Transfer(void) {
+    uint32_t spare = SEGA_Config_Spare();
+
+    switch (Config_step) {
+    case CONFIG_ERASE:
+        if (!SEGA_Config_Spare_Blank() && !CMSIS_FLASH_Page_Erase(spare)) {
+            break; //Повторим в следующий раз
+        }
+        if (CMSIS_FLASH_Program_HalfWord(spare + 2, (uint16_t)(Config_gen + 1))
+            && CMSIS_FLASH_Program_HalfWord(spare + 4, (uint16_t)~(Config_gen + 1))
+            && CMSIS_FLASH_Program_HalfWord(spare, CONFIG_PAGE_RECEIVE)) {
+            Config_copy_key = 0;
+            Config_copy_free = CONFIG_HEADER_SIZE;
+            Config_step = CONFIG_COPY;
+        }
+        break;
+
+    case CONFIG_COPY:
+        //Пропускаем ключи, которых нет ни во Flash, ни в очереди на запись
+        while (Config_copy_key < SEGA_CONFIG_KEYS && !READ_BIT(Config_stored | Config_dirty, 1ULL << Config_copy_key)) {
+            Config_copy_key++;
+        }
+        if (Config_copy_key < SEGA_CONFIG_KEYS) {
+            if (!SEGA_Config_Write(spare + Config_copy_free, Config_copy_key)) {
+                Config_step = CONFIG_ERASE; //Начнем перенос заново
+                break;
+            }
+            Config_copy_free += CONFIG_RECORD_SIZE;
+            Config_copy_key++;
+            break;
+        }
+        if (CMSIS_FLASH_Program_HalfWord(spare, CONFIG_PAGE_VALID)) {
+            //С этого момента при старте будет выбрана новая страница
+            Config_page = spare;
+            Config_gen++;
+            Config_free = Config_copy_free;
+            Config_step = CONFIG_IDLE;
+        }
+        else {
+            Config_step = CONFIG_ERASE;
+        }
+        break;
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запись изменений во Flash. Вызывать в главном цикле.
+ *  За вызов - одна операция (запись ключа или шаг переноса), только между опросами геймпада.
+ ***************************************************************************************
+ */
+void SEGA_Config_Process(void) {
+    uint8_t key;
+
+    if (!Config_dirty && Config_step == CONFIG_IDLE) {
+        return;
+    }
+    if (!SEGA_Config_Flash_Begin()) {
+        return;
+    }
+    if (Config_step == CONFIG_IDLE && Config_free + CONFIG_RECORD_SIZE > SEGA_CONFIG_PAGE_SIZE) {
+        Config_step = CONFIG_ERASE; //Активная страница заполнена
+    }
+    if (Config_step != CONFIG_IDLE) {
+        SEGA_Config_Transfer();
+    }
+    else {
+        for (key = 0; !READ_BIT(Config_dirty, 1ULL << key); key++) ;
+        SEGA_Config_Write(Config_page + Config_free, key);
+        Config_free += CONFIG_RECORD_SIZE; //Даже при ошибке: место могло быть испорчено
+    }
+    SEGA_Config_Flash_End();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Есть ли изменения, которые еще не записаны во Flash
+ ***************************************************************************************
+ */
+bool SEGA_Config_Busy(void) {
+    return Config_dirty || Config_step != CONFIG_IDLE;
+}
@@ -0,0 +1,264 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_console.c
+ *  @brief Эмуляция 6-кнопочного геймпада для приставки SEGA Mega Drive
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Описание фаз и подключения см. в SEGA_console.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_console.h"
+
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_CONSOLE)
+
+#define SEGA_CONSOLE_PINS 0x3F //PA0-PA5
+#define SEGA_CONSOLE_HIGH 4 //Смещение в таблице для SELECT = HIGH
+
+/*Ножки PA0-PA5 = PIN1, PIN2, PIN3, PIN4, PIN6, PIN9*/
+#define CONSOLE_PIN1 (1 << 0)
+#define CONSOLE_PIN2 (1 << 1)
+#define CONSOLE_PIN3 (1 << 2)
+#define CONSOLE_PIN4 (1 << 3)
+#define CONSOLE_PIN6 (1 << 4)
+#define CONSOLE_PIN9 (1 << 5)
+
+/*Кольцо DMA: значение BSRR на каждый фронт SELECT по порядку. Два кольца по SEGA_CONSOLE_EDGES слов
+  со сдвигом на одно: с Console_table[1] - первый фронт спад (SELECT в покое HIGH), с Console_table[0] - фронт*/
+static uint32_t Console_table[SEGA_CONSOLE_EDGES + 1];
+static const uint32_t * volatile Console_ring = &Console_table[1]; //Кольцо, которое сейчас читает DMA
+
+/*Фаза (индекс level | p, как в Set_Buttons) для каждого слова Console_table*/
+static const uint8_t Console_order[SEGA_CONSOLE_EDGES + 1] = {
+    SEGA_CONSOLE_HIGH + 0, 1, SEGA_CONSOLE_HIGH + 1, 2, SEGA_CONSOLE_HIGH + 2, 3, SEGA_CONSOLE_HIGH + 3, 0, SEGA_CONSOLE_HIGH + 0
+};
+
+static uint8_t Console_rx_state; //Прием посылки: 0 - ждем sync, 1 - младший байт, 2 - старший
+static uint8_t Console_rx_low;
+
+/**
+ ***************************************************************************************
+ *  @breif Значение для BSRR по маске "низких" ножек (кнопка нажата - 0 на ножке)
+ ***************************************************************************************
+ */
+static uint32_t SEGA_Console_Bsrr(uint8_t low) {
+    return (~low & SEGA_CONSOLE_PINS) | ((uint32_t)(low & SEGA_CONSOLE_PINS) << 16);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Перевод бита Buttons в маску ножки
+ ***************************************************************************************
+ */
+static inline uint8_t SEGA_Console_Pin(uint16_t buttons, uint16_t button, uint8_t pin) {
+    return (buttons & button) ? pin : 0;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запуск TIM2 в режиме одного импульса на SEGA_CONSOLE_RESET_US
+ ***************************************************************************************
+ */
+static void SEGA_Console_Timer_init(void) {
+    SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM2EN); //Запуск тактирования таймера 2
+    TIM2->CR1 = TIM_CR1_OPM | TIM_CR1_URS; //Один импульс, прерывание только по переполнению
+    TIM2->PSC = 72 - 1; //1 МГц
+    TIM2->ARR = SEGA_CONSOLE_RESET_US - 1;
+    SET_BIT(TIM2->EGR, TIM_EGR_UG); //Загрузим PSC
+    CLEAR_BIT(TIM2->SR, TIM_SR_UIF);
+    SET_BIT(TIM2->DIER, TIM_DIER_UIE);
+    NVIC_SetPriority(TIM2_IRQn, 1);
+    NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Ответ на фронты SELECT без ядра: TIM3 (вход TI1 = PA6) по каждому фронту
+ *  запрашивает DMA1 канал 6, тот пишет следующее слово кольца в GPIOA->BSRR
+ ***************************************************************************************
+ */
+static void SEGA_Console_DMA_init(void) {
+    SET_BIT(RCC->AHBENR, RCC_AHBENR_DMA1EN);
+    SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM3EN);
+
+    DMA1_Channel6->CCR = 0;
+    DMA1_Channel6->CPAR = (uint32_t)&GPIOA->BSRR;
+    MODIFY_REG(DMA1_Channel6->CCR, DMA_CCR_PL_Msk, 0b11 << DMA_CCR_PL_Pos); //Приоритет очень высокий
+    SET_BIT(DMA1_Channel6->CCR, DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_MSIZE_1 | DMA_CCR_PSIZE_1); //Память -> BSRR, по 32 бита, по кругу
+
+    TIM3->CR1 = TIM_CR1_URS; //Сброс от триггера не дает событие обновления
+    TIM3->PSC = 0;
+    TIM3->ARR = 0xFFFF;
+    TIM3->CCMR1 = TIM_CCMR1_CC1S_0; //CC1 - вход TI1, без фильтра (фильтр добавил бы задержку)
+    TIM3->SMCR = TIM_SMCR_TS_2 | TIM_SMCR_SMS_2; //Триггер TI1F_ED (оба фронта), режим сброса
+    TIM3->DIER = TIM_DIER_TDE; //Запрос DMA по событию триггера (TIM3_TRIG - канал 6)
+    SET_BIT(TIM3->CR1, TIM_CR1_CEN);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Кольцо DMA с ответа на первый фронт нового опроса, ножки - как до него
+ *  @attention Вызывать при запрещенных прерываниях.
+ ***************************************************************************************
+ */
+static void SEGA_Console_Rewind(void) {
+    const uint32_t *ring = READ_BIT(GPIOA->IDR, GPIO_IDR_IDR6) ? &Console_table[1] : &Console_table[0];
+
+    CLEAR_BIT(DMA1_Channel6->CCR, DMA_CCR_EN);
+    DMA1_Channel6->CMAR = (uint32_t)ring;
+    DMA1_Channel6->CNDTR = SEGA_CONSOLE_EDGES;
+    SET_BIT(DMA1_Channel6->CCR, DMA_CCR_EN);
+    Console_ring = ring;
+    GPIOA->BSRR = ring[SEGA_CONSOLE_EDGES - 1];
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Настройка режима эмуляции: PA0-PA5 на выход, PA6 - вход SELECT для TIM3
+ *  и EXTI6, TIM3 + DMA1 канал 6 - ответ на фронты, TIM2 - таймаут сброса фаз,
+ *  USART1 - прием кнопок с ПК.
+ ***************************************************************************************
+ */
+void SEGA_Console_Init(void) {
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_IOPAEN); //Запуск тактирования порта А
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_AFIOEN); //Запуск тактирования альтернативных функций
+
+    SEGA_Console_Set_Buttons(0);
+
+    //PA0-PA5 Output push-pull 10 MHz
+    MODIFY_REG(GPIOA->CRL, 0x00FFFFFF, 0x00111111);
+    //PA6 - SELECT (Input floating)
+    MODIFY_REG(GPIOA->CRL, GPIO_CRL_MODE6, 0b00 << GPIO_CRL_MODE6_Pos);
+    MODIFY_REG(GPIOA->CRL, GPIO_CRL_CNF6, 0b01 << GPIO_CRL_CNF6_Pos);
+
+    SEGA_Console_Timer_init();
+    SEGA_Console_DMA_init();
+    __disable_irq();
+    SEGA_Console_Rewind(); //Ножки - до первого фронта
+    __enable_irq();
+
+    MODIFY_REG(AFIO->EXTICR[1], AFIO_EXTICR2_EXTI6, AFIO_EXTICR2_EXTI6_PA); //EXTI6 - порт A
+    SET_BIT(EXTI->RTSR, EXTI_RTSR_TR6); //Реагирование по фронту
+    SET_BIT(EXTI->FTSR, EXTI_FTSR_TR6); //Реагирование по спаду
+    SET_BIT(EXTI->PR, EXTI_PR_PR6);
+    SET_BIT(EXTI->IMR, EXTI_IMR_MR6);
+    NVIC_SetPriority(EXTI9_5_IRQn, 0); //Перезапуск таймаута раньше, чем TIM2 успеет сбросить фазы
+    NVIC_EnableIRQ(EXTI9_5_IRQn);
+
+    CMSIS_USART1_Init();
+    CLEAR_BIT(USART1->CR1, USART_CR1_IDLEIE); //Посылка разбирается по байтам, IDLE не нужен
+    USART1->BRR = SEGA_CONSOLE_USART_BRR;
+    NVIC_SetPriority(USART1_IRQn, 2);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Пересчет таблицы фаз под новое состояние кнопок.
+ *  @param  buttons - биты как в переменной Buttons, 1 - кнопка нажата
+ ***************************************************************************************
+ */
+void SEGA_Console_Set_Buttons(uint16_t buttons) {
+    uint32_t table[8]; //По фазам: level | p
+    uint8_t dpad, low_normal, high_normal, high_extra;
+    uint32_t primask;
+    uint16_t left;
+
+    dpad = SEGA_Console_Pin(buttons, SEGA_UP_Pos, CONSOLE_PIN1) | SEGA_Console_Pin(buttons, SEGA_DOWN_Pos, CONSOLE_PIN2);
+    low_normal = SEGA_Console_Pin(buttons, SEGA_A_Pos, CONSOLE_PIN6) | SEGA_Console_Pin(buttons, SEGA_START_Pos, CONSOLE_PIN9);
+    high_normal = dpad | SEGA_Console_Pin(buttons, SEGA_LEFT_Pos, CONSOLE_PIN3) | SEGA_Console_Pin(buttons, SEGA_RIGHT_Pos, CONSOLE_PIN4) |
+                  SEGA_Console_Pin(buttons, SEGA_B_Pos, CONSOLE_PIN6) | SEGA_Console_Pin(buttons, SEGA_C_Pos, CONSOLE_PIN9);
+    high_extra = SEGA_Console_Pin(buttons, SEGA_Z_Pos, CONSOLE_PIN1) | SEGA_Console_Pin(buttons, SEGA_Y_Pos, CONSOLE_PIN2) |
+                 SEGA_Console_Pin(buttons, SEGA_X_Pos, CONSOLE_PIN3) | SEGA_Console_Pin(buttons, SEGA_MODE_Pos, CONSOLE_PIN4) |
+                 SEGA_Console_Pin(buttons, SEGA_B_Pos, CONSOLE_PIN6) | SEGA_Console_Pin(buttons, SEGA_C_Pos, CONSOLE_PIN9);
+
+    //PIN3, PIN4 при SELECT = LOW всегда 0 - признак геймпада Mega Drive
+    table[1] = table[2] = SEGA_Console_Bsrr(dpad | CONSOLE_PIN3 | CONSOLE_PIN4 | low_normal);
+    table[SEGA_CONSOLE_HIGH + 0] = table[SEGA_CONSOLE_HIGH + 1] = table[SEGA_CONSOLE_HIGH + 2] = SEGA_Console_Bsrr(high_normal);
+#if (SEGA_CONSOLE_6BUTTON)
+    table[3] = SEGA_Console_Bsrr(CONSOLE_PIN1 | CONSOLE_PIN2 | CONSOLE_PIN3 | CONSOLE_PIN4 | low_normal); //ID 6-кнопочного
+    table[0] = SEGA_Console_Bsrr(low_normal);
+    table[SEGA_CONSOLE_HIGH + 3] = SEGA_Console_Bsrr(high_extra);
+#else
+    table[3] = table[0] = table[1];
+    table[SEGA_CONSOLE_HIGH + 3] = table[SEGA_CONSOLE_HIGH + 0];
+#endif
+
+    //В кольцо по слову: DMA читает его в любой момент, каждое слово - целый ответ
+    for (uint8_t i = 0; i <= SEGA_CONSOLE_EDGES; i++) {
+        Console_table[i] = table[Console_order[i]];
+    }
+
+    //Сразу выставляем ножки для текущей фазы (ответ на последний фронт). Если фронт пришел
+    //между чтением CNDTR и записью BSRR, запись перебила ответ DMA - повторяем
+    primask = __get_PRIMASK();
+    __disable_irq();
+    do {
+        left = DMA1_Channel6->CNDTR;
+        GPIOA->BSRR = Console_ring[(2 * SEGA_CONSOLE_EDGES - 1 - left) % SEGA_CONSOLE_EDGES];
+    } while (left != DMA1_Channel6->CNDTR);
+    __set_PRIMASK(primask);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Прерывание по фронту/спаду SELECT: только перезапуск таймаута фаз.
+ *  Ножки к этому времени уже выставил DMA.
+ ***************************************************************************************
+ */
+void EXTI9_5_IRQHandler(void) {
+    TIM2->CNT = 0;
+    SET_BIT(TIM2->CR1, TIM_CR1_CEN); //Перезапуск таймаута
+    EXTI->PR = EXTI_PR_PR6;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Таймаут SELECT: геймпад возвращается в исходное состояние
+ *  @attention Вызывается из TIM2_IRQHandler.
+ ***************************************************************************************
+ */
+void SEGA_Console_Timeout(void) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (!READ_BIT(TIM2->CR1, TIM_CR1_CEN) && !READ_BIT(EXTI->PR, EXTI_PR_PR6)) {
+        //Если EXTI успел перезапустить таймер или фронт SELECT еще ждет обработки, сбрасывать нечего
+        SEGA_Console_Rewind();
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Прием кнопок с ПК: 0xA5, младший байт, старший байт
+ ***************************************************************************************
+ */
+void USART1_IRQHandler(void) {
+    uint8_t data;
+
+    if (READ_BIT(USART1->SR, USART_SR_RXNE)) {
+        data = USART1->DR;
+        switch (Console_rx_state) {
+        case 0:
+            if (data == SEGA_CONSOLE_SYNC) {
+                Console_rx_state = 1;
+            }
+            break;
+        case 1:
+            Console_rx_low = data;
+            Console_rx_state = 2;
+            break;
+        default:
+            SEGA_Console_Set_Buttons(((uint16_t)data << 8) | Console_rx_low);
+            Console_rx_state = 0;
+            break;
+        }
+    }
+}
+
+#endif /* SEGA_PROTOCOL == SEGA_PROTOCOL_CONSOLE */
@@ -64,13 +64,43 @@
  */
 
 #include "SEGA_gamepad.h"
+#include "SEGA_mouse.h"
+#include "SEGA_saturn.h"
+#include "SEGA_console.h"
+#include "SEGA_tas.h"
+#include "SEGA_inject.h"
+#include "SEGA_telemetry.h"
+#include "SEGA_power.h"
+#include "SEGA_boot.h"
+#include "SEGA_remap.h"
+#include "SEGA_socd.h"
+#include "SEGA_turbo.h"
+#include "SEGA_macro.h"
+#include "SEGA_keyboard.h"
+#include "SEGA_xinput.h"
+#include "SEGA_pointer.h"
+#include "SEGA_stamp.h"
 #include "usb_device.h"
 #include "usbd_customhid.h"
 
+#define GAMEPAD_SENT_NONE 0xFFFF //Отчет еще не уходил (кнопок 14, такого значения Buttons не бывает)
+#define GAMEPAD_IDLE_MAX  0x8000 //Предел счетчика кадров Gamepad_idle
+
 uint16_t Buttons; //Переменная под 12 кнопок
 bool flag_SELECT;        //Флаг для переключения ножки SELECT
 uint8_t Counter; //Счетчик переключений сигнала SELECT
+bool flag_SATURN = (SEGA_PROTOCOL == SEGA_PROTOCOL_SATURN); //Подключен геймпад Saturn
+static uint16_t Gamepad_live; //Кнопки после переназначения и режима указателя, до макросов и турбо
+static bool Gamepad_pending; //Последний отчет не принят в точку IN, повторить в следующем кадре
+static bool Gamepad_turn; //Прошлый кадр SOF отдан отчету геймпада (очередь с отчетом мыши)
+static uint16_t Gamepad_sent = GAMEPAD_SENT_NONE; //Кнопки последнего принятого отчета
+static uint16_t Gamepad_idle; //Кадров USB с последнего принятого отчета
+static uint16_t Gamepad_fn_last; //Последнее значение USB->FNR
+static bool Gamepad_repeat; //Период SET_IDLE истек: повторить отчет, даже если кнопки те же
 extern USB_Custom_HID_Gamepad Gamepad_data;
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_MOUSE)
+extern USB_Custom_HID_Mouse Mouse_data;
+#endif
 extern PCD_HandleTypeDef hpcd_USB_FS;
 extern USBD_HandleTypeDef hUsbDeviceFS;
 
@@ -105,6 +135,34 @@ void SEGA_GPIO_Init(void){
     MODIFY_REG(GPIOA->CRL, GPIO_CRL_CNF6, 0b00 << GPIO_CRL_CNF6_Pos); 
 }
 
+ /**
+ ***************************************************************************************
+ *  @breif Настройка PA7 на выход TR (PIN9 DB-9).
+ *  @attention Только для устройств, которым TR нужен как вход (мышь).
+ *  Требует доработки платы: PA7 через резистор 1 кОм на PIN9.
+ ***************************************************************************************
+ */
+void SEGA_TR_Output_Init(void) {
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_IOPAEN); //Запуск тактирования порта А
+    SEGA_TR_ON; //idle
+    //PA7 - PIN9 TR (Output push-pull)
+    MODIFY_REG(GPIOA->CRL, GPIO_CRL_MODE7, 0b10 << GPIO_CRL_MODE7_Pos);
+    MODIFY_REG(GPIOA->CRL, GPIO_CRL_CNF7, 0b00 << GPIO_CRL_CNF7_Pos);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Частота опроса геймпада. Вызывать после CMSIS_TIM2_init.
+ *  @param  hz - частота, Гц (ограничивается SEGA_POLL_HZ_MIN..SEGA_POLL_HZ_MAX)
+ *  @attention ARR буферизован (ARPE), новый период начнется со следующего обновления TIM2.
+ ***************************************************************************************
+ */
+void SEGA_Poll_Rate(uint16_t hz) {
+    if (hz < SEGA_POLL_HZ_MIN) hz = SEGA_POLL_HZ_MIN;
+    if (hz > SEGA_POLL_HZ_MAX) hz = SEGA_POLL_HZ_MAX;
+    TIM2->ARR = SEGA_POLL_TIM2_HZ / hz - 1;
+}
+
 /**
 ***************************************************************************************
 *  @breif Прерывания от таймера 2
@@ -115,12 +173,234 @@ void SEGA_GPIO_Init(void){
 void TIM2_IRQHandler(void) {
     //Опрос джойстика 240 раз в секунду
     if (READ_BIT(TIM2->SR, TIM_SR_UIF)) {
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_CONSOLE)
+        //В режиме эмуляции TIM2 отсчитывает таймаут SELECT
+        CLEAR_BIT(TIM2->SR, TIM_SR_UIF); //Сбросим флаг прерывания
+        SEGA_Console_Timeout();
+        return;
+#endif
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_MOUSE)
+        SEGA_Mouse_Start();
+#else
         flag_SELECT = 1;
+#endif
         SET_BIT(TIM3->CR1, TIM_CR1_CEN); //Запуск таймера
         CLEAR_BIT(TIM2->SR, TIM_SR_UIF); //Сбросим флаг прерывания
     }
 }
 
+/*Положение крестовины (hat) по направлениям осей: [y + 1][x + 1]*/
+static const uint8_t Hat_table[3][3] = {
+    {7, 0, 1},                 //UL U UR
+    {6, SEGA_HAT_NEUTRAL, 2},  //L  -  R
+    {5, 4, 3},                 //DL D DR
+};
+
+/*Значение оси отчета по направлению: [dir + 1]*/
+static const int8_t Axis_table[3] = { SEGA_AXIS_MIN, 0, SEGA_AXIS_MAX };
+
+/**
+***************************************************************************************
+*  @breif Направление оси по результату SOCD (SEGA_socd.h). Там на каждой оси нажато
+*  не больше одного направления, своего правила для UP+DOWN и LEFT+RIGHT здесь нет.
+*  @param  buttons - кнопки после SEGA_SOCD_Filter
+*  @param  minus - направление к SEGA_AXIS_MIN (LEFT или UP)
+*  @param  plus - направление к SEGA_AXIS_MAX (RIGHT или DOWN)
+*  @retval -1, 0, 1
+***************************************************************************************
+*/
+static int8_t SEGA_Gamepad_Dir(uint16_t buttons, uint16_t minus, uint16_t plus) {
+    if (buttons & minus) {
+        return -1;
+    }
+    return (buttons & plus) ? 1 : 0;
+}
+
+/**
+***************************************************************************************
+*  @breif Отправка отчета геймпада в USB
+*  @param  buttons - кнопки в формате переменной Buttons
+*  @retval true - отчет принят в точку IN (или не нужен: кнопки не изменились)
+*  @attention Как требует HID для SET_IDLE: отчет уходит только при изменении кнопок,
+*  а те же кнопки повторяются раз в период SET_IDLE (Gamepad_repeat, из SOF).
+*  Пока устройство не сконфигурировано или в suspend, отчеты не уходят,
+*  и первый отчет после конфигурации или resume уходит в любом случае.
+***************************************************************************************
+*/
+bool SEGA_Gamepad_Send(uint16_t buttons) {
+    bool configured = (hUsbDeviceFS.dev_state == USBD_STATE_CONFIGURED);
+    int8_t x, y;
+
+    //Если какая-то ножка нажата - мигнем светодиодом
+    if (buttons) {
+        SEGA_LED_ON;
+    }
+    else {
+        SEGA_LED_OFF;
+    }
+    if (configured && buttons == Gamepad_sent && !Gamepad_repeat) {
+        SEGA_Power_Sent(); //Эти кнопки у хоста уже есть
+        return true;
+    }
+
+    if (SEGA_Keyboard_Mode() != SEGA_KEYBOARD_OFF) {
+        //Устройство подключено клавиатурой (см. SEGA_keyboard.h)
+        if (!SEGA_Keyboard_Send(buttons)) {
+            return false;
+        }
+    }
+    else if (SEGA_XInput_Active()) {
+        //Устройство подключено геймпадом Xbox 360 (см. SEGA_xinput.h)
+        if (!SEGA_XInput_Send(buttons)) {
+            return false;
+        }
+    }
+    else {
+        //Крестовина и осями X/Y, и положением (hat), обе - из одного результата SOCD.
+        //Драйвер берет то, что понимает
+        x = SEGA_Gamepad_Dir(buttons, SEGA_LEFT_Pos, SEGA_RIGHT_Pos);
+        y = SEGA_Gamepad_Dir(buttons, SEGA_UP_Pos, SEGA_DOWN_Pos);
+        Gamepad_data.x = Axis_table[x + 1];
+        Gamepad_data.y = Axis_table[y + 1];
+        Gamepad_data.hat = Hat_table[y + 1][x + 1];
+        Gamepad_data.buttons = buttons >> 4;
+        if (USBD_CUSTOM_HID_SendReport(&hUsbDeviceFS, (uint8_t*)&Gamepad_data, SEGA_Stamp_Size()) != USBD_OK) {
+            return false;
+        }
+    }
+    SEGA_Boot_Mark(SEGA_BOOT_FIRST_REPORT);
+    SEGA_Power_Sent(); //Нажатие, разбудившее хост, можно забыть
+    Gamepad_sent = configured ? buttons : GAMEPAD_SENT_NONE;
+    Gamepad_repeat = false;
+    Gamepad_idle = 0;
+    return true;
+}
+
+/**
+***************************************************************************************
+*  @breif Кнопки живого геймпада через макросы, турбо, запись/воспроизведение и подачу с ПК - в USB.
+*  Вызывается в конце опроса и из SOF, когда макрос или турбо изменили кнопки.
+***************************************************************************************
+*/
+static void SEGA_Gamepad_Output(void) {
+    //Нажатие во время suspend будит хост и уходит первым отчетом после resume.
+    //При воспроизведении записи или подаче нажатий с ПК кнопки подменяются.
+    //SOCD последним: конфликт крестовины разрешается для любого источника, в том числе записи и ПК
+    Gamepad_pending = !SEGA_Gamepad_Send(SEGA_SOCD_Filter(SEGA_Inject_Filter(SEGA_TAS_Filter(SEGA_Power_Filter(SEGA_Turbo_Filter(SEGA_Macro_Filter(Gamepad_live)))))));
+}
+
+/**
+***************************************************************************************
+*  @breif Окончание опроса: остановка TIM3 и отправка отчета в USB
+***************************************************************************************
+*/
+static void SEGA_Poll_End(void) {
+    Counter = 0; //Сбросим счетчик импульсов
+    CLEAR_BIT(TIM3->CR1, TIM_CR1_CEN); //Остановим таймер
+    SEGA_Boot_Mark(SEGA_BOOT_FIRST_POLL);
+    SEGA_Stamp_Sample(); //От этого момента считается возраст кнопок в отчете
+    SEGA_Keyboard_Select(Buttons); //Геймпад или клавиатура - по первому опросу, до чтения дескрипторов хостом
+    SEGA_Telemetry_Push(Buttons); //Изменения живого геймпада с меткой времени в USART1
+    //Переназначение первым: дальше все работает с кнопками так, как их видит ПК
+    Gamepad_live = SEGA_Pointer_Filter(SEGA_Remap(Buttons));
+    SEGA_Gamepad_Output();
+}
+
+/**
+***************************************************************************************
+*  @breif Таймер SET_IDLE: отсчет кадров по USB->FNR с последнего принятого отчета.
+*  Период - IdleState * 4 мс (0 - бесконечный, отчет только при изменении кнопок).
+***************************************************************************************
+*/
+static void SEGA_Gamepad_Idle(USBD_HandleTypeDef *pdev) {
+    USBD_CUSTOM_HID_HandleTypeDef *hhid = (USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData;
+    uint16_t fn, period;
+
+    fn = READ_BIT(USB->FNR, USB_FNR_FN);
+    if (Gamepad_idle < GAMEPAD_IDLE_MAX) {
+        Gamepad_idle += (uint16_t)(fn - Gamepad_fn_last) & USB_FNR_FN;
+    }
+    Gamepad_fn_last = fn;
+
+    period = (hhid != NULL) ? (uint16_t)(hhid->IdleState * CUSTOM_HID_IDLE_MS) : 0;
+    if (period && Gamepad_idle >= period) {
+        Gamepad_repeat = true;
+    }
+}
+
+/**
+***************************************************************************************
+*  @breif Прерывание SOF (1 кГц), приходит только после конфигурации устройства
+***************************************************************************************
+*/
+void USBD_CUSTOM_HID_SOFCallback(USBD_HandleTypeDef *pdev) {
+    bool changed, pointer;
+
+    SEGA_Gamepad_Idle(pdev);
+    //Кадр записи TAS, посылка с ПК, шаг макроса или переключение турбо - отдельным отчетом
+    //в этом же кадре, через всю цепочку (SEGA_Gamepad_Output). Не ушедший отчет повторяем.
+    //Все модули отсчитывают кадры, поэтому вызываются всегда (без сокращенного ||)
+    changed = SEGA_TAS_SOF();
+    changed |= SEGA_Inject_SOF();
+    changed |= SEGA_Macro_SOF();
+    changed |= SEGA_Turbo_SOF();
+    pointer = SEGA_Pointer_SOF();
+    //Один отчет за кадр: если нужны оба, геймпад и мышь (SEGA_pointer.h) идут по очереди
+    if ((changed || Gamepad_pending || Gamepad_repeat) && !(pointer && Gamepad_turn)) {
+        SEGA_Gamepad_Output();
+        Gamepad_turn = true;
+    }
+    else if (pointer) {
+        SEGA_Pointer_Send();
+        Gamepad_turn = false;
+        Gamepad_pending |= changed; //Изменения геймпада уйдут в следующем кадре
+    }
+    else {
+        SEGA_Inject_Send(); //Кадр свободен - credits для ПК
+    }
+}
+
+/**
+***************************************************************************************
+*  @breif GET_REPORT по control-точке: последний собранный отчет, без нового опроса.
+*  Прерывания USB и опроса одного приоритета, так что отчет не бывает собран наполовину.
+*  @param  pdev - устройство USB
+*  @param  type - тип отчета (CUSTOM_HID_REPORT_TYPE_...)
+*  @param  id - Report ID (0 - у клавиатуры)
+*  @param  len - длина отчета
+*  @retval Отчет или NULL (такого отчета нет, STALL)
+***************************************************************************************
+*/
+uint8_t *USBD_CUSTOM_HID_GetReportCallback(USBD_HandleTypeDef *pdev, uint8_t type, uint8_t id, uint16_t *len) {
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_MOUSE)
+    static USB_Custom_HID_Mouse mouse = { .report_id = USB_REPORT_ID_MOUSE };
+#endif
+
+    (void)pdev;
+    if (type != CUSTOM_HID_REPORT_TYPE_INPUT || SEGA_XInput_Active()) {
+        return NULL; //Читаются только входные отчеты, у XInput запросов HID нет
+    }
+    if (SEGA_Keyboard_Mode() != SEGA_KEYBOARD_OFF) {
+        return (id == 0) ? SEGA_Keyboard_Report(len) : NULL;
+    }
+    switch (id) {
+    case USB_REPORT_ID_GAMEPAD:
+        *len = SEGA_Stamp_Size();
+        return (uint8_t*)&Gamepad_data;
+    case USB_REPORT_ID_MOUSE:
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_MOUSE)
+        //Перемещение относительное: уже ушедшее не повторяем
+        mouse.buttons = Mouse_data.buttons;
+        *len = sizeof(mouse);
+        return (uint8_t*)&mouse;
+#else
+        return SEGA_Pointer_Report(len);
+#endif
+    default:
+        return NULL;
+    }
+}
+
 /**
 ***************************************************************************************
 *  @breif Прерывания от таймера 3
@@ -134,6 +414,32 @@ void TIM2_IRQHandler(void) {
 void TIM3_IRQHandler(void) {
     //Делаем стробирующий сигнал на ножке PIN7 SELECT
     if (READ_BIT(TIM3->SR, TIM_SR_UIF)) {
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_MOUSE)
+        //С мышью вместо стробов SELECT идет рукопожатие TH/TR/TL
+        if (SEGA_Mouse_Tick()) {
+            CLEAR_BIT(TIM3->CR1, TIM_CR1_CEN); //Остановим таймер
+        }
+        CLEAR_BIT(TIM3->SR, TIM_SR_UIF); //Сбросим флаг прерывания
+        return;
+#endif
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_AUTO)
+        if (Counter == 0 && flag_SATURN != SEGA_Saturn_Detect()) {
+            //Геймпад сменился, старые кнопки не относятся к новому
+            flag_SATURN = !flag_SATURN;
+            Buttons = 0;
+        }
+#endif
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_SATURN) || (SEGA_PROTOCOL == SEGA_PROTOCOL_AUTO)
+        if (flag_SATURN) {
+            SEGA_Saturn_Strobe(Counter);
+            Counter++;
+            if (Counter > SEGA_SATURN_COUNTER_END) {
+                SEGA_Poll_End();
+            }
+            CLEAR_BIT(TIM3->SR, TIM_SR_UIF); //Сбросим флаг прерывания
+            return;
+        }
+#endif
         if (Counter % 2 != 0) {
             //Считывать сигнал будем между фронтами, чтоб не нарваться на переходный процесс
             flag_SELECT = !flag_SELECT;
@@ -418,45 +724,7 @@ void TIM3_IRQHandler(void) {
 		
         Counter++;
         if (Counter > 16) {
-            Counter = 0; //Сбросим счетчик импульсов
-            CLEAR_BIT(TIM3->CR1, TIM_CR1_CEN); //Остановим таймер
-            //Если какая-то ножка нажата - мигнем светодиодом
-            if (Buttons) {
-                SEGA_LED_ON;
-            }
-            else {
-                SEGA_LED_OFF;
-            }
-	        
-	        if (READ_BIT(Buttons, SEGA_UP_Pos) && !READ_BIT(Buttons, SEGA_DOWN_Pos))
-	        {
-		        Gamepad_data.y = -128;
-	        }
-	        else if (READ_BIT(Buttons, SEGA_DOWN_Pos) && !READ_BIT(Buttons, SEGA_UP_Pos)) {
-		        Gamepad_data.y = 127;
-	        }
-	        else if (READ_BIT(Buttons, SEGA_UP_Pos) && READ_BIT(Buttons, SEGA_DOWN_Pos)) {
-		        Gamepad_data.y = 0;
-	        }
-	        else {
-		        Gamepad_data.y = 0;
-	        }
-		
-	        if (READ_BIT(Buttons, SEGA_LEFT_Pos) && !READ_BIT(Buttons, SEGA_RIGHT_Pos))
-	        {
-		        Gamepad_data.x = -128;
-	        }
-	        else if (READ_BIT(Buttons, SEGA_RIGHT_Pos) && !READ_BIT(Buttons, SEGA_LEFT_Pos)) {
-		        Gamepad_data.x = 127;
-	        }
-	        else if (READ_BIT(Buttons, SEGA_LEFT_Pos) && READ_BIT(Buttons, SEGA_RIGHT_Pos)) {
-		        Gamepad_data.x = 0;
-	        }
-	        else {
-		        Gamepad_data.x = 0;
-	        }
-	        Gamepad_data.buttons = Buttons >> 4;
-	        USBD_CUSTOM_HID_SendReport(&hUsbDeviceFS, (uint8_t*)&Gamepad_data, sizeof(Gamepad_data));
+            SEGA_Poll_End();
         }
         CLEAR_BIT(TIM3->SR, TIM_SR_UIF); //Сбросим флаг прерывания
     }
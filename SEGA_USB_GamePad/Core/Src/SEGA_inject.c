@@ -0,0 +1,186 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_inject.c
+ *  @brief Подача нажатий с ПК через OUT отчеты USB (тесты задержки ввода)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат отчетов см. в SEGA_inject.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_inject.h"
+#include "usb_device.h"
+#include "usbd_customhid.h"
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+typedef struct {
+	uint32_t frame; //Кадр, в который посылку нужно применить
+	uint16_t buttons;
+	uint8_t mode;
+}SEGA_Inject_Frame;
+
+static SEGA_Inject_Frame Inject_buf[SEGA_INJECT_SIZE]; //Jitter buffer
+static uint8_t Inject_head; //Следующая посылка на применение
+static uint8_t Inject_tail; //Место под следующую принятую посылку
+static bool Inject_stream; //Поток идет, новые посылки ставятся в очередь за предыдущими
+static uint32_t Inject_last_frame; //Кадр последней посылки в очереди
+
+static uint32_t Inject_frame; //Счетчик кадров USB
+static uint16_t Inject_fn_last; //Последнее значение USB->FNR
+
+static uint8_t Inject_mode = SEGA_INJECT_RELEASE; //Режим текущей примененной посылки
+static uint16_t Inject_buttons; //Кнопки текущей примененной посылки
+static uint16_t Inject_live; //Последнее состояние живого геймпада
+
+static USB_Custom_HID_Inject Inject_report = { .report_id = USB_REPORT_ID_INJECT, .credits = SEGA_INJECT_SIZE };
+static bool Inject_report_pending; //Состояние изменилось, нужно отправить credits
+
+/**
+ ***************************************************************************************
+ *  @breif Обновление счетчика кадров по номеру кадра USB (11 бит)
+ ***************************************************************************************
+ */
+static void SEGA_Inject_Frame_Update(void) {
+    uint16_t fn = READ_BIT(USB->FNR, USB_FNR_FN);
+
+    Inject_frame += (uint16_t)(fn - Inject_fn_last) & USB_FNR_FN;
+    Inject_fn_last = fn;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Увеличение счетчика без переполнения
+ ***************************************************************************************
+ */
+static inline void SEGA_Inject_Count(uint8_t *counter) {
+    if (*counter != 0xFF) {
+        (*counter)++;
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Сложение живого геймпада с текущей посылкой
+ ***************************************************************************************
+ */
+static uint16_t SEGA_Inject_Compose(uint16_t buttons) {
+    switch (Inject_mode) {
+    case SEGA_INJECT_OVERRIDE:
+        return Inject_buttons;
+    case SEGA_INJECT_MERGE:
+        return buttons | Inject_buttons;
+    default:
+        return buttons;
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Прием OUT отчета USB_REPORT_ID_INJECT
+ *  @param  *report - отчет вместе с Report ID
+ ***************************************************************************************
+ */
+void SEGA_Inject_Receive(uint8_t *report) {
+    SEGA_Inject_Frame *slot;
+    uint16_t delay = report[3] | (report[4] << 8);
+    uint32_t frame;
+
+    SEGA_Inject_Frame_Update();
+    Inject_report_pending = true;
+    if ((uint8_t)(Inject_tail - Inject_head) >= SEGA_INJECT_SIZE) {
+        //ПК не дождался credits
+        SEGA_Inject_Count(&Inject_report.overrun);
+        return;
+    }
+
+    if (Inject_stream) {
+        frame = Inject_last_frame + delay;
+    }
+    else {
+        //Начало потока: запас на неравномерность доставки отчетов
+        frame = Inject_frame + SEGA_INJECT_LATENCY + delay;
+        Inject_stream = true;
+    }
+    if ((int32_t)(frame - Inject_frame) < 0) {
+        //Посылка опоздала: буфер опустел раньше, чем она пришла
+        SEGA_Inject_Count(&Inject_report.underrun);
+        frame = Inject_frame;
+    }
+
+    slot = &Inject_buf[Inject_tail & (SEGA_INJECT_SIZE - 1)];
+    slot->frame = frame;
+    slot->mode = report[2];
+    slot->buttons = report[5] | (report[6] << 8);
+    Inject_tail++;
+    Inject_last_frame = frame;
+    Inject_report.seq = report[1];
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Подмена или сложение кнопок. Вызывается перед отправкой отчета геймпада.
+ *  @param  buttons - кнопки живого геймпада
+ *  @retval Кнопки, которые нужно отправить в USB
+ ***************************************************************************************
+ */
+uint16_t SEGA_Inject_Filter(uint16_t buttons) {
+    Inject_live = buttons;
+    return SEGA_Inject_Compose(buttons);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Прерывание SOF (1 кГц). Применение посылок этого кадра.
+ *  @retval true - кнопки изменились: нажатие уходит в USB в этом же кадре, не дожидаясь
+ *  опроса геймпада, через общую цепочку (SEGA_Inject_Filter) с повтором, если точка IN занята
+ ***************************************************************************************
+ */
+bool SEGA_Inject_SOF(void) {
+    SEGA_Inject_Frame *slot;
+    bool changed = false;
+
+    SEGA_Inject_Frame_Update();
+    while (Inject_head != Inject_tail) {
+        slot = &Inject_buf[Inject_head & (SEGA_INJECT_SIZE - 1)];
+        if ((int32_t)(slot->frame - Inject_frame) > 0) {
+            break;
+        }
+        Inject_mode = slot->mode;
+        Inject_buttons = slot->buttons;
+        Inject_head++;
+        changed = true;
+    }
+
+    if (changed) {
+        Inject_report_pending = true;
+        if (Inject_head == Inject_tail && Inject_mode == SEGA_INJECT_RELEASE) {
+            Inject_stream = false; //Поток закончен, следующий начнется с новым запасом
+        }
+    }
+    return changed;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Отчет о credits. Вызывается по SOF, если в этом кадре точку IN
+ *  не занял отчет геймпада или мыши.
+ *  @retval true - отчет принят в точку IN
+ ***************************************************************************************
+ */
+bool SEGA_Inject_Send(void) {
+    if (!Inject_report_pending) {
+        return false;
+    }
+    Inject_report.credits = SEGA_INJECT_SIZE - (uint8_t)(Inject_tail - Inject_head);
+    if (USBD_CUSTOM_HID_SendReport(&hUsbDeviceFS, (uint8_t*)&Inject_report, sizeof(Inject_report)) != USBD_OK) {
+        return false;
+    }
+    Inject_report_pending = false;
+    return true;
+}
@@ -0,0 +1,206 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_keyboard.c
+ *  @brief Режим клавиатуры: геймпад представляется хосту HID клавиатурой
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Режимы, клавиши и устройство отчетов см. в SEGA_keyboard.h.
+ *  Дескрипторы отчетов - рядом с CUSTOM_HID_ReportDesc_FS (usbd_custom_hid_if.c).
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_keyboard.h"
+#include "SEGA_xinput.h"
+#include "SEGA_stamp.h"
+#include "SEGA_config.h"
+#include "usb_device.h"
+#include "usbd_customhid.h"
+#include "usbd_custom_hid_if.h"
+
+#define KEYBOARD_MASK ((1 << SEGA_KEYBOARD_BITS) - 1)
+#define KEYBOARD_PID  10 //Смещение idProduct в дескрипторе устройства
+
+/*Бит модификатора для клавиши, 0 - обычная клавиша*/
+#define KEYBOARD_MOD(key) (((key) >= SEGA_KEYBOARD_MODIFIER) ? (1 << ((key) - SEGA_KEYBOARD_MODIFIER)) : 0)
+
+/*Клавиша для каждого бита Buttons*/
+static const uint8_t Keyboard_key[SEGA_KEYBOARD_BITS] = {
+    SEGA_KEYBOARD_RIGHT, SEGA_KEYBOARD_LEFT, SEGA_KEYBOARD_DOWN, SEGA_KEYBOARD_UP,
+    SEGA_KEYBOARD_MODE, SEGA_KEYBOARD_START, SEGA_KEYBOARD_Z, SEGA_KEYBOARD_Y,
+    SEGA_KEYBOARD_X, SEGA_KEYBOARD_C, SEGA_KEYBOARD_B, SEGA_KEYBOARD_A,
+    SEGA_KEYBOARD_L, SEGA_KEYBOARD_R,
+};
+
+/*Бит в байте модификаторов для каждого бита Buttons, 0 - обычная клавиша*/
+static const uint8_t Keyboard_mod[SEGA_KEYBOARD_BITS] = {
+    KEYBOARD_MOD(SEGA_KEYBOARD_RIGHT), KEYBOARD_MOD(SEGA_KEYBOARD_LEFT), KEYBOARD_MOD(SEGA_KEYBOARD_DOWN), KEYBOARD_MOD(SEGA_KEYBOARD_UP),
+    KEYBOARD_MOD(SEGA_KEYBOARD_MODE), KEYBOARD_MOD(SEGA_KEYBOARD_START), KEYBOARD_MOD(SEGA_KEYBOARD_Z), KEYBOARD_MOD(SEGA_KEYBOARD_Y),
+    KEYBOARD_MOD(SEGA_KEYBOARD_X), KEYBOARD_MOD(SEGA_KEYBOARD_C), KEYBOARD_MOD(SEGA_KEYBOARD_B), KEYBOARD_MOD(SEGA_KEYBOARD_A),
+    KEYBOARD_MOD(SEGA_KEYBOARD_L), KEYBOARD_MOD(SEGA_KEYBOARD_R),
+};
+
+static uint8_t Keyboard_mode = SEGA_KEYBOARD_OFF;
+static bool Keyboard_selected; //Режим уже выбран (по первому опросу)
+
+static USB_Custom_HID_Keyboard Keyboard_report; //Отчет 6KRO
+static USB_Custom_HID_Keyboard Keyboard_rollover = { .keys = { SEGA_KEYBOARD_ROLLOVER, SEGA_KEYBOARD_ROLLOVER,
+    SEGA_KEYBOARD_ROLLOVER, SEGA_KEYBOARD_ROLLOVER, SEGA_KEYBOARD_ROLLOVER, SEGA_KEYBOARD_ROLLOVER } }; //Отчет при переполнении
+static uint16_t Keyboard_nkro; //Отчет NKRO
+static uint8_t Keyboard_slot[SEGA_KEYBOARD_BITS]; //Место в отчете 6KRO для нажатой обычной клавиши
+static uint8_t Keyboard_free = (1 << SEGA_KEYBOARD_SLOTS) - 1; //Свободные места отчета 6KRO
+static uint16_t Keyboard_waiting; //Нажатые клавиши, которым не хватило места
+static uint16_t Keyboard_last; //Кнопки, по которым собран отчет 6KRO
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+extern uint8_t USBD_FS_DeviceDesc[];
+
+/**
+ ***************************************************************************************
+ *  @breif Выбор режима по настройке и кнопке, зажатой при подключении. Вызывается в конце
+ *  каждого опроса, работает только в первом. Клавиатура подменяет дескриптор отчета и PID,
+ *  XInput - весь интерфейс (SEGA_XInput_Init).
+ *  @param  buttons - кнопки первого опроса (Buttons, до переназначения)
+ ***************************************************************************************
+ */
+void SEGA_Keyboard_Select(uint16_t buttons) {
+    uint8_t mode;
+    uint16_t pid;
+
+    if (Keyboard_selected) {
+        return;
+    }
+    Keyboard_selected = true;
+
+    mode = (uint8_t)SEGA_Config_Get(SEGA_CONFIG_USB_MODE);
+    if (mode == SEGA_XINPUT_MODE && !(buttons & SEGA_KEYBOARD_HOLD)) {
+        SEGA_XInput_Init(); //Не клавиатура: вместо HID интерфейс XInput (см. SEGA_xinput.h)
+        return;
+    }
+    if (mode == SEGA_STAMP_MODE && !(buttons & SEGA_KEYBOARD_HOLD)) {
+        SEGA_Stamp_Init(); //Геймпад с номером и возрастом отчета (см. SEGA_stamp.h)
+        return;
+    }
+    if (mode > SEGA_KEYBOARD_NKRO) {
+        mode = SEGA_KEYBOARD_OFF; //XInput или метки с зажатым START - геймпад, как и клавиатура
+    }
+    else if (buttons & SEGA_KEYBOARD_HOLD) {
+        mode = (mode == SEGA_KEYBOARD_OFF) ? SEGA_KEYBOARD_NKRO : SEGA_KEYBOARD_OFF;
+    }
+    if (mode == SEGA_KEYBOARD_OFF || CUSTOM_HID_Keyboard_FS(mode) != USBD_OK) {
+        return;
+    }
+    pid = (uint16_t)(USBD_FS_DeviceDesc[KEYBOARD_PID] | (USBD_FS_DeviceDesc[KEYBOARD_PID + 1] << 8)) + SEGA_KEYBOARD_PID_OFFSET;
+    USBD_FS_DeviceDesc[KEYBOARD_PID] = LOBYTE(pid);
+    USBD_FS_DeviceDesc[KEYBOARD_PID + 1] = HIBYTE(pid);
+    Keyboard_mode = mode;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Текущий режим
+ *  @retval SEGA_KEYBOARD_OFF, SEGA_KEYBOARD_6KRO или SEGA_KEYBOARD_NKRO
+ ***************************************************************************************
+ */
+uint8_t SEGA_Keyboard_Mode(void) {
+    return Keyboard_mode;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Обновление отчета 6KRO: только изменившиеся биты
+ *  @param  buttons - кнопки
+ ***************************************************************************************
+ */
+static void SEGA_Keyboard_Update(uint16_t buttons) {
+    uint16_t changed;
+    uint8_t bit, slot;
+
+    buttons &= KEYBOARD_MASK;
+    changed = buttons ^ Keyboard_last;
+    Keyboard_last = buttons;
+
+    while (changed) {
+        bit = (uint8_t)__builtin_ctz(changed);
+        changed &= changed - 1;
+
+        if (Keyboard_mod[bit]) {
+            if (buttons & (1 << bit)) {
+                Keyboard_report.modifiers |= Keyboard_mod[bit];
+            }
+            else {
+                Keyboard_report.modifiers &= ~Keyboard_mod[bit];
+            }
+        }
+        else if (buttons & (1 << bit)) {
+            //Нажата: первое свободное место, а если их нет - ждать
+            if (Keyboard_free) {
+                slot = (uint8_t)__builtin_ctz(Keyboard_free);
+                Keyboard_free &= ~(1 << slot);
+                Keyboard_slot[bit] = slot;
+                Keyboard_report.keys[slot] = Keyboard_key[bit];
+            }
+            else {
+                Keyboard_waiting |= 1 << bit;
+            }
+        }
+        else if (Keyboard_waiting & (1 << bit)) {
+            Keyboard_waiting &= ~(1 << bit); //Отпущена, так и не попав в отчет
+        }
+        else {
+            //Отпущена: место сразу отдается ждущей клавише или освобождается
+            slot = Keyboard_slot[bit];
+            if (Keyboard_waiting) {
+                bit = (uint8_t)__builtin_ctz(Keyboard_waiting);
+                Keyboard_waiting &= ~(1 << bit);
+                Keyboard_slot[bit] = slot;
+                Keyboard_report.keys[slot] = Keyboard_key[bit];
+            }
+            else {
+                Keyboard_report.keys[slot] = 0;
+                Keyboard_free |= 1 << slot;
+            }
+        }
+    }
+    Keyboard_rollover.modifiers = Keyboard_report.modifiers;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Текущий отчет клавиатуры (для отправки и для GET_REPORT), без обновления
+ *  @param  len - длина отчета
+ *  @retval Отчет NKRO, 6KRO или отчет переполнения
+ ***************************************************************************************
+ */
+uint8_t *SEGA_Keyboard_Report(uint16_t *len) {
+    USBD_CUSTOM_HID_HandleTypeDef *hhid = (USBD_CUSTOM_HID_HandleTypeDef *)hUsbDeviceFS.pClassData;
+
+    if (Keyboard_mode == SEGA_KEYBOARD_NKRO && hhid != NULL && hhid->Protocol) {
+        Keyboard_nkro = Keyboard_last;
+        *len = sizeof(Keyboard_nkro);
+        return (uint8_t*)&Keyboard_nkro;
+    }
+    //6KRO, а также NKRO после SET_PROTOCOL 0 (boot протокол)
+    *len = sizeof(Keyboard_report);
+    return (uint8_t*)(Keyboard_waiting ? &Keyboard_rollover : &Keyboard_report);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Отправка отчета клавиатуры в USB
+ *  @param  buttons - кнопки в формате переменной Buttons
+ *  @retval true - отчет принят в точку IN
+ ***************************************************************************************
+ */
+bool SEGA_Keyboard_Send(uint16_t buttons) {
+    uint8_t *report;
+    uint16_t len;
+
+    SEGA_Keyboard_Update(buttons);
+    report = SEGA_Keyboard_Report(&len);
+    return USBD_CUSTOM_HID_SendReport(&hUsbDeviceFS, report, len) == USBD_OK;
+}
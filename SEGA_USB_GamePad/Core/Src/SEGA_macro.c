@@ -0,0 +1,132 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_macro.c
+ *  @brief Макросы: последовательность нажатий по кнопке или сочетанию, с точностью до кадра
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат байт-кода см. в SEGA_macro.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_macro.h"
+#include "SEGA_config.h"
+
+#define MACRO_NONE 0xFF //Макрос не идет
+
+static uint8_t Macro_index = MACRO_NONE; //Идущий макрос
+static uint8_t Macro_pc; //Следующий байт байт-кода
+static uint8_t Macro_wait; //Сколько кадров еще держать текущее состояние
+static uint16_t Macro_state; //Кнопки, нажатые макросом
+static uint16_t Macro_last; //Живой геймпад прошлого опроса, для поиска нажатия сочетания
+static uint16_t Macro_fn_last; //Последнее значение USB->FNR
+
+/**
+ ***************************************************************************************
+ *  @breif Первый ключ (сочетание и режим) макроса
+ ***************************************************************************************
+ */
+static inline uint16_t SEGA_Macro_Trigger(uint8_t index) {
+    return SEGA_Config_Get(SEGA_CONFIG_MACRO_0 + index * SEGA_MACRO_KEYS);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Байт байт-кода идущего макроса
+ ***************************************************************************************
+ */
+static inline uint8_t SEGA_Macro_Fetch(uint8_t pc) {
+    return (uint8_t)(SEGA_Config_Get(SEGA_CONFIG_MACRO_0 + Macro_index * SEGA_MACRO_KEYS + 1 + pc / 2) >> ((pc % 2) * 8));
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Выполнение байт-кода до ближайшего ожидания или конца
+ ***************************************************************************************
+ */
+static void SEGA_Macro_Run(void) {
+    uint8_t op;
+
+    while (Macro_index != MACRO_NONE && !Macro_wait) {
+        op = (Macro_pc < SEGA_MACRO_CODE_SIZE) ? SEGA_Macro_Fetch(Macro_pc++) : 0;
+        if (!op) {
+            Macro_index = MACRO_NONE; //Конец: кнопки макроса отпускаются
+            Macro_state = 0;
+        }
+        else if (!(op & 0x80)) {
+            Macro_wait = op;
+        }
+        else if (!(op & 0x40)) {
+            Macro_state = (Macro_state & ~0x003F) | (op & 0x3F);
+        }
+        else {
+            Macro_state = (Macro_state & ~0x0FC0) | ((op & 0x3F) << 6);
+        }
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запуск макроса по сочетанию и сложение с живым геймпадом. Вызывается в конце опроса.
+ *  @param  buttons - живой геймпад
+ *  @retval Кнопки с учетом макроса
+ ***************************************************************************************
+ */
+uint16_t SEGA_Macro_Filter(uint16_t buttons) {
+    uint16_t trigger, chord;
+
+    if (Macro_index == MACRO_NONE) {
+        for (uint8_t i = 0; i < SEGA_MACRO_COUNT; i++) {
+            chord = SEGA_Macro_Trigger(i) & SEGA_MACRO_CHORD;
+            if (chord && (buttons & chord) == chord && (Macro_last & chord) != chord) {
+                //Сочетание только что нажато: первый шаг уходит в этом же отчете
+                Macro_index = i;
+                Macro_pc = 0;
+                Macro_wait = 0;
+                Macro_state = 0;
+                Macro_fn_last = READ_BIT(USB->FNR, USB_FNR_FN);
+                SEGA_Macro_Run();
+                break;
+            }
+        }
+    }
+    Macro_last = buttons;
+
+    if (Macro_index == MACRO_NONE) {
+        return buttons;
+    }
+    trigger = SEGA_Macro_Trigger(Macro_index);
+    if (trigger & SEGA_MACRO_OVERRIDE) {
+        return Macro_state;
+    }
+    return (buttons & ~(trigger & SEGA_MACRO_CHORD)) | Macro_state;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Прерывание SOF (1 кГц). Отсчет кадров по USB->FNR и шаги макроса.
+ *  @retval true - макрос изменил кнопки (или закончился), нужен отчет
+ ***************************************************************************************
+ */
+bool SEGA_Macro_SOF(void) {
+    uint16_t fn, frames;
+    uint16_t state = Macro_state;
+
+    if (Macro_index == MACRO_NONE) {
+        return false;
+    }
+    fn = READ_BIT(USB->FNR, USB_FNR_FN);
+    frames = (uint16_t)(fn - Macro_fn_last) & USB_FNR_FN; //Обычно 1, больше - если SOF пропущен
+    Macro_fn_last = fn;
+    while (frames-- && Macro_index != MACRO_NONE) {
+        if (Macro_wait) {
+            Macro_wait--;
+        }
+        SEGA_Macro_Run();
+    }
+    return Macro_state != state || Macro_index == MACRO_NONE;
+}
@@ -0,0 +1,230 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_mouse.c
+ *  @brief Библиотека для работы с мышью Sega Mega Mouse через порт DB-9
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Описание протокола и доработки платы см. в SEGA_mouse.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_mouse.h"
+#include "SEGA_boot.h"
+#include "usb_device.h"
+#include "usbd_customhid.h"
+
+#define SEGA_MOUSE_STEPS 10 //Количество полубайт в посылке (шаги 0..9)
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+USB_Custom_HID_Mouse Mouse_data = { .report_id = USB_REPORT_ID_MOUSE };
+
+static uint8_t Mouse_nibble[SEGA_MOUSE_STEPS]; //Принятые полубайты
+static uint8_t Mouse_step; //Текущий шаг рукопожатия
+static uint8_t Mouse_wait; //Сколько тиков ждем ответа TL
+static bool Mouse_busy; //Идет посылка
+static bool Mouse_connected; //Мышь ответила правильным ID
+
+static uint8_t Mouse_buttons; //Текущее состояние кнопок мыши
+static uint8_t Mouse_buttons_sent; //Кнопки, ушедшие в последнем отчете
+static int32_t Mouse_acc_x; //Накопленное перемещение по X, еще не отправленное в USB
+static int32_t Mouse_acc_y; //Накопленное перемещение по Y, еще не отправленное в USB
+
+/**
+ ***************************************************************************************
+ *  @breif Чтение полубайта с PIN1-PIN4. Сигнал инвертирован триггером Шмитта.
+ ***************************************************************************************
+ */
+static inline uint8_t SEGA_Mouse_Read_Nibble(void) {
+    return (uint8_t)(~GPIOA->IDR) & 0x0F;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Уровень TL (PIN6). Сигнал инвертирован триггером Шмитта.
+ ***************************************************************************************
+ */
+static inline bool SEGA_Mouse_Read_TL(void) {
+    return READ_BIT(GPIOA->IDR, SEGA_PIN6) == 0;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Завершение посылки. TH и TR возвращаются в idle.
+ ***************************************************************************************
+ */
+static void SEGA_Mouse_Stop(void) {
+    SEGA_SELECT_ON;
+    SEGA_TR_ON;
+    Mouse_busy = false;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Перевод 8 бит модуля + знак + переполнение в перемещение
+ ***************************************************************************************
+ */
+static int32_t SEGA_Mouse_Delta(uint8_t value, bool sign, bool overflow) {
+    if (overflow) {
+        return sign ? -255 : 255;
+    }
+    return sign ? (int32_t)value - 256 : (int32_t)value;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Отправка накопленного перемещения в USB.
+ *  @attention Если USB занят, перемещение остается в накопителе и уйдет следующим отчетом.
+ ***************************************************************************************
+ */
+static void SEGA_Mouse_Report(void) {
+    int32_t dx, dy;
+
+    SEGA_Boot_Mark(SEGA_BOOT_FIRST_POLL);
+    if (hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED) {
+        //Пока хост нас не сконфигурировал, копить нечего
+        Mouse_acc_x = 0;
+        Mouse_acc_y = 0;
+        return;
+    }
+    if (!Mouse_acc_x && !Mouse_acc_y && Mouse_buttons == Mouse_buttons_sent) {
+        return;
+    }
+
+    dx = Mouse_acc_x;
+    dy = Mouse_acc_y;
+    if (dx > 127) dx = 127;
+    if (dx < -127) dx = -127;
+    if (dy > 127) dy = 127;
+    if (dy < -127) dy = -127;
+
+    Mouse_data.buttons = Mouse_buttons;
+    Mouse_data.x = (int8_t)dx;
+    Mouse_data.y = (int8_t)dy;
+    if (USBD_CUSTOM_HID_SendReport(&hUsbDeviceFS, (uint8_t*)&Mouse_data, sizeof(Mouse_data)) == USBD_OK) {
+        Mouse_acc_x -= dx;
+        Mouse_acc_y -= dy;
+        Mouse_buttons_sent = Mouse_buttons;
+        SEGA_Boot_Mark(SEGA_BOOT_FIRST_REPORT);
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Разбор принятой посылки
+ ***************************************************************************************
+ */
+static void SEGA_Mouse_Decode(void) {
+    uint8_t flags = Mouse_nibble[4];
+    uint8_t x = (uint8_t)((Mouse_nibble[6] << 4) | Mouse_nibble[7]);
+    uint8_t y = (uint8_t)((Mouse_nibble[8] << 4) | Mouse_nibble[9]);
+
+    Mouse_buttons = Mouse_nibble[5];
+    Mouse_acc_x += SEGA_Mouse_Delta(x, READ_BIT(flags, 1 << 0), READ_BIT(flags, 1 << 2));
+    //У Mega Mouse Y растет вверх, а в USB HID - вниз
+    Mouse_acc_y -= SEGA_Mouse_Delta(y, READ_BIT(flags, 1 << 1), READ_BIT(flags, 1 << 3));
+
+    if (Mouse_buttons) {
+        SEGA_LED_ON;
+    }
+    else {
+        SEGA_LED_OFF;
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Настройка под мышь: выход TR, частота опроса TIM2.
+ *  @attention Вызывать после CMSIS_TIM2_init() и SEGA_GPIO_Init().
+ ***************************************************************************************
+ */
+void SEGA_Mouse_Init(void) {
+    SEGA_TR_Output_Init();
+    SEGA_Mouse_Stop();
+    TIM2->ARR = SEGA_MOUSE_TIM2_ARR; //Опрос мыши SEGA_MOUSE_POLL_HZ раз в секунду
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Начало посылки. TH в 0, первый полубайт читаем на следующем тике TIM3.
+ ***************************************************************************************
+ */
+void SEGA_Mouse_Start(void) {
+    if (Mouse_busy) {
+        return; //Предыдущая посылка еще идет
+    }
+    Mouse_step = 0;
+    Mouse_wait = 0;
+    Mouse_busy = true;
+    SEGA_TR_ON;
+    SEGA_SELECT_OFF;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Шаг рукопожатия. Вызывается из прерывания TIM3 каждые 10 мкс.
+ *  @retval true - посылка окончена (или прервана по таймауту), TIM3 можно останавливать
+ ***************************************************************************************
+ */
+bool SEGA_Mouse_Tick(void) {
+    bool tr;
+
+    if (!Mouse_busy) {
+        return true;
+    }
+
+    if (Mouse_step != 0) {
+        //На нечетных шагах TR = 0, на четных TR = 1. Мышь отвечает тем же уровнем на TL
+        tr = (Mouse_step & 1) == 0;
+        if (SEGA_Mouse_Read_TL() != tr) {
+            if (++Mouse_wait > SEGA_MOUSE_TIMEOUT_TICKS) {
+                //Мышь не ответила. Не ждем, а бросаем посылку до следующего опроса
+                Mouse_connected = false;
+                SEGA_Mouse_Stop();
+                return true;
+            }
+            return false;
+        }
+    }
+
+    Mouse_nibble[Mouse_step] = SEGA_Mouse_Read_Nibble();
+    if (Mouse_step == 1 && Mouse_nibble[1] != SEGA_MOUSE_ID) {
+        //Это не мышь
+        Mouse_connected = false;
+        SEGA_Mouse_Stop();
+        return true;
+    }
+
+    Mouse_step++;
+    Mouse_wait = 0;
+    if (Mouse_step == SEGA_MOUSE_STEPS) {
+        SEGA_Mouse_Stop();
+        Mouse_connected = true;
+        SEGA_Mouse_Decode();
+        SEGA_Mouse_Report();
+        return true;
+    }
+
+    //Запрашиваем следующий полубайт
+    if (Mouse_step & 1) {
+        SEGA_TR_OFF;
+    }
+    else {
+        SEGA_TR_ON;
+    }
+    return false;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Отвечает ли мышь
+ ***************************************************************************************
+ */
+bool SEGA_Mouse_Connected(void) {
+    return Mouse_connected;
+}
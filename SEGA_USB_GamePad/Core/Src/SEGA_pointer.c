@@ -0,0 +1,213 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_pointer.c
+ *  @brief Режим указателя: крестовина двигает курсор мыши, A/B/C - кнопки мыши
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Настройки, кривые разгона и порядок отчетов см. в SEGA_pointer.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_pointer.h"
+#include "SEGA_mouse.h"
+#include "SEGA_config.h"
+#include "SEGA_keyboard.h"
+#include "SEGA_xinput.h"
+#include "usb_device.h"
+#include "usbd_customhid.h"
+
+#define POINTER_COUNT_MAX  1024 //Предел накопленного перемещения, если отчеты не уходят
+#define POINTER_FRAMES_MAX 8 //Больше кадров за раз не считаем (первый SOF, долгий пропуск)
+
+/*Скорость, пикселей за кадр * 256, по времени удержания направления (шагами SEGA_POINTER_STEP кадров)*/
+static const uint16_t Pointer_curve[SEGA_POINTER_CURVES][SEGA_POINTER_STEPS] = {
+    //Линейная: 0.25 -> 3 пикселя за кадр
+    { 64, 87, 109, 132, 155, 178, 200, 223, 246, 268, 291, 314, 337, 359, 382, 405,
+      427, 450, 473, 495, 518, 541, 564, 586, 609, 632, 654, 677, 700, 723, 745, 768 },
+    //Квадратичная: долго медленно (точное наведение), потом быстро
+    { 64, 65, 67, 71, 76, 82, 90, 100, 111, 123, 137, 153, 169, 188, 208, 229,
+      252, 276, 301, 328, 357, 387, 419, 452, 486, 522, 559, 598, 638, 680, 723, 768 },
+    //Постоянная: 0.75 пикселя за кадр
+    { 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192,
+      192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192 },
+};
+
+/*Ось указателя*/
+typedef struct {
+    int8_t dir; //Направление: -1, 0, 1
+    uint16_t frames; //Сколько кадров удерживается направление
+    uint16_t frac; //Дробная часть перемещения, пикселей * 256
+    int32_t count; //Накопленное перемещение, еще не отправленное в USB
+} SEGA_Pointer_Axis;
+
+static USB_Custom_HID_Mouse Pointer_report = { .report_id = USB_REPORT_ID_MOUSE };
+static SEGA_Pointer_Axis Pointer_x;
+static SEGA_Pointer_Axis Pointer_y;
+static bool Pointer_on; //Режим указателя включен
+static uint16_t Pointer_last; //Кнопки прошлого опроса, для поиска нажатия сочетания
+static volatile uint16_t Pointer_held; //Крестовина и A/B/C, если режим включен
+static uint8_t Pointer_buttons_sent; //Кнопки мыши, ушедшие в последнем отчете
+static uint16_t Pointer_fn_last; //Последнее значение USB->FNR
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+/**
+ ***************************************************************************************
+ *  @breif Начальное состояние режима по настройкам
+ ***************************************************************************************
+ */
+void SEGA_Pointer_Init(void) {
+    uint16_t setting = SEGA_Config_Get(SEGA_CONFIG_POINTER);
+
+    Pointer_on = (setting & SEGA_POINTER_CHORD) && (setting & SEGA_POINTER_START);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Переключение режима по сочетанию и забор кнопок мыши. Вызывается в конце опроса.
+ *  @param  buttons - живой геймпад
+ *  @retval Кнопки для отчета геймпада
+ ***************************************************************************************
+ */
+uint16_t SEGA_Pointer_Filter(uint16_t buttons) {
+    uint16_t chord, last = Pointer_last;
+
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_MOUSE)
+    return buttons; //Report ID 2 занят мышью
+#endif
+    if (SEGA_Keyboard_Mode() != SEGA_KEYBOARD_OFF || SEGA_XInput_Active()) {
+        return buttons; //Отчета мыши нет в дескрипторе
+    }
+    Pointer_last = buttons;
+    chord = SEGA_Config_Get(SEGA_CONFIG_POINTER) & SEGA_POINTER_CHORD;
+    if (chord && (buttons & chord) == chord) {
+        if ((last & chord) != chord) {
+            Pointer_on = !Pointer_on; //Сочетание только что нажато
+        }
+        buttons &= ~chord;
+    }
+
+    if (!Pointer_on) {
+        Pointer_held = 0;
+        return buttons;
+    }
+    Pointer_held = buttons & SEGA_POINTER_BUTTONS;
+    return buttons & ~SEGA_POINTER_BUTTONS;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Перемещение по оси за один кадр
+ *  @param  axis - ось
+ *  @param  dir - направление: -1, 0, 1
+ *  @param  curve - кривая разгона
+ ***************************************************************************************
+ */
+static void SEGA_Pointer_Step(SEGA_Pointer_Axis *axis, int8_t dir, const uint16_t *curve) {
+    uint16_t step;
+
+    if (dir != axis->dir) {
+        //Направление отпущено или сменилось: разгон заново
+        axis->dir = dir;
+        axis->frames = 0;
+        axis->frac = 0;
+    }
+    if (!dir) {
+        return;
+    }
+    step = axis->frames / SEGA_POINTER_STEP;
+    if (step < SEGA_POINTER_STEPS - 1) {
+        axis->frames++;
+    }
+    else {
+        step = SEGA_POINTER_STEPS - 1;
+    }
+    axis->frac += curve[step];
+    if (axis->count > -POINTER_COUNT_MAX && axis->count < POINTER_COUNT_MAX) {
+        axis->count += dir * (axis->frac >> 8);
+    }
+    axis->frac &= 0xFF;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Прерывание SOF (1 кГц). Отсчет кадров по USB->FNR и перемещение указателя.
+ *  @retval true - есть перемещение или кнопки мыши изменились, нужен отчет мыши
+ ***************************************************************************************
+ */
+bool SEGA_Pointer_SOF(void) {
+    const uint16_t *curve;
+    uint16_t fn, frames, held, setting;
+    uint8_t buttons;
+
+    fn = READ_BIT(USB->FNR, USB_FNR_FN);
+    frames = (uint16_t)(fn - Pointer_fn_last) & USB_FNR_FN; //Обычно 1, больше - если SOF пропущен
+    Pointer_fn_last = fn;
+    if (frames > POINTER_FRAMES_MAX) {
+        frames = POINTER_FRAMES_MAX;
+    }
+
+    held = Pointer_held;
+    setting = SEGA_Config_Get(SEGA_CONFIG_POINTER_CURVE);
+    curve = Pointer_curve[(setting < SEGA_POINTER_CURVES) ? setting : 0];
+    while (frames--) {
+        SEGA_Pointer_Step(&Pointer_x, (int8_t)(!!(held & SEGA_RIGHT_Pos) - !!(held & SEGA_LEFT_Pos)), curve);
+        SEGA_Pointer_Step(&Pointer_y, (int8_t)(!!(held & SEGA_DOWN_Pos) - !!(held & SEGA_UP_Pos)), curve);
+    }
+
+    buttons = 0;
+    if (held & SEGA_A_Pos) buttons |= SEGA_MOUSE_LEFT_Pos;
+    if (held & SEGA_B_Pos) buttons |= SEGA_MOUSE_RIGHT_Pos;
+    if (held & SEGA_C_Pos) buttons |= SEGA_MOUSE_MIDDLE_Pos;
+    Pointer_report.buttons = buttons;
+
+    return Pointer_x.count || Pointer_y.count || buttons != Pointer_buttons_sent;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Отправка накопленного перемещения и кнопок мыши в USB
+ *  @retval true - отчет принят в точку IN
+ ***************************************************************************************
+ */
+bool SEGA_Pointer_Send(void) {
+    int32_t dx, dy;
+
+    dx = Pointer_x.count;
+    dy = Pointer_y.count;
+    if (dx > 127) dx = 127;
+    if (dx < -127) dx = -127;
+    if (dy > 127) dy = 127;
+    if (dy < -127) dy = -127;
+
+    Pointer_report.x = (int8_t)dx;
+    Pointer_report.y = (int8_t)dy;
+    if (USBD_CUSTOM_HID_SendReport(&hUsbDeviceFS, (uint8_t*)&Pointer_report, sizeof(Pointer_report)) != USBD_OK) {
+        return false;
+    }
+    Pointer_x.count -= dx;
+    Pointer_y.count -= dy;
+    Pointer_buttons_sent = Pointer_report.buttons;
+    return true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Текущее состояние мыши для GET_REPORT: кнопки последнего отчета, без перемещения
+ *  @param  len - длина отчета
+ *  @retval Отчет мыши
+ ***************************************************************************************
+ */
+uint8_t *SEGA_Pointer_Report(uint16_t *len) {
+    static USB_Custom_HID_Mouse state = { .report_id = USB_REPORT_ID_MOUSE };
+
+    //Перемещение относительное: уже ушедшее повторять нельзя, хост сдвинет курсор второй раз
+    state.buttons = Pointer_buttons_sent;
+    *len = sizeof(state);
+    return (uint8_t*)&state;
+}
@@ -0,0 +1,279 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_power.c
+ *  @brief Сон между событиями и режим пониженного потребления при USB suspend
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Режимы и источники пробуждения см. в SEGA_power.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_power.h"
+#include "usb_device.h"
+#include "usbd_core.h"
+
+extern PCD_HandleTypeDef hpcd_USB_FS;
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+static volatile bool Power_suspended; //Шина USB в suspend
+static volatile uint32_t Power_event_ms; //Время suspend или последнего пробуждения
+static volatile uint16_t Power_wake_buttons; //Нажатия, пойманные во время suspend
+static volatile bool Power_wake_request; //Нужно будить хост
+static struct CMSIS_Timer_name Power_resume_timer; //Длительность сигнала RESUME
+#if SEGA_POWER_PAD_WAKE
+static bool Power_rtc_ready; //LSI и RTC запущены (LSI и домен RTC работают и в Stop)
+#endif
+
+/**
+ ***************************************************************************************
+ *  @breif USB ушел в suspend. Вызывается из прерывания USB.
+ ***************************************************************************************
+ */
+void SEGA_Power_Suspend(void) {
+    Power_event_ms = CMSIS_Millis();
+    Power_suspended = true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif USB вышел из suspend. Вызывается из прерывания USB.
+ ***************************************************************************************
+ */
+void SEGA_Power_Resume(void) {
+    Power_suspended = false;
+    Power_wake_request = false; //Хост уже проснулся, иначе разбудим его в следующем suspend
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Шина USB в suspend
+ ***************************************************************************************
+ */
+bool SEGA_Power_Suspended(void) {
+    return Power_suspended;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Нажатия во время suspend. Вызывается в конце опроса геймпада.
+ *  @param  buttons - собранная переменная Buttons
+ *  @retval Кнопки, которые нужно отправить в USB: после resume
+ *  уходит и нажатие, разбудившее хост, даже если кнопку уже отпустили.
+ *  Нажатие держится, пока отчет не принят (SEGA_Power_Sent)
+ ***************************************************************************************
+ */
+uint16_t SEGA_Power_Filter(uint16_t buttons) {
+    if (Power_suspended) {
+        if (buttons) {
+            Power_wake_buttons |= buttons;
+            Power_wake_request = true;
+        }
+        return buttons;
+    }
+    return buttons | Power_wake_buttons;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Отчет принят в USB: нажатие, разбудившее хост, доставлено.
+ *  Вызывается из SEGA_Gamepad_Send при успешной отправке.
+ ***************************************************************************************
+ */
+void SEGA_Power_Sent(void) {
+    if (!Power_suspended) {
+        Power_wake_buttons = 0;
+    }
+}
+
+#if SEGA_POWER_PAD_WAKE
+/**
+ ***************************************************************************************
+ *  @breif Запуск RTC от LSI со счетом в мс (для пробы геймпада в Stop).
+ *  Один раз: ожидания LSIRDY, RSF и RTOFF (~200 мкс) не повторяются при каждом входе в Stop
+ ***************************************************************************************
+ */
+static void SEGA_Power_RTC_Init(void) {
+    if (Power_rtc_ready) {
+        return;
+    }
+    SET_BIT(RCC->APB1ENR, RCC_APB1ENR_PWREN | RCC_APB1ENR_BKPEN);
+    SET_BIT(PWR->CR, PWR_CR_DBP); //Доступ к backup domain
+    SET_BIT(RCC->CSR, RCC_CSR_LSION);
+    while (!READ_BIT(RCC->CSR, RCC_CSR_LSIRDY)) ;
+    if (!READ_BIT(RCC->BDCR, RCC_BDCR_RTCEN)) {
+        MODIFY_REG(RCC->BDCR, RCC_BDCR_RTCSEL, RCC_BDCR_RTCSEL_LSI);
+        SET_BIT(RCC->BDCR, RCC_BDCR_RTCEN);
+    }
+    CLEAR_BIT(RTC->CRL, RTC_CRL_RSF);
+    while (!READ_BIT(RTC->CRL, RTC_CRL_RSF)) ; //Синхронизация с доменом RTC
+
+    while (!READ_BIT(RTC->CRL, RTC_CRL_RTOFF)) ;
+    SET_BIT(RTC->CRL, RTC_CRL_CNF);
+    RTC->PRLH = 0;
+    RTC->PRLL = SEGA_POWER_LSI_HZ / 1000 - 1; //1 тик = 1 мс (LSI неточный, 30-60 кГц)
+    CLEAR_BIT(RTC->CRL, RTC_CRL_CNF);
+    while (!READ_BIT(RTC->CRL, RTC_CRL_RTOFF)) ;
+    Power_rtc_ready = true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Будильник RTC через ms миллисекунд
+ ***************************************************************************************
+ */
+static void SEGA_Power_RTC_Alarm(uint16_t ms) {
+    while (!READ_BIT(RTC->CRL, RTC_CRL_RTOFF)) ;
+    SET_BIT(RTC->CRL, RTC_CRL_CNF);
+    RTC->CNTH = 0;
+    RTC->CNTL = 0;
+    RTC->ALRH = 0;
+    RTC->ALRL = ms;
+    CLEAR_BIT(RTC->CRL, RTC_CRL_ALRF); //Линия EXTI17 опустится, следующий будильник даст фронт
+    CLEAR_BIT(RTC->CRL, RTC_CRL_CNF);
+    while (!READ_BIT(RTC->CRL, RTC_CRL_RTOFF)) ;
+}
+#endif
+
+/**
+ ***************************************************************************************
+ *  @breif Пора просыпаться: хост возобновил шину или нажата кнопка
+ *  @param  pad_mask - какие линии геймпада сейчас отражают кнопки
+ ***************************************************************************************
+ */
+static bool SEGA_Power_Wake_Source(uint32_t pad_mask) {
+    if (!Power_suspended || READ_BIT(USB->ISTR, USB_ISTR_WKUP | USB_ISTR_RESET)) {
+        return true;
+    }
+    return READ_BIT(GPIOA->IDR, pad_mask) != 0;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Stop до resume шины USB или нажатия кнопки
+ ***************************************************************************************
+ */
+static void SEGA_Power_Stop(void) {
+    uint32_t lines = SEGA_POWER_USB_LINE;
+    uint32_t pad_mask = 0;
+
+    //Остановим опрос геймпада. Начатый опрос TIM3 доработает сам (< 100 мкс)
+    CLEAR_BIT(TIM2->CR1, TIM_CR1_CEN);
+    while (READ_BIT(TIM3->CR1, TIM_CR1_CEN)) ;
+    SEGA_LED_OFF;
+    if (!hUsbDeviceFS.dev_remote_wakeup) {
+        Power_wake_buttons = 0; //Хост не разрешил будить себя, старое нажатие ему уже не нужно
+    }
+    Power_wake_request = false;
+
+#if SEGA_POWER_PAD_WAKE
+    //EXTI0-EXTI5 на порт A. 1 - кнопка нажата (после SN74HC14), поэтому по фронту
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_AFIOEN);
+    CLEAR_BIT(AFIO->EXTICR[0], AFIO_EXTICR1_EXTI0 | AFIO_EXTICR1_EXTI1 | AFIO_EXTICR1_EXTI2 | AFIO_EXTICR1_EXTI3);
+    CLEAR_BIT(AFIO->EXTICR[1], AFIO_EXTICR2_EXTI4 | AFIO_EXTICR2_EXTI5);
+    lines |= SEGA_POWER_PAD_LINES | SEGA_POWER_RTC_LINE;
+    pad_mask = SEGA_POWER_PAD_IDLE_MASK;
+    SEGA_Power_RTC_Init(); //Только при первом входе, дальше - только будильник
+    SEGA_Power_RTC_Alarm(SEGA_POWER_PROBE_MS);
+#endif
+    //Только события (EMR): будят ядро из WFE, прерывания не нужны
+    EXTI->PR = lines;
+    SET_BIT(EXTI->RTSR, lines);
+    SET_BIT(EXTI->EMR, lines);
+
+    SET_BIT(RCC->APB1ENR, RCC_APB1ENR_PWREN);
+    CLEAR_BIT(PWR->CR, PWR_CR_PDDS); //Stop, а не Standby
+    SET_BIT(PWR->CR, PWR_CR_LPDS); //Регулятор в режиме пониженного потребления
+    SET_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+    //Событие, пришедшее между проверкой и WFE, не теряется: WFE сразу вернется.
+    //Лишнее (старое) событие дает только один лишний проход цикла
+    while (!SEGA_Power_Wake_Source(pad_mask)) {
+        __WFE();
+#if SEGA_POWER_PAD_WAKE
+        if (READ_BIT(RTC->CRL, RTC_CRL_ALRF)) {
+            //Проба: переключим SELECT, чтоб стали видны другие кнопки.
+            //Уже нажатую кнопку увидит проверка в начале цикла, новое нажатие даст фронт EXTI
+            if (pad_mask == SEGA_POWER_PAD_IDLE_MASK) {
+                SEGA_SELECT_OFF;
+                pad_mask = SEGA_POWER_PAD_PROBE_MASK;
+            }
+            else {
+                SEGA_SELECT_ON;
+                pad_mask = SEGA_POWER_PAD_IDLE_MASK;
+            }
+            SEGA_Power_RTC_Alarm(SEGA_POWER_PROBE_MS);
+        }
+#endif
+    }
+    CLEAR_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+#if SEGA_POWER_PAD_WAKE
+    SEGA_SELECT_ON; //SELECT в покое
+#endif
+
+    //После Stop МК работает от HSI 8 МГц
+    CMSIS_RCC_SystemClock_72MHz();
+
+    CLEAR_BIT(EXTI->EMR, lines);
+    CLEAR_BIT(EXTI->RTSR, lines);
+    EXTI->PR = lines;
+
+    Power_event_ms = CMSIS_Millis();
+    SET_BIT(TIM2->CR1, TIM_CR1_CEN);
+    TIM2->EGR = TIM_EGR_UG; //Опрос прямо сейчас: нажатие попадет в SEGA_Power_Filter и разбудит хост
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Конец сигнала RESUME (вызывается из прерывания TIM4)
+ ***************************************************************************************
+ */
+static void SEGA_Power_Resume_End(struct CMSIS_Timer_name* timer) {
+    HAL_PCD_DeActivateRemoteWakeup(&hpcd_USB_FS);
+    //Хост сам ведет resume дальше. Прерывание WKUP после своего же сигнала может не прийти,
+    //поэтому возвращаем состояние устройства здесь, иначе отчеты не уйдут
+    USBD_LL_Resume(&hUsbDeviceFS);
+    Power_suspended = false;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Сигнал remote wakeup (RESUME на шине SEGA_POWER_RESUME_MS)
+ ***************************************************************************************
+ */
+static void SEGA_Power_Remote_Wakeup(void) {
+    Power_wake_request = false;
+    if (!hUsbDeviceFS.dev_remote_wakeup || Power_resume_timer.active) {
+        return; //Хост не разрешил (SET_FEATURE DEVICE_REMOTE_WAKEUP) или сигнал уже идет
+    }
+    CLEAR_BIT(USB->CNTR, USB_CNTR_LP_MODE);
+    CLEAR_BIT(USB->CNTR, USB_CNTR_FSUSP);
+    HAL_PCD_ActivateRemoteWakeup(&hpcd_USB_FS);
+    Power_resume_timer.Callback = SEGA_Power_Resume_End;
+    CMSIS_Timer_Start(&Power_resume_timer, SEGA_POWER_RESUME_MS * 1000, 0);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Сон до следующего прерывания или Stop при USB suspend. Вызывать в конце главного цикла.
+ *  @param  busy - кому-то из модулей нужно работать дальше без прерываний
+ ***************************************************************************************
+ */
+void SEGA_Power_Idle(bool busy) {
+    if (Power_wake_request && Power_suspended) {
+        SEGA_Power_Remote_Wakeup();
+    }
+    if (busy) {
+        return;
+    }
+    if (Power_suspended && !Power_resume_timer.active && CMSIS_Millis() - Power_event_ms >= SEGA_POWER_SUSPEND_DELAY_MS) {
+        SEGA_Power_Stop();
+        return;
+    }
+    //Работа, появившаяся в прерываниях после проверок главного цикла, подождет
+    //следующего прерывания (SOF - 1 мс, TIM2 - 4 мс)
+    __WFI();
+}
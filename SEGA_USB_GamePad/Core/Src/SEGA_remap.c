@@ -0,0 +1,81 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_remap.c
+ *  @brief Переназначение кнопок через таблицы подстановки
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат настроек и устройство таблиц см. в SEGA_remap.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_remap.h"
+#include "SEGA_config.h"
+
+static uint16_t Remap_lut[2][2][SEGA_REMAP_LUT_SIZE]; //Две пары таблиц: рабочая и запасная
+static const uint16_t (*volatile Remap_active)[SEGA_REMAP_LUT_SIZE] = Remap_lut[0]; //Рабочая пара
+static uint32_t Remap_version; //SEGA_Config_Version, по которой построены таблицы
+
+/**
+ ***************************************************************************************
+ *  @breif Построение таблиц по настройкам в запасную пару и переключение на нее
+ ***************************************************************************************
+ */
+static void SEGA_Remap_Build(void) {
+    uint16_t (*lut)[SEGA_REMAP_LUT_SIZE] = (Remap_active == Remap_lut[0]) ? Remap_lut[1] : Remap_lut[0];
+    uint16_t target[SEGA_REMAP_BITS]; //Куда уходит каждый бит Buttons
+    uint8_t bit, half, nibble;
+
+    Remap_version = SEGA_Config_Version();
+    for (bit = 0; bit < SEGA_REMAP_BITS; bit++) {
+        nibble = (SEGA_Config_Get(SEGA_CONFIG_REMAP_0 + bit / 4) >> ((bit % 4) * 4)) & 0xF;
+        target[bit] = (nibble < SEGA_REMAP_BITS) ? (uint16_t)(1 << nibble) : 0;
+    }
+
+    for (half = 0; half < 2; half++) {
+        lut[half][0] = 0;
+        for (uint16_t i = 1; i < SEGA_REMAP_LUT_SIZE; i++) {
+            //Сочетание = сочетание без младшей нажатой кнопки + эта кнопка
+            bit = (uint8_t)__builtin_ctz(i);
+            lut[half][i] = lut[half][i & (i - 1)] | target[half * SEGA_REMAP_HALF + bit];
+        }
+    }
+    Remap_active = (const uint16_t (*)[SEGA_REMAP_LUT_SIZE])lut;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Построение таблиц по настройкам. Вызывать после SEGA_Config_Init, до запуска опроса.
+ ***************************************************************************************
+ */
+void SEGA_Remap_Init(void) {
+    SEGA_Remap_Build();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Пересчет таблиц, если настройки изменились. Вызывать в главном цикле.
+ ***************************************************************************************
+ */
+void SEGA_Remap_Process(void) {
+    if (Remap_version != SEGA_Config_Version()) {
+        SEGA_Remap_Build();
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Переназначение кнопок. Вызывается в конце опроса геймпада.
+ *  @param  buttons - кнопки как на геймпаде
+ *  @retval Кнопки после переназначения
+ ***************************************************************************************
+ */
+uint16_t SEGA_Remap(uint16_t buttons) {
+    const uint16_t (*lut)[SEGA_REMAP_LUT_SIZE] = Remap_active;
+
+    return lut[0][buttons & (SEGA_REMAP_LUT_SIZE - 1)] | lut[1][(buttons >> SEGA_REMAP_HALF) & (SEGA_REMAP_LUT_SIZE - 1)];
+}
@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_saturn.c
+ *  @brief Библиотека для работы с цифровым геймпадом SEGA Saturn
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Описание протокола и доработки платы см. в SEGA_saturn.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_saturn.h"
+
+extern uint16_t Buttons;
+
+/*Состояние линий TH/TR для каждой фазы. Одна запись в BSRR - обе линии сразу*/
+static const uint32_t Saturn_select[] = {
+    GPIO_BSRR_BS6 | GPIO_BSRR_BS7, //Фаза 0: TH = 1, TR = 1 (idle)
+    GPIO_BSRR_BR6 | GPIO_BSRR_BR7, //Фаза 1: TH = 0, TR = 0
+    GPIO_BSRR_BS6 | GPIO_BSRR_BR7, //Фаза 2: TH = 1, TR = 0
+    GPIO_BSRR_BR6 | GPIO_BSRR_BS7, //Фаза 3: TH = 0, TR = 1
+    GPIO_BSRR_BS6 | GPIO_BSRR_BS7, //Конец: TH = 1, TR = 1 (idle)
+};
+
+/*Какой бит Buttons соответствует PIN1-PIN4 в каждой фазе*/
+static const uint16_t Saturn_map[4][4] = {
+    { 0,            0,             0,             SEGA_L_Pos },
+    { SEGA_Z_Pos,   SEGA_Y_Pos,    SEGA_X_Pos,    SEGA_R_Pos },
+    { SEGA_B_Pos,   SEGA_C_Pos,    SEGA_A_Pos,    SEGA_START_Pos },
+    { SEGA_UP_Pos,  SEGA_DOWN_Pos, SEGA_LEFT_Pos, SEGA_RIGHT_Pos },
+};
+
+/**
+ ***************************************************************************************
+ *  @breif Проверка, что к порту подключен геймпад Saturn.
+ *  @attention Вызывать в idle (TH = 1, TR = 1).
+ ***************************************************************************************
+ */
+bool SEGA_Saturn_Detect(void) {
+    return (READ_REG(GPIOA->IDR) & SEGA_SATURN_ID_MASK) == SEGA_SATURN_ID;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Шаг опроса геймпада Saturn.
+ *  На нечетных значениях счетчика переключаются линии TH/TR,
+ *  на четных - читается очередная группа кнопок.
+ *  @param  counter - номер шага 0..SEGA_SATURN_COUNTER_END
+ ***************************************************************************************
+ */
+void SEGA_Saturn_Strobe(uint8_t counter) {
+    uint8_t phase = counter >> 1;
+    uint8_t data;
+    uint16_t state = 0;
+    uint16_t mask = 0;
+
+    if (counter & 1) {
+        GPIOA->BSRR = Saturn_select[phase + 1];
+        return;
+    }
+
+    data = READ_REG(GPIOA->IDR) & 0x0F;
+    for (uint8_t i = 0; i < 4; i++) {
+        mask |= Saturn_map[phase][i];
+        if (data & (1 << i)) {
+            state |= Saturn_map[phase][i];
+        }
+    }
+    Buttons = (Buttons & ~mask) | state;
+}
@@ -0,0 +1,89 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_socd.c
+ *  @brief Разрешение одновременных противоположных направлений крестовины (SOCD)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Правила см. в SEGA_socd.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_socd.h"
+#include "SEGA_config.h"
+
+typedef struct {
+    uint16_t positive; //UP или LEFT
+    uint16_t negative; //DOWN или RIGHT
+    uint16_t first; //Направление, нажатое первым (0 - неизвестно)
+    uint16_t last; //Направление, нажатое последним (0 - неизвестно)
+}SEGA_SOCD_Axis;
+
+static SEGA_SOCD_Axis SOCD_vertical = { .positive = SEGA_UP_Pos, .negative = SEGA_DOWN_Pos };
+static SEGA_SOCD_Axis SOCD_horizontal = { .positive = SEGA_LEFT_Pos, .negative = SEGA_RIGHT_Pos };
+static uint16_t SOCD_last_buttons; //Кнопки прошлого опроса, для поиска фронтов
+
+/**
+ ***************************************************************************************
+ *  @breif Одна ось: обновление порядка нажатий и разрешение
+ *  @param  *axis - ось
+ *  @param  buttons - кнопки этого опроса
+ *  @param  pressed - фронты нажатия (кнопки, которых не было в прошлом опросе)
+ *  @param  policy - SEGA_SOCD_...
+ *  @retval Биты оси после разрешения
+ ***************************************************************************************
+ */
+static uint16_t SEGA_SOCD_Axis_Resolve(SEGA_SOCD_Axis *axis, uint16_t buttons, uint16_t pressed, uint8_t policy) {
+    uint16_t both = axis->positive | axis->negative;
+    uint16_t held = buttons & both;
+
+    if (held != both) {
+        //Одно направление или ни одного: конфликта нет, оно же первое и последнее
+        axis->first = held;
+        axis->last = held;
+        return held;
+    }
+
+    pressed &= both;
+    if (pressed == both) {
+        //Оба нажаты в одном опросе: порядок неизвестен
+        axis->first = 0;
+        axis->last = 0;
+    }
+    else if (pressed) {
+        axis->last = pressed;
+    }
+
+    switch (policy) {
+    case SEGA_SOCD_LAST:
+        return axis->last;
+    case SEGA_SOCD_FIRST:
+        return axis->first;
+    case SEGA_SOCD_UP:
+        return (axis->positive == SEGA_UP_Pos) ? SEGA_UP_Pos : 0;
+    default:
+        return 0;
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Разрешение SOCD. Вызывается перед каждой отправкой отчета геймпада.
+ *  @param  buttons - кнопки, которые уходят в отчет
+ *  @retval Кнопки, в которых на каждой оси нажато не больше одного направления
+ ***************************************************************************************
+ */
+uint16_t SEGA_SOCD_Filter(uint16_t buttons) {
+    uint8_t policy = (uint8_t)SEGA_Config_Get(SEGA_CONFIG_SOCD);
+    uint16_t pressed = buttons & ~SOCD_last_buttons;
+    uint16_t axes = SOCD_vertical.positive | SOCD_vertical.negative | SOCD_horizontal.positive | SOCD_horizontal.negative;
+
+    SOCD_last_buttons = buttons;
+    return (buttons & ~axes)
+        | SEGA_SOCD_Axis_Resolve(&SOCD_vertical, buttons, pressed, policy)
+        | SEGA_SOCD_Axis_Resolve(&SOCD_horizontal, buttons, pressed, policy);
+}
@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_stamp.c
+ *  @brief Номер и возраст отчета геймпада для компенсации задержки в эмуляторах
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат отчета и порядок отсчета возраста см. в SEGA_stamp.h.
+ *  Дескриптор отчета собирается из CUSTOM_HID_ReportDesc_FS (usbd_custom_hid_if.c).
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_stamp.h"
+#include "usb_device.h"
+#include "usbd_customhid.h"
+#include "usbd_custom_hid_if.h"
+
+static bool Stamp_active;
+static uint8_t Stamp_seq; //Номер следующего отчета
+static uint32_t Stamp_sample_us; //Время окончания последнего опроса, мкс
+
+/**
+ ***************************************************************************************
+ *  @breif Включение режима. Вызывается при выборе режима по первому опросу
+ *  (SEGA_Keyboard_Select), до того как хост прочитает дескрипторы.
+ ***************************************************************************************
+ */
+void SEGA_Stamp_Init(void) {
+    Stamp_active = (CUSTOM_HID_Stamp_FS() == USBD_OK);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Режим включен
+ *  @retval true - отчет геймпада с номером и возрастом
+ ***************************************************************************************
+ */
+bool SEGA_Stamp_Active(void) {
+    return Stamp_active;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запоминаем время окончания опроса: от него считается возраст кнопок
+ ***************************************************************************************
+ */
+void SEGA_Stamp_Sample(void) {
+    if (Stamp_active) {
+        Stamp_sample_us = CMSIS_Micros();
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Длина отчета геймпада
+ *  @retval sizeof(USB_Custom_HID_Gamepad) в режиме меток, без SEGA_STAMP_BYTES - без него
+ ***************************************************************************************
+ */
+uint16_t SEGA_Stamp_Size(void) {
+    return Stamp_active ? sizeof(USB_Custom_HID_Gamepad) : sizeof(USB_Custom_HID_Gamepad) - SEGA_STAMP_BYTES;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Номер и возраст в отчет геймпада прямо перед загрузкой в точку IN.
+ *  Вызывается из USBD_LL_Transmit для любой точки, остальные отчеты не трогает.
+ *  @param  ep_addr - адрес точки
+ *  @param  pbuf - отчет
+ *  @param  size - длина отчета
+ ***************************************************************************************
+ */
+void SEGA_Stamp_Transmit(uint8_t ep_addr, uint8_t *pbuf, uint16_t size) {
+    USB_Custom_HID_Gamepad *report = (USB_Custom_HID_Gamepad *)pbuf;
+    uint32_t age;
+
+    if (!Stamp_active || ep_addr != CUSTOM_HID_EPIN_ADDR || size != sizeof(USB_Custom_HID_Gamepad)
+        || report->report_id != USB_REPORT_ID_GAMEPAD) {
+        return;
+    }
+    age = CMSIS_Micros() - Stamp_sample_us;
+    report->seq = Stamp_seq++;
+    report->age = (age > SEGA_STAMP_AGE_MAX) ? SEGA_STAMP_AGE_MAX : (uint16_t)age;
+}
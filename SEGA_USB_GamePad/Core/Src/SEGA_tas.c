@@ -0,0 +1,395 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_tas.c
+ *  @brief Запись и воспроизведение нажатий геймпада с привязкой к кадрам USB
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат записи и режимы см. в SEGA_tas.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_tas.h"
+
+#define SEGA_TAS_CMD_NONE 0xFF //Нет команды
+
+static uint8_t TAS_ring[SEGA_TAS_RAM_SIZE]; //Кольцевой буфер записей
+static volatile uint32_t TAS_written; //Сколько байт записано с начала записи
+static volatile uint32_t TAS_spilled; //Сколько из них уже лежит во Flash
+static uint32_t TAS_length; //Длина последней законченной записи
+static uint32_t TAS_pos; //Позиция чтения при воспроизведении
+static bool TAS_flash; //Сбрасывать ли запись во Flash
+static uint8_t TAS_erase_page; //Следующая страница для стирания (режим SEGA_TAS_RECORD_ERASE)
+
+static volatile uint8_t TAS_mode = SEGA_TAS_IDLE;
+static volatile uint8_t TAS_pending = SEGA_TAS_CMD_NONE;
+static volatile bool TAS_overflow;
+
+static uint32_t TAS_frame; //Номер кадра с начала записи/воспроизведения
+static uint16_t TAS_fn_last; //Последнее значение USB->FNR
+static uint32_t TAS_event_frame; //Запись: кадр прошлой записи. Воспроизведение: кадр следующей
+static uint16_t TAS_state; //Последнее записанное/воспроизведенное состояние кнопок
+
+/**
+ ***************************************************************************************
+ *  @breif Обновление счетчика кадров по номеру кадра USB (11 бит)
+ ***************************************************************************************
+ */
+static void SEGA_TAS_Frame_Update(void) {
+    uint16_t fn = READ_BIT(USB->FNR, USB_FNR_FN);
+
+    TAS_frame += (uint16_t)(fn - TAS_fn_last) & USB_FNR_FN;
+    TAS_fn_last = fn;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Начало отсчета кадров с нуля
+ ***************************************************************************************
+ */
+static void SEGA_TAS_Frame_Reset(void) {
+    TAS_frame = 0;
+    TAS_fn_last = READ_BIT(USB->FNR, USB_FNR_FN);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запись числа в формате varint
+ *  @retval Количество записанных байт
+ ***************************************************************************************
+ */
+static uint8_t SEGA_TAS_Varint_Put(uint8_t *buf, uint32_t value) {
+    uint8_t n = 0;
+
+    while (value > 0x7F) {
+        buf[n++] = (uint8_t)(value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buf[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Чтение байта записи: начало из Flash, остаток из RAM
+ ***************************************************************************************
+ */
+static uint8_t SEGA_TAS_Get_Byte(uint32_t pos) {
+    if (pos < TAS_spilled) {
+        return *(const uint8_t *)(SEGA_TAS_FLASH_START + pos);
+    }
+    return TAS_ring[pos & (SEGA_TAS_RAM_SIZE - 1)];
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Чтение числа varint с текущей позиции воспроизведения
+ ***************************************************************************************
+ */
+static uint32_t SEGA_TAS_Varint_Get(void) {
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    uint8_t data;
+
+    do {
+        data = SEGA_TAS_Get_Byte(TAS_pos++);
+        value |= (uint32_t)(data & 0x7F) << shift;
+        shift += 7;
+    } while ((data & 0x80) && shift < 35);
+    return value;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Добавление записи об изменении кнопок
+ ***************************************************************************************
+ */
+static void SEGA_TAS_Record(uint16_t buttons) {
+    uint8_t buf[SEGA_TAS_RECORD_MAX];
+    uint8_t n;
+    uint32_t pos = TAS_written;
+
+    n = SEGA_TAS_Varint_Put(buf, TAS_frame - TAS_event_frame);
+    n += SEGA_TAS_Varint_Put(buf + n, buttons ^ TAS_state);
+
+    if (pos + n - TAS_spilled > SEGA_TAS_RAM_SIZE) {
+        //Еще не сброшенные во Flash данные затерлись бы. Заканчиваем запись
+        TAS_overflow = true;
+        TAS_length = pos;
+        TAS_mode = SEGA_TAS_IDLE;
+        return;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        TAS_ring[(pos + i) & (SEGA_TAS_RAM_SIZE - 1)] = buf[i];
+    }
+    TAS_written = pos + n;
+    TAS_event_frame = TAS_frame;
+    TAS_state = buttons;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Начало записи с пустого буфера
+ ***************************************************************************************
+ */
+static void SEGA_TAS_Record_Begin(void) {
+    __disable_irq();
+    TAS_written = 0;
+    TAS_spilled = 0;
+    TAS_length = 0;
+    TAS_state = 0;
+    TAS_event_frame = 0;
+    TAS_overflow = false;
+    SEGA_TAS_Frame_Reset();
+    TAS_mode = SEGA_TAS_RECORD;
+    __enable_irq();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Старт записи
+ *  @param  flash - сбрасывать ли запись во Flash
+ ***************************************************************************************
+ */
+static void SEGA_TAS_Record_Start(bool flash) {
+    __disable_irq();
+    TAS_mode = SEGA_TAS_IDLE;
+    TAS_length = 0; //Старая запись больше не воспроизводится: ее страницы Flash будут стерты
+    TAS_written = 0; //И ее остаток в RAM больше не сбрасывается во Flash
+    TAS_spilled = 0;
+    __enable_irq();
+    TAS_flash = flash;
+    if (flash) {
+        //Стираем заранее (во время записи стирание страницы, ~20 мс, недопустимо),
+        //по одной странице за вызов SEGA_TAS_Process, между опросами (SEGA_TAS_Erase)
+        TAS_erase_page = 0;
+        TAS_mode = SEGA_TAS_RECORD_ERASE;
+        return;
+    }
+    SEGA_TAS_Record_Begin();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Стирание одной страницы под запись. После последней начинается запись.
+ *  @attention Только между опросами геймпада и с запрещенными прерываниями, как в SEGA_config:
+ *  пока идет стирание, выборка команд из Flash стоит, и стробы SELECT разорвались бы.
+ ***************************************************************************************
+ */
+static void SEGA_TAS_Erase(void) {
+    bool ok;
+
+    __disable_irq();
+    if (READ_BIT(TIM3->CR1, TIM_CR1_CEN)) {
+        __enable_irq();
+        return; //Идут стробы SELECT, подождем конца опроса
+    }
+    CMSIS_FLASH_Unlock();
+    ok = CMSIS_FLASH_Page_Erase(SEGA_TAS_FLASH_START + TAS_erase_page * 1024);
+    __enable_irq();
+
+    if (!ok) {
+        TAS_flash = false; //Пишем только в RAM
+        SEGA_TAS_Record_Begin();
+    }
+    else if (++TAS_erase_page == SEGA_TAS_FLASH_PAGES) {
+        SEGA_TAS_Record_Begin();
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Старт воспроизведения последней записи
+ ***************************************************************************************
+ */
+static void SEGA_TAS_Play_Start(void) {
+    __disable_irq();
+    if (TAS_length) {
+        TAS_pos = 0;
+        TAS_state = 0;
+        SEGA_TAS_Frame_Reset();
+        TAS_event_frame = SEGA_TAS_Varint_Get();
+        TAS_mode = SEGA_TAS_PLAY;
+    }
+    __enable_irq();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Остановка записи/воспроизведения
+ ***************************************************************************************
+ */
+static void SEGA_TAS_Stop(void) {
+    __disable_irq();
+    if (TAS_mode == SEGA_TAS_RECORD) {
+        TAS_length = TAS_written;
+    }
+    TAS_mode = SEGA_TAS_IDLE;
+    __enable_irq();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Перенос одного полуслова записи из RAM во Flash.
+ *  @attention Только между опросами геймпада: запись во Flash останавливает выборку команд.
+ ***************************************************************************************
+ */
+static void SEGA_TAS_Spill(void) {
+    uint32_t pos = TAS_spilled;
+    uint16_t data;
+
+    if (!TAS_flash || (TAS_mode != SEGA_TAS_RECORD && TAS_mode != SEGA_TAS_IDLE)) {
+        return;
+    }
+    if (TAS_written - pos < 2 || pos + 2 > SEGA_TAS_FLASH_SIZE) {
+        return;
+    }
+
+    data = TAS_ring[pos & (SEGA_TAS_RAM_SIZE - 1)] | (TAS_ring[(pos + 1) & (SEGA_TAS_RAM_SIZE - 1)] << 8);
+    __disable_irq();
+    if (READ_BIT(TIM3->CR1, TIM_CR1_CEN)) {
+        __enable_irq();
+        return;
+    }
+    if (CMSIS_FLASH_Program_HalfWord(SEGA_TAS_FLASH_START + pos, data)) {
+        TAS_spilled = pos + 2;
+    }
+    else {
+        TAS_flash = false; //Дальше пишем только в RAM
+    }
+    __enable_irq();
+    if (!TAS_flash || TAS_spilled + 2 > SEGA_TAS_FLASH_SIZE) {
+        CMSIS_FLASH_Lock();
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Команда управления. Выполняется в главном цикле (SEGA_TAS_Process).
+ *  @param  cmd - SEGA_TAS_CMD_...
+ ***************************************************************************************
+ */
+void SEGA_TAS_Command(uint8_t cmd) {
+    TAS_pending = cmd;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Обработка команд и сброс записи во Flash. Вызывать в главном цикле.
+ ***************************************************************************************
+ */
+void SEGA_TAS_Process(void) {
+    uint8_t cmd = TAS_pending;
+
+    if (cmd != SEGA_TAS_CMD_NONE) {
+        TAS_pending = SEGA_TAS_CMD_NONE;
+        switch (cmd) {
+        case SEGA_TAS_CMD_STOP:
+            SEGA_TAS_Stop();
+            break;
+        case SEGA_TAS_CMD_RECORD:
+            SEGA_TAS_Record_Start(false);
+            break;
+        case SEGA_TAS_CMD_RECORD_FLASH:
+            SEGA_TAS_Record_Start(true);
+            break;
+        case SEGA_TAS_CMD_PLAY:
+            SEGA_TAS_Stop();
+            SEGA_TAS_Play_Start();
+            break;
+        }
+    }
+    if (TAS_mode == SEGA_TAS_RECORD_ERASE) {
+        SEGA_TAS_Erase();
+        return;
+    }
+    SEGA_TAS_Spill();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Есть ли данные, которые еще нужно сбросить во Flash
+ ***************************************************************************************
+ */
+bool SEGA_TAS_Busy(void) {
+    if (TAS_mode == SEGA_TAS_RECORD_ERASE) {
+        return true;
+    }
+    return TAS_flash && TAS_mode != SEGA_TAS_PLAY && TAS_written - TAS_spilled >= 2 && TAS_spilled + 2 <= SEGA_TAS_FLASH_SIZE;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запись или подмена кнопок. Вызывается в конце опроса геймпада.
+ *  @param  buttons - собранная переменная Buttons
+ *  @retval Кнопки, которые нужно отправить в USB
+ ***************************************************************************************
+ */
+uint16_t SEGA_TAS_Filter(uint16_t buttons) {
+    switch (TAS_mode) {
+    case SEGA_TAS_PLAY:
+        return TAS_state;
+    case SEGA_TAS_RECORD:
+        SEGA_TAS_Frame_Update();
+        if (buttons != TAS_state) {
+            SEGA_TAS_Record(buttons);
+        }
+        break;
+    }
+    return buttons;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Прерывание SOF (1 кГц). Отсчет кадров, при воспроизведении - применение записей этого кадра.
+ *  @retval true - кнопки изменились, в этом кадре нужен отчет (SEGA_TAS_Filter подставит TAS_state)
+ ***************************************************************************************
+ */
+bool SEGA_TAS_SOF(void) {
+    bool changed = false;
+
+    if (TAS_mode != SEGA_TAS_RECORD && TAS_mode != SEGA_TAS_PLAY) {
+        return false;
+    }
+    SEGA_TAS_Frame_Update(); //Номер кадра USB 11-битный, обновляем не реже раза в 2 с
+    if (TAS_mode != SEGA_TAS_PLAY) {
+        return false;
+    }
+    while (TAS_frame >= TAS_event_frame) {
+        if (TAS_pos >= TAS_length) {
+            //Последнее состояние продержалось кадр - дальше снова живой геймпад
+            TAS_mode = SEGA_TAS_IDLE;
+            return true;
+        }
+        TAS_state ^= (uint16_t)SEGA_TAS_Varint_Get();
+        changed = true;
+        if (TAS_pos >= TAS_length) {
+            TAS_event_frame = TAS_frame + 1;
+            break;
+        }
+        TAS_event_frame += SEGA_TAS_Varint_Get();
+    }
+    return changed;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Текущий режим (SEGA_TAS_IDLE, SEGA_TAS_RECORD, SEGA_TAS_PLAY)
+ ***************************************************************************************
+ */
+uint8_t SEGA_TAS_Get_Mode(void) {
+    return TAS_mode;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Была ли запись остановлена из-за нехватки места
+ ***************************************************************************************
+ */
+bool SEGA_TAS_Overflow(void) {
+    return TAS_overflow;
+}
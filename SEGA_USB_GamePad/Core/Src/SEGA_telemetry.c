@@ -0,0 +1,217 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_telemetry.c
+ *  @brief Поток изменений кнопок с метками времени по USART1 (для захвата видео и замеров задержки)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат кадров см. в SEGA_telemetry.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_telemetry.h"
+#include "usbd_cdc_acm.h"
+
+typedef struct {
+    uint32_t time; //CMSIS_Micros() в момент опроса
+    uint16_t buttons;
+}SEGA_Telemetry_Event;
+
+static SEGA_Telemetry_Event Telemetry_queue[SEGA_TELEMETRY_QUEUE];
+static volatile uint8_t Telemetry_head; //Пишет только прерывание TIM3
+static volatile uint8_t Telemetry_tail; //Пишет только главный цикл
+static volatile bool Telemetry_overflow; //Событие потеряно, нужно полное состояние
+static bool Telemetry_enabled;
+static uint16_t Telemetry_live; //Последнее значение Buttons (в прерывании)
+
+static uint8_t Telemetry_packet[SEGA_TELEMETRY_PACKET]; //Буфер DMA. Меняется только когда DMA свободен
+static uint32_t Telemetry_last_time; //Время, от которого считается следующий кадр
+static uint16_t Telemetry_state; //Состояние кнопок, известное ПК
+static bool Telemetry_sync; //ПК получил полное состояние
+static bool Telemetry_cdc; //Дублировать поток в COM-порт USB
+static uint16_t Telemetry_cdc_pending; //Пакет еще не передан в COM-порт
+
+/**
+ ***************************************************************************************
+ *  @breif Запись числа в формате varint
+ *  @retval Количество записанных байт
+ ***************************************************************************************
+ */
+static uint8_t SEGA_Telemetry_Varint_Put(uint8_t *buf, uint32_t value) {
+    uint8_t n = 0;
+
+    while (value > 0x7F) {
+        buf[n++] = (uint8_t)(value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buf[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif CRC-8, полином x^8 + x^2 + x + 1 (0x07), начальное значение 0
+ ***************************************************************************************
+ */
+static uint8_t SEGA_Telemetry_CRC8(const uint8_t *data, uint8_t size) {
+    uint8_t crc = 0;
+
+    while (size--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Сборка одного кадра
+ *  @param  *buf - куда писать (не меньше SEGA_TELEMETRY_FRAME_MAX байт)
+ *  @param  time - CMSIS_Micros() события
+ *  @param  buttons - состояние кнопок
+ *  @retval Длина кадра
+ ***************************************************************************************
+ */
+static uint8_t SEGA_Telemetry_Frame(uint8_t *buf, uint32_t time, uint16_t buttons) {
+    uint32_t dt = time - Telemetry_last_time;
+    uint8_t n = 1;
+
+    Telemetry_last_time = time;
+    n += SEGA_Telemetry_Varint_Put(buf + n, dt);
+    if (Telemetry_sync) {
+        buf[0] = SEGA_TELEMETRY_DELTA;
+        n += SEGA_Telemetry_Varint_Put(buf + n, buttons ^ Telemetry_state);
+    }
+    else {
+        buf[0] = SEGA_TELEMETRY_STATE;
+        n += SEGA_Telemetry_Varint_Put(buf + n, buttons);
+        Telemetry_sync = true;
+    }
+    buf[n] = SEGA_Telemetry_CRC8(buf, n);
+    Telemetry_state = buttons;
+    return n + 1;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Настройка USART1 и DMA
+ *  @attention Занимает USART1, несовместимо с SEGA_PROTOCOL_CONSOLE
+ ***************************************************************************************
+ */
+void SEGA_Telemetry_Init(void) {
+    CMSIS_USART1_Init();
+    CLEAR_BIT(USART1->CR1, USART_CR1_RXNEIE | USART_CR1_IDLEIE); //Только передача
+    NVIC_DisableIRQ(USART1_IRQn);
+    CMSIS_USART_Set_Baudrate(USART1, SEGA_TELEMETRY_BAUDRATE);
+    CMSIS_USART_DMA_TX_Init(&husart1_dma_tx);
+
+    Telemetry_last_time = CMSIS_Micros();
+    Telemetry_sync = false;
+    Telemetry_enabled = true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Новое значение Buttons. Вызывается в конце опроса из прерывания TIM3.
+ *  @attention Постоянное время: только запись в очередь
+ ***************************************************************************************
+ */
+void SEGA_Telemetry_Push(uint16_t buttons) {
+    uint8_t head = Telemetry_head;
+    SEGA_Telemetry_Event *event;
+
+    if (!Telemetry_enabled || buttons == Telemetry_live) {
+        return;
+    }
+    Telemetry_live = buttons;
+    if ((uint8_t)(head - Telemetry_tail) >= SEGA_TELEMETRY_QUEUE) {
+        Telemetry_overflow = true; //Главный цикл не успевает. ПК получит полное состояние
+        return;
+    }
+    event = &Telemetry_queue[head & (SEGA_TELEMETRY_QUEUE - 1)];
+    event->time = CMSIS_Micros();
+    event->buttons = buttons;
+    Telemetry_head = head + 1; //Публикуем событие после записи
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Сборка накопившихся событий в пакет и отправка через DMA. Вызывать в главном цикле.
+ ***************************************************************************************
+ */
+void SEGA_Telemetry_Process(void) {
+    uint16_t size = 0;
+    uint8_t tail = Telemetry_tail;
+    SEGA_Telemetry_Event *event;
+    uint32_t now;
+    uint16_t live;
+    bool empty;
+
+    if (!Telemetry_enabled || CMSIS_USART_DMA_TX_Busy(&husart1_dma_tx)) {
+        return; //Буфер пакета еще передается
+    }
+#if USBD_CDC_ACM
+    if (Telemetry_cdc_pending) {
+        //Точки CDC или HID были заняты. Пакет в COM-порт уходит целиком или не уходит вовсе
+        if (USBD_CDC_ACM_Busy() || USBD_CDC_ACM_Transmit(Telemetry_packet, Telemetry_cdc_pending) == USBD_BUSY) {
+            return;
+        }
+        Telemetry_cdc_pending = 0;
+        return;
+    }
+    if (USBD_CDC_ACM_Busy()) {
+        return;
+    }
+#endif
+
+    while (tail != Telemetry_head && size + SEGA_TELEMETRY_FRAME_MAX <= SEGA_TELEMETRY_PACKET) {
+        event = &Telemetry_queue[tail & (SEGA_TELEMETRY_QUEUE - 1)];
+        size += SEGA_Telemetry_Frame(Telemetry_packet + size, event->time, event->buttons);
+        tail++;
+    }
+    Telemetry_tail = tail;
+
+    if (size + SEGA_TELEMETRY_FRAME_MAX <= SEGA_TELEMETRY_PACKET) {
+        //Очередь пуста: проверим переполнение и долгую тишину
+        __disable_irq();
+        empty = (Telemetry_tail == Telemetry_head);
+        now = CMSIS_Micros();
+        live = Telemetry_live;
+        if (empty && Telemetry_overflow) {
+            Telemetry_overflow = false;
+            Telemetry_sync = false;
+        }
+        __enable_irq();
+        if (empty && (!Telemetry_sync || now - Telemetry_last_time >= SEGA_TELEMETRY_KEEPALIVE_MS * 1000UL)) {
+            size += SEGA_Telemetry_Frame(Telemetry_packet + size, now, Telemetry_sync ? Telemetry_state : live);
+        }
+    }
+
+    if (size) {
+        CMSIS_USART_Transmit_DMA(&husart1_dma_tx, Telemetry_packet, size);
+#if USBD_CDC_ACM
+        if (Telemetry_cdc && USBD_CDC_ACM_Connected()) {
+            Telemetry_cdc_pending = size;
+        }
+#endif
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Дублировать поток в виртуальный COM-порт
+ *  @param  enable - true: включить. Первым кадром уйдет полное состояние
+ ***************************************************************************************
+ */
+void SEGA_Telemetry_CDC(bool enable) {
+    if (enable && !Telemetry_cdc) {
+        Telemetry_sync = false; //Программе на ПК нужна точка отсчета
+    }
+    Telemetry_cdc = enable;
+}
@@ -0,0 +1,124 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_turbo.c
+ *  @brief Турбо (автоматическое повторение нажатий) с привязкой к кадрам USB
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат настроек и устройство таблицы см. в SEGA_turbo.h
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_turbo.h"
+#include "SEGA_config.h"
+
+static uint16_t Turbo_lut[2][SEGA_TURBO_PERIOD]; //Рабочая и запасная таблицы
+static const uint16_t *volatile Turbo_active = Turbo_lut[0];
+static volatile uint16_t Turbo_mask; //Кнопки с включенным турбо
+static uint32_t Turbo_version; //SEGA_Config_Version, по которой построена таблица
+
+static uint16_t Turbo_frame; //Кадр внутри периода, 0..SEGA_TURBO_PERIOD-1
+static uint16_t Turbo_fn_last; //Последнее значение USB->FNR
+static uint16_t Turbo_held; //Удерживаемые кнопки (последний опрос)
+static uint16_t Turbo_out; //Последний результат SEGA_Turbo_Filter
+
+/**
+ ***************************************************************************************
+ *  @breif Построение таблицы по настройкам в запасную и переключение на нее
+ ***************************************************************************************
+ */
+static void SEGA_Turbo_Build(void) {
+    uint16_t *lut = (Turbo_active == Turbo_lut[0]) ? Turbo_lut[1] : Turbo_lut[0];
+    uint16_t mask = 0;
+    uint16_t frame, pos;
+    uint8_t bit, setting, rate, phase;
+
+    Turbo_version = SEGA_Config_Version();
+    for (frame = 0; frame < SEGA_TURBO_PERIOD; frame++) {
+        lut[frame] = 0;
+    }
+    for (bit = 0; bit < SEGA_TURBO_BITS; bit++) {
+        setting = (uint8_t)(SEGA_Config_Get(SEGA_CONFIG_TURBO_0 + bit / 2) >> ((bit % 2) * 8));
+        rate = setting & 0x0F; //Периодов за SEGA_TURBO_PERIOD кадров
+        phase = setting >> 4;
+        if (!rate) {
+            continue;
+        }
+        mask |= 1 << bit;
+        for (frame = 0; frame < SEGA_TURBO_PERIOD; frame++) {
+            pos = (frame + phase * SEGA_TURBO_PHASE_STEP) % SEGA_TURBO_PERIOD;
+            //Номер полупериода: четный - нажата, нечетный - отпущена
+            if (!((pos * 2 * rate / SEGA_TURBO_PERIOD) & 1)) {
+                lut[frame] |= 1 << bit;
+            }
+        }
+    }
+
+    __disable_irq();
+    Turbo_active = lut;
+    Turbo_mask = mask;
+    __enable_irq();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Турбо для удерживаемых кнопок в текущем кадре
+ ***************************************************************************************
+ */
+static inline uint16_t SEGA_Turbo_Apply(uint16_t buttons) {
+    return (buttons & ~Turbo_mask) | (buttons & Turbo_active[Turbo_frame]);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Построение таблицы по настройкам. Вызывать после SEGA_Config_Init, до запуска опроса.
+ ***************************************************************************************
+ */
+void SEGA_Turbo_Init(void) {
+    SEGA_Turbo_Build();
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Пересчет таблицы, если настройки изменились. Вызывать в главном цикле.
+ ***************************************************************************************
+ */
+void SEGA_Turbo_Process(void) {
+    if (Turbo_version != SEGA_Config_Version()) {
+        SEGA_Turbo_Build();
+    }
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Турбо для удерживаемых кнопок. Вызывается в конце опроса геймпада.
+ *  @param  buttons - удерживаемые кнопки
+ *  @retval Кнопки с учетом турбо в текущем кадре
+ ***************************************************************************************
+ */
+uint16_t SEGA_Turbo_Filter(uint16_t buttons) {
+    Turbo_held = buttons;
+    Turbo_out = SEGA_Turbo_Apply(buttons);
+    return Turbo_out;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Прерывание SOF (1 кГц). Отсчет кадров по USB->FNR.
+ *  @retval true - в этом кадре турбо переключило удерживаемую кнопку, нужен отчет
+ ***************************************************************************************
+ */
+bool SEGA_Turbo_SOF(void) {
+    uint16_t fn = READ_BIT(USB->FNR, USB_FNR_FN);
+
+    Turbo_frame = (Turbo_frame + ((uint16_t)(fn - Turbo_fn_last) & USB_FNR_FN)) % SEGA_TURBO_PERIOD;
+    Turbo_fn_last = fn;
+    if (!(Turbo_held & Turbo_mask)) {
+        return false; //Кнопки с турбо не нажаты
+    }
+    return SEGA_Turbo_Apply(Turbo_held) != Turbo_out;
+}
@@ -0,0 +1,93 @@
+/**
+ ******************************************************************************
+ *  @file SEGA_xinput.c
+ *  @brief Режим XInput: геймпад представляется хосту проводным геймпадом Xbox 360
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат отчета и назначение кнопок см. в SEGA_xinput.h.
+ *  Дескриптор конфигурации - рядом с дескрипторами HID (usbd_customhid.c).
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_xinput.h"
+#include "usb_device.h"
+#include "usbd_customhid.h"
+
+#define XINPUT_VID 8 //Смещения idVendor, idProduct и bcdDevice в дескрипторе устройства
+#define XINPUT_PID 10
+#define XINPUT_BCD 12
+
+/*Кнопка XInput для каждого бита Buttons (L и R - курки, в таблицы не входят)*/
+static const uint16_t XInput_bit[SEGA_XINPUT_HALF * 2] = {
+    SEGA_XINPUT_RIGHT, SEGA_XINPUT_LEFT, SEGA_XINPUT_DOWN, SEGA_XINPUT_UP,
+    SEGA_XINPUT_BACK, SEGA_XINPUT_START, SEGA_XINPUT_LB, SEGA_XINPUT_Y,
+    SEGA_XINPUT_X, SEGA_XINPUT_RB, SEGA_XINPUT_B, SEGA_XINPUT_A,
+    0, 0,
+};
+
+static uint16_t XInput_lut[2][SEGA_XINPUT_LUT_SIZE]; //Кнопки XInput для младших и старших 7 бит Buttons
+static USB_XInput_Gamepad XInput_report = { .type = 0x00, .size = sizeof(USB_XInput_Gamepad) };
+static bool XInput_active;
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+extern uint8_t USBD_FS_DeviceDesc[];
+
+/**
+ ***************************************************************************************
+ *  @breif Включение режима XInput: дескриптор конфигурации, VID/PID и таблицы перевода.
+ *  Вызывается при выборе режима по первому опросу, до чтения дескрипторов хостом.
+ ***************************************************************************************
+ */
+void SEGA_XInput_Init(void) {
+    uint16_t i, bits;
+    uint8_t half, bit;
+
+    if (USBD_CUSTOM_HID_SetXInput(&hUsbDeviceFS) != USBD_OK) {
+        return;
+    }
+    for (half = 0; half < 2; half++) {
+        for (i = 0; i < SEGA_XINPUT_LUT_SIZE; i++) {
+            XInput_lut[half][i] = 0;
+            for (bits = i; bits; bits &= bits - 1) {
+                bit = (uint8_t)__builtin_ctz(bits);
+                XInput_lut[half][i] |= XInput_bit[half * SEGA_XINPUT_HALF + bit];
+            }
+        }
+    }
+    USBD_FS_DeviceDesc[XINPUT_VID] = LOBYTE(SEGA_XINPUT_VID);
+    USBD_FS_DeviceDesc[XINPUT_VID + 1] = HIBYTE(SEGA_XINPUT_VID);
+    USBD_FS_DeviceDesc[XINPUT_PID] = LOBYTE(SEGA_XINPUT_PID);
+    USBD_FS_DeviceDesc[XINPUT_PID + 1] = HIBYTE(SEGA_XINPUT_PID);
+    USBD_FS_DeviceDesc[XINPUT_BCD] = LOBYTE(SEGA_XINPUT_BCD);
+    USBD_FS_DeviceDesc[XINPUT_BCD + 1] = HIBYTE(SEGA_XINPUT_BCD);
+    XInput_active = true;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Устройство подключено как XInput
+ ***************************************************************************************
+ */
+bool SEGA_XInput_Active(void) {
+    return XInput_active;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Отправка отчета XInput в USB
+ *  @param  buttons - кнопки в формате переменной Buttons
+ *  @retval true - отчет принят в точку IN
+ ***************************************************************************************
+ */
+bool SEGA_XInput_Send(uint16_t buttons) {
+    XInput_report.buttons = XInput_lut[0][buttons & (SEGA_XINPUT_LUT_SIZE - 1)] |
+                            XInput_lut[1][(buttons >> SEGA_XINPUT_HALF) & (SEGA_XINPUT_LUT_SIZE - 1)];
+    XInput_report.lt = (buttons & SEGA_L_Pos) ? 0xFF : 0;
+    XInput_report.rt = (buttons & SEGA_R_Pos) ? 0xFF : 0;
+    return USBD_CUSTOM_HID_SendReport(&hUsbDeviceFS, (uint8_t*)&XInput_report, sizeof(XInput_report)) == USBD_OK;
+}
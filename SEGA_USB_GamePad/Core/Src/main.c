@@ -2,9 +2,20 @@
 #include "usb_device.h"
 #include "usbd_customhid.h"
 #include "SEGA_gamepad.h"
+#include "SEGA_mouse.h"
+#include "SEGA_console.h"
+#include "SEGA_tas.h"
+#include "SEGA_telemetry.h"
+#include "SEGA_cdc.h"
+#include "SEGA_power.h"
+#include "SEGA_boot.h"
+#include "SEGA_config.h"
+#include "SEGA_remap.h"
+#include "SEGA_turbo.h"
+#include "SEGA_pointer.h"
 
 extern uint16_t Buttons; //Переменная под 12 кнопок
-USB_Custom_HID_Gamepad Gamepad_data;
+USB_Custom_HID_Gamepad Gamepad_data = { .report_id = USB_REPORT_ID_GAMEPAD, .hat = SEGA_HAT_NEUTRAL };
 
 extern PCD_HandleTypeDef hpcd_USB_FS;
 extern USBD_HandleTypeDef hUsbDeviceFS;
@@ -22,18 +33,51 @@ void USB_HP_CAN1_TX_IRQHandler(void){
 
 
 int main(void){
+    SEGA_Boot_Init(); //Журнал времени загрузки (см. SEGA_boot.h)
+    CMSIS_RCC_HSE_Start(); //Кварц раскачивается, пока настраиваются ножки
     CMSIS_Debug_init();
-    CMSIS_RCC_SystemClock_72MHz();
-    CMSIS_SysTick_Timer_init();
+    SEGA_Config_Init(); //Настройки из Flash в RAM (только чтение, можно еще на HSI)
+    SEGA_Remap_Init(); //Таблицы переназначения кнопок по настройкам
+    SEGA_Turbo_Init(); //Таблица турбо по настройкам
+    SEGA_Pointer_Init(); //Режим указателя при старте по настройкам
 	CMSIS_PC13_OUTPUT_Push_Pull_init(); //Ножка, которая будет мигать при нажатии кнопок геймпада
 	SEGA_LED_OFF;
+#if (SEGA_PROTOCOL != SEGA_PROTOCOL_CONSOLE)
+	SEGA_GPIO_Init(); //Настройка ножек для работы с геймпадом
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_SATURN) || (SEGA_PROTOCOL == SEGA_PROTOCOL_AUTO)
+	SEGA_TR_Output_Init(); //Геймпаду Saturn нужна вторая линия выбора TR
+#endif
+#endif
+    CMSIS_RCC_SystemClock_72MHz();
+    CMSIS_Timebase_Init(); //Время в мкс, задержки и таймауты без прерываний SysTick
+    SEGA_Boot_Mark(SEGA_BOOT_CLOCK);
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_CONSOLE)
+	SEGA_Console_Init(); //МК сам отвечает приставке как геймпад. Кнопки приходят по USART1
+#else
+    MX_USB_DEVICE_Init(); //Как можно раньше: до сброса шины от хоста USB должен быть готов
+    SEGA_Boot_Mark(SEGA_BOOT_USB);
 	CMSIS_TIM2_init(); //Таймер на 240 Гц
 	CMSIS_TIM3_init(); //Таймер на 100кГц, для ножки PA7(SELECT). Длина импульса 20 мкс. Забираем данные между фронтами.
-	SEGA_GPIO_Init(); //Настройка ножек для работы с геймпадом
-    MX_USB_DEVICE_Init();
+#if (SEGA_PROTOCOL == SEGA_PROTOCOL_MOUSE)
+	SEGA_Mouse_Init(); //Вместо геймпада к DB-9 подключена Mega Mouse. Опрос 1 кГц
+#else
+    SEGA_Poll_Rate(SEGA_Config_Get(SEGA_CONFIG_POLL_HZ)); //Частота опроса из настроек
+#endif
+    TIM2->EGR = TIM_EGR_UG; //Первый опрос прямо сейчас, к SET_CONFIGURATION кнопки уже будут известны
+    SEGA_Boot_Mark(SEGA_BOOT_PAD);
+#if SEGA_TELEMETRY
+	SEGA_Telemetry_Init(); //Поток изменений кнопок по USART1
+#endif
+#endif
     
     while (1){
- 
+        SEGA_TAS_Process(); //Команды записи/воспроизведения и сброс записи во Flash
+        SEGA_Telemetry_Process(); //Отправка накопившихся изменений кнопок
+        SEGA_CDC_Process(); //Команды из виртуального COM-порта
+        SEGA_Remap_Process(); //Пересчет таблиц переназначения, если настройки изменились
+        SEGA_Turbo_Process(); //Пересчет таблицы турбо, если настройки изменились
+        SEGA_Config_Process(); //Запись измененных настроек во Flash
+        SEGA_Power_Idle(SEGA_TAS_Busy() || SEGA_Config_Busy()); //Сон до следующего прерывания, Stop при USB suspend
     }
   
 }
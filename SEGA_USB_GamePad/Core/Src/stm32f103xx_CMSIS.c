@@ -77,6 +77,20 @@ void CMSIS_Debug_init(void) {
 
 
 /*============================== НАСТРОЙКА RCC =======================================*/
+/**
+ ***************************************************************************************
+ *  @breif Ранний запуск внешнего кварцевого резонатора, без ожидания готовности
+ *  Кварцу нужно ~1-2 мс, чтоб раскачаться. Если запустить его первой строкой в main,
+ *  это время уйдет на настройку ножек, а CMSIS_RCC_SystemClock_72MHz() будет ждать
+ *  HSERDY меньше или не будет ждать вовсе.
+ ***************************************************************************************
+ */
+
+void CMSIS_RCC_HSE_Start(void) {
+	CLEAR_BIT(RCC->CR, RCC_CR_HSEBYP); //HSEBYP можно менять только при выключенном HSE
+	SET_BIT(RCC->CR, RCC_CR_HSEON); //Запустим внешний кварцевый резонатор
+}
+
 /**
  ***************************************************************************************
  *  @breif Настройка МК STM32F103C8T6 на частоту 72MHz от внешнего кварцевого резонатора
@@ -453,7 +467,8 @@ When the processor is halted for debugging the counter does not decrement.*/
 /**
  ***************************************************************************************
  *  @breif Настройка SysTick на микросекунды
- *  На этом таймере мы настроим Delay и аналог HAL_GetTick()
+ *  На этом таймере мы настроим аналог HAL_GetTick() (SysTimer_ms)
+ *  Сейчас не используется: время и задержки считает CMSIS_Timebase_Init (TIM4 + TIM1)
  *  PM0056 STM32F10xxx/20xxx/21xxx/L1xxxx Cortex®-M3 programming manual/
  *  см. п.4.5 SysTick timer (STK) (стр. 150)
  ***************************************************************************************
@@ -545,43 +560,323 @@ void CMSIS_SysTick_Timer_init(void) {
 
 /**
  ***************************************************************************************
- *  @breif Настройка Delay и аналог HAL_GetTick()
+ *  @breif Аналог HAL_GetTick() на SysTick (если он запущен)
+ *  @attention Время, задержки и таймауты теперь берутся из CMSIS_Micros (TIM4 + TIM1, см. ниже),
+ *  а SysTick больше не запускается: 1000 прерываний в секунду только ради счетчиков не нужны.
  ***************************************************************************************
  */
 
-volatile uint32_t SysTimer_ms = 0; //Переменная, аналогичная HAL_GetTick()
-volatile uint32_t Delay_counter_ms = 0; //Счетчик для функции Delay_ms
-volatile uint32_t Timeout_counter_ms = 0; //Переменная для таймаута функций
+volatile uint32_t SysTimer_ms = 0; //Счетчик мс SysTick
 
 /**
  ******************************************************************************
- *  @breif Delay_ms
- *  @param   uint32_t Milliseconds - Длина задержки в миллисекундах
+ *  @breif Прерывание по флагу COUNTFLAG (см. п. 4.5.1 SysTick control and status register (STK_CTRL))
+ *  Список векторов(прерываний) можно найти в файле startup_stm32f103c8tx.S
  ******************************************************************************
  */
-void Delay_ms(uint32_t Milliseconds) {
-	Delay_counter_ms = Milliseconds;
-	while (Delay_counter_ms != 0) ;
+void SysTick_Handler(void) {
+	SysTimer_ms++;
 }
 
+/*========================= ВРЕМЯ В МИКРОСЕКУНДАХ (TIM4 + TIM1) ==============================*/
+/**
+ ***************************************************************************************
+ *  Два 16-битных таймера, соединенных цепочкой (см. п.п. 15.3.15 Timer synchronization):
+ *  TIM4 считает микросекунды (72 МГц / 72), по переполнению выдает TRGO (MMS = Update),
+ *  TIM1 тактируется от TRGO TIM4 (ITR3, External clock mode 1) и считает старшие 16 бит.
+ *  Вместе - 32-битный счетчик микросекунд (переполнение через ~71,6 мин) без периодических
+ *  прерываний. Переполнения TIM1 считаются в прерывании раз в 71,6 мин (для CMSIS_Millis).
+ *
+ *  Программные таймеры: список, отсортированный по времени срабатывания. Сравнение CC1 TIM4
+ *  настраивается только на ближайший таймер (если он дальше 32 мс - на промежуточную
+ *  проверку через 32 мс). Нет таймеров - нет прерываний.
+ *  Callback таймера вызывается из прерывания TIM4.
+ *
+ *  Delay_ms и Delay_us спят в WFI до срабатывания таймера. Не вызывать их из прерываний
+ *  с приоритетом выше или равным TIM4 (в том числе из Callback таймера).
+ ***************************************************************************************
+ */
+
+#define TIMEBASE_STEP_US 0x8000 //Самое дальнее сравнение CC1, мкс
+
+static struct CMSIS_Timer_name* Timer_list; //Запущенные таймеры, ближайший первым
+static volatile uint32_t Timebase_overflow; //Количество переполнений 32-битного счетчика
+
+static uint32_t Timeout_start_us; //Таймаут блокирующих функций
+static uint32_t Timeout_length_us;
+
 /**
  ******************************************************************************
- *  @breif Прерывание по флагу COUNTFLAG (см. п. 4.5.1 SysTick control and status register (STK_CTRL))
- *  Список векторов(прерываний) можно найти в файле startup_stm32f103c8tx.S
+ *  @breif Настройка счетчика микросекунд на TIM4 + TIM1
  ******************************************************************************
  */
-void SysTick_Handler(void) {
+void CMSIS_Timebase_Init(void) {
+	SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM4EN); //Запуск тактирования таймера 4
+	SET_BIT(RCC->APB2ENR, RCC_APB2ENR_TIM1EN); //Запуск тактирования таймера 1
+
+	//TIM4 - младшие 16 бит
+	TIM4->CR1 = 0;
+	TIM4->PSC = 72 - 1; //APB1 36 МГц, на таймеры x2 = 72 МГц. 72 МГц / 72 = 1 МГц
+	TIM4->ARR = 0xFFFF;
+	MODIFY_REG(TIM4->CR2, TIM_CR2_MMS, 0b010 << TIM_CR2_MMS_Pos); //TRGO по переполнению
+	TIM4->CCMR1 = 0; //CC1 - сравнение без вывода на ножку
+	TIM4->EGR = TIM_EGR_UG; //Загрузим PSC
+	TIM4->SR = 0;
+	TIM4->DIER = 0;
+
+	//TIM1 - старшие 16 бит
+	TIM1->CR1 = 0;
+	TIM1->PSC = 0;
+	TIM1->ARR = 0xFFFF;
+	TIM1->RCR = 0;
+	MODIFY_REG(TIM1->SMCR, TIM_SMCR_TS | TIM_SMCR_SMS, (0b011 << TIM_SMCR_TS_Pos) | (0b111 << TIM_SMCR_SMS_Pos)); //ITR3 (TIM4), External clock mode 1
+	TIM1->EGR = TIM_EGR_UG;
+	TIM1->SR = 0;
+	TIM1->DIER = TIM_DIER_UIE; //Переполнение 32-битного счетчика
+
+	TIM1->CNT = 0;
+	TIM4->CNT = 0;
+	Timebase_overflow = 0;
+	Timer_list = NULL;
+	SET_BIT(TIM1->CR1, TIM_CR1_CEN);
+	SET_BIT(TIM4->CR1, TIM_CR1_CEN);
+	NVIC_EnableIRQ(TIM1_UP_IRQn);
+	NVIC_EnableIRQ(TIM4_IRQn);
+}
 
-	SysTimer_ms++;
+/**
+ ******************************************************************************
+ *  @breif Время в микросекундах (32 бита, переполнение через ~71,6 мин)
+ ******************************************************************************
+ */
+uint32_t CMSIS_Micros(void) {
+	uint16_t high;
+	uint16_t low;
+
+	do {
+		high = TIM1->CNT;
+		low = TIM4->CNT;
+		//При low = 0 TIM1 мог еще не успеть увеличиться (задержка синхронизации), читаем заново
+	} while (high != TIM1->CNT || !low);
+	return ((uint32_t)high << 16) | low;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Время в миллисекундах (аналог HAL_GetTick())
+ ******************************************************************************
+ */
+uint32_t CMSIS_Millis(void) {
+	uint32_t primask = __get_PRIMASK();
+	uint32_t overflow;
+	uint32_t us;
+
+	__disable_irq();
+	us = CMSIS_Micros();
+	overflow = Timebase_overflow;
+	if (READ_BIT(TIM1->SR, TIM_SR_UIF) && us < 0x80000000) {
+		overflow++; //Переполнение уже было, но прерывание еще не обработано
+	}
+	__set_PRIMASK(primask);
+	return (uint32_t)((((uint64_t)overflow << 32) | us) / 1000);
+}
+
+/**
+ ******************************************************************************
+ *  @breif HAL_GetTick() для HAL (HAL_Delay, таймауты PCD). Заменяет weak функцию из stm32f1xx_hal.c
+ ******************************************************************************
+ */
+uint32_t HAL_GetTick(void) {
+	return CMSIS_Millis();
+}
+
+/**
+ ******************************************************************************
+ *  @breif Переполнение старших 16 бит
+ ******************************************************************************
+ */
+__WEAK void TIM1_UP_IRQHandler(void) {
+	CLEAR_BIT(TIM1->SR, TIM_SR_UIF);
+	Timebase_overflow++;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Настройка сравнения CC1 TIM4 на ближайший таймер
+ *  @attention Вызывать при запрещенных прерываниях или из прерывания TIM4
+ ******************************************************************************
+ */
+static void CMSIS_Timer_Program(void) {
+	uint32_t now;
+
+	if (!Timer_list) {
+		CLEAR_BIT(TIM4->DIER, TIM_DIER_CC1IE);
+		return;
+	}
+	now = CMSIS_Micros();
+	if ((int32_t)(Timer_list->deadline - now) < TIMEBASE_STEP_US) {
+		TIM4->CCR1 = (uint16_t)Timer_list->deadline;
+	}
+	else {
+		TIM4->CCR1 = (uint16_t)(now + TIMEBASE_STEP_US); //Промежуточная проверка
+	}
+	CLEAR_BIT(TIM4->SR, TIM_SR_CC1IF);
+	SET_BIT(TIM4->DIER, TIM_DIER_CC1IE);
+	if ((int32_t)(Timer_list->deadline - CMSIS_Micros()) <= 1) {
+		TIM4->EGR = TIM_EGR_CC1G; //Срок уже наступил или наступит раньше, чем сработает сравнение
+	}
+}
+
+/**
+ ******************************************************************************
+ *  @breif Вставка таймера в список по времени срабатывания
+ ******************************************************************************
+ */
+static void CMSIS_Timer_Insert(struct CMSIS_Timer_name* timer) {
+	struct CMSIS_Timer_name** link = &Timer_list;
+
+	while (*link && (int32_t)((*link)->deadline - timer->deadline) <= 0) {
+		link = &(*link)->next;
+	}
+	timer->next = *link;
+	*link = timer;
+	timer->active = true;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Удаление таймера из списка
+ ******************************************************************************
+ */
+static void CMSIS_Timer_Remove(struct CMSIS_Timer_name* timer) {
+	struct CMSIS_Timer_name** link = &Timer_list;
+
+	while (*link && *link != timer) {
+		link = &(*link)->next;
+	}
+	if (*link) {
+		*link = timer->next;
+	}
+	timer->active = false;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Запуск программного таймера
+ *  @param  *timer - таймер. Не копируется! Callback можно оставить NULL и ждать active = false
+ *  @param  Delay_us - через сколько мкс сработать (не больше 2^31)
+ *  @param  Period_us - период повторения, 0 - однократно
+ ******************************************************************************
+ */
+void CMSIS_Timer_Start(struct CMSIS_Timer_name* timer, uint32_t Delay_us, uint32_t Period_us) {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (timer->active) {
+		CMSIS_Timer_Remove(timer);
+	}
+	timer->deadline = CMSIS_Micros() + Delay_us;
+	timer->period = Period_us;
+	CMSIS_Timer_Insert(timer);
+	CMSIS_Timer_Program();
+	__set_PRIMASK(primask);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Остановка программного таймера
+ ******************************************************************************
+ */
+void CMSIS_Timer_Stop(struct CMSIS_Timer_name* timer) {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (timer->active) {
+		CMSIS_Timer_Remove(timer);
+		CMSIS_Timer_Program();
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Прерывание сравнения TIM4: срабатывание таймеров, чей срок наступил
+ ******************************************************************************
+ */
+__WEAK void TIM4_IRQHandler(void) {
+	struct CMSIS_Timer_name* timer;
+
+	CLEAR_BIT(TIM4->SR, TIM_SR_CC1IF);
+	while (Timer_list && (int32_t)(Timer_list->deadline - CMSIS_Micros()) <= 0) {
+		timer = Timer_list;
+		Timer_list = timer->next;
+		timer->active = false;
+		if (timer->period) {
+			timer->deadline += timer->period;
+			CMSIS_Timer_Insert(timer);
+		}
+		if (timer->Callback) {
+			timer->Callback(timer); //Может запускать и останавливать таймеры
+		}
+	}
+	CMSIS_Timer_Program();
+}
 
-	if (Delay_counter_ms) {
-		Delay_counter_ms--;
+/**
+ ******************************************************************************
+ *  @breif Delay_us. Ядро спит в WFI до срабатывания таймера.
+ *  @param   uint32_t Microseconds - Длина задержки в микросекундах (не больше 2^31)
+ ******************************************************************************
+ */
+void Delay_us(uint32_t Microseconds) {
+	struct CMSIS_Timer_name timer = { 0 };
+
+	CMSIS_Timer_Start(&timer, Microseconds, 0);
+	__disable_irq();
+	while (timer.active) {
+		__WFI(); //Ядро просыпается по ожидающему прерыванию и при запрещенных прерываниях
+		__enable_irq();
+		__disable_irq();
 	}
-	if (Timeout_counter_ms) {
-		Timeout_counter_ms--;
+	__enable_irq();
+}
+
+/**
+ ******************************************************************************
+ *  @breif Delay_ms
+ *  @param   uint32_t Milliseconds - Длина задержки в миллисекундах
+ ******************************************************************************
+ */
+void Delay_ms(uint32_t Milliseconds) {
+	uint32_t ms;
+
+	while (Milliseconds) {
+		ms = (Milliseconds > 1000) ? 1000 : Milliseconds;
+		Delay_us(ms * 1000);
+		Milliseconds -= ms;
 	}
 }
 
+/**
+ ******************************************************************************
+ *  @breif Начало отсчета таймаута блокирующих функций
+ *  @param   Timeout_ms - таймаут в миллисекундах
+ ******************************************************************************
+ */
+static void CMSIS_Timeout_Start(uint32_t Timeout_ms) {
+	Timeout_start_us = CMSIS_Micros();
+	Timeout_length_us = (Timeout_ms > 0x7FFFFFFF / 1000) ? 0x7FFFFFFF : Timeout_ms * 1000;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Таймаут истек
+ ******************************************************************************
+ */
+static bool CMSIS_Timeout_Expired(void) {
+	return CMSIS_Micros() - Timeout_start_us >= Timeout_length_us;
+}
+
 
 
 /*============================== НАСТРОЙКА GPIO =======================================*/
@@ -1565,6 +1860,8 @@ void CMSIS_USART2_Init(void) {
 	NVIC_EnableIRQ(USART2_IRQn); //Включим прерывания по USART2
 }
 
+static void CMSIS_USART_DMA_RX_IDLE(struct USART_DMA_RX_name* husart_dma); //Конец кадра при приеме через DMA (см. ниже)
+
 /**
  ******************************************************************************
  *  @breif Прерывание по USART1
@@ -1572,10 +1869,20 @@ void CMSIS_USART2_Init(void) {
  */
 
 __WEAK void USART1_IRQHandler(void) {
+	if (husart1_dma_rx.active) {
+		//Прием идет через DMA, здесь только конец кадра
+		CMSIS_USART_DMA_RX_IDLE(&husart1_dma_rx);
+		return;
+	}
 	if (READ_BIT(USART1->SR, USART_SR_RXNE)) {
 		//Если пришли данные по USART
-		husart1.rx_buffer[husart1.rx_counter] = USART1->DR; //Считаем данные в соответствующую ячейку в rx_buffer
-		husart1.rx_counter++; //Увеличим счетчик принятых байт на 1
+		if (husart1.rx_counter < sizeof(husart1.rx_buffer)) {
+			husart1.rx_buffer[husart1.rx_counter] = USART1->DR; //Считаем данные в соответствующую ячейку в rx_buffer
+			husart1.rx_counter++; //Увеличим счетчик принятых байт на 1
+		}
+		else {
+			USART1->DR; //Буфер полон. Лишние байты отбрасываем, чтоб не затереть память
+		}
 	}
 	if (READ_BIT(USART1->SR, USART_SR_IDLE)) {
 		//Если прилетел флаг IDLE
@@ -1587,10 +1894,20 @@ __WEAK void USART1_IRQHandler(void) {
 
 
 __WEAK void USART2_IRQHandler(void) {
+	if (husart2_dma_rx.active) {
+		//Прием идет через DMA, здесь только конец кадра
+		CMSIS_USART_DMA_RX_IDLE(&husart2_dma_rx);
+		return;
+	}
 	if (READ_BIT(USART2->SR, USART_SR_RXNE)) {
 		//Если пришли данные по USART
-		husart2.rx_buffer[husart2.rx_counter] = USART2->DR; //Считаем данные в соответствующую ячейку в rx_buffer
-		husart2.rx_counter++; //Увеличим счетчик принятых байт на 1
+		if (husart2.rx_counter < sizeof(husart2.rx_buffer)) {
+			husart2.rx_buffer[husart2.rx_counter] = USART2->DR; //Считаем данные в соответствующую ячейку в rx_buffer
+			husart2.rx_counter++; //Увеличим счетчик принятых байт на 1
+		}
+		else {
+			USART2->DR; //Буфер полон. Лишние байты отбрасываем, чтоб не затереть память
+		}
 	}
 	if (READ_BIT(USART2->SR, USART_SR_IDLE)) {
 		//Если прилетел флаг IDLE
@@ -1612,10 +1929,10 @@ __WEAK void USART2_IRQHandler(void) {
 
 bool CMSIS_USART_Transmit(USART_TypeDef* USART, uint8_t* data, uint16_t Size, uint32_t Timeout_ms) {
 	for (uint16_t i = 0; i < Size; i++) {
-		Timeout_counter_ms = Timeout_ms;
+		CMSIS_Timeout_Start(Timeout_ms);
 		//Ждем, пока линия не освободится
 		while (READ_BIT(USART->SR, USART_SR_TXE) == 0) {
-			if (!Timeout_counter_ms) {
+			if (CMSIS_Timeout_Expired()) {
 				return false;
 			}
 		}
@@ -1624,6 +1941,276 @@ bool CMSIS_USART_Transmit(USART_TypeDef* USART, uint8_t* data, uint16_t Size, ui
 	return true;
 }
 
+/**
+ ******************************************************************************
+ *  @breif Установка скорости USART
+ *  @param  *USART - USART1 (PCLK2 = 72 МГц) или USART2 (PCLK1 = 36 МГц)
+ *  @param  Baudrate - скорость, бод. Максимум PCLK/16: 4.5 Мбод для USART1, 2.25 Мбод для USART2
+ ******************************************************************************
+ */
+void CMSIS_USART_Set_Baudrate(USART_TypeDef* USART, uint32_t Baudrate) {
+	uint32_t pclk = (USART == USART1) ? 72000000 : 36000000;
+	//BRR = USARTDIV * 16, т.е. мантисса и дробная часть вместе - это просто PCLK / Baudrate
+	USART->BRR = (pclk + Baudrate / 2) / Baudrate;
+}
+
+/*-------------------------------- Передача по DMA ---------------------------------------*/
+/*
+ * Передача без ожидания. Кадры (указатель + длина) кладутся в кольцо дескрипторов,
+ * DMA отправляет их по очереди, следующий кадр запускается из прерывания Transfer complete.
+ * Данные не копируются: буфер кадра должен оставаться неизменным, пока кадр не отправлен
+ * (обычно это статический буфер). Функция отправки всегда выполняется за постоянное время.
+ *
+ * Каналы DMA1 (Table 78. Summary of DMA1 requests for each channel):
+ * USART1_TX - Channel 4
+ * USART2_TX - Channel 7
+ */
+
+struct USART_DMA_TX_name husart1_dma_tx = { .USART = USART1, .Channel = DMA1_Channel4, .Channel_number = 4 };
+struct USART_DMA_TX_name husart2_dma_tx = { .USART = USART2, .Channel = DMA1_Channel7, .Channel_number = 7 };
+
+/**
+ ******************************************************************************
+ *  @breif Запуск DMA на кадр из головы очереди
+ ******************************************************************************
+ */
+static void CMSIS_USART_DMA_TX_Start(struct USART_DMA_TX_name* husart_dma) {
+	uint8_t i = husart_dma->tail & (USART_DMA_TX_QUEUE - 1);
+
+	CLEAR_BIT(husart_dma->Channel->CCR, DMA_CCR_EN);
+	husart_dma->Channel->CMAR = (uint32_t)husart_dma->frame_data[i];
+	husart_dma->Channel->CNDTR = husart_dma->frame_size[i];
+	CLEAR_BIT(husart_dma->USART->SR, USART_SR_TC);
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_EN);
+	husart_dma->busy = true;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Настройка передачи USART через DMA
+ *  @param  *husart_dma - husart1_dma_tx или husart2_dma_tx
+ *  @attention Сам USART должен быть уже настроен (CMSIS_USART1_Init/CMSIS_USART2_Init)
+ ******************************************************************************
+ */
+void CMSIS_USART_DMA_TX_Init(struct USART_DMA_TX_name* husart_dma) {
+	SET_BIT(RCC->AHBENR, RCC_AHBENR_DMA1EN); //Включение тактирования DMA1
+	CLEAR_BIT(husart_dma->Channel->CCR, DMA_CCR_EN);
+	husart_dma->Channel->CPAR = (uint32_t)&husart_dma->USART->DR; //Адрес периферии
+	MODIFY_REG(husart_dma->Channel->CCR, DMA_CCR_PL_Msk, 0b01 << DMA_CCR_PL_Pos); //Приоритет средний
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_DIR); //Чтение из памяти
+	CLEAR_BIT(husart_dma->Channel->CCR, DMA_CCR_CIRC); //Обычный режим
+	MODIFY_REG(husart_dma->Channel->CCR, DMA_CCR_PSIZE_Msk, 0b00 << DMA_CCR_PSIZE_Pos); //Периферия 8 бит
+	MODIFY_REG(husart_dma->Channel->CCR, DMA_CCR_MSIZE_Msk, 0b00 << DMA_CCR_MSIZE_Pos); //Память 8 бит
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_MINC); //Инкремент памяти
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_TCIE); //Прерывание по окончанию передачи
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_TEIE); //Прерывание по ошибке
+	SET_BIT(husart_dma->USART->CR3, USART_CR3_DMAT); //USART запрашивает DMA на передачу
+	husart_dma->head = 0;
+	husart_dma->tail = 0;
+	husart_dma->busy = false;
+	NVIC_EnableIRQ((husart_dma->Channel_number == 4) ? DMA1_Channel4_IRQn : DMA1_Channel7_IRQn);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Постановка кадра в очередь на отправку через DMA
+ *  @param  *husart_dma - husart1_dma_tx или husart2_dma_tx
+ *  @param  *data - данные. Не копируются! Не менять до окончания отправки
+ *  @param  Size - сколько байт требуется передать
+ *  @retval  True - кадр в очереди. False - очередь заполнена, кадр не принят
+ ******************************************************************************
+ */
+bool CMSIS_USART_Transmit_DMA(struct USART_DMA_TX_name* husart_dma, const uint8_t* data, uint16_t Size) {
+	uint32_t primask = __get_PRIMASK();
+	uint8_t i;
+
+	if (!Size) {
+		return true;
+	}
+	__disable_irq(); //Очередь может пополняться из разных прерываний
+	if ((uint8_t)(husart_dma->head - husart_dma->tail) >= USART_DMA_TX_QUEUE) {
+		__set_PRIMASK(primask);
+		return false;
+	}
+	i = husart_dma->head & (USART_DMA_TX_QUEUE - 1);
+	husart_dma->frame_data[i] = data;
+	husart_dma->frame_size[i] = Size;
+	husart_dma->head++;
+	if (!husart_dma->busy) {
+		CMSIS_USART_DMA_TX_Start(husart_dma);
+	}
+	__set_PRIMASK(primask); //Вызов при запрещенных прерываниях их не разрешает
+	return true;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Есть ли неотправленные кадры
+ ******************************************************************************
+ */
+bool CMSIS_USART_DMA_TX_Busy(struct USART_DMA_TX_name* husart_dma) {
+	return husart_dma->busy;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Обработка прерывания DMA передачи: запуск следующего кадра
+ ******************************************************************************
+ */
+static void CMSIS_USART_DMA_TX_IRQ(struct USART_DMA_TX_name* husart_dma) {
+	uint32_t shift = (husart_dma->Channel_number - 1) * 4; //Флаги канала в DMA->ISR/IFCR
+
+	if (READ_BIT(DMA1->ISR, (DMA_ISR_TCIF1 | DMA_ISR_TEIF1) << shift)) {
+		DMA1->IFCR = DMA_IFCR_CGIF1 << shift; //Сбросим флаги канала
+		//При ошибке кадр просто пропускается
+		husart_dma->tail++;
+		if (husart_dma->tail != husart_dma->head) {
+			CMSIS_USART_DMA_TX_Start(husart_dma);
+		}
+		else {
+			CLEAR_BIT(husart_dma->Channel->CCR, DMA_CCR_EN);
+			husart_dma->busy = false;
+		}
+	}
+}
+
+__WEAK void DMA1_Channel4_IRQHandler(void) {
+	CMSIS_USART_DMA_TX_IRQ(&husart1_dma_tx);
+}
+
+static void CMSIS_I2C1_Async_DMA_RX_IRQ(void); //Прием I2C1 через DMA (см. ниже)
+
+__WEAK void DMA1_Channel7_IRQHandler(void) {
+	//Канал 7 общий у USART2_TX и I2C1_RX
+	if (DMA1_Channel7->CPAR == (uint32_t)&I2C1->DR) {
+		CMSIS_I2C1_Async_DMA_RX_IRQ();
+		return;
+	}
+	CMSIS_USART_DMA_TX_IRQ(&husart2_dma_tx);
+}
+
+/*-------------------------------- Прием по DMA ---------------------------------------*/
+/*
+ * Прием в кольцевой буфер: DMA в режиме Circular непрерывно пишет принятые байты
+ * в buffer, прерываний на каждый байт нет. Принятое отдается в callback:
+ * - по флагу IDLE (линия замолчала - кадр закончился), Frame_end = true;
+ * - по половине (HT) и концу (TC) буфера, Frame_end = false, чтоб длинный кадр
+ *   не затер сам себя.
+ * Если кадр переходит через конец буфера, callback вызывается дважды.
+ * Если кадр кончился ровно на половине или конце буфера, его данные уже отданы
+ * по HT/TC, и по IDLE callback получает Size = 0, Frame_end = true.
+ * Данные не теряются, пока между двумя событиями приходит меньше USART_DMA_RX_SIZE / 2 байт.
+ *
+ * Каналы DMA1:
+ * USART1_RX - Channel 5
+ * USART2_RX - Channel 6
+ */
+
+struct USART_DMA_RX_name husart1_dma_rx = { .USART = USART1, .Channel = DMA1_Channel5, .Channel_number = 5 };
+struct USART_DMA_RX_name husart2_dma_rx = { .USART = USART2, .Channel = DMA1_Channel6, .Channel_number = 6 };
+
+/**
+ ******************************************************************************
+ *  @breif Настройка приема USART через DMA
+ *  @param  *husart_dma - husart1_dma_rx или husart2_dma_rx
+ *  @param  Callback - куда отдавать принятые данные (вызывается из прерывания)
+ *  @attention Сам USART должен быть уже настроен (CMSIS_USART1_Init/CMSIS_USART2_Init)
+ ******************************************************************************
+ */
+void CMSIS_USART_DMA_RX_Init(struct USART_DMA_RX_name* husart_dma, void (*Callback)(const uint8_t* data, uint16_t Size, bool Frame_end)) {
+	husart_dma->Callback = Callback;
+	husart_dma->read_pos = 0;
+
+	SET_BIT(RCC->AHBENR, RCC_AHBENR_DMA1EN); //Включение тактирования DMA1
+	CLEAR_BIT(husart_dma->Channel->CCR, DMA_CCR_EN);
+	husart_dma->Channel->CPAR = (uint32_t)&husart_dma->USART->DR; //Адрес периферии
+	husart_dma->Channel->CMAR = (uint32_t)husart_dma->buffer; //Адрес буфера
+	husart_dma->Channel->CNDTR = USART_DMA_RX_SIZE;
+	MODIFY_REG(husart_dma->Channel->CCR, DMA_CCR_PL_Msk, 0b10 << DMA_CCR_PL_Pos); //Приоритет высокий
+	CLEAR_BIT(husart_dma->Channel->CCR, DMA_CCR_DIR); //Чтение с периферии
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_CIRC); //Circular mode
+	MODIFY_REG(husart_dma->Channel->CCR, DMA_CCR_PSIZE_Msk, 0b00 << DMA_CCR_PSIZE_Pos); //Периферия 8 бит
+	MODIFY_REG(husart_dma->Channel->CCR, DMA_CCR_MSIZE_Msk, 0b00 << DMA_CCR_MSIZE_Pos); //Память 8 бит
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_MINC); //Инкремент памяти
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_HTIE); //Прерывание по половине буфера
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_TCIE); //Прерывание по концу буфера
+	SET_BIT(husart_dma->Channel->CCR, DMA_CCR_EN);
+
+	CLEAR_BIT(husart_dma->USART->CR1, USART_CR1_RXNEIE); //Прерывание на каждый байт больше не нужно
+	SET_BIT(husart_dma->USART->CR1, USART_CR1_IDLEIE); //Конец кадра ловим по IDLE
+	SET_BIT(husart_dma->USART->CR3, USART_CR3_DMAR); //USART запрашивает DMA на прием
+	husart_dma->active = true;
+
+	NVIC_EnableIRQ((husart_dma->Channel_number == 5) ? DMA1_Channel5_IRQn : DMA1_Channel6_IRQn);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Отдать в callback все, что DMA успел принять с прошлого раза
+ *  @param  Frame_end - вызвано по IDLE
+ ******************************************************************************
+ */
+static void CMSIS_USART_DMA_RX_Process(struct USART_DMA_RX_name* husart_dma, bool Frame_end) {
+	uint16_t pos = USART_DMA_RX_SIZE - husart_dma->Channel->CNDTR; //Куда DMA запишет следующий байт
+	uint16_t read = husart_dma->read_pos;
+
+	if (pos == USART_DMA_RX_SIZE) {
+		pos = 0;
+	}
+	if (pos != read && husart_dma->Callback) {
+		if (pos > read) {
+			husart_dma->Callback(&husart_dma->buffer[read], pos - read, Frame_end);
+		}
+		else {
+			//Кадр перешел через конец буфера
+			husart_dma->Callback(&husart_dma->buffer[read], USART_DMA_RX_SIZE - read, Frame_end && !pos);
+			if (pos) {
+				husart_dma->Callback(husart_dma->buffer, pos, Frame_end);
+			}
+		}
+	}
+	else if (Frame_end && husart_dma->Callback) {
+		//Кадр кончился ровно на половине или конце буфера: данные уже отданы по HT/TC
+		husart_dma->Callback(&husart_dma->buffer[pos], 0, true);
+	}
+	husart_dma->read_pos = pos;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Обработка IDLE в прерывании USART
+ ******************************************************************************
+ */
+static void CMSIS_USART_DMA_RX_IDLE(struct USART_DMA_RX_name* husart_dma) {
+	if (READ_BIT(husart_dma->USART->SR, USART_SR_IDLE)) {
+		husart_dma->USART->DR; //Сбросим флаг IDLE (чтение SR, затем DR)
+		CMSIS_USART_DMA_RX_Process(husart_dma, true);
+	}
+}
+
+/**
+ ******************************************************************************
+ *  @breif Обработка прерывания DMA приема (HT/TC)
+ ******************************************************************************
+ */
+static void CMSIS_USART_DMA_RX_IRQ(struct USART_DMA_RX_name* husart_dma) {
+	uint32_t shift = (husart_dma->Channel_number - 1) * 4; //Флаги канала в DMA->ISR/IFCR
+
+	if (READ_BIT(DMA1->ISR, (DMA_ISR_HTIF1 | DMA_ISR_TCIF1) << shift)) {
+		DMA1->IFCR = (DMA_IFCR_CHTIF1 | DMA_IFCR_CTCIF1) << shift;
+		CMSIS_USART_DMA_RX_Process(husart_dma, false);
+	}
+}
+
+__WEAK void DMA1_Channel5_IRQHandler(void) {
+	CMSIS_USART_DMA_RX_IRQ(&husart1_dma_rx);
+}
+
+__WEAK void DMA1_Channel6_IRQHandler(void) {
+	CMSIS_USART_DMA_RX_IRQ(&husart2_dma_rx);
+}
+
+
 
 
 /*================================= НАСТРОЙКА I2C ============================================*/
@@ -1796,11 +2383,11 @@ bool CMSIS_I2C_Adress_Device_Scan(I2C_TypeDef* I2C, uint8_t Adress_Device, uint3
 	CLEAR_BIT(I2C->CR1, I2C_CR1_POS); //Бит ACK управляет (N)ACK текущего байта, принимаемого в сдвиговом регистре.
 	SET_BIT(I2C->CR1, I2C_CR1_START); //Отправляем сигнал START
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while (READ_BIT(I2C->SR1, I2C_SR1_SB) == 0) {
 		//Ожидаем до момента, пока не сработает Start condition generated
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -1810,11 +2397,11 @@ bool CMSIS_I2C_Adress_Device_Scan(I2C_TypeDef* I2C, uint8_t Adress_Device, uint3
 	I2C->SR1;
 	I2C->DR = (Adress_Device << 1); //Адрес + Write
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while ((READ_BIT(I2C->SR1, I2C_SR1_AF) == 0) && (READ_BIT(I2C->SR1, I2C_SR1_ADDR) == 0)) {
 		//Ждем, пока адрес отзовется
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -1878,11 +2465,11 @@ bool CMSIS_I2C_Data_Transmit(I2C_TypeDef* I2C, uint8_t Adress_Device, uint8_t* d
 	CLEAR_BIT(I2C->CR1, I2C_CR1_POS); //Бит ACK управляет (N)ACK текущего байта, принимаемого в сдвиговом регистре.
 	SET_BIT(I2C->CR1, I2C_CR1_START); //Стартуем.
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while (READ_BIT(I2C->SR1, I2C_SR1_SB) == 0) {
 		//Ожидаем до момента, пока не сработает Start condition generated
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -1892,11 +2479,11 @@ bool CMSIS_I2C_Data_Transmit(I2C_TypeDef* I2C, uint8_t Adress_Device, uint8_t* d
 	I2C->SR1;
 	I2C->DR = (Adress_Device << 1); //Адрес + Write
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while ((READ_BIT(I2C->SR1, I2C_SR1_AF) == 0) && (READ_BIT(I2C->SR1, I2C_SR1_ADDR) == 0)) {
 		//Ждем, пока адрес отзовется
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -1978,11 +2565,11 @@ bool CMSIS_I2C_Data_Receive(I2C_TypeDef* I2C, uint8_t Adress_Device, uint8_t* da
 	CLEAR_BIT(I2C->CR1, I2C_CR1_POS); //Бит ACK управляет (N)ACK текущего байта, принимаемого в сдвиговом регистре.
 	SET_BIT(I2C->CR1, I2C_CR1_START); //Стартуем.
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while (READ_BIT(I2C->SR1, I2C_SR1_SB) == 0) {
 		//Ожидаем до момента, пока не сработает Start condition generated
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -1992,11 +2579,11 @@ bool CMSIS_I2C_Data_Receive(I2C_TypeDef* I2C, uint8_t Adress_Device, uint8_t* da
 	I2C->SR1;
 	I2C->DR = (Adress_Device << 1 | 1); //Адрес + команда Read
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while ((READ_BIT(I2C->SR1, I2C_SR1_AF) == 0) && (READ_BIT(I2C->SR1, I2C_SR1_ADDR) == 0)) {
 		//Ждем, пока адрес отзовется
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -2013,10 +2600,10 @@ bool CMSIS_I2C_Data_Receive(I2C_TypeDef* I2C, uint8_t Adress_Device, uint8_t* da
 			if (i < Size_data - 1) {
 				SET_BIT(I2C->CR1, I2C_CR1_ACK); //Если мы хотим принять следующий байт, то отправляем ACK
 
-				Timeout_counter_ms = Timeout_ms;
+				CMSIS_Timeout_Start(Timeout_ms);
 				while (READ_BIT(I2C->SR1, I2C_SR1_RXNE) == 0) {
 					//Ожидаем, пока в сдвиговом регистре появятся данные
-					if (!Timeout_counter_ms) {
+					if (CMSIS_Timeout_Expired()) {
 						return false;
 					}
 				}
@@ -2027,10 +2614,10 @@ bool CMSIS_I2C_Data_Receive(I2C_TypeDef* I2C, uint8_t Adress_Device, uint8_t* da
 				CLEAR_BIT(I2C->CR1, I2C_CR1_ACK); //Если мы знаем, что следующий принятый байт будет последним, то отправим NACK
 
 				SET_BIT(I2C->CR1, I2C_CR1_STOP); //Останавливаем
-				Timeout_counter_ms = Timeout_ms;
+				CMSIS_Timeout_Start(Timeout_ms);
 				while (READ_BIT(I2C->SR1, I2C_SR1_RXNE) == 0) {
 					//Ожидаем, пока в сдвиговом регистре появятся данные
-					if (!Timeout_counter_ms) {
+					if (CMSIS_Timeout_Expired()) {
 						return false;
 					}
 				}
@@ -2091,11 +2678,11 @@ bool CMSIS_I2C_MemWrite(I2C_TypeDef* I2C, uint8_t Adress_Device, uint16_t Adress
 	CLEAR_BIT(I2C->CR1, I2C_CR1_POS); //Бит ACK управляет (N)ACK текущего байта, принимаемого в сдвиговом регистре.
 	SET_BIT(I2C->CR1, I2C_CR1_START); //Стартуем.
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while (READ_BIT(I2C->SR1, I2C_SR1_SB) == 0) {
 		//Ожидаем до момента, пока не сработает Start condition generated
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -2105,11 +2692,11 @@ bool CMSIS_I2C_MemWrite(I2C_TypeDef* I2C, uint8_t Adress_Device, uint16_t Adress
 	I2C->SR1;
 	I2C->DR = (Adress_Device << 1); //Адрес + Write
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while ((READ_BIT(I2C->SR1, I2C_SR1_AF) == 0) && (READ_BIT(I2C->SR1, I2C_SR1_ADDR) == 0)) {
 		//Ждем, пока адрес отзовется
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -2207,11 +2794,11 @@ bool CMSIS_I2C_MemRead(I2C_TypeDef* I2C, uint8_t Adress_Device, uint16_t Adress_
 	CLEAR_BIT(I2C->CR1, I2C_CR1_POS); //Бит ACK управляет (N)ACK текущего байта, принимаемого в сдвиговом регистре.
 	SET_BIT(I2C->CR1, I2C_CR1_START); //Стартуем.
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while (READ_BIT(I2C->SR1, I2C_SR1_SB) == 0) {
 		//Ожидаем до момента, пока не сработает Start condition generated
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -2221,11 +2808,11 @@ bool CMSIS_I2C_MemRead(I2C_TypeDef* I2C, uint8_t Adress_Device, uint16_t Adress_
 	I2C->SR1;
 	I2C->DR = (Adress_Device << 1); //Адрес + команда Write
 
-	Timeout_counter_ms = Timeout_ms;
+	CMSIS_Timeout_Start(Timeout_ms);
 	while ((READ_BIT(I2C->SR1, I2C_SR1_AF) == 0) && (READ_BIT(I2C->SR1, I2C_SR1_ADDR) == 0)) {
 		//Ждем, пока адрес отзовется
 
-		if (!Timeout_counter_ms) {
+		if (CMSIS_Timeout_Expired()) {
 			return false;
 		}
 
@@ -2255,11 +2842,11 @@ bool CMSIS_I2C_MemRead(I2C_TypeDef* I2C, uint8_t Adress_Device, uint16_t Adress_
 		//Повторный старт
 		SET_BIT(I2C->CR1, I2C_CR1_START); //Стартуем.
 
-		Timeout_counter_ms = Timeout_ms;
+		CMSIS_Timeout_Start(Timeout_ms);
 		while (READ_BIT(I2C->SR1, I2C_SR1_SB) == 0) {
 			//Ожидаем до момента, пока не сработает Start condition generated
 
-			if (!Timeout_counter_ms) {
+			if (CMSIS_Timeout_Expired()) {
 				return false;
 			}
 
@@ -2269,11 +2856,11 @@ bool CMSIS_I2C_MemRead(I2C_TypeDef* I2C, uint8_t Adress_Device, uint16_t Adress_
 		I2C->SR1;
 		I2C->DR = (Adress_Device << 1 | 1); //Адрес + команда Read
 
-		Timeout_counter_ms = Timeout_ms;
+		CMSIS_Timeout_Start(Timeout_ms);
 		while ((READ_BIT(I2C->SR1, I2C_SR1_AF) == 0) && (READ_BIT(I2C->SR1, I2C_SR1_ADDR) == 0)) {
 			//Ждем, пока адрес отзовется
 
-			if (!Timeout_counter_ms) {
+			if (CMSIS_Timeout_Expired()) {
 				return false;
 			}
 
@@ -2319,7 +2906,458 @@ bool CMSIS_I2C_MemRead(I2C_TypeDef* I2C, uint8_t Adress_Device, uint16_t Adress_
 }
 
 
-/*================================= НАСТРОЙКА SPI ============================================*/
+/*------------------------- Асинхронный обмен I2C1 (прерывания + DMA) -------------------------*/
+/*
+ * Функции выше ждут флаги в цикле и держат ядро всю транзакцию: при 100 кГц это ~90 мкс на байт,
+ * т.е. чтение 16 байт из EEPROM с 2-байтным адресом - около 2 мс простоя.
+ * Здесь транзакция ставится в очередь и идет сама: ядро тратит время только на 5-7 коротких
+ * прерываний (START, адрес, адрес памяти, повторный START, конец), а данные любого размера
+ * переносит DMA. По окончании вызывается Callback (из прерывания).
+ *
+ * Каналы DMA1 (Table 78):
+ * I2C1_TX - Channel 6 (без прерывания: конец передачи ловится по флагу BTF)
+ * I2C1_RX - Channel 7 (прерывание TC: после него STOP)
+ * Это те же каналы, что у USART2 RX/TX. Одновременно с DMA USART2 не использовать.
+ *
+ * Прием:
+ * 1 байт - без DMA: NACK и STOP сразу после ADDR, байт забирается по RXNE.
+ * 2 и больше - DMA с битом LAST: последний байт автоматически получит NACK.
+ *
+ * Ошибки:
+ * AF (нет ответа) - STOP, Status = I2C_ASYNC_NACK.
+ * BERR, ARLO, OVR, ошибка DMA, таймаут - восстановление шины, Status = I2C_ASYNC_ERROR.
+ * Восстановление: ножки переводятся в GPIO, 9 тактов SCL, пока ведомый не отпустит SDA,
+ * условие STOP вручную, затем SWRST и возврат настроек I2C1 (CR2, CCR, TRISE) без ожиданий.
+ *
+ * Прерывания ничего не ждут: восстановление шины (~100 мкс) и запуск следующей транзакции,
+ * пока STOP предыдущей еще формируется, делает CMSIS_I2C1_Async_Poll из главного цикла.
+ * Иначе обработчик на приоритете TIM3 задерживал бы строб SELECT.
+ */
+
+#define I2C_ASYNC_PHASE_START_W 0 //Ждем SB, дальше адрес + Write
+#define I2C_ASYNC_PHASE_ADDR_W  1 //Ждем ADDR после адреса + Write
+#define I2C_ASYNC_PHASE_MEMADDR 2 //Передаем адрес памяти по TXE
+#define I2C_ASYNC_PHASE_RESTART 3 //Ждем BTF перед повторным START
+#define I2C_ASYNC_PHASE_START_R 4 //Ждем SB, дальше адрес + Read
+#define I2C_ASYNC_PHASE_ADDR_R  5 //Ждем ADDR после адреса + Read
+#define I2C_ASYNC_PHASE_TX      6 //Данные передает DMA, ждем BTF
+#define I2C_ASYNC_PHASE_RX      7 //Данные принимает DMA (или RXNE для 1 байта)
+
+static struct I2C_Transaction_name* I2C1_async_queue[I2C_ASYNC_QUEUE];
+static volatile uint8_t I2C1_async_head; //Сюда кладем следующую транзакцию
+static volatile uint8_t I2C1_async_tail; //Эта транзакция сейчас выполняется
+static struct I2C_Transaction_name* volatile I2C1_async_current;
+static volatile uint8_t I2C1_async_phase;
+static uint8_t I2C1_async_adress_left; //Сколько байт адреса памяти еще передать
+static volatile uint32_t I2C1_async_start_ms; //Время последнего продвижения текущей транзакции
+static uint32_t I2C1_async_progress; //Фаза и остаток DMA на прошлой проверке таймаута
+static volatile bool I2C1_async_recover; //Шину нужно восстановить (в CMSIS_I2C1_Async_Poll)
+
+static void CMSIS_I2C1_Async_Start(void);
+
+/**
+ ******************************************************************************
+ *  @breif Короткая задержка для ручного тактирования шины (~5 мкс)
+ ******************************************************************************
+ */
+static void CMSIS_I2C1_Bus_Delay(void) {
+	for (volatile uint16_t i = 0; i < 60; i++) ;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Восстановление зависшей шины I2C1
+ *  @attention Не использует CMSIS_I2C_Reset (там бесконечные ожидания флагов)
+ ******************************************************************************
+ */
+static void CMSIS_I2C1_Bus_Recover(void) {
+	uint32_t cr2 = I2C1->CR2;
+	uint32_t ccr = I2C1->CCR;
+	uint32_t trise = I2C1->TRISE;
+
+	CLEAR_BIT(I2C1->CR1, I2C_CR1_PE);
+
+	//PB6 SCL, PB7 SDA - General purpose output open drain, линии отпущены
+	GPIOB->BSRR = GPIO_BSRR_BS6 | GPIO_BSRR_BS7;
+	MODIFY_REG(GPIOB->CRL, GPIO_CRL_CNF6_Msk | GPIO_CRL_CNF7_Msk, (0b01 << GPIO_CRL_CNF6_Pos) | (0b01 << GPIO_CRL_CNF7_Pos));
+
+	//Ведомый, застрявший посреди байта, отпустит SDA не позже, чем через 9 тактов
+	for (uint8_t i = 0; i < 9 && !READ_BIT(GPIOB->IDR, GPIO_IDR_IDR7); i++) {
+		GPIOB->BSRR = GPIO_BSRR_BR6;
+		CMSIS_I2C1_Bus_Delay();
+		GPIOB->BSRR = GPIO_BSRR_BS6;
+		CMSIS_I2C1_Bus_Delay();
+	}
+	//Условие STOP: SDA из 0 в 1 при SCL = 1
+	GPIOB->BSRR = GPIO_BSRR_BR6;
+	CMSIS_I2C1_Bus_Delay();
+	GPIOB->BSRR = GPIO_BSRR_BR7;
+	CMSIS_I2C1_Bus_Delay();
+	GPIOB->BSRR = GPIO_BSRR_BS6;
+	CMSIS_I2C1_Bus_Delay();
+	GPIOB->BSRR = GPIO_BSRR_BS7;
+	CMSIS_I2C1_Bus_Delay();
+
+	//Обратно в Alternate function open drain
+	MODIFY_REG(GPIOB->CRL, GPIO_CRL_CNF6_Msk | GPIO_CRL_CNF7_Msk, (0b11 << GPIO_CRL_CNF6_Pos) | (0b11 << GPIO_CRL_CNF7_Pos));
+
+	//Сброс блока I2C (снимает зависший BUSY) и возврат настроек
+	SET_BIT(I2C1->CR1, I2C_CR1_SWRST);
+	CLEAR_BIT(I2C1->CR1, I2C_CR1_SWRST);
+	I2C1->CR2 = cr2 & ~(I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITBUFEN);
+	I2C1->CCR = ccr;
+	I2C1->TRISE = trise;
+	SET_BIT(I2C1->CR1, I2C_CR1_PE);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Завершение текущей транзакции и запуск следующей
+ *  @param  Status - I2C_ASYNC_OK, I2C_ASYNC_NACK или I2C_ASYNC_ERROR
+ ******************************************************************************
+ */
+static void CMSIS_I2C1_Async_Finish(uint8_t Status) {
+	struct I2C_Transaction_name* transaction = I2C1_async_current;
+
+	CLEAR_BIT(DMA1_Channel6->CCR, DMA_CCR_EN);
+	CLEAR_BIT(DMA1_Channel7->CCR, DMA_CCR_EN);
+	CLEAR_BIT(I2C1->CR2, I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITBUFEN);
+	CLEAR_BIT(I2C1->CR1, I2C_CR1_ACK);
+
+	I2C1_async_current = NULL;
+	I2C1_async_tail++;
+	I2C1_async_start_ms = CMSIS_Millis(); //Отсчет для STOP, который так и не сформировался
+	if (transaction) {
+		transaction->Status = Status;
+		if (transaction->Callback) {
+			transaction->Callback(transaction);
+		}
+	}
+	CMSIS_I2C1_Async_Start();
+}
+
+/**
+ ******************************************************************************
+ *  @breif Прерывание с ошибкой: STOP или восстановление шины (его сделает CMSIS_I2C1_Async_Poll)
+ ******************************************************************************
+ */
+static void CMSIS_I2C1_Async_Abort(uint8_t Status) {
+	if (Status == I2C_ASYNC_NACK) {
+		SET_BIT(I2C1->CR1, I2C_CR1_STOP);
+	}
+	else {
+		I2C1_async_recover = true;
+		CLEAR_BIT(I2C1->CR2, I2C_CR2_ITEVTEN); //До восстановления события не нужны
+	}
+	CMSIS_I2C1_Async_Finish(Status);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Запуск следующей транзакции из очереди (если шина свободна).
+ *  Не ждет: пока формируется STOP предыдущей или шину нужно восстановить,
+ *  транзакцию запустит CMSIS_I2C1_Async_Poll.
+ ******************************************************************************
+ */
+static void CMSIS_I2C1_Async_Start(void) {
+	if (I2C1_async_current) {
+		return; //Следующая запустится из CMSIS_I2C1_Async_Finish
+	}
+	if (I2C1_async_tail == I2C1_async_head || I2C1_async_recover || READ_BIT(I2C1->CR1, I2C_CR1_STOP)) {
+		CLEAR_BIT(I2C1->CR2, I2C_CR2_ITEVTEN);
+		return;
+	}
+	if (READ_BIT(I2C1->SR2, I2C_SR2_BUSY)) {
+		I2C1_async_recover = true; //Шину держит кто-то другой или она зависла
+		CLEAR_BIT(I2C1->CR2, I2C_CR2_ITEVTEN);
+		return;
+	}
+
+	I2C1_async_current = I2C1_async_queue[I2C1_async_tail & (I2C_ASYNC_QUEUE - 1)];
+	I2C1_async_phase = I2C_ASYNC_PHASE_START_W;
+	if (I2C1_async_current->Read && !I2C1_async_current->Size_adress) {
+		I2C1_async_phase = I2C_ASYNC_PHASE_START_R; //Простое чтение, без адреса памяти
+	}
+	I2C1_async_start_ms = CMSIS_Millis();
+	I2C1_async_progress = 0xFFFFFFFF;
+	CLEAR_BIT(I2C1->CR1, I2C_CR1_POS);
+	SET_BIT(I2C1->CR2, I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+	SET_BIT(I2C1->CR1, I2C_CR1_START);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Запуск передачи данных через DMA (после адреса устройства и памяти)
+ ******************************************************************************
+ */
+static void CMSIS_I2C1_Async_Start_TX(struct I2C_Transaction_name* transaction) {
+	I2C1_async_phase = I2C_ASYNC_PHASE_TX;
+	if (transaction->Size_data) {
+		DMA1_Channel6->CMAR = (uint32_t)transaction->data;
+		DMA1_Channel6->CNDTR = transaction->Size_data;
+		SET_BIT(DMA1_Channel6->CCR, DMA_CCR_EN);
+		SET_BIT(I2C1->CR2, I2C_CR2_DMAEN);
+	}
+}
+
+/**
+ ******************************************************************************
+ *  @breif Настройка асинхронного обмена по I2C1 (сама шина настраивается CMSIS_I2C1_Init)
+ ******************************************************************************
+ */
+void CMSIS_I2C1_Async_Init(void) {
+	CMSIS_I2C1_Init();
+
+	SET_BIT(RCC->AHBENR, RCC_AHBENR_DMA1EN); //Включение тактирования DMA1
+	//Channel 6: память -> I2C1->DR
+	DMA1_Channel6->CCR = 0;
+	DMA1_Channel6->CPAR = (uint32_t)&I2C1->DR;
+	MODIFY_REG(DMA1_Channel6->CCR, DMA_CCR_PL_Msk, 0b10 << DMA_CCR_PL_Pos); //Приоритет высокий
+	SET_BIT(DMA1_Channel6->CCR, DMA_CCR_DIR | DMA_CCR_MINC); //Чтение из памяти, инкремент памяти
+	//Channel 7: I2C1->DR -> память
+	DMA1_Channel7->CCR = 0;
+	DMA1_Channel7->CPAR = (uint32_t)&I2C1->DR;
+	MODIFY_REG(DMA1_Channel7->CCR, DMA_CCR_PL_Msk, 0b10 << DMA_CCR_PL_Pos); //Приоритет высокий
+	SET_BIT(DMA1_Channel7->CCR, DMA_CCR_MINC | DMA_CCR_TCIE | DMA_CCR_TEIE);
+
+	I2C1_async_head = 0;
+	I2C1_async_tail = 0;
+	I2C1_async_current = NULL;
+	I2C1_async_recover = false;
+	SET_BIT(I2C1->CR2, I2C_CR2_ITERREN);
+	NVIC_EnableIRQ(I2C1_EV_IRQn);
+	NVIC_EnableIRQ(I2C1_ER_IRQn);
+	NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Постановка транзакции в очередь
+ *  @param  *transaction - описание транзакции. Не копируется! Не менять, пока Status == I2C_ASYNC_PENDING
+ *  @retval  True - транзакция в очереди. False - очередь заполнена
+ ******************************************************************************
+ */
+bool CMSIS_I2C1_Async_Submit(struct I2C_Transaction_name* transaction) {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if ((uint8_t)(I2C1_async_head - I2C1_async_tail) >= I2C_ASYNC_QUEUE) {
+		__set_PRIMASK(primask);
+		return false;
+	}
+	transaction->Status = I2C_ASYNC_PENDING;
+	I2C1_async_queue[I2C1_async_head & (I2C_ASYNC_QUEUE - 1)] = transaction;
+	I2C1_async_head++;
+	CMSIS_I2C1_Async_Start();
+	__set_PRIMASK(primask);
+	return true;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Есть ли невыполненные транзакции
+ ******************************************************************************
+ */
+bool CMSIS_I2C1_Async_Busy(void) {
+	return I2C1_async_head != I2C1_async_tail;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Таймаут, восстановление шины и запуск следующей транзакции.
+ *  Вызывать периодически (например, в главном цикле): следующая транзакция после STOP
+ *  и после ошибки шины запускается отсюда.
+ *  Таймаут считается от последнего продвижения (смена фазы или байт через DMA), а не от начала:
+ *  длинная транзакция на 100 кГц идет дольше I2C_ASYNC_TIMEOUT_MS (255 байт - 23 мс).
+ *  @attention Если транзакция не продвигается дольше I2C_ASYNC_TIMEOUT_MS, шина восстанавливается,
+ *  и Callback вызывается отсюда, а не из прерывания.
+ ******************************************************************************
+ */
+void CMSIS_I2C1_Async_Poll(void) {
+	uint32_t progress = ((uint32_t)I2C1_async_phase << 16) | (DMA1_Channel6->CNDTR + DMA1_Channel7->CNDTR);
+
+	if (I2C1_async_current) {
+		if (progress != I2C1_async_progress) {
+			I2C1_async_progress = progress;
+			I2C1_async_start_ms = CMSIS_Millis(); //Транзакция идет: отсчет заново
+			return;
+		}
+		if (CMSIS_Millis() - I2C1_async_start_ms <= I2C_ASYNC_TIMEOUT_MS) {
+			return;
+		}
+	}
+	else if (I2C1_async_tail == I2C1_async_head && !I2C1_async_recover) {
+		return;
+	}
+	NVIC_DisableIRQ(I2C1_EV_IRQn);
+	NVIC_DisableIRQ(I2C1_ER_IRQn);
+	NVIC_DisableIRQ(DMA1_Channel7_IRQn);
+	if (I2C1_async_current && CMSIS_Millis() - I2C1_async_start_ms > I2C_ASYNC_TIMEOUT_MS) {
+		CMSIS_I2C1_Async_Abort(I2C_ASYNC_ERROR);
+	}
+	if (!I2C1_async_current) {
+		if (READ_BIT(I2C1->CR1, I2C_CR1_STOP) && CMSIS_Millis() - I2C1_async_start_ms > I2C_ASYNC_TIMEOUT_MS) {
+			I2C1_async_recover = true; //STOP так и не сформирован: шина зависла
+		}
+		if (I2C1_async_recover) {
+			I2C1_async_recover = false;
+			CMSIS_I2C1_Bus_Recover();
+		}
+		CMSIS_I2C1_Async_Start();
+	}
+	NVIC_EnableIRQ(I2C1_EV_IRQn);
+	NVIC_EnableIRQ(I2C1_ER_IRQn);
+	NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Прерывание событий I2C1: START, адрес, адрес памяти, конец передачи
+ ******************************************************************************
+ */
+__WEAK void I2C1_EV_IRQHandler(void) {
+	struct I2C_Transaction_name* transaction = I2C1_async_current;
+	uint16_t sr1 = I2C1->SR1;
+
+	if (!transaction) {
+		CLEAR_BIT(I2C1->CR2, I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN);
+		return;
+	}
+
+	if (sr1 & I2C_SR1_SB) {
+		//SB сбрасывается чтением SR1 и записью в DR
+		if (I2C1_async_phase == I2C_ASYNC_PHASE_START_R) {
+			I2C1_async_phase = I2C_ASYNC_PHASE_ADDR_R;
+			I2C1->DR = (transaction->Adress_Device << 1) | 1; //Адрес + Read
+		}
+		else {
+			I2C1_async_phase = I2C_ASYNC_PHASE_ADDR_W;
+			I2C1->DR = transaction->Adress_Device << 1; //Адрес + Write
+		}
+		return;
+	}
+
+	if (sr1 & I2C_SR1_ADDR) {
+		if (I2C1_async_phase == I2C_ASYNC_PHASE_ADDR_R) {
+			I2C1_async_phase = I2C_ASYNC_PHASE_RX;
+			if (transaction->Size_data <= 1) {
+				//Один байт: NACK и STOP нужно выставить до сброса ADDR
+				CLEAR_BIT(I2C1->CR1, I2C_CR1_ACK);
+				I2C1->SR2;
+				SET_BIT(I2C1->CR1, I2C_CR1_STOP);
+				SET_BIT(I2C1->CR2, I2C_CR2_ITBUFEN);
+			}
+			else {
+				DMA1_Channel7->CMAR = (uint32_t)transaction->data;
+				DMA1_Channel7->CNDTR = transaction->Size_data;
+				SET_BIT(DMA1_Channel7->CCR, DMA_CCR_EN);
+				SET_BIT(I2C1->CR1, I2C_CR1_ACK);
+				SET_BIT(I2C1->CR2, I2C_CR2_DMAEN | I2C_CR2_LAST); //LAST: NACK на последнем байте DMA
+				I2C1->SR2;
+			}
+			return;
+		}
+		I2C1->SR2; //ADDR сбрасывается чтением SR1, а потом SR2
+		if (transaction->Size_adress) {
+			I2C1_async_phase = I2C_ASYNC_PHASE_MEMADDR;
+			I2C1_async_adress_left = transaction->Size_adress;
+			SET_BIT(I2C1->CR2, I2C_CR2_ITBUFEN); //Адрес памяти по TXE
+		}
+		else if (transaction->Size_data) {
+			CMSIS_I2C1_Async_Start_TX(transaction);
+		}
+		else {
+			//Только адрес (проверка наличия устройства)
+			SET_BIT(I2C1->CR1, I2C_CR1_STOP);
+			CMSIS_I2C1_Async_Finish(I2C_ASYNC_OK);
+		}
+		return;
+	}
+
+	if (I2C1_async_phase == I2C_ASYNC_PHASE_MEMADDR && (sr1 & I2C_SR1_TXE)) {
+		I2C1_async_adress_left--;
+		I2C1->DR = (uint8_t)(transaction->Adress_data >> (8 * I2C1_async_adress_left)); //Старший байт первым
+		if (!I2C1_async_adress_left) {
+			CLEAR_BIT(I2C1->CR2, I2C_CR2_ITBUFEN);
+			if (transaction->Read) {
+				I2C1_async_phase = I2C_ASYNC_PHASE_RESTART;
+			}
+			else {
+				CMSIS_I2C1_Async_Start_TX(transaction);
+			}
+		}
+		return;
+	}
+
+	if (sr1 & I2C_SR1_BTF) {
+		if (I2C1_async_phase == I2C_ASYNC_PHASE_RESTART) {
+			I2C1_async_phase = I2C_ASYNC_PHASE_START_R;
+			SET_BIT(I2C1->CR1, I2C_CR1_START); //Повторный старт
+		}
+		else if (I2C1_async_phase == I2C_ASYNC_PHASE_TX && !DMA1_Channel6->CNDTR) {
+			//DMA отдал все байты, и последний ушел в линию
+			SET_BIT(I2C1->CR1, I2C_CR1_STOP);
+			CMSIS_I2C1_Async_Finish(I2C_ASYNC_OK);
+		}
+		return;
+	}
+
+	if (I2C1_async_phase == I2C_ASYNC_PHASE_RX && (sr1 & I2C_SR1_RXNE)) {
+		//Прием одного байта без DMA
+		if (transaction->Size_data) {
+			transaction->data[0] = I2C1->DR;
+		}
+		else {
+			I2C1->DR;
+		}
+		CMSIS_I2C1_Async_Finish(I2C_ASYNC_OK);
+	}
+}
+
+/**
+ ******************************************************************************
+ *  @breif Прерывание ошибок I2C1
+ ******************************************************************************
+ */
+__WEAK void I2C1_ER_IRQHandler(void) {
+	uint16_t sr1 = I2C1->SR1;
+
+	//Флаги ошибок сбрасываются записью 0
+	I2C1->SR1 = ~(sr1 & (I2C_SR1_AF | I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_OVR | I2C_SR1_TIMEOUT | I2C_SR1_PECERR)) & 0xFFFF;
+	if (!I2C1_async_current) {
+		return;
+	}
+	if (sr1 & I2C_SR1_AF) {
+		CMSIS_I2C1_Async_Abort(I2C_ASYNC_NACK); //Устройство не ответило
+	}
+	else if (sr1 & (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_OVR | I2C_SR1_TIMEOUT)) {
+		CMSIS_I2C1_Async_Abort(I2C_ASYNC_ERROR);
+	}
+}
+
+/**
+ ******************************************************************************
+ *  @breif Прерывание DMA приема I2C1 (Channel 7)
+ ******************************************************************************
+ */
+static void CMSIS_I2C1_Async_DMA_RX_IRQ(void) {
+	uint32_t isr = DMA1->ISR;
+
+	DMA1->IFCR = DMA_IFCR_CGIF7;
+	if (!I2C1_async_current) {
+		return;
+	}
+	if (isr & DMA_ISR_TEIF7) {
+		CMSIS_I2C1_Async_Abort(I2C_ASYNC_ERROR);
+	}
+	else if (isr & DMA_ISR_TCIF7) {
+		SET_BIT(I2C1->CR1, I2C_CR1_STOP); //Последний байт уже принят с NACK
+		CMSIS_I2C1_Async_Finish(I2C_ASYNC_OK);
+	}
+}
+
+
+/*================================= НАСТРОЙКА SPI ============================================*/
 
 /**
 ***************************************************************************************
@@ -2468,28 +3506,28 @@ bool CMSIS_SPI_Data_Transmit_8BIT(SPI_TypeDef* SPI, uint8_t* data, uint16_t Size
 		//(При этом очищается бит TXE)
         
 		for (uint16_t i = 1; i < Size_data; i++) {
-			Timeout_counter_ms = Timeout_ms;
+			CMSIS_Timeout_Start(Timeout_ms);
 			while (!READ_BIT(SPI->SR, SPI_SR_TXE)) {
 				//Ждем, пока буфер на передачу не освободится
-				if (!Timeout_counter_ms) {
+				if (CMSIS_Timeout_Expired()) {
 					return false;
 				}
 			}
 			SPI->DR = *(data + i); //Запишем следующий элемент данных.
 		}
-		Timeout_counter_ms = Timeout_ms;
+		CMSIS_Timeout_Start(Timeout_ms);
 		while (!READ_BIT(SPI->SR, SPI_SR_TXE)) {
 			//После записи последнего элемента данных в регистр SPI_DR,
 			//подождем, пока TXE станет равным 1.
-			if (!Timeout_counter_ms) {
+			if (CMSIS_Timeout_Expired()) {
 				return false;
 			}
 		}
-		Timeout_counter_ms = Timeout_ms;
+		CMSIS_Timeout_Start(Timeout_ms);
 		while (READ_BIT(SPI->SR, SPI_SR_BSY)) {
 			//Затем подождем, пока BSY станет равным 0.
 			//Это указывает на то, что передача последних данных завершена.
-			if (!Timeout_counter_ms) {
+			if (CMSIS_Timeout_Expired()) {
 				return false;
 			}
 		}
@@ -2519,28 +3557,28 @@ bool CMSIS_SPI_Data_Transmit_16BIT(SPI_TypeDef* SPI, uint16_t* data, uint16_t Si
 		//(При этом очищается бит TXE)
         
 		for (uint16_t i = 1; i < Size_data; i++) {
-			Timeout_counter_ms = Timeout_ms;
+			CMSIS_Timeout_Start(Timeout_ms);
 			while (!READ_BIT(SPI->SR, SPI_SR_TXE)) {
 				//Ждем, пока буфер на передачу не освободится
-				if (!Timeout_counter_ms) {
+				if (CMSIS_Timeout_Expired()) {
 					return false;
 				}
 			}
 			SPI->DR = *(data + i); //Запишем следующий элемент данных.
 		}
-		Timeout_counter_ms = Timeout_ms;
+		CMSIS_Timeout_Start(Timeout_ms);
 		while (!READ_BIT(SPI->SR, SPI_SR_TXE)) {
 			//После записи последнего элемента данных в регистр SPI_DR,
 			//подождем, пока TXE станет равным 1.
-			if (!Timeout_counter_ms) {
+			if (CMSIS_Timeout_Expired()) {
 				return false;
 			}
 		}
-		Timeout_counter_ms = Timeout_ms;
+		CMSIS_Timeout_Start(Timeout_ms);
 		while (READ_BIT(SPI->SR, SPI_SR_BSY)) {
 			//Затем подождем, пока BSY станет равным 0.
 			//Это указывает на то, что передача последних данных завершена.
-			if (!Timeout_counter_ms) {
+			if (CMSIS_Timeout_Expired()) {
 				return false;
 			}
 		}
@@ -2576,21 +3614,21 @@ bool CMSIS_SPI_Data_Receive_8BIT(SPI_TypeDef* SPI, uint8_t* data, uint16_t Size_
 		//Начнем прием данных
 		for (uint16_t i = 0; i < Size_data; i++) {
 			SPI->DR = 0; //Запустим тактирование, чтоб считать 8 бит
-			Timeout_counter_ms = Timeout_ms;
+			CMSIS_Timeout_Start(Timeout_ms);
 			while (!READ_BIT(SPI->SR, SPI_SR_RXNE)) {
 				//Ждем, пока буфер на прием не заполнится
-				if (!Timeout_counter_ms) {
+				if (CMSIS_Timeout_Expired()) {
 					return false;
 				}
 			}
 			*(data + i) = SPI->DR; //Считываем данные
 		}
         
-		Timeout_counter_ms = Timeout_ms;
+		CMSIS_Timeout_Start(Timeout_ms);
 		while (READ_BIT(SPI->SR, SPI_SR_BSY)) {
 			//Затем подождем, пока BSY станет равным 0.
 			//Это указывает на то, что прием последних данных завершен.
-			if (!Timeout_counter_ms) {
+			if (CMSIS_Timeout_Expired()) {
 				return false;
 			}
 		}
@@ -2624,21 +3662,21 @@ bool CMSIS_SPI_Data_Receive_16BIT(SPI_TypeDef* SPI, uint16_t* data, uint16_t Siz
 		//Начнем прием данных
 		for (uint16_t i = 0; i < Size_data; i++) {
 			SPI->DR = 0; //Запустим тактирование, чтоб считать 16 бит
-			Timeout_counter_ms = Timeout_ms;
+			CMSIS_Timeout_Start(Timeout_ms);
 			while (!READ_BIT(SPI->SR, SPI_SR_RXNE)) {
 				//Ждем, пока буфер на прием не заполнится
-				if (!Timeout_counter_ms) {
+				if (CMSIS_Timeout_Expired()) {
 					return false;
 				}
 			}
 			*(data + i) = SPI->DR; //Считываем данные
 		}
         
-		Timeout_counter_ms = Timeout_ms;
+		CMSIS_Timeout_Start(Timeout_ms);
 		while (READ_BIT(SPI->SR, SPI_SR_BSY)) {
 			//Затем подождем, пока BSY станет равным 0.
 			//Это указывает на то, что прием последних данных завершен.
-			if (!Timeout_counter_ms) {
+			if (CMSIS_Timeout_Expired()) {
 				return false;
 			}
 		}
@@ -2648,3 +3686,347 @@ bool CMSIS_SPI_Data_Receive_16BIT(SPI_TypeDef* SPI, uint16_t* data, uint16_t Siz
 		return false;
 	}
 }
+
+/*------------------------------ SPI1 через DMA ------------------------------*/
+/*
+ * Функции выше опрашивают TXE/RXNE на каждый байт. Здесь байты переносит DMA:
+ * SPI1_RX - DMA1 Channel 2, SPI1_TX - DMA1 Channel 3 (Table 78).
+ *
+ * Очередь транзакций: у каждой своя ножка NSS (любой GPIO, уровень NSS_logic во время обмена),
+ * данные на передачу и/или буфер приема. DMA приема работает всегда (если принятое не нужно -
+ * в байт-заглушку), поэтому конец транзакции - прерывание TC канала 2: к этому моменту
+ * последний байт уже целиком прошел по линии, и NSS можно сразу отпускать.
+ * Канал приема имеет приоритет выше канала передачи, чтобы не было OVR.
+ *
+ * Поточный режим (например, дисплей отображения нажатий): буфер из двух половин
+ * передается по кругу (circular DMA), NSS все время активен. Прерывания HT/TC канала 3
+ * сообщают, какая половина уже ушла в линию и ее можно заполнять новыми данными.
+ * Пока идет поток, транзакции из очереди ждут CMSIS_SPI1_DMA_Stream_Stop.
+ *
+ * Скорость задается в CMSIS_SPI1_init (делитель BR).
+ */
+
+static struct SPI_Transaction_name* SPI1_dma_queue[SPI_DMA_QUEUE];
+static volatile uint8_t SPI1_dma_head; //Сюда кладем следующую транзакцию
+static volatile uint8_t SPI1_dma_tail; //Эта транзакция сейчас выполняется
+static struct SPI_Transaction_name* volatile SPI1_dma_current;
+static uint8_t SPI1_dma_dummy_rx; //Сюда DMA складывает ненужные принятые байты
+static const uint8_t SPI1_dma_dummy_tx = 0xFF; //Передается при чистом приеме
+
+static volatile bool SPI1_dma_stream; //Идет поточная передача
+static uint8_t* SPI1_dma_stream_buffer;
+static uint16_t SPI1_dma_stream_half;
+static void (*SPI1_dma_stream_callback)(uint8_t* half);
+static GPIO_TypeDef* SPI1_dma_stream_GPIO;
+static uint8_t SPI1_dma_stream_pin;
+static bool SPI1_dma_stream_logic;
+
+/**
+ ******************************************************************************
+ *  @breif Управление ножкой NSS
+ *  @param  Active - true - выбрать ведомого, false - отпустить
+ *  @param  NSS_logic - уровень NSS, при котором ведомый выбран
+ ******************************************************************************
+ */
+static void CMSIS_SPI1_DMA_NSS(GPIO_TypeDef* GPIO, uint8_t NSS_pin, bool NSS_logic, bool Active) {
+	if (Active == NSS_logic) {
+		GPIO->BSRR = 1 << NSS_pin;
+	}
+	else {
+		GPIO->BSRR = 1 << (NSS_pin + 16);
+	}
+}
+
+/**
+ ******************************************************************************
+ *  @breif Сброс OVR и RXNE, оставшихся от передачи без приема
+ ******************************************************************************
+ */
+static void CMSIS_SPI1_DMA_Flush(void) {
+	SPI1->DR;
+	SPI1->SR;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Запуск следующей транзакции из очереди
+ ******************************************************************************
+ */
+static void CMSIS_SPI1_DMA_Start(void) {
+	struct SPI_Transaction_name* transaction;
+
+	if (SPI1_dma_current || SPI1_dma_stream || SPI1_dma_tail == SPI1_dma_head) {
+		return;
+	}
+	transaction = SPI1_dma_queue[SPI1_dma_tail & (SPI_DMA_QUEUE - 1)];
+	SPI1_dma_current = transaction;
+	CMSIS_SPI1_DMA_Flush();
+
+	//Прием
+	if (transaction->rx_data) {
+		DMA1_Channel2->CMAR = (uint32_t)transaction->rx_data;
+		SET_BIT(DMA1_Channel2->CCR, DMA_CCR_MINC);
+	}
+	else {
+		DMA1_Channel2->CMAR = (uint32_t)&SPI1_dma_dummy_rx;
+		CLEAR_BIT(DMA1_Channel2->CCR, DMA_CCR_MINC);
+	}
+	DMA1_Channel2->CNDTR = transaction->Size_data;
+
+	//Передача
+	if (transaction->tx_data) {
+		DMA1_Channel3->CMAR = (uint32_t)transaction->tx_data;
+		SET_BIT(DMA1_Channel3->CCR, DMA_CCR_MINC);
+	}
+	else {
+		DMA1_Channel3->CMAR = (uint32_t)&SPI1_dma_dummy_tx;
+		CLEAR_BIT(DMA1_Channel3->CCR, DMA_CCR_MINC);
+	}
+	DMA1_Channel3->CNDTR = transaction->Size_data;
+
+	CMSIS_SPI1_DMA_NSS(transaction->GPIO, transaction->NSS_pin, transaction->NSS_logic, true);
+	SET_BIT(DMA1_Channel2->CCR, DMA_CCR_EN);
+	SET_BIT(DMA1_Channel3->CCR, DMA_CCR_EN);
+	SET_BIT(SPI1->CR2, SPI_CR2_RXDMAEN); //Сначала прием, потом передача (см. п.п. 25.3.9)
+	SET_BIT(SPI1->CR2, SPI_CR2_TXDMAEN);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Настройка обмена по SPI1 через DMA (сама шина настраивается CMSIS_SPI1_init)
+ ******************************************************************************
+ */
+void CMSIS_SPI1_DMA_Init(void) {
+	SET_BIT(RCC->AHBENR, RCC_AHBENR_DMA1EN); //Включение тактирования DMA1
+	//Channel 2: SPI1->DR -> память
+	DMA1_Channel2->CCR = 0;
+	DMA1_Channel2->CPAR = (uint32_t)&SPI1->DR;
+	MODIFY_REG(DMA1_Channel2->CCR, DMA_CCR_PL_Msk, 0b11 << DMA_CCR_PL_Pos); //Приоритет очень высокий
+	SET_BIT(DMA1_Channel2->CCR, DMA_CCR_TCIE | DMA_CCR_TEIE);
+	//Channel 3: память -> SPI1->DR
+	DMA1_Channel3->CCR = 0;
+	DMA1_Channel3->CPAR = (uint32_t)&SPI1->DR;
+	MODIFY_REG(DMA1_Channel3->CCR, DMA_CCR_PL_Msk, 0b10 << DMA_CCR_PL_Pos); //Приоритет высокий
+	SET_BIT(DMA1_Channel3->CCR, DMA_CCR_DIR); //Чтение из памяти
+
+	SPI1_dma_head = 0;
+	SPI1_dma_tail = 0;
+	SPI1_dma_current = NULL;
+	SPI1_dma_stream = false;
+	NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+	NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Постановка транзакции в очередь
+ *  @param  *transaction - описание транзакции. Не копируется! Не менять, пока Status == SPI_DMA_PENDING
+ *  @retval  True - транзакция в очереди. False - очередь заполнена или Size_data = 0
+ ******************************************************************************
+ */
+bool CMSIS_SPI1_DMA_Submit(struct SPI_Transaction_name* transaction) {
+	uint32_t primask = __get_PRIMASK();
+
+	if (!transaction->Size_data) {
+		return false;
+	}
+	__disable_irq();
+	if ((uint8_t)(SPI1_dma_head - SPI1_dma_tail) >= SPI_DMA_QUEUE) {
+		__set_PRIMASK(primask);
+		return false;
+	}
+	transaction->Status = SPI_DMA_PENDING;
+	SPI1_dma_queue[SPI1_dma_head & (SPI_DMA_QUEUE - 1)] = transaction;
+	SPI1_dma_head++;
+	CMSIS_SPI1_DMA_Start();
+	__set_PRIMASK(primask);
+	return true;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Есть ли невыполненные транзакции
+ ******************************************************************************
+ */
+bool CMSIS_SPI1_DMA_Busy(void) {
+	return SPI1_dma_head != SPI1_dma_tail;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Запуск поточной передачи (двойной буфер)
+ *  @param  *buffer - буфер из двух половин по Size_half байт
+ *  @param  Callback - вызывается из прерывания с половиной, которую можно заполнять
+ *  @retval  True - поток запущен. False - шина занята транзакцией или другим потоком
+ ******************************************************************************
+ */
+bool CMSIS_SPI1_DMA_Stream_Start(GPIO_TypeDef* GPIO, uint8_t NSS_pin, bool NSS_logic, uint8_t* buffer, uint16_t Size_half, void (*Callback)(uint8_t* half)) {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (SPI1_dma_current || SPI1_dma_stream) {
+		__set_PRIMASK(primask);
+		return false;
+	}
+	SPI1_dma_stream = true;
+	__set_PRIMASK(primask);
+
+	SPI1_dma_stream_buffer = buffer;
+	SPI1_dma_stream_half = Size_half;
+	SPI1_dma_stream_callback = Callback;
+	SPI1_dma_stream_GPIO = GPIO;
+	SPI1_dma_stream_pin = NSS_pin;
+	SPI1_dma_stream_logic = NSS_logic;
+
+	DMA1_Channel3->CMAR = (uint32_t)buffer;
+	DMA1_Channel3->CNDTR = Size_half * 2;
+	DMA1->IFCR = DMA_IFCR_CGIF3; //HT и TC от транзакций очереди (там прерывания канала 3 выключены)
+	SET_BIT(DMA1_Channel3->CCR, DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_HTIE | DMA_CCR_TCIE);
+	CMSIS_SPI1_DMA_NSS(GPIO, NSS_pin, NSS_logic, true);
+	SET_BIT(DMA1_Channel3->CCR, DMA_CCR_EN);
+	SET_BIT(SPI1->CR2, SPI_CR2_TXDMAEN); //Прием не нужен, OVR сбросим при остановке
+	return true;
+}
+
+/**
+ ******************************************************************************
+ *  @breif Остановка поточной передачи. Дальше выполняются транзакции из очереди.
+ ******************************************************************************
+ */
+void CMSIS_SPI1_DMA_Stream_Stop(void) {
+	uint32_t primask = __get_PRIMASK();
+
+	if (!SPI1_dma_stream) {
+		return;
+	}
+	CLEAR_BIT(SPI1->CR2, SPI_CR2_TXDMAEN);
+	CLEAR_BIT(DMA1_Channel3->CCR, DMA_CCR_EN);
+	CLEAR_BIT(DMA1_Channel3->CCR, DMA_CCR_CIRC | DMA_CCR_HTIE | DMA_CCR_TCIE);
+	DMA1->IFCR = DMA_IFCR_CGIF3;
+	//Дождемся, пока уйдут байты, уже попавшие в SPI (не больше двух)
+	while (!READ_BIT(SPI1->SR, SPI_SR_TXE)) ;
+	while (READ_BIT(SPI1->SR, SPI_SR_BSY)) ;
+	CMSIS_SPI1_DMA_Flush();
+	CMSIS_SPI1_DMA_NSS(SPI1_dma_stream_GPIO, SPI1_dma_stream_pin, SPI1_dma_stream_logic, false);
+
+	__disable_irq();
+	SPI1_dma_stream = false;
+	CMSIS_SPI1_DMA_Start();
+	__set_PRIMASK(primask);
+}
+
+/**
+ ******************************************************************************
+ *  @breif Прерывание DMA приема SPI1 (Channel 2): конец транзакции
+ ******************************************************************************
+ */
+__WEAK void DMA1_Channel2_IRQHandler(void) {
+	uint32_t isr = DMA1->ISR;
+	struct SPI_Transaction_name* transaction = SPI1_dma_current;
+
+	DMA1->IFCR = DMA_IFCR_CGIF2;
+	if (!transaction) {
+		return;
+	}
+	CLEAR_BIT(SPI1->CR2, SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN);
+	CLEAR_BIT(DMA1_Channel2->CCR, DMA_CCR_EN);
+	CLEAR_BIT(DMA1_Channel3->CCR, DMA_CCR_EN);
+	while (READ_BIT(SPI1->SR, SPI_SR_BSY)) ;
+	CMSIS_SPI1_DMA_NSS(transaction->GPIO, transaction->NSS_pin, transaction->NSS_logic, false);
+
+	SPI1_dma_current = NULL;
+	SPI1_dma_tail++;
+	transaction->Status = (isr & DMA_ISR_TEIF2) ? SPI_DMA_ERROR : SPI_DMA_OK;
+	if (transaction->Callback) {
+		transaction->Callback(transaction);
+	}
+	CMSIS_SPI1_DMA_Start();
+}
+
+/**
+ ******************************************************************************
+ *  @breif Прерывание DMA передачи SPI1 (Channel 3): половина буфера потока освободилась
+ ******************************************************************************
+ */
+__WEAK void DMA1_Channel3_IRQHandler(void) {
+	uint32_t isr = DMA1->ISR;
+
+	DMA1->IFCR = DMA_IFCR_CGIF3;
+	if (!SPI1_dma_stream || !SPI1_dma_stream_callback) {
+		return;
+	}
+	if (isr & DMA_ISR_HTIF3) {
+		SPI1_dma_stream_callback(SPI1_dma_stream_buffer); //Первая половина ушла, идет вторая
+	}
+	if (isr & DMA_ISR_TCIF3) {
+		SPI1_dma_stream_callback(SPI1_dma_stream_buffer + SPI1_dma_stream_half); //Вторая половина ушла, идет первая
+	}
+}
+
+
+/*================================= РАБОТА С FLASH ============================================*/
+/**
+ ***************************************************************************************
+ *  PM0075 Programming manual. STM32F10xxx Flash memory microcontrollers
+ *  Страница 1 Кбайт (STM32F103C8). Запись только полусловами (16 бит), в стертую ячейку (0xFFFF).
+ *  Во время стирания/записи любое чтение Flash (в т.ч. выборка команд и векторов прерываний)
+ *  ждет окончания операции: стирание страницы ~20 мс, запись полуслова ~50 мкс.
+ ***************************************************************************************
+ */
+
+/**
+ ***************************************************************************************
+ *  @breif Разблокировка записи во Flash (FPEC)
+ ***************************************************************************************
+ */
+void CMSIS_FLASH_Unlock(void) {
+	if (READ_BIT(FLASH->CR, FLASH_CR_LOCK)) {
+		FLASH->KEYR = FLASH_KEY1;
+		FLASH->KEYR = FLASH_KEY2;
+	}
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Блокировка записи во Flash
+ ***************************************************************************************
+ */
+void CMSIS_FLASH_Lock(void) {
+	SET_BIT(FLASH->CR, FLASH_CR_LOCK);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Стирание страницы Flash
+ *  @param  Adress - любой адрес внутри страницы
+ *  @retval  Возвращает статус. True - Успешно. False - Ошибка.
+ ***************************************************************************************
+ */
+bool CMSIS_FLASH_Page_Erase(uint32_t Adress) {
+	while (READ_BIT(FLASH->SR, FLASH_SR_BSY)) ;
+	SET_BIT(FLASH->SR, FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR); //Сбросим флаги
+	SET_BIT(FLASH->CR, FLASH_CR_PER);
+	FLASH->AR = Adress;
+	SET_BIT(FLASH->CR, FLASH_CR_STRT);
+	while (READ_BIT(FLASH->SR, FLASH_SR_BSY)) ;
+	CLEAR_BIT(FLASH->CR, FLASH_CR_PER);
+	return !READ_BIT(FLASH->SR, FLASH_SR_PGERR | FLASH_SR_WRPRTERR);
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Запись полуслова во Flash
+ *  @param  Adress - четный адрес
+ *  @param  Data - данные
+ *  @retval  Возвращает статус. True - Успешно. False - Ошибка.
+ ***************************************************************************************
+ */
+bool CMSIS_FLASH_Program_HalfWord(uint32_t Adress, uint16_t Data) {
+	while (READ_BIT(FLASH->SR, FLASH_SR_BSY)) ;
+	SET_BIT(FLASH->SR, FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR); //Сбросим флаги
+	SET_BIT(FLASH->CR, FLASH_CR_PG);
+	*(volatile uint16_t *)Adress = Data;
+	while (READ_BIT(FLASH->SR, FLASH_SR_BSY)) ;
+	CLEAR_BIT(FLASH->CR, FLASH_CR_PG);
+	return !READ_BIT(FLASH->SR, FLASH_SR_PGERR | FLASH_SR_WRPRTERR);
+}
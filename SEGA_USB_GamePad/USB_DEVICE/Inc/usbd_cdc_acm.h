@@ -0,0 +1,150 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_acm.h
+  * @author  Волков Олег
+  * @date    18.10.2026
+  * @brief   Виртуальный COM-порт (CDC-ACM) рядом с интерфейсом геймпада
+  ******************************************************************************
+  * @attention
+  *
+  *  Составное устройство: класс USBD_CUSTOM_HID остается единственным классом
+  *  в стеке ST и сам раздает запросы и события точек интерфейсам:
+  *
+  *  | Интерфейс | Точки            | Назначение                             |
+  *  | 0         | 0x81 / 0x01 INTR | геймпад (HID), bInterval 1 мс          |
+  *  | 1         | 0x83 INTR        | CDC: управление (уведомления не шлются)|
+  *  | 2         | 0x82 / 0x02 BULK | CDC: данные, 64 байта                  |
+  *
+  *  Интерфейсы 1 и 2 объединены IAD, поэтому в дескрипторе устройства
+  *  класс 0xEF/0x02/0x01 (Miscellaneous, IAD).
+  *
+  *  Приоритет HID: прерывающие точки хост опрашивает в начале каждого кадра,
+  *  bulk получает только остаток кадра, так что поток CDC не может сдвинуть
+  *  опрос геймпада. На стороне МК передача CDC запускается только когда точка
+  *  HID IN свободна, а в прерывании USB для CDC выполняется только копирование
+  *  пакета в кольцевой буфер. Разбор команд - в главном цикле.
+  *
+  *  Прием: пакет из точки 0x02 копируется в кольцевой буфер на CDC_ACM_RX_SIZE байт.
+  *  Если места под следующий пакет нет, точка не взводится (хост получает NAK),
+  *  пока USBD_CDC_ACM_Read не освободит буфер. Данные не теряются.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_ACM_H
+#define __USBD_CDC_ACM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_ioreq.h"
+#include  <stdbool.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define CDC_ACM_CMD_EP                       0x83U
+#define CDC_ACM_OUT_EP                       0x02U
+#define CDC_ACM_IN_EP                        0x82U
+
+#define CDC_ACM_CMD_PACKET_SIZE              0x08U
+#define CDC_ACM_DATA_PACKET_SIZE             0x40U
+#define CDC_ACM_CMD_BINTERVAL                0x10U
+
+#define CDC_ACM_COMM_INTERFACE               0x01U
+#define CDC_ACM_DATA_INTERFACE               0x02U
+
+#define CDC_ACM_RX_SIZE                      256U /* Кольцевой буфер приема (степень двойки) */
+
+#define CDC_ACM_REQ_SET_LINE_CODING          0x20U
+#define CDC_ACM_REQ_GET_LINE_CODING          0x21U
+#define CDC_ACM_REQ_SET_CONTROL_LINE_STATE   0x22U
+#define CDC_ACM_REQ_SEND_BREAK               0x23U
+
+#define CDC_ACM_CFG_DESC_SIZ                 66U
+
+/* Часть дескриптора конфигурации: IAD + интерфейс управления + интерфейс данных */
+#define CDC_ACM_CFG_DESC                                                         \
+  /* IAD */                                                                      \
+  0x08,         /*bLength*/                                                      \
+  0x0B,         /*bDescriptorType: Interface Association*/                       \
+  CDC_ACM_COMM_INTERFACE, /*bFirstInterface*/                                    \
+  0x02,         /*bInterfaceCount*/                                              \
+  0x02,         /*bFunctionClass: CDC*/                                          \
+  0x02,         /*bFunctionSubClass: ACM*/                                       \
+  0x01,         /*bFunctionProtocol: AT commands*/                               \
+  0x00,         /*iFunction*/                                                    \
+  /* Интерфейс управления */                                                     \
+  0x09,         /*bLength*/                                                      \
+  USB_DESC_TYPE_INTERFACE,                                                       \
+  CDC_ACM_COMM_INTERFACE, /*bInterfaceNumber*/                                   \
+  0x00,         /*bAlternateSetting*/                                            \
+  0x01,         /*bNumEndpoints*/                                                \
+  0x02,         /*bInterfaceClass: CDC*/                                         \
+  0x02,         /*bInterfaceSubClass: ACM*/                                      \
+  0x01,         /*bInterfaceProtocol: AT commands*/                              \
+  0x00,         /*iInterface*/                                                   \
+  /* Header Functional Descriptor */                                             \
+  0x05, 0x24, 0x00, 0x10, 0x01,                                                  \
+  /* Call Management Functional Descriptor */                                    \
+  0x05, 0x24, 0x01, 0x00, CDC_ACM_DATA_INTERFACE,                                \
+  /* ACM Functional Descriptor: SET/GET_LINE_CODING, SET_CONTROL_LINE_STATE */   \
+  0x04, 0x24, 0x02, 0x02,                                                        \
+  /* Union Functional Descriptor */                                              \
+  0x05, 0x24, 0x06, CDC_ACM_COMM_INTERFACE, CDC_ACM_DATA_INTERFACE,              \
+  /* Точка уведомлений */                                                        \
+  0x07,                                                                          \
+  USB_DESC_TYPE_ENDPOINT,                                                        \
+  CDC_ACM_CMD_EP,                                                                \
+  0x03,         /*bmAttributes: Interrupt*/                                      \
+  LOBYTE(CDC_ACM_CMD_PACKET_SIZE),                                               \
+  HIBYTE(CDC_ACM_CMD_PACKET_SIZE),                                               \
+  CDC_ACM_CMD_BINTERVAL,                                                         \
+  /* Интерфейс данных */                                                         \
+  0x09,                                                                          \
+  USB_DESC_TYPE_INTERFACE,                                                       \
+  CDC_ACM_DATA_INTERFACE, /*bInterfaceNumber*/                                   \
+  0x00,         /*bAlternateSetting*/                                            \
+  0x02,         /*bNumEndpoints*/                                                \
+  0x0A,         /*bInterfaceClass: CDC Data*/                                    \
+  0x00,                                                                          \
+  0x00,                                                                          \
+  0x00,                                                                          \
+  /* Точка OUT */                                                                \
+  0x07,                                                                          \
+  USB_DESC_TYPE_ENDPOINT,                                                        \
+  CDC_ACM_OUT_EP,                                                                \
+  0x02,         /*bmAttributes: Bulk*/                                           \
+  LOBYTE(CDC_ACM_DATA_PACKET_SIZE),                                              \
+  HIBYTE(CDC_ACM_DATA_PACKET_SIZE),                                              \
+  0x00,                                                                          \
+  /* Точка IN */                                                                 \
+  0x07,                                                                          \
+  USB_DESC_TYPE_ENDPOINT,                                                        \
+  CDC_ACM_IN_EP,                                                                 \
+  0x02,         /*bmAttributes: Bulk*/                                           \
+  LOBYTE(CDC_ACM_DATA_PACKET_SIZE),                                              \
+  HIBYTE(CDC_ACM_DATA_PACKET_SIZE),                                              \
+  0x00
+
+/* Exported functions --------------------------------------------------------*/
+/* Вызываются классом USBD_CUSTOM_HID */
+void    USBD_CDC_ACM_Init(USBD_HandleTypeDef *pdev);
+void    USBD_CDC_ACM_DeInit(USBD_HandleTypeDef *pdev);
+uint8_t USBD_CDC_ACM_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+void    USBD_CDC_ACM_EP0_RxReady(USBD_HandleTypeDef *pdev);
+void    USBD_CDC_ACM_DataIn(USBD_HandleTypeDef *pdev);
+void    USBD_CDC_ACM_DataOut(USBD_HandleTypeDef *pdev);
+
+/* Для приложения (главный цикл) */
+uint8_t  USBD_CDC_ACM_Transmit(const uint8_t *buf, uint16_t len); /* Без копирования! */
+bool     USBD_CDC_ACM_Busy(void); /* Передача еще идет */
+bool     USBD_CDC_ACM_Connected(void); /* Порт открыт на ПК (DTR) */
+uint16_t USBD_CDC_ACM_Read(uint8_t *buf, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_CDC_ACM_H */
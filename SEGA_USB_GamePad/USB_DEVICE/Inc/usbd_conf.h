@@ -63,7 +63,15 @@
   */
 
 /*---------- -----------*/
+#ifndef USBD_CDC_ACM
+#define USBD_CDC_ACM     1 /* 1 - составное устройство: геймпад + виртуальный COM-порт (usbd_cdc_acm.h) */
+#endif
+/*---------- -----------*/
+#if USBD_CDC_ACM
+#define USBD_MAX_NUM_INTERFACES     3
+#else
 #define USBD_MAX_NUM_INTERFACES     1
+#endif
 /*---------- -----------*/
 #define USBD_MAX_NUM_CONFIGURATION     1
 /*---------- -----------*/
@@ -73,9 +81,9 @@
 /*---------- -----------*/
 #define USBD_SELF_POWERED     1
 /*---------- -----------*/
-#define USBD_CUSTOMHID_OUTREPORT_BUF_SIZE     2
+#define USBD_CUSTOMHID_OUTREPORT_BUF_SIZE     32 /* XInput OUT endpoint: up to 32 bytes */
 /*---------- -----------*/
-#define USBD_CUSTOM_HID_REPORT_DESC_SIZE     37
+#define USBD_CUSTOM_HID_REPORT_DESC_SIZE     151
 /*---------- -----------*/
 #define CUSTOM_HID_FS_BINTERVAL     1
 
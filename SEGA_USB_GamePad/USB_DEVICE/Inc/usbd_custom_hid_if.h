@@ -105,6 +105,8 @@ extern USBD_CUSTOM_HID_ItfTypeDef USBD_CustomHID_fops_FS;
   */
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
+uint8_t CUSTOM_HID_Keyboard_FS(uint8_t mode);
+uint8_t CUSTOM_HID_Stamp_FS(void);
 
 /* USER CODE END EXPORTED_FUNCTIONS */
 
@@ -27,6 +27,7 @@ extern "C" {
 
 /* Includes ------------------------------------------------------------------*/
 #include  "usbd_ioreq.h"
+#include  "usbd_cdc_acm.h"
 
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
@@ -42,14 +43,36 @@ extern "C" {
   * @{
   */
 #define CUSTOM_HID_EPIN_ADDR                 0x81U
-#define CUSTOM_HID_EPIN_SIZE                 0x02U
+#define CUSTOM_HID_EPIN_SIZE                 0x10U
 
 #define CUSTOM_HID_EPOUT_ADDR                0x01U
-#define CUSTOM_HID_EPOUT_SIZE                0x02U
+#define CUSTOM_HID_EPOUT_SIZE                0x08U
 
+#define CUSTOM_HID_INTERFACE                 0x00U
+
+#if USBD_CDC_ACM
+#define USB_CUSTOM_HID_CONFIG_DESC_SIZ       (41U + CDC_ACM_CFG_DESC_SIZ)
+#else
 #define USB_CUSTOM_HID_CONFIG_DESC_SIZ       41U
+#endif /* USBD_CDC_ACM */
 #define USB_CUSTOM_HID_DESC_SIZ              9U
 
+/* XInput personality: vendor interface of the wired Xbox 360 controller */
+#define CUSTOM_HID_XINPUT_EP_SIZE            0x20U
+#define CUSTOM_HID_XINPUT_OUT_BINTERVAL      0x08U
+#define CUSTOM_HID_XINPUT_DESC_SIZ           40U
+#if USBD_CDC_ACM
+#define USB_CUSTOM_HID_XINPUT_CONFIG_DESC_SIZ (9U + CUSTOM_HID_XINPUT_DESC_SIZ + CDC_ACM_CFG_DESC_SIZ)
+#else
+#define USB_CUSTOM_HID_XINPUT_CONFIG_DESC_SIZ (9U + CUSTOM_HID_XINPUT_DESC_SIZ)
+#endif /* USBD_CDC_ACM */
+
+/* Offsets of the fields patched by USBD_CUSTOM_HID_SetReportDesc */
+#define CUSTOM_HID_CFG_SUBCLASS_OFFSET       15U /* bInterfaceSubClass */
+#define CUSTOM_HID_CFG_PROTOCOL_OFFSET       16U /* nInterfaceProtocol */
+#define CUSTOM_HID_CFG_REPORT_LEN_OFFSET     25U /* wItemLength of the HID descriptor */
+#define CUSTOM_HID_DESC_REPORT_LEN_OFFSET    7U
+
 #ifndef CUSTOM_HID_HS_BINTERVAL
 #define CUSTOM_HID_HS_BINTERVAL            0x05U
 #endif /* CUSTOM_HID_HS_BINTERVAL */
@@ -76,6 +99,11 @@ extern "C" {
 
 #define CUSTOM_HID_REQ_SET_REPORT            0x09U
 #define CUSTOM_HID_REQ_GET_REPORT            0x01U
+
+#define CUSTOM_HID_REPORT_TYPE_INPUT         0x01U
+#define CUSTOM_HID_REPORT_TYPE_OUTPUT        0x02U
+#define CUSTOM_HID_REPORT_TYPE_FEATURE       0x03U
+#define CUSTOM_HID_IDLE_MS                   4U /* SET_IDLE duration unit, ms */
 /**
   * @}
   */
@@ -146,6 +174,19 @@ uint8_t USBD_CUSTOM_HID_SendReport(USBD_HandleTypeDef *pdev,
 uint8_t  USBD_CUSTOM_HID_RegisterInterface(USBD_HandleTypeDef   *pdev,
                                            USBD_CUSTOM_HID_ItfTypeDef *fops);
 
+uint8_t  USBD_CUSTOM_HID_SetReportDesc(USBD_HandleTypeDef *pdev,
+                                       uint8_t *desc,
+                                       uint16_t size,
+                                       uint8_t boot);
+
+uint8_t  USBD_CUSTOM_HID_SetXInput(USBD_HandleTypeDef *pdev);
+
+void USBD_CUSTOM_HID_SOFCallback(USBD_HandleTypeDef *pdev);
+uint8_t *USBD_CUSTOM_HID_GetReportCallback(USBD_HandleTypeDef *pdev,
+                                           uint8_t type,
+                                           uint8_t id,
+                                           uint16_t *len);
+
 /**
   * @}
   */
@@ -0,0 +1,287 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_acm.c
+  * @author  Волков Олег
+  * @date    18.10.2026
+  * @brief   Виртуальный COM-порт (CDC-ACM) рядом с интерфейсом геймпада
+  ******************************************************************************
+  * @attention
+  *
+  *  Описание см. в usbd_cdc_acm.h
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_acm.h"
+#include "usbd_customhid.h"
+#include "usbd_ctlreq.h"
+
+#if USBD_CDC_ACM
+
+/* Private variables ---------------------------------------------------------*/
+static USBD_HandleTypeDef *cdc_pdev;
+
+__ALIGN_BEGIN static uint8_t cdc_line_coding[7] __ALIGN_END =
+{
+  0x00, 0xC2, 0x01, 0x00, /* dwDTERate: 115200 (для виртуального порта не важна) */
+  0x00,                   /* bCharFormat: 1 стоп бит */
+  0x00,                   /* bParityType: нет */
+  0x08,                   /* bDataBits: 8 */
+};
+
+__ALIGN_BEGIN static uint8_t cdc_cmd_buf[CDC_ACM_CMD_PACKET_SIZE] __ALIGN_END;
+static uint8_t cdc_cmd_opcode = 0xFFU; /* Запрос, ожидающий данных на EP0 */
+
+__ALIGN_BEGIN static uint8_t cdc_rx_packet[CDC_ACM_DATA_PACKET_SIZE] __ALIGN_END;
+static uint8_t cdc_rx_ring[CDC_ACM_RX_SIZE];
+static volatile uint16_t cdc_rx_head; /* Пишет прерывание USB */
+static volatile uint16_t cdc_rx_tail; /* Пишет главный цикл */
+static volatile bool cdc_rx_stalled;  /* Точка OUT не взведена: нет места */
+
+static volatile bool cdc_tx_busy;
+static volatile bool cdc_tx_zlp;      /* После передачи нужен пакет нулевой длины */
+static volatile bool cdc_dtr;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Взвести точку OUT, если в кольце есть место под целый пакет
+  */
+static void USBD_CDC_ACM_Arm_Rx(void)
+{
+  if ((uint16_t)(CDC_ACM_RX_SIZE - (uint16_t)(cdc_rx_head - cdc_rx_tail)) >= CDC_ACM_DATA_PACKET_SIZE)
+  {
+    cdc_rx_stalled = false;
+    USBD_LL_PrepareReceive(cdc_pdev, CDC_ACM_OUT_EP, cdc_rx_packet, CDC_ACM_DATA_PACKET_SIZE);
+  }
+  else
+  {
+    cdc_rx_stalled = true; /* Хост получает NAK, пока главный цикл не заберет данные */
+  }
+}
+
+/* Class callbacks -----------------------------------------------------------*/
+
+/**
+  * @brief  Открытие точек CDC (SET_CONFIGURATION)
+  */
+void USBD_CDC_ACM_Init(USBD_HandleTypeDef *pdev)
+{
+  cdc_pdev = pdev;
+
+  USBD_LL_OpenEP(pdev, CDC_ACM_IN_EP, USBD_EP_TYPE_BULK, CDC_ACM_DATA_PACKET_SIZE);
+  pdev->ep_in[CDC_ACM_IN_EP & 0xFU].is_used = 1U;
+
+  USBD_LL_OpenEP(pdev, CDC_ACM_OUT_EP, USBD_EP_TYPE_BULK, CDC_ACM_DATA_PACKET_SIZE);
+  pdev->ep_out[CDC_ACM_OUT_EP & 0xFU].is_used = 1U;
+
+  USBD_LL_OpenEP(pdev, CDC_ACM_CMD_EP, USBD_EP_TYPE_INTR, CDC_ACM_CMD_PACKET_SIZE);
+  pdev->ep_in[CDC_ACM_CMD_EP & 0xFU].is_used = 1U;
+
+  cdc_rx_head = 0U;
+  cdc_rx_tail = 0U;
+  cdc_tx_busy = false;
+  cdc_tx_zlp = false;
+  cdc_dtr = false;
+  USBD_CDC_ACM_Arm_Rx();
+}
+
+/**
+  * @brief  Закрытие точек CDC
+  */
+void USBD_CDC_ACM_DeInit(USBD_HandleTypeDef *pdev)
+{
+  USBD_LL_CloseEP(pdev, CDC_ACM_IN_EP);
+  pdev->ep_in[CDC_ACM_IN_EP & 0xFU].is_used = 0U;
+
+  USBD_LL_CloseEP(pdev, CDC_ACM_OUT_EP);
+  pdev->ep_out[CDC_ACM_OUT_EP & 0xFU].is_used = 0U;
+
+  USBD_LL_CloseEP(pdev, CDC_ACM_CMD_EP);
+  pdev->ep_in[CDC_ACM_CMD_EP & 0xFU].is_used = 0U;
+
+  cdc_tx_busy = false;
+  cdc_dtr = false;
+}
+
+/**
+  * @brief  Запросы к интерфейсам CDC
+  */
+uint8_t USBD_CDC_ACM_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+  static uint8_t alt = 0U;
+  uint8_t ret = USBD_OK;
+
+  switch (req->bmRequest & USB_REQ_TYPE_MASK)
+  {
+    case USB_REQ_TYPE_CLASS:
+      switch (req->bRequest)
+      {
+        case CDC_ACM_REQ_SET_LINE_CODING:
+          cdc_cmd_opcode = req->bRequest;
+          USBD_CtlPrepareRx(pdev, cdc_cmd_buf, MIN(req->wLength, sizeof(cdc_line_coding)));
+          break;
+
+        case CDC_ACM_REQ_GET_LINE_CODING:
+          USBD_CtlSendData(pdev, cdc_line_coding, MIN(req->wLength, sizeof(cdc_line_coding)));
+          break;
+
+        case CDC_ACM_REQ_SET_CONTROL_LINE_STATE:
+          cdc_dtr = (req->wValue & 0x0001U) != 0U;
+          break;
+
+        case CDC_ACM_REQ_SEND_BREAK:
+          break;
+
+        default:
+          USBD_CtlError(pdev, req);
+          ret = USBD_FAIL;
+          break;
+      }
+      break;
+
+    case USB_REQ_TYPE_STANDARD:
+      switch (req->bRequest)
+      {
+        case USB_REQ_GET_INTERFACE:
+          USBD_CtlSendData(pdev, &alt, 1U);
+          break;
+
+        case USB_REQ_SET_INTERFACE:
+          break;
+
+        default:
+          USBD_CtlError(pdev, req);
+          ret = USBD_FAIL;
+          break;
+      }
+      break;
+
+    default:
+      USBD_CtlError(pdev, req);
+      ret = USBD_FAIL;
+      break;
+  }
+  return ret;
+}
+
+/**
+  * @brief  Данные запроса пришли по EP0
+  */
+void USBD_CDC_ACM_EP0_RxReady(USBD_HandleTypeDef *pdev)
+{
+  UNUSED(pdev);
+
+  if (cdc_cmd_opcode == CDC_ACM_REQ_SET_LINE_CODING)
+  {
+    for (uint8_t i = 0U; i < sizeof(cdc_line_coding); i++)
+    {
+      cdc_line_coding[i] = cdc_cmd_buf[i];
+    }
+  }
+  cdc_cmd_opcode = 0xFFU;
+}
+
+/**
+  * @brief  Передача по точке 0x82 закончена
+  */
+void USBD_CDC_ACM_DataIn(USBD_HandleTypeDef *pdev)
+{
+  if (cdc_tx_zlp)
+  {
+    /* Длина была кратна размеру пакета: хосту нужен короткий пакет как конец передачи */
+    cdc_tx_zlp = false;
+    USBD_LL_Transmit(pdev, CDC_ACM_IN_EP, NULL, 0U);
+    return;
+  }
+  cdc_tx_busy = false;
+}
+
+/**
+  * @brief  Пакет пришел в точку 0x02
+  */
+void USBD_CDC_ACM_DataOut(USBD_HandleTypeDef *pdev)
+{
+  uint16_t len = (uint16_t)USBD_LL_GetRxDataSize(pdev, CDC_ACM_OUT_EP);
+  uint16_t head = cdc_rx_head;
+
+  for (uint16_t i = 0U; i < len; i++)
+  {
+    cdc_rx_ring[(head + i) & (CDC_ACM_RX_SIZE - 1U)] = cdc_rx_packet[i];
+  }
+  cdc_rx_head = head + len;
+  USBD_CDC_ACM_Arm_Rx();
+}
+
+/* Application API -----------------------------------------------------------*/
+
+/**
+  * @brief  Отправка данных без копирования. Буфер не менять до окончания передачи.
+  * @retval USBD_OK - передача запущена, USBD_BUSY - точка (или точка HID) занята
+  */
+uint8_t USBD_CDC_ACM_Transmit(const uint8_t *buf, uint16_t len)
+{
+  USBD_CUSTOM_HID_HandleTypeDef *hhid;
+
+  if ((cdc_pdev == NULL) || (cdc_pdev->dev_state != USBD_STATE_CONFIGURED))
+  {
+    return USBD_FAIL;
+  }
+  hhid = (USBD_CUSTOM_HID_HandleTypeDef *)cdc_pdev->pClassData;
+  if (cdc_tx_busy || (hhid == NULL) || (hhid->state != CUSTOM_HID_IDLE))
+  {
+    /* Сначала хост должен забрать отчет геймпада */
+    return USBD_BUSY;
+  }
+  cdc_tx_busy = true;
+  cdc_tx_zlp = (len != 0U) && ((len % CDC_ACM_DATA_PACKET_SIZE) == 0U);
+  USBD_LL_Transmit(cdc_pdev, CDC_ACM_IN_EP, (uint8_t *)buf, len);
+  return USBD_OK;
+}
+
+/**
+  * @brief  Передача еще идет
+  */
+bool USBD_CDC_ACM_Busy(void)
+{
+  return cdc_tx_busy;
+}
+
+/**
+  * @brief  Порт открыт программой на ПК (DTR)
+  */
+bool USBD_CDC_ACM_Connected(void)
+{
+  return (cdc_pdev != NULL) && (cdc_pdev->dev_state == USBD_STATE_CONFIGURED) && cdc_dtr;
+}
+
+/**
+  * @brief  Чтение принятых данных. Вызывать из главного цикла.
+  * @retval Сколько байт прочитано
+  */
+uint16_t USBD_CDC_ACM_Read(uint8_t *buf, uint16_t size)
+{
+  uint16_t tail = cdc_rx_tail;
+  uint16_t n = 0U;
+
+  while ((n < size) && (tail != cdc_rx_head))
+  {
+    buf[n++] = cdc_rx_ring[tail & (CDC_ACM_RX_SIZE - 1U)];
+    tail++;
+  }
+  cdc_rx_tail = tail;
+
+  if (cdc_rx_stalled && (n != 0U))
+  {
+    __disable_irq(); /* Взвести точку может и прерывание USB */
+    if (cdc_rx_stalled)
+    {
+      USBD_CDC_ACM_Arm_Rx();
+    }
+    __enable_irq();
+  }
+  return n;
+}
+
+#endif /* USBD_CDC_ACM */
@@ -23,7 +23,12 @@
 #include "usbd_custom_hid_if.h"
 
 /* USER CODE BEGIN INCLUDE */
-
+#include "SEGA_tas.h"
+#include "SEGA_inject.h"
+#include "SEGA_boot.h"
+#include "SEGA_keyboard.h"
+#include "SEGA_xinput.h"
+#include <string.h>
 /* USER CODE END INCLUDE */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -95,6 +100,7 @@ __ALIGN_BEGIN static uint8_t CUSTOM_HID_ReportDesc_FS[USBD_CUSTOM_HID_REPORT_DES
 	0x05, 0x01, // USAGE_PAGE (Generic Desktop)
 	0x09, 0x05, // USAGE (Game Pad)
 	0xa1, 0x01, // COLLECTION (Application)
+	0x85, 0x01, //   REPORT_ID (1)
 	0x09, 0x30, //   USAGE (X)
 	0x09, 0x31, //   USAGE (Y)
 	0x15, 0x80, //   LOGICAL_MINIMUM (-128)
@@ -102,19 +108,170 @@ __ALIGN_BEGIN static uint8_t CUSTOM_HID_ReportDesc_FS[USBD_CUSTOM_HID_REPORT_DES
 	0x95, 0x02, //   REPORT_COUNT (2)
 	0x75, 0x08, //   REPORT_SIZE (8)
 	0x81, 0x02, //   INPUT (Data,Var,Abs)
+	0x09, 0x39, //   USAGE (Hat switch)
+	0x15, 0x00, //   LOGICAL_MINIMUM (0)
+	0x25, 0x07, //   LOGICAL_MAXIMUM (7)
+	0x35, 0x00, //   PHYSICAL_MINIMUM (0)
+	0x46, 0x3b, 0x01, //   PHYSICAL_MAXIMUM (315)
+	0x65, 0x14, //   UNIT (Eng Rot:Angular Pos)
+	0x75, 0x04, //   REPORT_SIZE (4)
+	0x95, 0x01, //   REPORT_COUNT (1)
+	0x81, 0x42, //   INPUT (Data,Var,Abs,Null)
+	0x65, 0x00, //   UNIT (None)
+	0x81, 0x03, //   INPUT (Cnst,Var,Abs)
 	0x05, 0x09, //   USAGE_PAGE (Button)
 	0x19, 0x01, //   USAGE_MINIMUM (Button 1)
-	0x29, 0x08, //   USAGE_MAXIMUM (Button 8)
+	0x29, 0x10, //   USAGE_MAXIMUM (Button 16)
 	0x15, 0x00, //   LOGICAL_MINIMUM (0)
 	0x25, 0x01, //   LOGICAL_MAXIMUM (1)
-	0x95, 0x08, //   REPORT_COUNT (8)
+	0x95, 0x10, //   REPORT_COUNT (16)
 	0x75, 0x01, //   REPORT_SIZE (1)
 	0x81, 0x02, //   INPUT (Data,Var,Abs)
-	0xc0                           // END_COLLECTION
+	0xc0,       // END_COLLECTION
+
+	0x05, 0x01, // USAGE_PAGE (Generic Desktop)
+	0x09, 0x02, // USAGE (Mouse)
+	0xa1, 0x01, // COLLECTION (Application)
+	0x85, 0x02, //   REPORT_ID (2)
+	0x09, 0x01, //   USAGE (Pointer)
+	0xa1, 0x00, //   COLLECTION (Physical)
+	0x05, 0x09, //     USAGE_PAGE (Button)
+	0x19, 0x01, //     USAGE_MINIMUM (Button 1)
+	0x29, 0x04, //     USAGE_MAXIMUM (Button 4)
+	0x15, 0x00, //     LOGICAL_MINIMUM (0)
+	0x25, 0x01, //     LOGICAL_MAXIMUM (1)
+	0x95, 0x04, //     REPORT_COUNT (4)
+	0x75, 0x01, //     REPORT_SIZE (1)
+	0x81, 0x02, //     INPUT (Data,Var,Abs)
+	0x95, 0x01, //     REPORT_COUNT (1)
+	0x75, 0x04, //     REPORT_SIZE (4)
+	0x81, 0x03, //     INPUT (Cnst,Var,Abs)
+	0x05, 0x01, //     USAGE_PAGE (Generic Desktop)
+	0x09, 0x30, //     USAGE (X)
+	0x09, 0x31, //     USAGE (Y)
+	0x15, 0x81, //     LOGICAL_MINIMUM (-127)
+	0x25, 0x7f, //     LOGICAL_MAXIMUM (127)
+	0x75, 0x08, //     REPORT_SIZE (8)
+	0x95, 0x02, //     REPORT_COUNT (2)
+	0x81, 0x06, //     INPUT (Data,Var,Rel)
+	0xc0,       //   END_COLLECTION
+	0xc0,       // END_COLLECTION
+
+	0x06, 0x00, 0xff, // USAGE_PAGE (Vendor Defined Page 1)
+	0x09, 0x01, // USAGE (Vendor Usage 1)
+	0xa1, 0x01, // COLLECTION (Application)
+	0x85, 0x03, //   REPORT_ID (3)
+	0x09, 0x01, //   USAGE (Vendor Usage 1)
+	0x15, 0x00, //   LOGICAL_MINIMUM (0)
+	0x26, 0xff, 0x00, //   LOGICAL_MAXIMUM (255)
+	0x75, 0x08, //   REPORT_SIZE (8)
+	0x95, 0x01, //   REPORT_COUNT (1)
+	0x91, 0x02, //   OUTPUT (Data,Var,Abs)
+	0x85, 0x04, //   REPORT_ID (4)
+	0x09, 0x02, //   USAGE (Vendor Usage 2)
+	0x95, 0x06, //   REPORT_COUNT (6)
+	0x91, 0x02, //   OUTPUT (Data,Var,Abs)
+	0x09, 0x03, //   USAGE (Vendor Usage 3)
+	0x95, 0x04, //   REPORT_COUNT (4)
+	0x81, 0x02, //   INPUT (Data,Var,Abs)
+	0xc0        // END_COLLECTION
 };
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
+/** Keyboard personality, 6KRO: standard boot keyboard report, no report ID (see SEGA_keyboard.h). */
+__ALIGN_BEGIN static uint8_t CUSTOM_HID_KeyboardDesc_FS[] __ALIGN_END =
+{
+	0x05, 0x01, // USAGE_PAGE (Generic Desktop)
+	0x09, 0x06, // USAGE (Keyboard)
+	0xa1, 0x01, // COLLECTION (Application)
+	0x05, 0x07, //   USAGE_PAGE (Keyboard)
+	0x19, 0xe0, //   USAGE_MINIMUM (Keyboard LeftControl)
+	0x29, 0xe7, //   USAGE_MAXIMUM (Keyboard Right GUI)
+	0x15, 0x00, //   LOGICAL_MINIMUM (0)
+	0x25, 0x01, //   LOGICAL_MAXIMUM (1)
+	0x75, 0x01, //   REPORT_SIZE (1)
+	0x95, 0x08, //   REPORT_COUNT (8)
+	0x81, 0x02, //   INPUT (Data,Var,Abs)
+	0x95, 0x01, //   REPORT_COUNT (1)
+	0x75, 0x08, //   REPORT_SIZE (8)
+	0x81, 0x03, //   INPUT (Cnst,Var,Abs)
+	0x05, 0x08, //   USAGE_PAGE (LEDs)
+	0x19, 0x01, //   USAGE_MINIMUM (Num Lock)
+	0x29, 0x05, //   USAGE_MAXIMUM (Kana)
+	0x95, 0x05, //   REPORT_COUNT (5)
+	0x75, 0x01, //   REPORT_SIZE (1)
+	0x91, 0x02, //   OUTPUT (Data,Var,Abs)
+	0x95, 0x01, //   REPORT_COUNT (1)
+	0x75, 0x03, //   REPORT_SIZE (3)
+	0x91, 0x03, //   OUTPUT (Cnst,Var,Abs)
+	0x05, 0x07, //   USAGE_PAGE (Keyboard)
+	0x19, 0x00, //   USAGE_MINIMUM (Reserved (no event indicated))
+	0x29, 0x65, //   USAGE_MAXIMUM (Keyboard Application)
+	0x15, 0x00, //   LOGICAL_MINIMUM (0)
+	0x25, 0x65, //   LOGICAL_MAXIMUM (101)
+	0x95, 0x06, //   REPORT_COUNT (6)
+	0x75, 0x08, //   REPORT_SIZE (8)
+	0x81, 0x00, //   INPUT (Data,Ary,Abs)
+	0xc0        // END_COLLECTION
+};
 
+/** Stamped gamepad: sequence number and sample age, inserted at the end of the gamepad collection. */
+static const uint8_t CUSTOM_HID_StampItems_FS[] =
+{
+	0x06, 0x00, 0xff, //   USAGE_PAGE (Vendor Defined 0xFF00)
+	0x09, 0x01, //   USAGE (Vendor Usage 1) - sequence number
+	0x15, 0x00, //   LOGICAL_MINIMUM (0)
+	0x26, 0xff, 0x00, //   LOGICAL_MAXIMUM (255)
+	0x75, 0x08, //   REPORT_SIZE (8)
+	0x95, 0x01, //   REPORT_COUNT (1)
+	0x81, 0x02, //   INPUT (Data,Var,Abs)
+	0x09, 0x02, //   USAGE (Vendor Usage 2) - sample age, us
+	0x27, 0xff, 0xff, 0x00, 0x00, //   LOGICAL_MAXIMUM (65535)
+	0x75, 0x10, //   REPORT_SIZE (16)
+	0x81, 0x02, //   INPUT (Data,Var,Abs)
+};
+
+/** Stamped gamepad report descriptor, built by CUSTOM_HID_Stamp_FS. */
+__ALIGN_BEGIN static uint8_t CUSTOM_HID_StampDesc_FS[USBD_CUSTOM_HID_REPORT_DESC_SIZE + sizeof(CUSTOM_HID_StampItems_FS)] __ALIGN_END;
+
+/** Keyboard personality, NKRO: one bit per Buttons bit, in Buttons order, no report ID. */
+__ALIGN_BEGIN static uint8_t CUSTOM_HID_NkroDesc_FS[] __ALIGN_END =
+{
+	0x05, 0x01, // USAGE_PAGE (Generic Desktop)
+	0x09, 0x06, // USAGE (Keyboard)
+	0xa1, 0x01, // COLLECTION (Application)
+	0x05, 0x07, //   USAGE_PAGE (Keyboard)
+	0x09, SEGA_KEYBOARD_RIGHT, //   USAGE (bit 0, RIGHT)
+	0x09, SEGA_KEYBOARD_LEFT,  //   USAGE (bit 1, LEFT)
+	0x09, SEGA_KEYBOARD_DOWN,  //   USAGE (bit 2, DOWN)
+	0x09, SEGA_KEYBOARD_UP,    //   USAGE (bit 3, UP)
+	0x09, SEGA_KEYBOARD_MODE,  //   USAGE (bit 4, MODE)
+	0x09, SEGA_KEYBOARD_START, //   USAGE (bit 5, START)
+	0x09, SEGA_KEYBOARD_Z,     //   USAGE (bit 6, Z)
+	0x09, SEGA_KEYBOARD_Y,     //   USAGE (bit 7, Y)
+	0x09, SEGA_KEYBOARD_X,     //   USAGE (bit 8, X)
+	0x09, SEGA_KEYBOARD_C,     //   USAGE (bit 9, C)
+	0x09, SEGA_KEYBOARD_B,     //   USAGE (bit 10, B)
+	0x09, SEGA_KEYBOARD_A,     //   USAGE (bit 11, A)
+	0x09, SEGA_KEYBOARD_L,     //   USAGE (bit 12, L)
+	0x09, SEGA_KEYBOARD_R,     //   USAGE (bit 13, R)
+	0x15, 0x00, //   LOGICAL_MINIMUM (0)
+	0x25, 0x01, //   LOGICAL_MAXIMUM (1)
+	0x75, 0x01, //   REPORT_SIZE (1)
+	0x95, 0x0e, //   REPORT_COUNT (14)
+	0x81, 0x02, //   INPUT (Data,Var,Abs)
+	0x95, 0x02, //   REPORT_COUNT (2)
+	0x81, 0x03, //   INPUT (Cnst,Var,Abs)
+	0x05, 0x08, //   USAGE_PAGE (LEDs)
+	0x19, 0x01, //   USAGE_MINIMUM (Num Lock)
+	0x29, 0x05, //   USAGE_MAXIMUM (Kana)
+	0x95, 0x05, //   REPORT_COUNT (5)
+	0x91, 0x02, //   OUTPUT (Data,Var,Abs)
+	0x95, 0x01, //   REPORT_COUNT (1)
+	0x75, 0x03, //   REPORT_SIZE (3)
+	0x91, 0x03, //   OUTPUT (Cnst,Var,Abs)
+	0xc0        // END_COLLECTION
+};
 /* USER CODE END PRIVATE_VARIABLES */
 
 /**
@@ -169,6 +326,15 @@ USBD_CUSTOM_HID_ItfTypeDef USBD_CustomHID_fops_FS =
 static int8_t CUSTOM_HID_Init_FS(void)
 {
   /* USER CODE BEGIN 4 */
+  /* Called on SET_CONFIGURATION: poll the pad right away so the first report
+     is queued on the IN endpoint within one poll, not one poll period.
+     Not while TIM3 is strobing: the update would restart SELECT mid-poll,
+     and that poll's own SEGA_Poll_End delivers the report anyway */
+  SEGA_Boot_Mark(SEGA_BOOT_CONFIGURED);
+  if (READ_BIT(TIM2->CR1, TIM_CR1_CEN) && !READ_BIT(TIM3->CR1, TIM_CR1_CEN))
+  {
+    TIM2->EGR = TIM_EGR_UG;
+  }
   return (USBD_OK);
   /* USER CODE END 4 */
 }
@@ -193,6 +359,22 @@ static int8_t CUSTOM_HID_DeInit_FS(void)
 static int8_t CUSTOM_HID_OutEvent_FS(uint8_t event_idx, uint8_t state)
 {
   /* USER CODE BEGIN 6 */
+  USBD_CUSTOM_HID_HandleTypeDef *hhid = (USBD_CUSTOM_HID_HandleTypeDef *)hUsbDeviceFS.pClassData;
+
+  if (SEGA_Keyboard_Mode() != SEGA_KEYBOARD_OFF || SEGA_XInput_Active())
+  {
+    return (USBD_OK); /* Keyboard LEDs or XInput rumble/LED, no report ID: not a control command */
+  }
+
+  switch (event_idx)
+  {
+  case USB_REPORT_ID_CONTROL:
+    SEGA_TAS_Command(state);
+    break;
+  case USB_REPORT_ID_INJECT:
+    SEGA_Inject_Receive(hhid->Report_buf); //Посылке нужен весь отчет, а не 2 байта
+    break;
+  }
   return (USBD_OK);
   /* USER CODE END 6 */
 }
@@ -213,6 +395,50 @@ static int8_t USBD_CUSTOM_HID_SendReport_FS(uint8_t *report, uint16_t len)
 /* USER CODE END 7 */
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+/**
+  * @brief  Switch the HID interface to the keyboard report descriptor
+  *         (boot keyboard interface). Call before the host reads descriptors.
+  * @param  mode: SEGA_KEYBOARD_6KRO or SEGA_KEYBOARD_NKRO
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+uint8_t CUSTOM_HID_Keyboard_FS(uint8_t mode)
+{
+  if (mode == SEGA_KEYBOARD_NKRO)
+  {
+    return USBD_CUSTOM_HID_SetReportDesc(&hUsbDeviceFS, CUSTOM_HID_NkroDesc_FS,
+                                         sizeof(CUSTOM_HID_NkroDesc_FS), 1U);
+  }
+  return USBD_CUSTOM_HID_SetReportDesc(&hUsbDeviceFS, CUSTOM_HID_KeyboardDesc_FS,
+                                       sizeof(CUSTOM_HID_KeyboardDesc_FS), 1U);
+}
+
+/**
+  * @brief  Switch the HID interface to the stamped gamepad report descriptor
+  *         (see SEGA_stamp.h). Call before the host reads descriptors.
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+uint8_t CUSTOM_HID_Stamp_FS(void)
+{
+  uint16_t pos = 0U;
+  uint8_t data;
+
+  /* Walk the short items up to END_COLLECTION of the gamepad (first) collection */
+  while (pos < USBD_CUSTOM_HID_REPORT_DESC_SIZE && CUSTOM_HID_ReportDesc_FS[pos] != 0xc0U)
+  {
+    data = CUSTOM_HID_ReportDesc_FS[pos] & 0x03U;
+    pos += 1U + ((data == 3U) ? 4U : data);
+  }
+  if (pos >= USBD_CUSTOM_HID_REPORT_DESC_SIZE)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+  memcpy(CUSTOM_HID_StampDesc_FS, CUSTOM_HID_ReportDesc_FS, pos);
+  memcpy(&CUSTOM_HID_StampDesc_FS[pos], CUSTOM_HID_StampItems_FS, sizeof(CUSTOM_HID_StampItems_FS));
+  memcpy(&CUSTOM_HID_StampDesc_FS[pos + sizeof(CUSTOM_HID_StampItems_FS)], &CUSTOM_HID_ReportDesc_FS[pos],
+         USBD_CUSTOM_HID_REPORT_DESC_SIZE - pos);
+  return USBD_CUSTOM_HID_SetReportDesc(&hUsbDeviceFS, CUSTOM_HID_StampDesc_FS,
+                                       sizeof(CUSTOM_HID_StampDesc_FS), 0U);
+}
 
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 /**
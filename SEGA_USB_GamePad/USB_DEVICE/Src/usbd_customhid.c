@@ -106,6 +106,7 @@ static uint8_t  USBD_CUSTOM_HID_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 
 static uint8_t  USBD_CUSTOM_HID_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t  USBD_CUSTOM_HID_EP0_RxReady(USBD_HandleTypeDef  *pdev);
+static uint8_t  USBD_CUSTOM_HID_SOF(USBD_HandleTypeDef *pdev);
 /**
   * @}
   */
@@ -123,7 +124,7 @@ USBD_ClassTypeDef  USBD_CUSTOM_HID =
   USBD_CUSTOM_HID_EP0_RxReady, /*EP0_RxReady*/ /* STATUS STAGE IN */
   USBD_CUSTOM_HID_DataIn, /*DataIn*/
   USBD_CUSTOM_HID_DataOut,
-  NULL, /*SOF */
+  USBD_CUSTOM_HID_SOF, /*SOF */
   NULL,
   NULL,
   USBD_CUSTOM_HID_GetHSCfgDesc,
@@ -137,21 +138,21 @@ __ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_CfgFSDesc[USB_CUSTOM_HID_CONFIG_DES
 {
   0x09, /* bLength: Configuration Descriptor size */
   USB_DESC_TYPE_CONFIGURATION, /* bDescriptorType: Configuration */
-  USB_CUSTOM_HID_CONFIG_DESC_SIZ,
+  LOBYTE(USB_CUSTOM_HID_CONFIG_DESC_SIZ),
   /* wTotalLength: Bytes returned */
-  0x00,
-  0x01,         /*bNumInterfaces: 1 interface*/
+  HIBYTE(USB_CUSTOM_HID_CONFIG_DESC_SIZ),
+  USBD_MAX_NUM_INTERFACES, /*bNumInterfaces: HID (+ CDC comm + CDC data)*/
   0x01,         /*bConfigurationValue: Configuration value*/
   0x00,         /*iConfiguration: Index of string descriptor describing
   the configuration*/
-  0xC0,         /*bmAttributes: bus powered */
+  0xE0,         /*bmAttributes: self powered, remote wakeup */
   0x32,         /*MaxPower 100 mA: this current is used for detecting Vbus*/
 
   /************** Descriptor of CUSTOM HID interface ****************/
   /* 09 */
   0x09,         /*bLength: Interface Descriptor size*/
   USB_DESC_TYPE_INTERFACE,/*bDescriptorType: Interface descriptor type*/
-  0x00,         /*bInterfaceNumber: Number of Interface*/
+  CUSTOM_HID_INTERFACE, /*bInterfaceNumber: Number of Interface*/
   0x00,         /*bAlternateSetting: Alternate setting*/
   0x02,         /*bNumEndpoints*/
   0x03,         /*bInterfaceClass: CUSTOM_HID*/
@@ -189,6 +190,10 @@ __ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_CfgFSDesc[USB_CUSTOM_HID_CONFIG_DES
   0x00,
   CUSTOM_HID_FS_BINTERVAL,  /* bInterval: Polling Interval */
   /* 41 */
+#if USBD_CDC_ACM
+  CDC_ACM_CFG_DESC,
+  /* 107 */
+#endif /* USBD_CDC_ACM */
 };
 
 /* USB CUSTOM_HID device HS Configuration Descriptor */
@@ -196,21 +201,21 @@ __ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_CfgHSDesc[USB_CUSTOM_HID_CONFIG_DES
 {
   0x09, /* bLength: Configuration Descriptor size */
   USB_DESC_TYPE_CONFIGURATION, /* bDescriptorType: Configuration */
-  USB_CUSTOM_HID_CONFIG_DESC_SIZ,
+  LOBYTE(USB_CUSTOM_HID_CONFIG_DESC_SIZ),
   /* wTotalLength: Bytes returned */
-  0x00,
-  0x01,         /*bNumInterfaces: 1 interface*/
+  HIBYTE(USB_CUSTOM_HID_CONFIG_DESC_SIZ),
+  USBD_MAX_NUM_INTERFACES, /*bNumInterfaces: HID (+ CDC comm + CDC data)*/
   0x01,         /*bConfigurationValue: Configuration value*/
   0x00,         /*iConfiguration: Index of string descriptor describing
   the configuration*/
-  0xC0,         /*bmAttributes: bus powered */
+  0xE0,         /*bmAttributes: self powered, remote wakeup */
   0x32,         /*MaxPower 100 mA: this current is used for detecting Vbus*/
 
   /************** Descriptor of CUSTOM HID interface ****************/
   /* 09 */
   0x09,         /*bLength: Interface Descriptor size*/
   USB_DESC_TYPE_INTERFACE,/*bDescriptorType: Interface descriptor type*/
-  0x00,         /*bInterfaceNumber: Number of Interface*/
+  CUSTOM_HID_INTERFACE, /*bInterfaceNumber: Number of Interface*/
   0x00,         /*bAlternateSetting: Alternate setting*/
   0x02,         /*bNumEndpoints*/
   0x03,         /*bInterfaceClass: CUSTOM_HID*/
@@ -248,6 +253,10 @@ __ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_CfgHSDesc[USB_CUSTOM_HID_CONFIG_DES
   0x00,
   CUSTOM_HID_HS_BINTERVAL,  /* bInterval: Polling Interval */
   /* 41 */
+#if USBD_CDC_ACM
+  CDC_ACM_CFG_DESC,
+  /* 107 */
+#endif /* USBD_CDC_ACM */
 };
 
 /* USB CUSTOM_HID device Other Speed Configuration Descriptor */
@@ -255,21 +264,21 @@ __ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_OtherSpeedCfgDesc[USB_CUSTOM_HID_CO
 {
   0x09, /* bLength: Configuration Descriptor size */
   USB_DESC_TYPE_CONFIGURATION, /* bDescriptorType: Configuration */
-  USB_CUSTOM_HID_CONFIG_DESC_SIZ,
+  LOBYTE(USB_CUSTOM_HID_CONFIG_DESC_SIZ),
   /* wTotalLength: Bytes returned */
-  0x00,
-  0x01,         /*bNumInterfaces: 1 interface*/
+  HIBYTE(USB_CUSTOM_HID_CONFIG_DESC_SIZ),
+  USBD_MAX_NUM_INTERFACES, /*bNumInterfaces: HID (+ CDC comm + CDC data)*/
   0x01,         /*bConfigurationValue: Configuration value*/
   0x00,         /*iConfiguration: Index of string descriptor describing
   the configuration*/
-  0xC0,         /*bmAttributes: bus powered */
+  0xE0,         /*bmAttributes: self powered, remote wakeup */
   0x32,         /*MaxPower 100 mA: this current is used for detecting Vbus*/
 
   /************** Descriptor of CUSTOM HID interface ****************/
   /* 09 */
   0x09,         /*bLength: Interface Descriptor size*/
   USB_DESC_TYPE_INTERFACE,/*bDescriptorType: Interface descriptor type*/
-  0x00,         /*bInterfaceNumber: Number of Interface*/
+  CUSTOM_HID_INTERFACE, /*bInterfaceNumber: Number of Interface*/
   0x00,         /*bAlternateSetting: Alternate setting*/
   0x02,         /*bNumEndpoints*/
   0x03,         /*bInterfaceClass: CUSTOM_HID*/
@@ -307,6 +316,10 @@ __ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_OtherSpeedCfgDesc[USB_CUSTOM_HID_CO
   0x00,
   CUSTOM_HID_FS_BINTERVAL,  /* bInterval: Polling Interval */
   /* 41 */
+#if USBD_CDC_ACM
+  CDC_ACM_CFG_DESC,
+  /* 107 */
+#endif /* USBD_CDC_ACM */
 };
 
 /* USB CUSTOM_HID device Configuration Descriptor */
@@ -324,6 +337,78 @@ __ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_Desc[USB_CUSTOM_HID_DESC_SIZ] __ALI
   0x00,
 };
 
+/* Report descriptor length (the descriptor itself is fops->pReport) */
+static uint16_t USBD_CUSTOM_HID_ReportDescSize = USBD_CUSTOM_HID_REPORT_DESC_SIZE;
+
+/* USB XInput personality Configuration Descriptor: interface 0 as on a wired
+   Xbox 360 controller (vendor class 0xFF/0x5D/0x01), CDC unchanged */
+__ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_CfgXInputDesc[USB_CUSTOM_HID_XINPUT_CONFIG_DESC_SIZ] __ALIGN_END =
+{
+  0x09, /* bLength: Configuration Descriptor size */
+  USB_DESC_TYPE_CONFIGURATION, /* bDescriptorType: Configuration */
+  LOBYTE(USB_CUSTOM_HID_XINPUT_CONFIG_DESC_SIZ),
+  /* wTotalLength: Bytes returned */
+  HIBYTE(USB_CUSTOM_HID_XINPUT_CONFIG_DESC_SIZ),
+  USBD_MAX_NUM_INTERFACES, /*bNumInterfaces: XInput (+ CDC comm + CDC data)*/
+  0x01,         /*bConfigurationValue: Configuration value*/
+  0x00,         /*iConfiguration: Index of string descriptor describing
+  the configuration*/
+  0xE0,         /*bmAttributes: self powered, remote wakeup */
+  0x32,         /*MaxPower 100 mA: this current is used for detecting Vbus*/
+
+  /************** Descriptor of XInput interface ****************/
+  /* 09 */
+  0x09,         /*bLength: Interface Descriptor size*/
+  USB_DESC_TYPE_INTERFACE,/*bDescriptorType: Interface descriptor type*/
+  CUSTOM_HID_INTERFACE, /*bInterfaceNumber: Number of Interface*/
+  0x00,         /*bAlternateSetting: Alternate setting*/
+  0x02,         /*bNumEndpoints*/
+  0xFF,         /*bInterfaceClass: Vendor Specific*/
+  0x5D,         /*bInterfaceSubClass: XInput*/
+  0x01,         /*bInterfaceProtocol: controller*/
+  0,            /*iInterface: Index of string descriptor*/
+  /******************** XInput class descriptor (undocumented) ****************/
+  /* 18 */
+  0x11,         /*bLength*/
+  0x21,         /*bDescriptorType*/
+  0x00, 0x01,   /*version 1.00*/
+  0x01,         /*subtype*/
+  0x25,         /*reserved*/
+  CUSTOM_HID_EPIN_ADDR, /*IN endpoint, 20 byte reports*/
+  0x14,
+  0x00, 0x00, 0x00, 0x00,
+  0x13,
+  CUSTOM_HID_EPOUT_ADDR, /*OUT endpoint, 8 byte rumble / 3 byte LED*/
+  0x08,
+  0x00, 0x00,
+  /******************** Descriptor of XInput endpoints ********************/
+  /* 35 */
+  0x07,          /*bLength: Endpoint Descriptor size*/
+  USB_DESC_TYPE_ENDPOINT, /*bDescriptorType:*/
+  CUSTOM_HID_EPIN_ADDR,     /*bEndpointAddress: Endpoint Address (IN)*/
+  0x03,          /*bmAttributes: Interrupt endpoint*/
+  CUSTOM_HID_XINPUT_EP_SIZE, /*wMaxPacketSize: 32 Bytes max */
+  0x00,
+  CUSTOM_HID_FS_BINTERVAL,          /*bInterval: Polling Interval */
+  /* 42 */
+
+  0x07,          /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT, /* bDescriptorType: */
+  CUSTOM_HID_EPOUT_ADDR,  /*bEndpointAddress: Endpoint Address (OUT)*/
+  0x03, /* bmAttributes: Interrupt endpoint */
+  CUSTOM_HID_XINPUT_EP_SIZE,  /* wMaxPacketSize: 32 Bytes max  */
+  0x00,
+  CUSTOM_HID_XINPUT_OUT_BINTERVAL,  /* bInterval: Polling Interval */
+  /* 49 */
+#if USBD_CDC_ACM
+  CDC_ACM_CFG_DESC,
+  /* 115 */
+#endif /* USBD_CDC_ACM */
+};
+
+/* XInput personality selected: other configuration descriptor and endpoint size */
+static uint8_t USBD_CUSTOM_HID_XInput = 0U;
+
 /* USB Standard Device Descriptor */
 __ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END =
 {
@@ -347,6 +432,17 @@ __ALIGN_BEGIN static uint8_t USBD_CUSTOM_HID_DeviceQualifierDesc[USB_LEN_DEV_QUA
   * @{
   */
 
+/**
+  * @brief  USBD_CUSTOM_HID_OutSize
+  *         OUT transfer length: one packet of the OUT endpoint, so that
+  *         every packet completes the transfer
+  * @retval length
+  */
+static uint16_t USBD_CUSTOM_HID_OutSize(void)
+{
+  return (USBD_CUSTOM_HID_XInput != 0U) ? CUSTOM_HID_XINPUT_EP_SIZE : CUSTOM_HID_EPOUT_SIZE;
+}
+
 /**
   * @brief  USBD_CUSTOM_HID_Init
   *         Initialize the CUSTOM_HID interface
@@ -362,13 +458,13 @@ static uint8_t  USBD_CUSTOM_HID_Init(USBD_HandleTypeDef *pdev,
 
   /* Open EP IN */
   USBD_LL_OpenEP(pdev, CUSTOM_HID_EPIN_ADDR, USBD_EP_TYPE_INTR,
-                 CUSTOM_HID_EPIN_SIZE);
+                 (USBD_CUSTOM_HID_XInput != 0U) ? CUSTOM_HID_XINPUT_EP_SIZE : CUSTOM_HID_EPIN_SIZE);
 
   pdev->ep_in[CUSTOM_HID_EPIN_ADDR & 0xFU].is_used = 1U;
 
   /* Open EP OUT */
   USBD_LL_OpenEP(pdev, CUSTOM_HID_EPOUT_ADDR, USBD_EP_TYPE_INTR,
-                 CUSTOM_HID_EPOUT_SIZE);
+                 (USBD_CUSTOM_HID_XInput != 0U) ? CUSTOM_HID_XINPUT_EP_SIZE : CUSTOM_HID_EPOUT_SIZE);
 
   pdev->ep_out[CUSTOM_HID_EPOUT_ADDR & 0xFU].is_used = 1U;
 
@@ -383,13 +479,19 @@ static uint8_t  USBD_CUSTOM_HID_Init(USBD_HandleTypeDef *pdev,
     hhid = (USBD_CUSTOM_HID_HandleTypeDef *) pdev->pClassData;
 
     hhid->state = CUSTOM_HID_IDLE;
+    hhid->Protocol = 1U; /* Report protocol after reset (HID 1.11, 7.2.6) */
+    hhid->IdleState = 0U; /* Infinite idle: reports only on change until SET_IDLE */
     ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->Init();
 
     /* Prepare Out endpoint to receive 1st packet */
     USBD_LL_PrepareReceive(pdev, CUSTOM_HID_EPOUT_ADDR, hhid->Report_buf,
-                           USBD_CUSTOMHID_OUTREPORT_BUF_SIZE);
+                           USBD_CUSTOM_HID_OutSize());
   }
 
+#if USBD_CDC_ACM
+  USBD_CDC_ACM_Init(pdev);
+#endif /* USBD_CDC_ACM */
+
   return ret;
 }
 
@@ -411,6 +513,10 @@ static uint8_t  USBD_CUSTOM_HID_DeInit(USBD_HandleTypeDef *pdev,
   USBD_LL_CloseEP(pdev, CUSTOM_HID_EPOUT_ADDR);
   pdev->ep_out[CUSTOM_HID_EPOUT_ADDR & 0xFU].is_used = 0U;
 
+#if USBD_CDC_ACM
+  USBD_CDC_ACM_DeInit(pdev);
+#endif /* USBD_CDC_ACM */
+
   /* FRee allocated memory */
   if (pdev->pClassData != NULL)
   {
@@ -437,6 +543,18 @@ static uint8_t  USBD_CUSTOM_HID_Setup(USBD_HandleTypeDef *pdev,
   uint16_t status_info = 0U;
   uint8_t ret = USBD_OK;
 
+#if USBD_CDC_ACM
+  if ((((req->bmRequest & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_INTERFACE) &&
+       (LOBYTE(req->wIndex) != CUSTOM_HID_INTERFACE)) ||
+      (((req->bmRequest & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_ENDPOINT) &&
+       ((LOBYTE(req->wIndex) == CDC_ACM_IN_EP) || (LOBYTE(req->wIndex) == CDC_ACM_OUT_EP) ||
+        (LOBYTE(req->wIndex) == CDC_ACM_CMD_EP))))
+  {
+    /* Composite device: requests to interfaces 1 and 2 and to their endpoints belong to CDC */
+    return USBD_CDC_ACM_Setup(pdev, req);
+  }
+#endif /* USBD_CDC_ACM */
+
   switch (req->bmRequest & USB_REQ_TYPE_MASK)
   {
     case USB_REQ_TYPE_CLASS :
@@ -458,9 +576,25 @@ static uint8_t  USBD_CUSTOM_HID_Setup(USBD_HandleTypeDef *pdev,
           USBD_CtlSendData(pdev, (uint8_t *)(void *)&hhid->IdleState, 1U);
           break;
 
+        case CUSTOM_HID_REQ_GET_REPORT:
+          /* Served from the latest report snapshot, no new poll is started */
+          pbuf = USBD_CUSTOM_HID_GetReportCallback(pdev, HIBYTE(req->wValue),
+                                                   LOBYTE(req->wValue), &len);
+          if (pbuf == NULL)
+          {
+            USBD_CtlError(pdev, req);
+            ret = USBD_FAIL;
+          }
+          else
+          {
+            USBD_CtlSendData(pdev, pbuf, MIN(len, req->wLength));
+          }
+          break;
+
         case CUSTOM_HID_REQ_SET_REPORT:
           hhid->IsReportAvailable = 1U;
-          USBD_CtlPrepareRx(pdev, hhid->Report_buf, req->wLength);
+          USBD_CtlPrepareRx(pdev, hhid->Report_buf,
+                            MIN(req->wLength, USBD_CUSTOMHID_OUTREPORT_BUF_SIZE));
           break;
 
         default:
@@ -488,7 +622,7 @@ static uint8_t  USBD_CUSTOM_HID_Setup(USBD_HandleTypeDef *pdev,
         case USB_REQ_GET_DESCRIPTOR:
           if (req->wValue >> 8 == CUSTOM_HID_REPORT_DESC)
           {
-            len = MIN(USBD_CUSTOM_HID_REPORT_DESC_SIZE, req->wLength);
+            len = MIN(USBD_CUSTOM_HID_ReportDescSize, req->wLength);
             pbuf = ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->pReport;
           }
           else
@@ -570,6 +704,60 @@ uint8_t USBD_CUSTOM_HID_SendReport(USBD_HandleTypeDef  *pdev,
   return USBD_OK;
 }
 
+/**
+  * @brief  USBD_CUSTOM_HID_SetReportDesc
+  *         Select the report descriptor (device personality).
+  *         Must be called before the host reads the configuration descriptor.
+  * @param  pdev: device instance
+  * @param  desc: report descriptor
+  * @param  size: report descriptor length
+  * @param  boot: boot interface protocol (0 = none, 1 = keyboard, 2 = mouse)
+  * @retval status
+  */
+uint8_t USBD_CUSTOM_HID_SetReportDesc(USBD_HandleTypeDef *pdev,
+                                      uint8_t *desc,
+                                      uint16_t size,
+                                      uint8_t boot)
+{
+  uint8_t *cfg[] = {USBD_CUSTOM_HID_CfgFSDesc, USBD_CUSTOM_HID_CfgHSDesc,
+                    USBD_CUSTOM_HID_OtherSpeedCfgDesc};
+  uint8_t i;
+
+  if (pdev->pUserData == NULL)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->pReport = desc;
+  USBD_CUSTOM_HID_ReportDescSize = size;
+
+  for (i = 0U; i < 3U; i++)
+  {
+    cfg[i][CUSTOM_HID_CFG_SUBCLASS_OFFSET] = (boot != 0U) ? 1U : 0U;
+    cfg[i][CUSTOM_HID_CFG_PROTOCOL_OFFSET] = boot;
+    cfg[i][CUSTOM_HID_CFG_REPORT_LEN_OFFSET] = LOBYTE(size);
+    cfg[i][CUSTOM_HID_CFG_REPORT_LEN_OFFSET + 1U] = HIBYTE(size);
+  }
+  USBD_CUSTOM_HID_Desc[CUSTOM_HID_DESC_REPORT_LEN_OFFSET] = LOBYTE(size);
+  USBD_CUSTOM_HID_Desc[CUSTOM_HID_DESC_REPORT_LEN_OFFSET + 1U] = HIBYTE(size);
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CUSTOM_HID_SetXInput
+  *         Select the XInput personality (vendor interface instead of HID).
+  *         Must be called before the host reads the configuration descriptor.
+  * @param  pdev: device instance
+  * @retval status
+  */
+uint8_t USBD_CUSTOM_HID_SetXInput(USBD_HandleTypeDef *pdev)
+{
+  UNUSED(pdev);
+  USBD_CUSTOM_HID_XInput = 1U;
+  return (uint8_t)USBD_OK;
+}
+
 /**
   * @brief  USBD_CUSTOM_HID_GetFSCfgDesc
   *         return FS configuration descriptor
@@ -579,6 +767,11 @@ uint8_t USBD_CUSTOM_HID_SendReport(USBD_HandleTypeDef  *pdev,
   */
 static uint8_t  *USBD_CUSTOM_HID_GetFSCfgDesc(uint16_t *length)
 {
+  if (USBD_CUSTOM_HID_XInput != 0U)
+  {
+    *length = sizeof(USBD_CUSTOM_HID_CfgXInputDesc);
+    return USBD_CUSTOM_HID_CfgXInputDesc;
+  }
   *length = sizeof(USBD_CUSTOM_HID_CfgFSDesc);
   return USBD_CUSTOM_HID_CfgFSDesc;
 }
@@ -592,6 +785,11 @@ static uint8_t  *USBD_CUSTOM_HID_GetFSCfgDesc(uint16_t *length)
   */
 static uint8_t  *USBD_CUSTOM_HID_GetHSCfgDesc(uint16_t *length)
 {
+  if (USBD_CUSTOM_HID_XInput != 0U)
+  {
+    *length = sizeof(USBD_CUSTOM_HID_CfgXInputDesc);
+    return USBD_CUSTOM_HID_CfgXInputDesc;
+  }
   *length = sizeof(USBD_CUSTOM_HID_CfgHSDesc);
   return USBD_CUSTOM_HID_CfgHSDesc;
 }
@@ -605,6 +803,11 @@ static uint8_t  *USBD_CUSTOM_HID_GetHSCfgDesc(uint16_t *length)
   */
 static uint8_t  *USBD_CUSTOM_HID_GetOtherSpeedCfgDesc(uint16_t *length)
 {
+  if (USBD_CUSTOM_HID_XInput != 0U)
+  {
+    *length = sizeof(USBD_CUSTOM_HID_CfgXInputDesc);
+    return USBD_CUSTOM_HID_CfgXInputDesc;
+  }
   *length = sizeof(USBD_CUSTOM_HID_OtherSpeedCfgDesc);
   return USBD_CUSTOM_HID_OtherSpeedCfgDesc;
 }
@@ -619,6 +822,18 @@ static uint8_t  *USBD_CUSTOM_HID_GetOtherSpeedCfgDesc(uint16_t *length)
 static uint8_t  USBD_CUSTOM_HID_DataIn(USBD_HandleTypeDef *pdev,
                                        uint8_t epnum)
 {
+#if USBD_CDC_ACM
+  if (epnum == (CDC_ACM_IN_EP & 0x7FU))
+  {
+    USBD_CDC_ACM_DataIn(pdev);
+    return USBD_OK;
+  }
+  if (epnum != (CUSTOM_HID_EPIN_ADDR & 0x7FU))
+  {
+    return USBD_OK;
+  }
+#endif /* USBD_CDC_ACM */
+
   /* Ensure that the FIFO is empty before a new transfer, this condition could
   be caused by  a new transfer before the end of the previous transfer */
   ((USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData)->state = CUSTOM_HID_IDLE;
@@ -639,11 +854,19 @@ static uint8_t  USBD_CUSTOM_HID_DataOut(USBD_HandleTypeDef *pdev,
 
   USBD_CUSTOM_HID_HandleTypeDef     *hhid = (USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData;
 
+#if USBD_CDC_ACM
+  if (epnum == CDC_ACM_OUT_EP)
+  {
+    USBD_CDC_ACM_DataOut(pdev);
+    return USBD_OK;
+  }
+#endif /* USBD_CDC_ACM */
+
   ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->OutEvent(hhid->Report_buf[0],
                                                             hhid->Report_buf[1]);
 
   USBD_LL_PrepareReceive(pdev, CUSTOM_HID_EPOUT_ADDR, hhid->Report_buf,
-                         USBD_CUSTOMHID_OUTREPORT_BUF_SIZE);
+                         USBD_CUSTOM_HID_OutSize());
 
   return USBD_OK;
 }
@@ -665,9 +888,58 @@ static uint8_t USBD_CUSTOM_HID_EP0_RxReady(USBD_HandleTypeDef *pdev)
     hhid->IsReportAvailable = 0U;
   }
 
+#if USBD_CDC_ACM
+  USBD_CDC_ACM_EP0_RxReady(pdev);
+#endif /* USBD_CDC_ACM */
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_CUSTOM_HID_SOF
+  *         Start Of Frame (1 ms), only in configured state
+  * @param  pdev: device instance
+  * @retval status
+  */
+static uint8_t USBD_CUSTOM_HID_SOF(USBD_HandleTypeDef *pdev)
+{
+  USBD_CUSTOM_HID_SOFCallback(pdev);
+
   return USBD_OK;
 }
 
+/**
+  * @brief  USBD_CUSTOM_HID_SOFCallback
+  *         Start Of Frame user hook
+  * @param  pdev: device instance
+  * @retval None
+  */
+__weak void USBD_CUSTOM_HID_SOFCallback(USBD_HandleTypeDef *pdev)
+{
+  UNUSED(pdev);
+}
+
+/**
+  * @brief  USBD_CUSTOM_HID_GetReportCallback
+  *         GET_REPORT user hook
+  * @param  pdev: device instance
+  * @param  type: report type (1 = input, 2 = output, 3 = feature)
+  * @param  id: report ID (0 if report IDs are not used)
+  * @param  len: report length
+  * @retval pointer to the report, NULL if there is no such report (STALL)
+  */
+__weak uint8_t *USBD_CUSTOM_HID_GetReportCallback(USBD_HandleTypeDef *pdev,
+                                                  uint8_t type,
+                                                  uint8_t id,
+                                                  uint16_t *len)
+{
+  UNUSED(pdev);
+  UNUSED(type);
+  UNUSED(id);
+  *len = 0U;
+  return NULL;
+}
+
 /**
 * @brief  DeviceQualifierDescriptor
 *         return Device Qualifier descriptor
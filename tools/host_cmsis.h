@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ *  @file host_cmsis.h
+ *  @brief Сборка модулей прошивки на ПК: подмена ядра и регистры периферии
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Подключается к модулю прошивки через -include перед его собственным кодом.
+ *  Заголовки устройства уже прочитаны, поэтому дальше в модуле:
+ *   - __disable_irq/__enable_irq, PRIMASK и __WFI ничего не делают (на ПК нет
+ *     прерываний, тест вызывает обработчики прерываний сам);
+ *   - NVIC_* ничего не делают.
+ *
+ *  Регистры периферии остаются по своим адресам: host_periph_map() отображает
+ *  туда обычную память (все нули). Вызывать в начале теста, до первого обращения
+ *  к периферии. Флаги, которые выставляет железо (DMA1->ISR, USART->SR, ...),
+ *  выставляет тест.
+ *
+ *  Модули, которые пишут в каналы DMA адрес буфера (CMAR = (uint32_t)buffer),
+ *  собираются с -no-pie: тогда статические буферы лежат ниже 4 Гбайт
+ *  и адрес в 32-битном регистре настоящий.
+ *
+ *  __disable_irq/__enable_irq и __get_PRIMASK/__set_PRIMASK работают с Host_primask:
+ *  тест видит, в каком состоянии прерываний функция прошивки вернулась.
+ *
+ *  С -DHOST_POLL каждый READ_BIT сначала вызывает host_poll(&REG, BIT) из теста:
+ *  циклы ожидания флагов в прошивке двигают время модели периферии,
+ *  а __WFE вызывает host_wfe() из теста (сон до события модели). Без него __WFE ничего не делает.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __HOST_CMSIS_H
+#define __HOST_CMSIS_H
+
+#include <sys/mman.h>
+#include "stm32f103xx_CMSIS.h"
+
+#undef __disable_irq
+#undef __enable_irq
+#undef __WFI
+#undef __WFE
+/*PRIMASK ядра: 1 - прерывания запрещены. Один на программу (weak), тесты его проверяют*/
+__attribute__((weak)) uint32_t Host_primask;
+
+#define __disable_irq() ((void)(Host_primask = 1))
+#define __enable_irq() ((void)(Host_primask = 0))
+#define __get_PRIMASK() Host_primask
+#define __set_PRIMASK(primask) ((void)(Host_primask = (primask)))
+#define __WFI() ((void)0)
+#define __WFE() ((void)0)
+
+#undef NVIC_DisableIRQ
+#undef NVIC_EnableIRQ
+#define NVIC_DisableIRQ(irq) ((void)(irq))
+#define NVIC_EnableIRQ(irq) ((void)(irq))
+
+#ifdef HOST_POLL
+void host_poll(const volatile void *reg, uint32_t bit); //Опрос регистра: модель делает шаг по времени
+
+void host_wfe(void); //Сон ядра до события
+
+#undef READ_BIT
+#define READ_BIT(REG, BIT) (host_poll(&(REG), (BIT)), (REG) & (BIT))
+#undef __WFE
+#define __WFE() host_wfe()
+#endif
+
+#define HOST_PERIPH_SIZE 0x24000 //APB1, APB2 и AHB до FLASH и CRC включительно
+
+/*Регистры периферии: память процесса по адресам PERIPH_BASE. retval false - адреса заняты*/
+static inline bool host_periph_map(void) {
+    void *periph = mmap((void *)PERIPH_BASE, HOST_PERIPH_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    return periph == (void *)PERIPH_BASE;
+}
+
+#endif /* __HOST_CMSIS_H */
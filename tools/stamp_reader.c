@@ -0,0 +1,144 @@
+/**
+ ******************************************************************************
+ *  @file stamp_reader.c
+ *  @brief Номер и возраст отчетов геймпада (SEGA_stamp.h) через hidraw в Linux
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  stamp_reader /dev/hidrawN [отчетов]
+ *
+ *  Геймпад в режиме SEGA_STAMP_MODE (SEGA_CONFIG_USB_MODE = 4). Читаются только
+ *  отчеты с Report ID 1, по строке на отчет в stdout:
+ *  "мкс_хоста интервал_мкс номер пропущено возраст_мкс кнопки",
+ *  где мкс_хоста - CLOCK_MONOTONIC при возврате read() от первого отчета,
+ *  пропущено - сколько номеров не дошло до хоста перед этим отчетом,
+ *  возраст 65535 - предел (повтор по SET_IDLE или до первого опроса).
+ *  Без числа отчетов - до Ctrl+C. Итог - в stderr.
+ *
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+/*Разметка отчета, см. таблицу в SEGA_stamp.h*/
+#define STAMP_REPORT_ID   1
+#define STAMP_BUTTONS_POS 4 //Кнопки, 2 байта
+#define STAMP_SEQ_POS     6 //Номер, 1 байт
+#define STAMP_AGE_POS     7 //Возраст, 2 байта (младший первым)
+#define STAMP_SIZE        9
+#define STAMP_AGE_MAX     0xFFFF
+
+static volatile sig_atomic_t Stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    Stop = 1;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+int main(int argc, char **argv) {
+    struct sigaction sa;
+    uint8_t buf[64];
+    uint64_t limit = 0, reports = 0, lost = 0, age_sum = 0, age_count = 0;
+    uint64_t start = 0, prev_time = 0, time;
+    uint32_t age_min = STAMP_AGE_MAX, age_max = 0, short_reports = 0;
+    uint16_t age, buttons;
+    uint8_t seq, prev_seq = 0, gap;
+    ssize_t n;
+    int fd;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "stamp_reader /dev/hidrawN [отчетов]\n");
+        return 2;
+    }
+    if (argc == 3) {
+        limit = strtoull(argv[2], NULL, 0);
+    }
+    if ((fd = open(argv[1], O_RDONLY)) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    //Без SA_RESTART: Ctrl+C прерывает ожидающий read()
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    while (!Stop && (!limit || reports < limit)) {
+        n = read(fd, buf, sizeof(buf));
+        time = now_us();
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror(argv[1]);
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (buf[0] != STAMP_REPORT_ID) {
+            continue; //Мышь, клавиатура и прочие отчеты
+        }
+        if (n < STAMP_SIZE) {
+            //Отчет без меток: геймпад не в режиме SEGA_STAMP_MODE (или зажат START)
+            if (!short_reports++) {
+                fprintf(stderr, "%s: отчет %zd байт, без номера и возраста\n", argv[1], n);
+            }
+            continue;
+        }
+
+        buttons = buf[STAMP_BUTTONS_POS] | (uint16_t)(buf[STAMP_BUTTONS_POS + 1] << 8);
+        seq = buf[STAMP_SEQ_POS];
+        age = buf[STAMP_AGE_POS] | (uint16_t)(buf[STAMP_AGE_POS + 1] << 8);
+        if (!reports) {
+            start = prev_time = time;
+            gap = 0;
+        }
+        else {
+            gap = (uint8_t)(seq - prev_seq - 1); //Номер идет по кругу 0..255
+        }
+        lost += gap;
+        if (age != STAMP_AGE_MAX) {
+            age_sum += age;
+            age_count++;
+            age_min = age < age_min ? age : age_min;
+            age_max = age > age_max ? age : age_max;
+        }
+        printf("%" PRIu64 " %" PRIu64 " %u %u %u%s 0x%04X\n", time - start, time - prev_time,
+               seq, gap, age, age == STAMP_AGE_MAX ? "+" : "", buttons);
+        fflush(stdout);
+        prev_seq = seq;
+        prev_time = time;
+        reports++;
+    }
+    close(fd);
+
+    fprintf(stderr, "отчетов: %" PRIu64 ", пропущено номеров: %" PRIu64 ", без меток: %" PRIu32 "\n",
+            reports, lost, short_reports);
+    if (age_count) {
+        fprintf(stderr, "возраст, мкс: мин %" PRIu32 ", средний %" PRIu64 ", макс %" PRIu32 " (без %" PRIu64 " отчетов с пределом)\n",
+                age_min, age_sum / age_count, age_max, reports - age_count);
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ ******************************************************************************
+ *  @file tas_codec.c
+ *  @brief Формат записи SEGA_tas на ПК: кодирование и декодирование
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Формат см. в tas_codec.h
+ *
+ ******************************************************************************
+ */
+
+#include "tas_codec.h"
+
+/**
+ ***************************************************************************************
+ *  @breif Запись числа в формате varint (как SEGA_TAS_Varint_Put)
+ *  @retval Количество записанных байт
+ ***************************************************************************************
+ */
+size_t tas_varint_put(uint8_t *buf, uint32_t value) {
+    size_t n = 0;
+
+    while (value > 0x7F) {
+        buf[n++] = (uint8_t)(value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buf[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Чтение числа varint
+ *  @param  pos - позиция, сдвигается за прочитанное число
+ *  @retval 0 - успешно, -1 - данные кончились или varint длиннее TAS_VARINT_MAX байт
+ ***************************************************************************************
+ */
+int tas_varint_get(const uint8_t *buf, size_t len, size_t *pos, uint32_t *value) {
+    uint32_t result = 0;
+    size_t p = *pos;
+    uint8_t data;
+
+    for (int i = 0; i < TAS_VARINT_MAX; i++) {
+        if (p >= len) {
+            return -1;
+        }
+        data = buf[p++];
+        result |= (uint32_t)(data & 0x7F) << (7 * i);
+        if (!(data & 0x80)) {
+            *pos = p;
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Кодирование трассы так же, как SEGA_TAS_Record: запись только при изменении
+ *  @param  events - события по возрастанию кадров
+ *  @retval Длина записи, 0 - не хватило места в out
+ ***************************************************************************************
+ */
+size_t tas_encode(const tas_event *events, size_t count, uint8_t *out, size_t size) {
+    uint8_t buf[TAS_RECORD_MAX];
+    uint32_t frame = 0;
+    uint16_t state = 0;
+    size_t written = 0;
+    size_t n;
+
+    for (size_t i = 0; i < count; i++) {
+        if (events[i].buttons == state) {
+            continue;
+        }
+        n = tas_varint_put(buf, events[i].frame - frame);
+        n += tas_varint_put(buf + n, events[i].buttons ^ state);
+        if (written + n > size) {
+            return 0;
+        }
+        for (size_t j = 0; j < n; j++) {
+            out[written + j] = buf[j];
+        }
+        written += n;
+        frame = events[i].frame;
+        state = events[i].buttons;
+    }
+    return written;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Декодирование записи так же, как воспроизведение в SEGA_TAS_SOF
+ *  @retval Количество событий в events
+ ***************************************************************************************
+ */
+size_t tas_decode(const uint8_t *buf, size_t len, tas_event *events, size_t count) {
+    size_t pos = 0;
+    size_t n = 0;
+    uint32_t frame, delta, diff;
+    uint16_t state = 0;
+
+    if (tas_varint_get(buf, len, &pos, &frame)) {
+        return 0;
+    }
+    while (n < count) {
+        if (tas_varint_get(buf, len, &pos, &diff)) {
+            break; //Запись оборвана посередине
+        }
+        state ^= (uint16_t)diff;
+        events[n].frame = frame;
+        events[n].buttons = state;
+        n++;
+        if (pos >= len || tas_varint_get(buf, len, &pos, &delta)) {
+            break;
+        }
+        frame += delta;
+    }
+    return n;
+}
@@ -0,0 +1,43 @@
+/**
+ ******************************************************************************
+ *  @file tas_codec.h
+ *  @brief Формат записи SEGA_tas на ПК: кодирование и декодирование
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Тот же формат, что пишет прошивка (см. SEGA_USB_GamePad/Core/Inc/SEGA_tas.h):
+ *
+ *      varint(кадров с прошлой записи) varint(кнопки XOR прошлое состояние)
+ *
+ *  Начальное состояние - 0 в кадре 0. Запись появляется только при изменении кнопок.
+ *  Декодер повторяет воспроизведение в SEGA_TAS_SOF и останавливается на конце данных
+ *  или на varint длиннее 5 байт (так выглядит стертая Flash, 0xFF).
+ *
+ ******************************************************************************
+ */
+
+#ifndef __TAS_CODEC_H
+#define __TAS_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*Макросы*/
+#define TAS_RECORD_MAX 8 //Максимальная длина одной записи, как SEGA_TAS_RECORD_MAX
+#define TAS_VARINT_MAX 5 //Байт в varint для 32 бит
+
+/*Событие трассы: с кадра frame кнопки равны buttons*/
+typedef struct {
+    uint32_t frame;
+    uint16_t buttons;
+} tas_event;
+
+size_t tas_varint_put(uint8_t *buf, uint32_t value); //Запись varint, retval - байт
+int tas_varint_get(const uint8_t *buf, size_t len, size_t *pos, uint32_t *value); //Чтение varint, 0 - успешно
+size_t tas_encode(const tas_event *events, size_t count, uint8_t *out, size_t size); //Трасса -> запись, retval - байт (0 - мало места)
+size_t tas_decode(const uint8_t *buf, size_t len, tas_event *events, size_t count); //Запись -> трасса, retval - событий
+
+#endif /* __TAS_CODEC_H */
@@ -0,0 +1,242 @@
+/**
+ ******************************************************************************
+ *  @file tas_tool.c
+ *  @brief Записи SEGA_tas на ПК: кодирование, декодирование и степень сжатия
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  tas_tool encode trace.txt out.bin - трасса в формат записи SEGA_tas
+ *  tas_tool decode in.bin            - запись (out.bin или дамп Flash) в трассу, в stdout
+ *  tas_tool stats trace.txt ...      - степень сжатия и запас по памяти для каждой трассы
+ *
+ *  Трасса - текст, строка на событие: "кадр кнопки" (кадр - десятичный номер кадра USB
+ *  от начала записи, 1 мс; кнопки - переменная Buttons, 0x... или десятичное).
+ *  Строки с # - комментарии. Подходит и опрос каждый кадр (1 кГц): одинаковые
+ *  состояния подряд в запись не попадают, как и в прошивке.
+ *
+ *  Настоящие трассы - дамп записи из Flash (команда "tas flash"):
+ *  st-flash read dump.bin 0x08008000 30720, затем tas_tool decode dump.bin > trace.txt
+ *  (конец записи - стертая Flash).
+ *
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tas_codec.h"
+
+#define TOOL_RAM_SIZE    4096 //SEGA_TAS_RAM_SIZE
+#define TOOL_FLASH_SIZE  (30 * 1024) //SEGA_TAS_FLASH_SIZE
+#define TOOL_WINDOW      1000 //Окно для пиковой скорости, кадров (1 с)
+#define TOOL_EVENTS_MAX  (4 * 1024 * 1024)
+
+/**
+ ***************************************************************************************
+ *  @breif Чтение трассы
+ *  @retval Количество событий, -1 - ошибка
+ ***************************************************************************************
+ */
+static long tool_read_trace(const char *name, tas_event *events, size_t count) {
+    FILE *f = fopen(name, "r");
+    char line[128];
+    unsigned long frame;
+    long buttons;
+    uint32_t last = 0;
+    size_t n = 0;
+    int lineno = 0;
+
+    if (!f) {
+        perror(name);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        if (sscanf(line, "%lu %li", &frame, &buttons) != 2 || buttons < 0 || buttons > 0xFFFF || frame < last) {
+            fprintf(stderr, "%s:%d: ожидается \"кадр кнопки\" с неубывающим кадром\n", name, lineno);
+            fclose(f);
+            return -1;
+        }
+        if (n == count) {
+            fprintf(stderr, "%s: больше %zu событий\n", name, count);
+            fclose(f);
+            return -1;
+        }
+        events[n].frame = (uint32_t)frame;
+        events[n].buttons = (uint16_t)buttons;
+        last = (uint32_t)frame;
+        n++;
+    }
+    fclose(f);
+    return (long)n;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Чтение двоичного файла целиком
+ *  @retval Длина, -1 - ошибка
+ ***************************************************************************************
+ */
+static long tool_read_file(const char *name, uint8_t **data) {
+    FILE *f = fopen(name, "rb");
+    long len;
+
+    if (!f) {
+        perror(name);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    *data = malloc(len ? (size_t)len : 1);
+    if (!*data || fread(*data, 1, (size_t)len, f) != (size_t)len) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return len;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Пиковое число байт записи за любые TOOL_WINDOW кадров
+ ***************************************************************************************
+ */
+static size_t tool_peak_rate(const tas_event *events, size_t count) {
+    uint8_t buf[TAS_RECORD_MAX];
+    size_t *size = malloc((count ? count : 1) * sizeof(size_t));
+    uint32_t *frame = malloc((count ? count : 1) * sizeof(uint32_t));
+    uint32_t prev = 0;
+    uint16_t state = 0;
+    size_t records = 0, head = 0, sum = 0, peak = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (events[i].buttons == state) {
+            continue;
+        }
+        size[records] = tas_varint_put(buf, events[i].frame - prev);
+        size[records] += tas_varint_put(buf, events[i].buttons ^ state);
+        frame[records] = events[i].frame;
+        sum += size[records];
+        while (frame[records] - frame[head] >= TOOL_WINDOW) {
+            sum -= size[head++];
+        }
+        if (sum > peak) {
+            peak = sum;
+        }
+        records++;
+        prev = events[i].frame;
+        state = events[i].buttons;
+    }
+    free(size);
+    free(frame);
+    return peak;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Степень сжатия одной трассы
+ ***************************************************************************************
+ */
+static int tool_stats(const char *name, tas_event *events, uint8_t *out) {
+    long count = tool_read_trace(name, events, TOOL_EVENTS_MAX);
+    size_t changes = 0, bytes, peak;
+    uint32_t frames;
+    uint16_t state = 0;
+    double seconds, rate;
+
+    if (count < 0) {
+        return 1;
+    }
+    for (long i = 0; i < count; i++) {
+        if (events[i].buttons != state) {
+            changes++;
+            state = events[i].buttons;
+        }
+    }
+    bytes = tas_encode(events, (size_t)count, out, TOOL_EVENTS_MAX * TAS_RECORD_MAX);
+    frames = count ? events[count - 1].frame + 1 : 0;
+    seconds = frames / 1000.0;
+    rate = seconds > 0 ? bytes / seconds : 0;
+    peak = tool_peak_rate(events, (size_t)count);
+
+    printf("%s\n", name);
+    printf("  длительность      %u кадров (%.1f с)\n", frames, seconds);
+    printf("  изменений         %zu (%.1f в секунду)\n", changes, seconds > 0 ? changes / seconds : 0);
+    printf("  запись            %zu байт, %.2f байта на изменение\n", bytes, changes ? (double)bytes / changes : 0);
+    printf("  опрос 1 кГц       %lu байт (2 байта на кадр), сжатие %.1f:1\n",
+        (unsigned long)frames * 2, bytes ? frames * 2.0 / bytes : 0);
+    printf("  пары кадр+кнопки  %zu байт (4 + 2 байта на изменение), сжатие %.1f:1\n",
+        changes * 6, bytes ? changes * 6.0 / bytes : 0);
+    printf("  скорость          %.0f байт/с, пик %zu байт за 1 с\n", rate, peak);
+    if (rate > 0) {
+        printf("  хватит            RAM %d байт - %.0f с, Flash %d байт - %.0f с\n",
+            TOOL_RAM_SIZE, TOOL_RAM_SIZE / rate, TOOL_FLASH_SIZE, TOOL_FLASH_SIZE / rate);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    tas_event *events;
+    uint8_t *out, *data;
+    long count, len;
+    size_t bytes, n;
+    FILE *f;
+    int rc = 0;
+
+    if (argc < 3 || (strcmp(argv[1], "encode") && strcmp(argv[1], "decode") && strcmp(argv[1], "stats"))
+        || (!strcmp(argv[1], "encode") && argc != 4)) {
+        fprintf(stderr, "tas_tool encode trace.txt out.bin\n"
+                        "tas_tool decode in.bin\n"
+                        "tas_tool stats trace.txt ...\n");
+        return 2;
+    }
+    events = malloc(TOOL_EVENTS_MAX * sizeof(tas_event));
+    out = malloc(TOOL_EVENTS_MAX * TAS_RECORD_MAX);
+    if (!events || !out) {
+        return 1;
+    }
+
+    if (!strcmp(argv[1], "encode")) {
+        count = tool_read_trace(argv[2], events, TOOL_EVENTS_MAX);
+        if (count < 0) {
+            return 1;
+        }
+        bytes = tas_encode(events, (size_t)count, out, TOOL_EVENTS_MAX * TAS_RECORD_MAX);
+        f = fopen(argv[3], "wb");
+        if (!f || fwrite(out, 1, bytes, f) != bytes) {
+            perror(argv[3]);
+            return 1;
+        }
+        fclose(f);
+        if (bytes > TOOL_FLASH_SIZE) {
+            fprintf(stderr, "внимание: %zu байт - больше области Flash (%d)\n", bytes, TOOL_FLASH_SIZE);
+        }
+    }
+    else if (!strcmp(argv[1], "decode")) {
+        len = tool_read_file(argv[2], &data);
+        if (len < 0) {
+            return 1;
+        }
+        n = tas_decode(data, (size_t)len, events, TOOL_EVENTS_MAX);
+        printf("# %s: %zu событий\n", argv[2], n);
+        for (size_t i = 0; i < n; i++) {
+            printf("%u 0x%04X\n", events[i].frame, events[i].buttons);
+        }
+        free(data);
+    }
+    else {
+        for (int i = 2; i < argc; i++) {
+            rc |= tool_stats(argv[i], events, out);
+        }
+    }
+    free(events);
+    free(out);
+    return rc;
+}
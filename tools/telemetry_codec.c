@@ -0,0 +1,147 @@
+/**
+ ******************************************************************************
+ *  @file telemetry_codec.c
+ *  @brief Поток SEGA_telemetry на ПК: разбор кадров
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ */
+
+#include <string.h>
+#include "telemetry_codec.h"
+
+/**
+ ***************************************************************************************
+ *  @breif CRC-8, полином x^8 + x^2 + x + 1 (0x07), начальное значение 0
+ ***************************************************************************************
+ */
+uint8_t telemetry_crc8(const uint8_t *data, uint8_t size) {
+    uint8_t crc = 0;
+
+    while (size--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Чтение varint из начатого кадра
+ *  @param  max - допустимое число байт
+ *  @retval 1 - прочитано, 0 - нужно больше байт, -1 - длиннее max
+ ***************************************************************************************
+ */
+static int telemetry_varint(const uint8_t *buf, uint8_t len, uint8_t *pos, uint8_t max, uint32_t *value) {
+    uint32_t v = 0;
+
+    for (uint8_t i = 0; i < max; i++) {
+        if (*pos + i >= len) {
+            return 0;
+        }
+        v |= (uint32_t)(buf[*pos + i] & 0x7F) << (7 * i);
+        if (!(buf[*pos + i] & 0x80)) {
+            *pos += i + 1;
+            *value = v;
+            return 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Разбор кадра в начале буфера
+ *  @retval Длина кадра, 0 - нужно больше байт, -1 - не кадр
+ ***************************************************************************************
+ */
+static int telemetry_parse(const uint8_t *buf, uint8_t len, uint32_t *dt, uint32_t *value) {
+    uint8_t pos = 1;
+    int r;
+
+    r = telemetry_varint(buf, len, &pos, 5, dt);
+    if (r <= 0) {
+        return r;
+    }
+    r = telemetry_varint(buf, len, &pos, 3, value);
+    if (r <= 0) {
+        return r;
+    }
+    if (*value > 0xFFFF) {
+        return -1;
+    }
+    if (pos >= len) {
+        return 0;
+    }
+    return (telemetry_crc8(buf, pos) == buf[pos]) ? pos + 1 : -1;
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Сброс разбора
+ ***************************************************************************************
+ */
+void telemetry_init(telemetry_decoder *d) {
+    memset(d, 0, sizeof(*d));
+}
+
+/**
+ ***************************************************************************************
+ *  @breif Очередной байт потока
+ *  @param  *event - сюда пишется кадр, если он закончился на этом байте
+ *  @retval true - кадр готов
+ ***************************************************************************************
+ */
+bool telemetry_feed(telemetry_decoder *d, uint8_t byte, telemetry_event *event) {
+    uint32_t dt, value;
+    uint8_t i;
+    int r;
+
+    if (d->len == 0 && byte != TELEMETRY_DELTA && byte != TELEMETRY_STATE) {
+        d->skipped++;
+        return false;
+    }
+    d->buf[d->len++] = byte;
+
+    while ((r = telemetry_parse(d->buf, d->len, &dt, &value)) < 0) {
+        //Не кадр: ищем следующее начало внутри уже принятых байт
+        d->errors++;
+        for (i = 1; i < d->len && d->buf[i] != TELEMETRY_DELTA && d->buf[i] != TELEMETRY_STATE; i++) {
+        }
+        d->skipped += i;
+        d->len -= i;
+        memmove(d->buf, d->buf + i, d->len);
+        if (d->len == 0) {
+            return false;
+        }
+    }
+    if (r == 0) {
+        return false;
+    }
+    d->len = 0;
+    d->frames++;
+
+    event->type = d->buf[0];
+    event->dt = dt;
+    if (event->type == TELEMETRY_STATE) {
+        d->states++;
+        d->time = d->sync ? d->time + dt : 0;
+        event->changed = d->sync ? (uint16_t)(value ^ d->buttons) : 0;
+        d->buttons = (uint16_t)value;
+        d->sync = true;
+    }
+    else {
+        if (!d->sync) {
+            return false; //Точки отсчета еще нет
+        }
+        d->time += dt;
+        event->changed = (uint16_t)value;
+        d->buttons ^= (uint16_t)value;
+    }
+    event->time = d->time;
+    event->buttons = d->buttons;
+    return true;
+}
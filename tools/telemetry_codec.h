@@ -0,0 +1,59 @@
+/**
+ ******************************************************************************
+ *  @file telemetry_codec.h
+ *  @brief Поток SEGA_telemetry на ПК: разбор кадров
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Тот же формат, что передает прошивка (см. SEGA_USB_GamePad/Core/Inc/SEGA_telemetry.h):
+ *
+ *      0x5A/0x5B varint(мкс с прошлого кадра) varint(маска или Buttons) CRC-8
+ *
+ *  Разбор побайтный, так что подходит для чтения прямо из COM-порта. Кадр с неверной
+ *  CRC или слишком длинным varint отбрасывается, поиск начала кадра продолжается со
+ *  следующего байта. Кадры 0x5A до первого 0x5B пропускаются: кнопки еще неизвестны.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __TELEMETRY_CODEC_H
+#define __TELEMETRY_CODEC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Макросы*/
+#define TELEMETRY_DELTA     0x5A //Маска изменившихся битов
+#define TELEMETRY_STATE     0x5B //Полное состояние кнопок
+#define TELEMETRY_FRAME_MAX 10 //Как SEGA_TELEMETRY_FRAME_MAX: 1 + 5 + 3 + 1
+
+/*Разобранный кадр*/
+typedef struct {
+    uint8_t type; //TELEMETRY_DELTA или TELEMETRY_STATE
+    uint32_t dt; //мкс с прошлого кадра
+    uint64_t time; //мкс от первого полного состояния (без переполнения)
+    uint16_t buttons; //Состояние кнопок после кадра
+    uint16_t changed; //Изменившиеся биты (для 0x5B - относительно прошлого известного)
+} telemetry_event;
+
+/*Состояние разбора*/
+typedef struct {
+    uint8_t buf[TELEMETRY_FRAME_MAX];
+    uint8_t len;
+    bool sync; //Было полное состояние
+    uint64_t time;
+    uint16_t buttons;
+    uint32_t frames; //Принято кадров
+    uint32_t states; //Из них полных состояний
+    uint32_t errors; //Отброшено кадров (CRC или формат)
+    uint32_t skipped; //Байт вне кадров
+} telemetry_decoder;
+
+void telemetry_init(telemetry_decoder *d); //Сброс разбора
+bool telemetry_feed(telemetry_decoder *d, uint8_t byte, telemetry_event *event); //Байт потока, true - готов кадр
+uint8_t telemetry_crc8(const uint8_t *data, uint8_t size); //CRC-8 кадра, полином 0x07
+
+#endif /* __TELEMETRY_CODEC_H */
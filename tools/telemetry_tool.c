@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ *  @file telemetry_tool.c
+ *  @brief Поток SEGA_telemetry на ПК: декодирование в текст
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  telemetry_tool decode [поток.bin] - кадры в stdout: "мкс кнопки маска"
+ *  telemetry_tool tas [поток.bin]    - трасса для tas_tool encode: "кадр кнопки"
+ *
+ *  Без имени файла поток читается из stdin, например:
+ *  stty -F /dev/ttyUSB0 921600 raw && telemetry_tool decode < /dev/ttyUSB0
+ *  (или виртуальный COM-порт после команды "tm on").
+ *  Время считается от первого полного состояния. Итог разбора - в stderr.
+ *
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "telemetry_codec.h"
+
+int main(int argc, char **argv) {
+    telemetry_decoder d;
+    telemetry_event event;
+    FILE *f = stdin;
+    bool tas;
+    int c;
+
+    if (argc < 2 || argc > 3 || (strcmp(argv[1], "decode") && strcmp(argv[1], "tas"))) {
+        fprintf(stderr, "telemetry_tool decode|tas [поток.bin]\n");
+        return 2;
+    }
+    tas = !strcmp(argv[1], "tas");
+    if (argc == 3 && !(f = fopen(argv[2], "rb"))) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    telemetry_init(&d);
+    while ((c = getc(f)) != EOF) {
+        if (!telemetry_feed(&d, (uint8_t)c, &event)) {
+            continue;
+        }
+        if (tas) {
+            printf("%" PRIu64 " 0x%04X\n", event.time / 1000, event.buttons); //Кадр USB - 1 мс
+        }
+        else {
+            printf("%" PRIu64 " 0x%04X 0x%04X%s\n", event.time, event.buttons, event.changed,
+                   event.type == TELEMETRY_STATE ? " state" : "");
+        }
+        fflush(stdout);
+    }
+    if (f != stdin) {
+        fclose(f);
+    }
+    fprintf(stderr, "кадров: %" PRIu32 " (полных состояний: %" PRIu32 "), отброшено: %" PRIu32 ", байт вне кадров: %" PRIu32 "\n",
+            d.frames, d.states, d.errors, d.skipped);
+    return d.errors != 0;
+}
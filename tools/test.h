@@ -0,0 +1,31 @@
+/**
+ ******************************************************************************
+ *  @file test.h
+ *  @brief Проверки для тестов на ПК
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ */
+
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdio.h>
+
+static int Test_failed;
+static int Test_count;
+
+/*Проверка: при ошибке - файл, строка и условие, тест идет дальше*/
+#define CHECK(cond) do { \
+        Test_count++; \
+        if (!(cond)) { \
+            Test_failed++; \
+            printf("%s:%d: FAIL: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+/*Итог: 0 - все проверки прошли*/
+#define TEST_RESULT(name) (printf("%s: %d проверок, %d ошибок\n", (name), Test_count, Test_failed), Test_failed != 0)
+
+#endif /* __TEST_H */
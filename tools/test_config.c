@@ -0,0 +1,405 @@
+/**
+ ******************************************************************************
+ *  @file test_config.c
+ *  @brief Тест SEGA_config на модели Flash: пропадание питания, загрузка, износ
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/SEGA_config.c как есть (через host_cmsis.h).
+ *
+ *  Модель Flash: страницы SEGA_CONFIG_PAGE_A/B отображены в память процесса по тем же
+ *  адресам, так что модуль читает их указателями, как на устройстве. CMSIS_FLASH_*:
+ *   - запись полуслова только в 0xFFFF (или 0x0000 поверх чего угодно), иначе PGERR;
+ *   - запись и стирание только при разблокированной Flash и остановленном TIM3;
+ *   - каждая операция считается, на заданной операции "пропадает питание": запись
+ *     сбрасывает в 0 лишь часть нужных бит, стирание стирает часть полуслов.
+ *
+ *  Перезагрузка - fork() и SEGA_Config_Init: значения берутся только из Flash, она общая.
+ *  Сценарии, которым нужен модуль как после включения, запускаются в процессах,
+ *  отделенных до того, как основной процесс начал писать настройки.
+ *
+ *  Проверяется: значения по умолчанию, перезагрузка после записи и переноса,
+ *  отсутствие операций с Flash во время опроса, и пропадание питания на каждой
+ *  операции длинного сценария (после перезагрузки у каждого ключа прежнее или новое
+ *  значение, и запись дальше работает).
+ *  Замер: время SEGA_Config_Init на ПК при полной странице и усиление записи
+ *  (байт во Flash на байт изменений) со стираниями на 1000 изменений.
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "SEGA_config.h"
+#include "host_cmsis.h"
+#include "test.h"
+
+#define FLASH_BASE_MAP  (SEGA_CONFIG_PAGE_A & ~0xFFFUL) //Начало отображения (кратно 4 Кбайт)
+#define FLASH_MAP_SIZE  (SEGA_CONFIG_PAGE_B + SEGA_CONFIG_PAGE_SIZE - FLASH_BASE_MAP)
+#define SCENARIO_SETS   600 //Больше двух страниц записей: два переноса и стирание
+#define SCENARIO_KEY    20 //Ключи сценария: SCENARIO_KEY..SCENARIO_KEY + SCENARIO_KEYS - 1
+#define SCENARIO_KEYS   6
+#define PAGE_RECORDS    ((SEGA_CONFIG_PAGE_SIZE - 8) / 4) //Записей на странице
+#define CUT_NONE        -1L
+
+/*Модель Flash*/
+static uint8_t *Flash; //Отображение страниц настроек
+static long Flash_ops; //Операций записи и стирания
+static long Cut_at = CUT_NONE; //Операция, на которой пропадает питание
+static uint64_t Bytes_programmed;
+static uint32_t Erases;
+static uint32_t Random = 88172645u;
+
+/*Общая память с процессами сценария*/
+typedef struct {
+    long current; //Номер изменения, которое записывалось при пропадании питания
+} shared_state;
+
+static shared_state *Shared;
+
+/*Сценарий: ключ и значение каждого изменения*/
+static uint8_t Scenario_key[SCENARIO_SETS];
+static uint16_t Scenario_value[SCENARIO_SETS];
+
+static uint32_t random_next(void) {
+    Random ^= Random << 13;
+    Random ^= Random >> 17;
+    Random ^= Random << 5;
+    return Random;
+}
+
+static inline uint16_t *flash_halfword(uint32_t adress) {
+    return (uint16_t *)(uintptr_t)adress;
+}
+
+static bool flash_mapped(uint32_t adress, uint32_t size) {
+    return adress >= SEGA_CONFIG_PAGE_A && adress + size <= SEGA_CONFIG_PAGE_B + SEGA_CONFIG_PAGE_SIZE;
+}
+
+/*Операция с Flash: проверки доступа и пропадание питания*/
+static bool flash_op(void) {
+    CHECK(!READ_BIT(FLASH->CR, FLASH_CR_LOCK));
+    CHECK(!READ_BIT(TIM3->CR1, TIM_CR1_CEN)); //Никогда во время опроса
+    return Flash_ops++ == Cut_at;
+}
+
+/*Подмена CMSIS_FLASH_**/
+void CMSIS_FLASH_Unlock(void) {
+    CLEAR_BIT(FLASH->CR, FLASH_CR_LOCK);
+}
+
+void CMSIS_FLASH_Lock(void) {
+    SET_BIT(FLASH->CR, FLASH_CR_LOCK);
+}
+
+bool CMSIS_FLASH_Program_HalfWord(uint32_t Adress, uint16_t Data) {
+    uint16_t *cell = flash_halfword(Adress);
+
+    CHECK(flash_mapped(Adress, 2) && !(Adress & 1));
+    if (flash_op()) {
+        *cell &= (uint16_t)~((*cell & ~Data) & random_next()); //Обнулилась только часть бит
+        _exit(Test_failed ? 3 : 0);
+    }
+    if (*cell != 0xFFFF && Data != 0x0000) {
+        return false; //PGERR
+    }
+    *cell = Data;
+    Bytes_programmed += 2;
+    return true;
+}
+
+bool CMSIS_FLASH_Page_Erase(uint32_t Adress) {
+    uint16_t *page = flash_halfword(Adress);
+
+    CHECK(flash_mapped(Adress, SEGA_CONFIG_PAGE_SIZE) && !(Adress % SEGA_CONFIG_PAGE_SIZE));
+    if (flash_op()) {
+        for (int i = 0; i < SEGA_CONFIG_PAGE_SIZE / 2; i++) {
+            if (random_next() & 1) {
+                page[i] = 0xFFFF;
+            }
+        }
+        _exit(Test_failed ? 3 : 0);
+    }
+    memset(page, 0xFF, SEGA_CONFIG_PAGE_SIZE);
+    Erases++;
+    return true;
+}
+
+/*CRC-8 записи, как в SEGA_config.c: ключ, младший и старший байт значения*/
+static uint8_t record_crc8(uint8_t key, uint16_t value) {
+    uint8_t data[3] = { key, (uint8_t)value, (uint8_t)(value >> 8) };
+    uint8_t crc = 0;
+
+    for (uint8_t i = 0; i < sizeof(data); i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*Стертая Flash*/
+static void flash_erase_all(void) {
+    memset(Flash + (SEGA_CONFIG_PAGE_A - FLASH_BASE_MAP), 0xFF, 2 * SEGA_CONFIG_PAGE_SIZE);
+}
+
+/*Все изменения записаны во Flash*/
+static void config_flush(void) {
+    for (int i = 0; SEGA_Config_Busy() && i < 1000; i++) {
+        SEGA_Config_Process();
+    }
+    CHECK(!SEGA_Config_Busy());
+}
+
+/*Перезагрузка: в новом процессе SEGA_Config_Init и сравнение с expected.
+  Ключи с expected_alt[key] != expected[key] могут иметь любое из двух значений*/
+static bool reboot_check(const uint16_t *expected, const uint16_t *expected_alt) {
+    pid_t pid = fork();
+    int status;
+
+    if (pid == 0) {
+        SEGA_Config_Init();
+        for (uint8_t key = 0; key < SEGA_CONFIG_KEYS; key++) {
+            if (SEGA_Config_Get(key) != expected[key] && (!expected_alt || SEGA_Config_Get(key) != expected_alt[key])) {
+                printf("  ключ %u: %u, ожидалось %u\n", key, SEGA_Config_Get(key), expected[key]);
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*Текущие значения всех ключей*/
+static void config_snapshot(uint16_t *values) {
+    for (uint8_t key = 0; key < SEGA_CONFIG_KEYS; key++) {
+        values[key] = SEGA_Config_Get(key);
+    }
+}
+
+/*Стертая Flash: значения по умолчанию*/
+static void test_defaults(void) {
+    flash_erase_all();
+    SEGA_Config_Init();
+    CHECK(SEGA_Config_Get(SEGA_CONFIG_POLL_HZ) == 240);
+    CHECK(SEGA_Config_Get(SEGA_CONFIG_REMAP_2) == 0xBA98);
+    CHECK(SEGA_Config_Get(SEGA_CONFIG_SOCD) == 0);
+    CHECK(SEGA_Config_Get(SEGA_CONFIG_KEYS) == 0);
+    CHECK(!SEGA_Config_Set(SEGA_CONFIG_KEYS, 1));
+    CHECK(!SEGA_Config_Busy());
+}
+
+/*Запись, перезагрузка, заполнение страницы и перенос*/
+static void test_roundtrip(void) {
+    uint16_t expected[SEGA_CONFIG_KEYS];
+    uint32_t version = SEGA_Config_Version();
+
+    CHECK(SEGA_Config_Set(SEGA_CONFIG_POLL_HZ, 1000));
+    CHECK(SEGA_Config_Set(SEGA_CONFIG_SOCD, 2));
+    CHECK(SEGA_Config_Set(SEGA_CONFIG_SOCD, 2)); //То же значение: не изменение
+    CHECK(SEGA_Config_Version() == version + 2);
+    CHECK(SEGA_Config_Get(SEGA_CONFIG_POLL_HZ) == 1000); //В RAM сразу
+    CHECK(SEGA_Config_Busy());
+    config_flush();
+    config_snapshot(expected);
+    CHECK(reboot_check(expected, NULL));
+
+    //Три страницы записей по одному ключу: два переноса
+    for (int i = 0; i < 3 * SEGA_CONFIG_PAGE_SIZE / 4; i++) {
+        SEGA_Config_Set(SEGA_CONFIG_POINTER_CURVE, (uint16_t)i);
+        config_flush();
+    }
+    config_snapshot(expected);
+    CHECK(expected[SEGA_CONFIG_POLL_HZ] == 1000);
+    CHECK(reboot_check(expected, NULL));
+}
+
+/*Пока идет опрос (TIM3 включен), Flash не трогается*/
+static void test_no_flash_during_poll(void) {
+    long ops;
+
+    SET_BIT(TIM3->CR1, TIM_CR1_CEN);
+    SEGA_Config_Set(SEGA_CONFIG_SOCD, 1);
+    ops = Flash_ops;
+    for (int i = 0; i < 10; i++) {
+        SEGA_Config_Process();
+    }
+    CHECK(Flash_ops == ops);
+    CHECK(SEGA_Config_Busy());
+    CHECK(READ_BIT(FLASH->CR, FLASH_CR_LOCK)); //Блокировка не снята
+    CLEAR_BIT(TIM3->CR1, TIM_CR1_CEN);
+    config_flush();
+    CHECK(Flash_ops > ops);
+    CHECK(READ_BIT(FLASH->CR, FLASH_CR_LOCK)); //Блокировка возвращена
+}
+
+/*Сценарий с пропаданием питания на операции cut. Выполняется в отдельном процессе.
+  Код процесса: 0 - питание пропало, 2 - сценарий закончился раньше, 3 - ошибка проверки*/
+static void scenario_run(long cut) {
+    Cut_at = cut;
+    Flash_ops = 0;
+    Random ^= (uint32_t)(cut + 1) * 2654435761u; //Своя порча в каждой точке
+    SEGA_Config_Init();
+    for (long i = 0; i < SCENARIO_SETS; i++) {
+        Shared->current = i;
+        SEGA_Config_Set(Scenario_key[i], Scenario_value[i]);
+        config_flush();
+    }
+    _exit(Test_failed ? 3 : 2);
+}
+
+/*После перезагрузки запись работает: новое значение переживает следующую перезагрузку*/
+static void scenario_resume(void) {
+    uint16_t expected[SEGA_CONFIG_KEYS];
+
+    SEGA_Config_Init();
+    SEGA_Config_Set(SCENARIO_KEY + SCENARIO_KEYS, 0x1234);
+    config_flush();
+    config_snapshot(expected);
+    _exit(Test_failed || !reboot_check(expected, NULL));
+}
+
+/*Пропадание питания на каждой операции с Flash*/
+static void test_power_loss(void) {
+    uint16_t defaults[SEGA_CONFIG_KEYS], before[SEGA_CONFIG_KEYS], after[SEGA_CONFIG_KEYS];
+    long cut, failed = 0;
+    pid_t pid;
+    int status;
+
+    flash_erase_all();
+    SEGA_Config_Init();
+    config_snapshot(defaults);
+
+    for (long i = 0; i < SCENARIO_SETS; i++) {
+        Scenario_key[i] = (uint8_t)(SCENARIO_KEY + random_next() % SCENARIO_KEYS);
+        Scenario_value[i] = (uint16_t)random_next();
+    }
+
+    for (cut = 0;; cut++) {
+        flash_erase_all();
+        pid = fork();
+        if (pid == 0) {
+            scenario_run(cut);
+        }
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 2);
+            break; //Операций меньше, чем cut: все точки пройдены
+        }
+
+        //Ожидаемые значения: все изменения до current, ключ current - старое или новое
+        memcpy(before, defaults, sizeof(before));
+        for (long i = 0; i < Shared->current; i++) {
+            before[Scenario_key[i]] = Scenario_value[i];
+        }
+        memcpy(after, before, sizeof(after));
+        after[Scenario_key[Shared->current]] = Scenario_value[Shared->current];
+        if (!reboot_check(before, after)) {
+            printf("  питание пропало на операции %ld (изменение %ld)\n", cut, Shared->current);
+            failed++;
+            continue;
+        }
+
+        pid = fork();
+        if (pid == 0) {
+            scenario_resume();
+        }
+        waitpid(pid, &status, 0);
+        failed += !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    CHECK(failed == 0);
+    CHECK(cut > 2 * SCENARIO_SETS); //Две записи на изменение плюс переносы
+    printf("SEGA_config: пропадание питания на каждой из %ld операций с Flash, ошибок %ld\n", cut, failed);
+}
+
+/*Усиление записи: sets изменений по 4 "горячим" из 20 записанных ключей.
+  Выполняется в отдельном процессе*/
+static void bench_wear(int sets) {
+    flash_erase_all();
+    SEGA_Config_Init();
+    for (int key = 0; key < 20; key++) {
+        SEGA_Config_Set((uint8_t)(SCENARIO_KEY + key), 1);
+    }
+    config_flush();
+    Bytes_programmed = 0;
+    Erases = 0;
+    for (int i = 0; i < sets; i++) {
+        SEGA_Config_Set((uint8_t)(SCENARIO_KEY + random_next() % 4), (uint16_t)(i + 2));
+        config_flush();
+    }
+    printf("  %d изменений: записано %llu байт, %.2f байт Flash на байт значения, %.2f стираний на 1000 изменений\n",
+           sets, (unsigned long long)Bytes_programmed, Bytes_programmed / (2.0 * sets), 1000.0 * Erases / sets);
+    printf("  ресурс (10000 стираний на страницу, 2 страницы): ~%.0f млн изменений\n", 2 * 10000.0 * sets / Erases / 1e6);
+    CHECK(Bytes_programmed < 2.5 * 2 * sets); //Запись 4 байта на изменение плюс перенос
+    _exit(Test_failed != 0);
+}
+
+/*Замер: загрузка полной страницы*/
+static void bench(void) {
+    struct timespec t0, t1;
+    const int loads = 2000;
+    uint16_t *page = flash_halfword(SEGA_CONFIG_PAGE_A);
+    uint16_t value;
+    uint8_t key;
+    double ns;
+
+    //Полная страница: запись POLL_HZ и дальше записи разных ключей по кругу
+    flash_erase_all();
+    page[0] = 0x0000; //Активная
+    page[1] = 1; //Поколение
+    page[2] = (uint16_t)~1;
+    for (int i = 0; i < PAGE_RECORDS; i++) {
+        key = i ? (uint8_t)(SCENARIO_KEY + i % 32) : SEGA_CONFIG_POLL_HZ;
+        value = i ? (uint16_t)i : 500;
+        page[4 + 2 * i] = (uint16_t)(key << 8) | record_crc8(key, value);
+        page[5 + 2 * i] = value;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < loads; i++) {
+        SEGA_Config_Init();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / loads;
+    CHECK(SEGA_Config_Get(SEGA_CONFIG_POLL_HZ) == 500);
+    CHECK(SEGA_Config_Get(SCENARIO_KEY + (PAGE_RECORDS - 1) % 32) == PAGE_RECORDS - 1);
+    printf("SEGA_Config_Init, полная страница (%d записей): %.1f мкс на ПК\n", PAGE_RECORDS, ns / 1000);
+}
+
+int main(void) {
+    pid_t pid;
+    int status;
+
+    Flash = mmap((void *)FLASH_BASE_MAP, FLASH_MAP_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    Shared = mmap(NULL, sizeof(shared_state), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (Flash != (uint8_t *)FLASH_BASE_MAP || Shared == MAP_FAILED || !host_periph_map()) {
+        perror("mmap");
+        return 1;
+    }
+    SET_BIT(FLASH->CR, FLASH_CR_LOCK); //Как после сброса
+    setvbuf(stdout, NULL, _IONBF, 0); //Вывод процессов сценария не перемешивается
+
+    //Первыми: здесь модуль видел только стертую Flash, процессы сценариев начинают с чистого листа
+    test_power_loss();
+    pid = fork();
+    if (pid == 0) {
+        bench_wear(20000);
+    }
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    test_defaults();
+    test_roundtrip();
+    test_no_flash_during_poll();
+    bench();
+    return TEST_RESULT("test_config");
+}
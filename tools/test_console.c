@@ -0,0 +1,401 @@
+/**
+ ******************************************************************************
+ *  @file test_console.c
+ *  @brief Тест и замер SEGA_console: ответ приставке на фронты SELECT в окне чтения
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/SEGA_console.c как есть
+ *  (через host_cmsis.h, с -no-pie и -DSEGA_PROTOCOL=SEGA_PROTOCOL_CONSOLE).
+ *
+ *  Модель со временем в нс:
+ *   - приставка (игра): пишет SELECT и читает порт через заданное время -
+ *     0.52 мкс (игра без NOP, ~4 такта 68000) или 1.56 мкс (две NOP, по рекомендации SEGA);
+ *   - фронт SELECT: если TIM3 настроен на триггер TI1F_ED с запросом DMA, а канал 6 DMA1
+ *     включен на GPIOA->BSRR - DMA пишет следующее слово кольца (CMAR, CNDTR, по кругу)
+ *     через DMA_NS; если EXTI6 разрешен на этот фронт - вызывается EXTI9_5_IRQHandler,
+ *     и его запись в BSRR (если есть) выходит через ISR_NS (бюджет из SEGA_console.h);
+ *     ножка меняется еще через PIN_NS;
+ *   - TIM2: перезапуск из обработчика EXTI, через ARR + 1 тиков без перезапуска
+ *     останавливается и вызывает SEGA_Console_Timeout (как TIM2_IRQHandler);
+ *   - ПК: посылка 0xA5, младший, старший байт через USART1_IRQHandler между чтениями.
+ *
+ *  Ожидаемые ножки считает сам тест по таблице фаз из SEGA_console.h (счетчик
+ *  спадов SELECT, сброс после паузы дольше SEGA_CONSOLE_RESET_US).
+ *
+ *  Проверяется: каждое чтение 6- и 3-кнопочной игры (в том числе оставляющей
+ *  SELECT = LOW) и случайных опросов с посылками с ПК видит ножки своей фазы
+ *  при чтении и через 0.52, и через 1.56 мкс; обработчик EXTI ножки не пишет.
+ *  Замер: задержка фронт SELECT -> ножки и запас до чтения.
+ *
+ ******************************************************************************
+ */
+
+#include <string.h>
+#include "SEGA_console.h"
+#include "host_cmsis.h"
+#include "test.h"
+
+#define US              1000ULL
+#define MS              1000000ULL
+#define CYCLE_NS(n)     ((n) * 1000ULL / 72) //Такты 72 МГц в нс
+#define DMA_NS          CYCLE_NS(20) //Фронт -> BSRR через TIM3 + DMA: 10-17 тактов по SEGA_console.h, с запасом
+#define ISR_NS          CYCLE_NS(60) //Фронт -> BSRR из обработчика EXTI: 51-60 тактов по SEGA_console.h
+#define PIN_NS          25 //Фронт на ножке (10 МГц, 50 пФ)
+#define READ_FAST_NS    520 //Игра без NOP
+#define READ_NOP_NS     1560 //Две NOP после записи SELECT
+#define EDGE_GAP_NS     (2 * US) //От чтения до следующей записи SELECT
+#define FRAME_NS        16683000ULL //Кадр NTSC, игра опрашивает раз в кадр
+#define TIMEOUT_NS      (SEGA_CONSOLE_RESET_US * US)
+#define WRITES_MAX      8
+#define SCS_MAP         (SCS_BASE & ~0xFFFUL)
+
+/*Ножки PA0-PA5 = PIN1, PIN2, PIN3, PIN4, PIN6, PIN9*/
+#define PIN1 (1 << 0)
+#define PIN2 (1 << 1)
+#define PIN3 (1 << 2)
+#define PIN4 (1 << 3)
+#define PIN6 (1 << 4)
+#define PIN9 (1 << 5)
+#define PINS 0x3F
+
+/*Модель МК и линии SELECT*/
+static struct {
+    uint64_t now;
+    bool select; //Уровень SELECT (PA6)
+    uint8_t pins; //Уровни PA0-PA5
+    struct {
+        uint64_t at;
+        uint32_t bsrr;
+    } write[WRITES_MAX]; //Записи BSRR, которые еще не дошли до ножек
+    uint8_t writes;
+    uint64_t settled_at; //Когда ножки менялись последний раз
+    uint64_t timeout_at; //Остановка TIM2
+    uint32_t dma_base; //CMAR и CNDTR при включении канала (перезагрузка по кругу)
+    uint16_t dma_reload;
+    uint32_t dma_transfers;
+    uint32_t isr_writes;
+} Sim;
+
+/*Игра: счетчик спадов SELECT и время последнего фронта, как их видит приставка*/
+static struct {
+    uint16_t buttons;
+    uint8_t phase;
+    uint64_t edge_at;
+    uint64_t margin_min; //Наименьший запас от ножек до чтения после фронта
+    uint32_t reads;
+} Game;
+
+static uint32_t Random = 0x1E5A0C0D;
+
+static uint32_t random_next(void) {
+    Random ^= Random << 13;
+    Random ^= Random >> 17;
+    Random ^= Random << 5;
+    return Random;
+}
+
+/*---------------------------------- Заглушки прошивки ----------------------------------*/
+
+void CMSIS_USART1_Init(void) {
+}
+
+void EXTI9_5_IRQHandler(void);
+void USART1_IRQHandler(void);
+
+/*---------------------------------- Модель ----------------------------------*/
+
+static void sim_write(uint64_t at, uint32_t bsrr) {
+    if (Sim.writes < WRITES_MAX) {
+        Sim.write[Sim.writes].at = at;
+        Sim.write[Sim.writes].bsrr = bsrr;
+        Sim.writes++;
+    }
+}
+
+/*Запись прошивки в BSRR выходит на ножки в момент at*/
+static uint32_t sim_fw_write(uint64_t at) {
+    uint32_t bsrr = GPIOA->BSRR;
+
+    if (bsrr) {
+        sim_write(at + PIN_NS, bsrr);
+        GPIOA->BSRR = 0;
+    }
+    return bsrr;
+}
+
+/*Прошивка (пере)включила канал DMA: запомним, откуда он начинает круг*/
+static void sim_dma_armed(void) {
+    if (DMA1_Channel6->CCR & DMA_CCR_EN) {
+        Sim.dma_base = DMA1_Channel6->CMAR;
+        Sim.dma_reload = DMA1_Channel6->CNDTR;
+    }
+}
+
+static void sim_timer(void) {
+    if ((TIM2->CR1 & TIM_CR1_CEN) && TIM2->CNT == 0) {
+        Sim.timeout_at = Sim.now + (uint64_t)(TIM2->ARR + 1) * (TIM2->PSC + 1) * 1000 / 72;
+        TIM2->CNT = 1;
+    }
+}
+
+/*Время до t: записи BSRR доходят до ножек, TIM2 отсчитывает таймаут*/
+static void sim_advance(uint64_t t) {
+    for (;;) {
+        uint64_t next = t + 1;
+        int w = -1;
+
+        for (int i = 0; i < Sim.writes; i++) {
+            if (Sim.write[i].at <= t && Sim.write[i].at < next) {
+                next = Sim.write[i].at;
+                w = i;
+            }
+        }
+        if ((TIM2->CR1 & TIM_CR1_CEN) && Sim.timeout_at <= t && Sim.timeout_at < next) {
+            Sim.now = Sim.timeout_at;
+            CLEAR_BIT(TIM2->CR1, TIM_CR1_CEN);
+            SEGA_Console_Timeout(); //TIM2_IRQHandler
+            sim_fw_write(Sim.now);
+            sim_dma_armed();
+            continue;
+        }
+        if (w < 0) {
+            break;
+        }
+        Sim.now = next;
+        Sim.pins = (Sim.pins | (Sim.write[w].bsrr & PINS)) & ~(Sim.write[w].bsrr >> 16);
+        Sim.settled_at = Sim.now;
+        Sim.write[w] = Sim.write[--Sim.writes];
+    }
+    Sim.now = t;
+}
+
+/*Приставка пишет SELECT*/
+static void sim_select(bool level) {
+    uint16_t left;
+
+    if (level == Sim.select) {
+        return;
+    }
+    Sim.select = level;
+    if (level) {
+        SET_BIT(GPIOA->IDR, GPIO_IDR_IDR6);
+    }
+    else {
+        CLEAR_BIT(GPIOA->IDR, GPIO_IDR_IDR6);
+    }
+
+    //TIM3: TI1F_ED в режиме сброса, запрос DMA по триггеру -> канал 6 пишет в BSRR
+    left = DMA1_Channel6->CNDTR;
+    if (TIM3->SMCR == (TIM_SMCR_TS_2 | TIM_SMCR_SMS_2) && (TIM3->DIER & TIM_DIER_TDE)
+        && (DMA1_Channel6->CCR & DMA_CCR_EN) && (DMA1_Channel6->CCR & DMA_CCR_DIR)
+        && DMA1_Channel6->CPAR == (uint32_t)(uintptr_t)&GPIOA->BSRR && left) {
+        sim_write(Sim.now + DMA_NS + PIN_NS, ((uint32_t *)(uintptr_t)Sim.dma_base)[Sim.dma_reload - left]);
+        DMA1_Channel6->CNDTR = (left == 1) ? Sim.dma_reload : left - 1;
+        Sim.dma_transfers++;
+    }
+
+    //EXTI6
+    if ((EXTI->IMR & EXTI_IMR_MR6) && (level ? (EXTI->RTSR & EXTI_RTSR_TR6) : (EXTI->FTSR & EXTI_FTSR_TR6))) {
+        GPIOA->BSRR = 0;
+        EXTI9_5_IRQHandler();
+        EXTI->PR = 0;
+        if (sim_fw_write(Sim.now + ISR_NS)) {
+            Sim.isr_writes++;
+        }
+        sim_timer();
+    }
+}
+
+/*Посылка с ПК по USART1*/
+static void sim_usart(uint16_t buttons) {
+    uint8_t packet[3] = {SEGA_CONSOLE_SYNC, (uint8_t)buttons, (uint8_t)(buttons >> 8)};
+
+    for (int i = 0; i < 3; i++) {
+        USART1->SR = USART_SR_RXNE;
+        USART1->DR = packet[i];
+        USART1_IRQHandler();
+        sim_fw_write(Sim.now);
+    }
+    Game.buttons = buttons;
+}
+
+/*---------------------------------- Приставка ----------------------------------*/
+
+static uint8_t pin(uint16_t buttons, uint16_t button, uint8_t mask) {
+    return (buttons & button) ? mask : 0;
+}
+
+/*Ножки по таблице фаз SEGA_console.h: 1 - высокий уровень*/
+static uint8_t expect(uint16_t b, bool high, uint8_t p) {
+    uint8_t low;
+
+    if (high) {
+        if (SEGA_CONSOLE_6BUTTON && p == 3) {
+            low = pin(b, SEGA_Z_Pos, PIN1) | pin(b, SEGA_Y_Pos, PIN2) | pin(b, SEGA_X_Pos, PIN3) | pin(b, SEGA_MODE_Pos, PIN4);
+        }
+        else {
+            low = pin(b, SEGA_UP_Pos, PIN1) | pin(b, SEGA_DOWN_Pos, PIN2) | pin(b, SEGA_LEFT_Pos, PIN3) | pin(b, SEGA_RIGHT_Pos, PIN4);
+        }
+        low |= pin(b, SEGA_B_Pos, PIN6) | pin(b, SEGA_C_Pos, PIN9);
+    }
+    else {
+        if (SEGA_CONSOLE_6BUTTON && p == 3) {
+            low = PIN1 | PIN2 | PIN3 | PIN4;
+        }
+        else if (SEGA_CONSOLE_6BUTTON && p == 0) {
+            low = 0;
+        }
+        else {
+            low = pin(b, SEGA_UP_Pos, PIN1) | pin(b, SEGA_DOWN_Pos, PIN2) | PIN3 | PIN4;
+        }
+        low |= pin(b, SEGA_A_Pos, PIN6) | pin(b, SEGA_START_Pos, PIN9);
+    }
+    return ~low & PINS;
+}
+
+/*Игра пишет SELECT = level и через delay читает порт*/
+static void game_read(bool level, uint64_t delay) {
+    bool edge = (level != Sim.select);
+    uint8_t want;
+
+    if (edge) {
+        if (Sim.now - Game.edge_at >= TIMEOUT_NS) {
+            Game.phase = 0; //Геймпад сбросил фазы
+        }
+        if (!level) {
+            Game.phase = (Game.phase + 1) & 3;
+        }
+        Game.edge_at = Sim.now;
+    }
+    else if (Sim.now + delay - Game.edge_at >= TIMEOUT_NS + PIN_NS) {
+        Game.phase = 0; //Сброс успел дойти до ножек к чтению
+    }
+    sim_select(level);
+    sim_advance(Sim.now + delay);
+    want = expect(Game.buttons, level, Game.phase);
+    CHECK(Sim.pins == want);
+    if (Sim.pins != want) {
+        printf("  SELECT %d, фаза %u, чтение через %llu нс: ножки 0x%02X, нужно 0x%02X\n", level, Game.phase,
+               (unsigned long long)delay, Sim.pins, want);
+    }
+    if (edge && Sim.now - Sim.settled_at < Game.margin_min) {
+        Game.margin_min = Sim.now - Sim.settled_at;
+    }
+    Game.reads++;
+    sim_advance(Sim.now + EDGE_GAP_NS);
+}
+
+/*Опрос: чтения при уровнях SELECT по очереди, начиная с first*/
+static void game_poll(bool first, int reads, uint64_t delay) {
+    bool level = first;
+
+    for (int i = 0; i < reads; i++) {
+        game_read(level, delay);
+        level = !level;
+    }
+}
+
+static void game_frame(void) {
+    sim_advance(Sim.now + FRAME_NS);
+}
+
+/*---------------------------------- Тесты ----------------------------------*/
+
+static void test_init(void) {
+    SET_BIT(GPIOA->IDR, GPIO_IDR_IDR6); //SELECT в покое
+    Sim.select = true;
+    SEGA_Console_Init();
+    sim_fw_write(Sim.now);
+    sim_dma_armed();
+    sim_advance(Sim.now + US);
+    Game.margin_min = UINT64_MAX;
+    Game.edge_at = 0;
+
+    CHECK((GPIOA->CRL & 0x00FFFFFF) == 0x00111111);
+    CHECK(DMA1_Channel6->CCR & DMA_CCR_CIRC);
+    CHECK(Sim.dma_reload == SEGA_CONSOLE_EDGES);
+    CHECK(Sim.pins == PINS); //Ничего не нажато
+}
+
+/*6-кнопочная игра: 8 фронтов за опрос, раз в кадр*/
+static void test_6button(uint64_t delay) {
+    static const uint16_t each[] = {
+        SEGA_UP_Pos, SEGA_DOWN_Pos, SEGA_LEFT_Pos, SEGA_RIGHT_Pos, SEGA_A_Pos, SEGA_B_Pos,
+        SEGA_C_Pos, SEGA_START_Pos, SEGA_X_Pos, SEGA_Y_Pos, SEGA_Z_Pos, SEGA_MODE_Pos, 0x0FFF, 0
+    };
+
+    for (size_t i = 0; i < sizeof(each) / sizeof(each[0]); i++) {
+        sim_usart(each[i]);
+        game_frame();
+        game_poll(true, SEGA_CONSOLE_EDGES + 1, delay);
+    }
+}
+
+/*3-кнопочная игра: HIGH, затем LOW, SELECT остается LOW до следующего кадра*/
+static void test_3button(uint64_t delay) {
+    for (int i = 0; i < 64; i++) {
+        sim_usart((uint16_t)(random_next() & 0x0FFF));
+        game_frame();
+        game_poll(true, 2, delay);
+    }
+    game_frame();
+    game_poll(false, 3, delay); //Первое чтение при LOW без фронта
+}
+
+/*Случайные опросы: длина, начальный уровень, паузы короче и длиннее таймаута, посылки между чтениями*/
+static void test_random(void) {
+    for (int i = 0; i < 20000; i++) {
+        uint32_t r = random_next();
+        uint64_t gap = (r & 1) ? 50 * US + random_next() % (1200 * US) : 2 * MS + random_next() % (18 * MS);
+        uint64_t delay = (r & 2) ? READ_FAST_NS : READ_NOP_NS;
+        bool level = (r & 4) ? Sim.select : !Sim.select;
+        int reads = 1 + (int)((r >> 8) % (2 * SEGA_CONSOLE_EDGES));
+
+        sim_advance(Sim.now + gap);
+        for (int k = 0; k < reads; k++) {
+            if ((random_next() & 7) == 0) {
+                sim_usart((uint16_t)(random_next() & 0x0FFF)); //Посылка посреди опроса
+            }
+            game_read(level, delay);
+            level = !level;
+        }
+    }
+}
+
+static void test_no_isr_output(void) {
+    CHECK(Sim.isr_writes == 0); //Ножки пишет только DMA
+    CHECK(Sim.dma_transfers > 0);
+}
+
+/*---------------------------------- Замер ----------------------------------*/
+
+static void bench(void) {
+    printf("Ответ приставке (TIM3 + DMA1 канал 6): фронт SELECT -> ножки %llu нс, %u чтений\n",
+           (unsigned long long)(DMA_NS + PIN_NS), Game.reads);
+    printf("  наименьший запас до чтения: %llu нс (игра без NOP читает через %u нс, с двумя NOP - через %u нс)\n",
+           (unsigned long long)Game.margin_min, READ_FAST_NS, READ_NOP_NS);
+    printf("  для сравнения: запись из обработчика EXTI - %llu нс\n", (unsigned long long)(ISR_NS + PIN_NS));
+}
+
+int main(void) {
+    if (!host_periph_map()
+        || mmap((void *)SCS_MAP, 0x1000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0)
+           != (void *)SCS_MAP) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_init();
+    test_6button(READ_NOP_NS);
+    test_6button(READ_FAST_NS);
+    test_3button(READ_NOP_NS);
+    test_3button(READ_FAST_NS);
+    test_random();
+    test_no_isr_output();
+    bench();
+    return TEST_RESULT("test_console");
+}
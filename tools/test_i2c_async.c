@@ -0,0 +1,821 @@
+/**
+ ******************************************************************************
+ *  @file test_i2c_async.c
+ *  @brief Тест и замер асинхронного обмена I2C1 (CMSIS_I2C1_Async_*) против блокирующего
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/stm32f103xx_CMSIS.c как есть
+ *  (через host_cmsis.h, с -no-pie и -DHOST_POLL).
+ *
+ *  Модель I2C1 (ведущий, 7-битный адрес) и шины со временем в нс:
+ *  START и STOP - такт SCL, байт - 9 тактов, период SCL по CCR/FS/DUTY.
+ *  На шине EEPROM 24C32 (0x50, адрес 2 байта) и дисплей (0x3C, адрес регистра 1 байт).
+ *  Каналы DMA1 6 (I2C1_TX) и 7 (I2C1_RX), бит LAST, прерывания EV/ER/DMA по уровню.
+ *
+ *  Чтение SR1, SR2 и DR модель не видит, поэтому:
+ *   - ADDR снимается после обработчика EV, вызванного с ADDR, а в блокирующем коде -
+ *     на следующем опросе другого флага или записи в DR;
+ *   - RXNE снимается после обработчика EV с RXNE, а в блокирующем коде - на опросе
+ *     после того, в котором RXNE увидели.
+ *  Восстановление шины модель узнает по записи в GPIOB->BSRR.
+ *
+ *  Время процессора: опрос регистра в цикле - POLL_NS, прерывание (вход, обработчик,
+ *  выход) - IRQ_NS. Блокирующая функция занимает процессор все время транзакции.
+ *
+ *  Проверяется: запись и чтение с адресом памяти 0, 1 и 2 байта, 1 байт без DMA,
+ *  проверка наличия устройства, очередь и порядок Callback, NACK адреса и данных,
+ *  ошибка шины и зависший ведомый (таймаут CMSIS_I2C1_Async_Poll) с восстановлением,
+ *  блокирующие CMSIS_I2C_MemWrite/MemRead на той же модели.
+ *  Замер на 100 и 400 кГц: время процессора на транзакцию, прерывания, время на ПК.
+ *
+ ******************************************************************************
+ */
+
+#include <string.h>
+#include <time.h>
+#include "host_cmsis.h"
+#include "test.h"
+
+#define DR_EMPTY      0x100 //В DR нет байта (прошивка пишет только 8 бит)
+#define POLL_NS       100 //Опрос регистра APB1 в цикле, ~7 тактов на 72 МГц
+#define IRQ_NS        1000 //Вход, обработчик и выход, ~70 тактов на 72 МГц
+#define MAIN_LOOP_NS  100000 //Как часто главный цикл зовет CMSIS_I2C1_Async_Poll
+#define FOREVER       UINT64_MAX
+#define EEPROM_ADRESS 0x50
+#define LCD_ADRESS    0x3C
+#define I2C_SR1_ERRORS (I2C_SR1_AF | I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_OVR)
+
+/*Обработчики прерываний из stm32f103xx_CMSIS.c (в заголовке их нет)*/
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
+void DMA1_Channel7_IRQHandler(void);
+
+/*Ведомый с памятью: первые addr_bytes байт записи - адрес, дальше данные*/
+typedef struct {
+    uint8_t address;
+    uint8_t addr_bytes;
+    uint16_t size; //Степень двойки
+    uint8_t mem[4096];
+    uint16_t ptr;
+    uint8_t addr_left;
+    bool nack_data; //Не подтверждать байты данных (защита от записи)
+} slave_model;
+
+static slave_model Eeprom = { .address = EEPROM_ADRESS, .addr_bytes = 2, .size = 4096 };
+static slave_model Lcd = { .address = LCD_ADRESS, .addr_bytes = 1, .size = 256 };
+
+/*Что сейчас делает ведущий*/
+enum { PHASE_IDLE, PHASE_START, PHASE_ADDR, PHASE_ADDR_ACK, PHASE_TX, PHASE_RX, PHASE_HALT };
+
+/*Модель I2C1 и шины*/
+static struct {
+    uint64_t now; //нс
+    uint32_t events; //SB, ADDR, BTF, TXE, RXNE - выставляет железо
+    uint32_t errors; //AF, BERR, ARLO, OVR - сбрасываются записью 0
+    uint32_t sr1; //Что записано в SR1 в последний раз
+    uint8_t phase;
+    bool busy;
+    bool tra; //Ведущий передает
+    slave_model *slave;
+    uint64_t start_at; //START/STOP будет сформирован в это время
+    uint64_t stop_at;
+    bool shifting; //Байт в сдвиговом регистре
+    uint64_t shift_at; //Байт закончится в это время (FOREVER - ведомый держит SCL)
+    uint8_t shift_byte;
+    bool tx_full; //Байт в DR на передачу
+    uint8_t tx_byte;
+    bool rx_full; //Принятый байт в DR
+    bool rx_on; //Последний байт получил ACK, прием продолжается
+    bool rx_held; //Принятый байт ждет в сдвиговом регистре (BTF)
+    uint8_t rx_byte;
+    bool stall_next; //Ведомый зависнет на следующем байте данных
+    bool berr_next; //Ошибка шины на следующем байте данных
+    bool addr_seen; //Блокирующий код увидел ADDR
+    bool rxne_seen; //Блокирующий код увидел RXNE
+    const uint8_t *dma6;
+    uint8_t *dma7;
+    bool dma6_on;
+    bool dma7_on;
+    bool gpio; //SCL в режиме GPIO (восстановление шины)
+    uint32_t recoveries;
+    uint32_t irq_recoveries; //Восстановлений внутри обработчика прерывания
+    bool in_irq;
+    uint64_t irq_max_ns; //Самый долгий обработчик по модели (ожидания в нем)
+    uint64_t cpu_ns; //Время процессора по модели
+    uint32_t irqs;
+    uint64_t irq_host_ns; //Время в обработчиках на ПК
+} Bus;
+
+/*Транзакции теста*/
+static struct I2C_Transaction_name Tr[I2C_ASYNC_QUEUE + 1];
+static uint8_t Data[I2C_ASYNC_QUEUE + 1][256]; //Статические: адрес помещается в CMAR
+static struct I2C_Transaction_name *Done[64]; //Порядок вызова Callback
+static uint32_t Done_count;
+static uint64_t Done_at; //Время последнего Callback
+
+static double host_ns(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void transaction_done(struct I2C_Transaction_name *transaction) {
+    if (Done_count < sizeof(Done) / sizeof(Done[0])) {
+        Done[Done_count++] = transaction;
+    }
+    Done_at = Bus.now;
+}
+
+/*---------------------------------- Ведомые ----------------------------------*/
+
+static slave_model *slave_find(uint8_t address) {
+    if (address == Eeprom.address) {
+        return &Eeprom;
+    }
+    if (address == Lcd.address) {
+        return &Lcd;
+    }
+    return NULL;
+}
+
+static bool slave_write(slave_model *s, uint8_t byte) {
+    if (s->addr_left) {
+        s->ptr = (uint16_t)(((s->ptr << 8) | byte) & (s->size - 1));
+        s->addr_left--;
+        return true;
+    }
+    if (s->nack_data) {
+        return false;
+    }
+    s->mem[s->ptr] = byte;
+    s->ptr = (s->ptr + 1) & (s->size - 1);
+    return true;
+}
+
+static uint8_t slave_read(slave_model *s) {
+    uint8_t byte = s->mem[s->ptr];
+
+    s->ptr = (s->ptr + 1) & (s->size - 1);
+    return byte;
+}
+
+/*---------------------------------- Модель I2C1 ----------------------------------*/
+
+/*Период SCL по CCR: Sm - 2 * CCR, Fm - 3 * CCR (DUTY 0) или 25 * CCR тактов PCLK1 36 МГц*/
+static uint64_t scl_ns(void) {
+    uint32_t ccr = I2C1->CCR & I2C_CCR_CCR;
+    uint32_t k = !(I2C1->CCR & I2C_CCR_FS) ? 2 : (I2C1->CCR & I2C_CCR_DUTY) ? 25 : 3;
+
+    return (uint64_t)k * ccr * 1000 / 36;
+}
+
+/*Счетчик микросекунд TIM4 + TIM1 (CMSIS_Micros, CMSIS_Millis) по времени модели*/
+static void timebase_update(void) {
+    uint32_t us = (uint32_t)(Bus.now / 1000);
+
+    if (!(us & 0xFFFF)) {
+        us++; //CMSIS_Micros перечитывает при младших 16 битах = 0
+    }
+    TIM4->CNT = us & 0xFFFF;
+    TIM1->CNT = us >> 16;
+}
+
+/*Сброс блока и шины: SWRST в CMSIS_I2C1_Bus_Recover*/
+static void bus_reset(void) {
+    Bus.events = Bus.errors = Bus.sr1 = 0;
+    Bus.phase = PHASE_IDLE;
+    Bus.busy = Bus.tra = false;
+    Bus.slave = NULL;
+    Bus.start_at = Bus.stop_at = FOREVER;
+    Bus.shifting = Bus.tx_full = Bus.rx_full = Bus.rx_on = Bus.rx_held = false;
+    Bus.stall_next = Bus.berr_next = false;
+    Bus.addr_seen = Bus.rxne_seen = false;
+    CLEAR_BIT(I2C1->CR1, I2C_CR1_START | I2C_CR1_STOP | I2C_CR1_ACK | I2C_CR1_POS);
+    I2C1->DR = DR_EMPTY;
+}
+
+/*ADDR снят: дальше передача или прием данных*/
+static void addr_clear(void) {
+    if (Bus.phase != PHASE_ADDR_ACK) {
+        return;
+    }
+    Bus.events &= ~I2C_SR1_ADDR;
+    Bus.addr_seen = false;
+    Bus.phase = Bus.tra ? PHASE_TX : PHASE_RX;
+    Bus.rx_on = !Bus.tra;
+}
+
+/*Принятый байт забрали из DR*/
+static void rx_consume(void) {
+    if (!Bus.rx_full) {
+        return;
+    }
+    Bus.rx_full = false;
+    Bus.events &= ~I2C_SR1_RXNE;
+    I2C1->DR = DR_EMPTY;
+    if (Bus.rx_held) {
+        Bus.rx_held = false;
+        Bus.events &= ~I2C_SR1_BTF;
+        Bus.rx_full = true;
+        Bus.events |= I2C_SR1_RXNE;
+        I2C1->DR = Bus.rx_byte;
+    }
+}
+
+static void shift_start(uint8_t byte, uint32_t bits) {
+    Bus.shifting = true;
+    Bus.shift_byte = byte;
+    Bus.shift_at = Bus.now + bits * scl_ns();
+}
+
+/*Данные пошли: ведомый может зависнуть или шина сломаться на этом байте*/
+static void shift_data(uint8_t byte) {
+    shift_start(byte, 9);
+    if (Bus.stall_next) {
+        Bus.stall_next = false;
+        Bus.shift_at = FOREVER;
+    }
+}
+
+/*Все, что следует из регистров прямо сейчас: записи прошивки, DMA, START/STOP, следующий байт*/
+static void bus_sync(void) {
+    uint32_t cr1, cr2;
+
+    //Флаги DMA сбрасываются записью в IFCR, CGIF - все флаги канала
+    for (uint32_t ch = 0; ch < 28; ch += 4) {
+        if (DMA1->IFCR & (DMA_IFCR_CGIF1 << ch)) {
+            DMA1->IFCR |= 0xF << ch;
+        }
+    }
+    DMA1->ISR &= ~DMA1->IFCR;
+    DMA1->IFCR = 0;
+
+    //CMSIS_I2C1_Bus_Recover: ножки в режим GPIO, 9 тактов SCL, STOP, SWRST.
+    //Одно восстановление - одно переключение SCL в режим GPIO
+    if (GPIOB->BSRR) {
+        GPIOB->BSRR = 0;
+        if (!Bus.gpio) {
+            Bus.recoveries++;
+            Bus.irq_recoveries += Bus.in_irq;
+            bus_reset();
+        }
+    }
+    Bus.gpio = ((GPIOB->CRL & GPIO_CRL_CNF6_Msk) >> GPIO_CRL_CNF6_Pos) == 0b01;
+
+    //Ошибки сбрасываются записью 0
+    Bus.errors &= ~(Bus.sr1 & ~I2C1->SR1);
+
+    //Канал DMA включили: адрес памяти защелкивается
+    if ((DMA1_Channel6->CCR & DMA_CCR_EN) && !Bus.dma6_on) {
+        Bus.dma6 = (const uint8_t *)(uintptr_t)DMA1_Channel6->CMAR;
+    }
+    Bus.dma6_on = DMA1_Channel6->CCR & DMA_CCR_EN;
+    if ((DMA1_Channel7->CCR & DMA_CCR_EN) && !Bus.dma7_on) {
+        Bus.dma7 = (uint8_t *)(uintptr_t)DMA1_Channel7->CMAR;
+    }
+    Bus.dma7_on = DMA1_Channel7->CCR & DMA_CCR_EN;
+    cr2 = I2C1->CR2;
+
+    //Запись в DR
+    if (!Bus.rx_full && I2C1->DR != DR_EMPTY) {
+        uint8_t byte = (uint8_t)I2C1->DR;
+
+        I2C1->DR = DR_EMPTY;
+        if (Bus.events & I2C_SR1_SB) {
+            Bus.events &= ~I2C_SR1_SB;
+            Bus.phase = PHASE_ADDR;
+            shift_start(byte, 9);
+        }
+        else {
+            addr_clear(); //Блокирующий код прочитал SR1 и SR2 до записи
+            if (Bus.phase == PHASE_TX) {
+                Bus.tx_full = true;
+                Bus.tx_byte = byte;
+                Bus.events &= ~(I2C_SR1_TXE | I2C_SR1_BTF);
+            }
+        }
+    }
+
+    if (Bus.phase == PHASE_TX && Bus.start_at == FOREVER && Bus.stop_at == FOREVER) {
+        //DMA пишет в DR, пока TXE
+        if (!Bus.tx_full && (cr2 & I2C_CR2_DMAEN) && Bus.dma6_on && DMA1_Channel6->CNDTR) {
+            Bus.tx_full = true;
+            Bus.tx_byte = *Bus.dma6++;
+            Bus.events &= ~I2C_SR1_BTF;
+            if (--DMA1_Channel6->CNDTR == 0) {
+                DMA1->ISR |= DMA_ISR_TCIF6 | DMA_ISR_GIF6;
+            }
+        }
+        if (Bus.tx_full && !Bus.shifting) {
+            Bus.tx_full = false;
+            shift_data(Bus.tx_byte);
+        }
+        if (!Bus.tx_full) {
+            Bus.events |= I2C_SR1_TXE;
+        }
+        //DR снова пуст: DMA кладет следующий байт сразу
+        if (!Bus.tx_full && (cr2 & I2C_CR2_DMAEN) && Bus.dma6_on && DMA1_Channel6->CNDTR) {
+            Bus.tx_full = true;
+            Bus.tx_byte = *Bus.dma6++;
+            Bus.events &= ~I2C_SR1_TXE;
+            if (--DMA1_Channel6->CNDTR == 0) {
+                DMA1->ISR |= DMA_ISR_TCIF6 | DMA_ISR_GIF6;
+            }
+        }
+    }
+    if (Bus.phase == PHASE_RX) {
+        //DMA забирает принятый байт
+        if (Bus.rx_full && (cr2 & I2C_CR2_DMAEN) && Bus.dma7_on && DMA1_Channel7->CNDTR) {
+            *Bus.dma7++ = (uint8_t)I2C1->DR;
+            rx_consume();
+            if (--DMA1_Channel7->CNDTR == 0) {
+                DMA1->ISR |= DMA_ISR_TCIF7 | DMA_ISR_GIF7;
+            }
+        }
+        if (Bus.rx_on && !Bus.shifting && !Bus.rx_held && Bus.start_at == FOREVER) {
+            shift_data(0);
+        }
+    }
+
+    cr1 = I2C1->CR1;
+    if ((cr1 & I2C_CR1_START) && Bus.start_at == FOREVER && Bus.stop_at == FOREVER && !Bus.shifting && !Bus.tx_full) {
+        Bus.start_at = Bus.now + scl_ns(); //Повторный START - после текущего байта
+    }
+    if ((cr1 & I2C_CR1_STOP) && Bus.stop_at == FOREVER) {
+        if (!Bus.busy) {
+            CLEAR_BIT(I2C1->CR1, I2C_CR1_STOP);
+        }
+        else if (!Bus.shifting && Bus.start_at == FOREVER) {
+            Bus.stop_at = Bus.now + scl_ns(); //STOP - после текущего байта
+        }
+    }
+
+    Bus.sr1 = Bus.events | Bus.errors;
+    I2C1->SR1 = Bus.sr1;
+    I2C1->SR2 = (Bus.busy ? I2C_SR2_BUSY | I2C_SR2_MSL : 0) | (Bus.busy && Bus.tra ? I2C_SR2_TRA : 0);
+}
+
+/*Событие шины в момент Bus.now*/
+static void bus_event(void) {
+    uint32_t cr2 = I2C1->CR2;
+
+    if (Bus.start_at <= Bus.now) {
+        Bus.start_at = FOREVER;
+        CLEAR_BIT(I2C1->CR1, I2C_CR1_START);
+        Bus.events = I2C_SR1_SB;
+        Bus.busy = true;
+        Bus.phase = PHASE_START;
+        Bus.tx_full = Bus.rx_on = Bus.rx_held = false;
+    }
+    else if (Bus.stop_at <= Bus.now) {
+        Bus.stop_at = FOREVER;
+        CLEAR_BIT(I2C1->CR1, I2C_CR1_STOP);
+        Bus.events &= I2C_SR1_RXNE; //Непрочитанный байт остается в DR
+        Bus.tx_full = false; //Неотправленный после NACK - нет
+        Bus.busy = Bus.tra = false;
+        Bus.phase = PHASE_IDLE;
+        Bus.slave = NULL;
+        Bus.addr_seen = false;
+    }
+    else if (Bus.shifting && Bus.shift_at <= Bus.now) {
+        Bus.shifting = false;
+        if (Bus.phase == PHASE_ADDR) {
+            Bus.slave = slave_find(Bus.shift_byte >> 1);
+            if (Bus.slave) {
+                Bus.tra = !(Bus.shift_byte & 1);
+                Bus.slave->addr_left = Bus.tra ? Bus.slave->addr_bytes : 0;
+                Bus.events |= I2C_SR1_ADDR;
+                Bus.phase = PHASE_ADDR_ACK;
+            }
+            else {
+                Bus.errors |= I2C_SR1_AF;
+                Bus.phase = PHASE_HALT;
+            }
+        }
+        else if (Bus.berr_next) {
+            Bus.berr_next = false;
+            Bus.errors |= I2C_SR1_BERR;
+            Bus.phase = PHASE_HALT;
+        }
+        else if (Bus.phase == PHASE_TX) {
+            if (!slave_write(Bus.slave, Bus.shift_byte)) {
+                Bus.errors |= I2C_SR1_AF;
+                Bus.phase = PHASE_HALT;
+            }
+            else if (!Bus.tx_full) {
+                Bus.events |= I2C_SR1_BTF;
+            }
+        }
+        else if (Bus.phase == PHASE_RX) {
+            uint8_t byte = slave_read(Bus.slave);
+            bool last = (cr2 & I2C_CR2_DMAEN) && (cr2 & I2C_CR2_LAST) && Bus.dma7_on && DMA1_Channel7->CNDTR == 1;
+
+            //ACK на 9-м такте: бит ACK и LAST для последнего байта DMA
+            Bus.rx_on = (I2C1->CR1 & I2C_CR1_ACK) && !last;
+            if (!Bus.rx_full) {
+                Bus.rx_full = true;
+                Bus.events |= I2C_SR1_RXNE;
+                I2C1->DR = byte;
+            }
+            else {
+                Bus.rx_held = true;
+                Bus.rx_byte = byte;
+                Bus.events |= I2C_SR1_BTF;
+            }
+        }
+    }
+    bus_sync();
+}
+
+/*Время модели идет до t*/
+static void bus_advance(uint64_t t) {
+    for (;;) {
+        uint64_t next = Bus.start_at < Bus.stop_at ? Bus.start_at : Bus.stop_at;
+
+        if (Bus.shifting && Bus.shift_at < next) {
+            next = Bus.shift_at;
+        }
+        if (next > t) {
+            break;
+        }
+        Bus.now = next;
+        bus_event();
+    }
+    Bus.now = t;
+    timebase_update();
+}
+
+/*Опрос регистра в цикле ожидания прошивки (host_cmsis.h)*/
+void host_poll(const volatile void *reg, uint32_t bit) {
+    if (reg == &I2C1->SR1 && Bus.addr_seen && !(bit & (I2C_SR1_ADDR | I2C_SR1_AF))) {
+        addr_clear(); //Между опросами прочитаны SR1 и SR2
+    }
+    if (Bus.rxne_seen) {
+        Bus.rxne_seen = false;
+        rx_consume(); //Между опросами прочитан DR
+    }
+    bus_sync();
+    Bus.cpu_ns += POLL_NS;
+    bus_advance(Bus.now + POLL_NS);
+    if (reg == &I2C1->SR1) {
+        Bus.addr_seen |= (bit & I2C_SR1_ADDR) && (Bus.events & I2C_SR1_ADDR);
+        Bus.rxne_seen = (bit & I2C_SR1_RXNE) && (Bus.events & I2C_SR1_RXNE);
+    }
+}
+
+/*Вызов обработчика, как NVIC, и время процессора на него*/
+static void call_irq(void (*IRQHandler)(void)) {
+    uint32_t events = Bus.events;
+    uint64_t now = Bus.now;
+    double t0 = host_ns();
+
+    Bus.in_irq = true;
+    IRQHandler();
+    Bus.irq_host_ns += (uint64_t)(host_ns() - t0);
+    if (Bus.now - now > Bus.irq_max_ns) {
+        Bus.irq_max_ns = Bus.now - now;
+    }
+    Bus.irqs++;
+    if (IRQHandler == I2C1_EV_IRQHandler) {
+        if (events & I2C_SR1_ADDR) {
+            addr_clear(); //Обработчик читает SR2 на каждом ADDR
+        }
+        if (events & I2C_SR1_RXNE) {
+            rx_consume(); //Прием одного байта: обработчик читает DR
+        }
+    }
+    bus_sync();
+    Bus.in_irq = false;
+    Bus.cpu_ns += IRQ_NS;
+    bus_advance(Bus.now + IRQ_NS);
+}
+
+/*Запрос прерывания по уровню флагов. retval true - обработчик вызван*/
+static bool bus_irq(void) {
+    uint32_t cr2 = I2C1->CR2;
+
+    if ((cr2 & I2C_CR2_ITERREN) && Bus.errors) {
+        call_irq(I2C1_ER_IRQHandler);
+        return true;
+    }
+    if ((cr2 & I2C_CR2_ITEVTEN) && ((Bus.events & (I2C_SR1_SB | I2C_SR1_ADDR | I2C_SR1_BTF))
+                                    || ((cr2 & I2C_CR2_ITBUFEN) && (Bus.events & (I2C_SR1_TXE | I2C_SR1_RXNE))))) {
+        call_irq(I2C1_EV_IRQHandler);
+        return true;
+    }
+    if (((DMA1_Channel7->CCR & DMA_CCR_TCIE) && (DMA1->ISR & DMA_ISR_TCIF7))
+        || ((DMA1_Channel7->CCR & DMA_CCR_TEIE) && (DMA1->ISR & DMA_ISR_TEIF7))) {
+        call_irq(DMA1_Channel7_IRQHandler);
+        return true;
+    }
+    return false;
+}
+
+/*Прерывания и шина, пока очередь не опустеет (или limit нс). poll - главный цикл зовет Poll*/
+static void bus_run(uint64_t limit, bool poll) {
+    uint64_t end = Bus.now + limit;
+    uint64_t next_poll = Bus.now + MAIN_LOOP_NS;
+
+    while (Bus.now < end) {
+        uint64_t next;
+
+        bus_sync();
+        if (bus_irq()) {
+            continue;
+        }
+        if (!CMSIS_I2C1_Async_Busy() && !Bus.busy) {
+            return;
+        }
+        next = Bus.start_at < Bus.stop_at ? Bus.start_at : Bus.stop_at;
+        if (Bus.shifting && Bus.shift_at < next) {
+            next = Bus.shift_at;
+        }
+        if (poll && next_poll < next) {
+            next = next_poll;
+        }
+        if (next > end) {
+            next = end;
+        }
+        bus_advance(next);
+        if (poll && Bus.now >= next_poll) {
+            next_poll = Bus.now + MAIN_LOOP_NS;
+            CMSIS_I2C1_Async_Poll();
+        }
+    }
+}
+
+/*---------------------------------- Тесты ----------------------------------*/
+
+static struct I2C_Transaction_name *transaction(uint8_t n, uint8_t device, uint16_t adress, uint8_t size_adress,
+                                                bool read, uint16_t size) {
+    struct I2C_Transaction_name *t = &Tr[n];
+
+    *t = (struct I2C_Transaction_name) { .Adress_Device = device, .Adress_data = adress, .Size_adress = size_adress,
+                                         .Read = read, .data = Data[n], .Size_data = size,
+                                         .Callback = transaction_done };
+    return t;
+}
+
+static void fill(uint8_t n, uint16_t size, uint8_t seed) {
+    for (uint16_t i = 0; i < size; i++) {
+        Data[n][i] = (uint8_t)(seed + i * 7);
+    }
+}
+
+/*Одна транзакция от постановки до Callback. retval Status*/
+static uint8_t run_one(struct I2C_Transaction_name *t) {
+    Done_count = 0;
+    CHECK(CMSIS_I2C1_Async_Submit(t));
+    bus_run(100000000, true);
+    CHECK(Done_count == 1 && Done[0] == t);
+    CHECK(!CMSIS_I2C1_Async_Busy());
+    CHECK(!Bus.busy);
+    return t->Status;
+}
+
+static void test_init(void) {
+    bus_reset();
+    CMSIS_I2C1_Async_Init();
+    I2C1->CCR = 180; //Sm 100 кГц (CMSIS_I2C1_Init ставит 30 без FS: 600 кГц)
+    CHECK(DMA1_Channel6->CPAR == (uint32_t)(uintptr_t)&I2C1->DR);
+    CHECK(DMA1_Channel7->CPAR == (uint32_t)(uintptr_t)&I2C1->DR);
+    CHECK((DMA1_Channel6->CCR & (DMA_CCR_DIR | DMA_CCR_MINC)) == (DMA_CCR_DIR | DMA_CCR_MINC));
+    CHECK((DMA1_Channel7->CCR & (DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_TCIE)) == (DMA_CCR_MINC | DMA_CCR_TCIE));
+    CHECK(I2C1->CR2 & I2C_CR2_ITERREN);
+    CHECK(!(I2C1->CR2 & I2C_CR2_ITEVTEN)); //Нет транзакций - нет прерываний событий
+    CHECK(scl_ns() == 10000);
+}
+
+/*EEPROM: запись и чтение с 2-байтным адресом, 1, 2 и 255 байт*/
+static void test_eeprom(void) {
+    static const uint16_t size[] = {1, 2, 3, 16, 255};
+
+    for (size_t i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        uint16_t adress = (uint16_t)(0x0123 + i * 0x101);
+
+        fill(0, size[i], (uint8_t)i);
+        CHECK(run_one(transaction(0, EEPROM_ADRESS, adress, 2, false, size[i])) == I2C_ASYNC_OK);
+        CHECK(memcmp(Eeprom.mem + adress, Data[0], size[i]) == 0);
+        memset(Data[1], 0, sizeof(Data[1]));
+        CHECK(run_one(transaction(1, EEPROM_ADRESS, adress, 2, true, size[i])) == I2C_ASYNC_OK);
+        CHECK(memcmp(Data[1], Data[0], size[i]) == 0);
+        CHECK(Data[1][size[i]] == 0); //Лишнего не принято
+    }
+}
+
+/*Дисплей: адрес регистра 1 байт; без адреса памяти - сырые байты*/
+static void test_lcd(void) {
+    fill(0, 8, 0x40);
+    CHECK(run_one(transaction(0, LCD_ADRESS, 0x10, 1, false, 8)) == I2C_ASYNC_OK);
+    CHECK(memcmp(Lcd.mem + 0x10, Data[0], 8) == 0);
+
+    Data[0][0] = 0x20; //Первый байт - адрес регистра
+    Data[0][1] = 0xAA;
+    CHECK(run_one(transaction(0, LCD_ADRESS, 0, 0, false, 2)) == I2C_ASYNC_OK);
+    CHECK(Lcd.mem[0x20] == 0xAA);
+
+    CHECK(run_one(transaction(1, LCD_ADRESS, 0x10, 1, true, 1)) == I2C_ASYNC_OK);
+    CHECK(Data[1][0] == Lcd.mem[0x10]);
+    CHECK(run_one(transaction(1, LCD_ADRESS, 0, 0, true, 7)) == I2C_ASYNC_OK); //С текущего адреса
+    CHECK(memcmp(Data[1], Lcd.mem + 0x11, 7) == 0);
+    CHECK(run_one(transaction(1, LCD_ADRESS, 0, 0, true, 1)) == I2C_ASYNC_OK);
+    CHECK(Data[1][0] == Lcd.mem[0x18]);
+}
+
+/*Проверка наличия устройства: только адрес*/
+static void test_probe(void) {
+    CHECK(run_one(transaction(0, EEPROM_ADRESS, 0, 0, false, 0)) == I2C_ASYNC_OK);
+    CHECK(run_one(transaction(0, 0x51, 0, 0, false, 0)) == I2C_ASYNC_NACK);
+    CHECK(run_one(transaction(0, 0x51, 0, 2, true, 4)) == I2C_ASYNC_NACK);
+    CHECK(run_one(transaction(0, LCD_ADRESS, 0, 0, false, 0)) == I2C_ASYNC_OK);
+}
+
+/*Очередь: I2C_ASYNC_QUEUE транзакций, Callback по порядку, лишняя не принимается*/
+static void test_queue(void) {
+    Done_count = 0;
+    for (uint8_t n = 0; n < I2C_ASYNC_QUEUE; n++) {
+        fill(n, 4 + n, n);
+        CHECK(CMSIS_I2C1_Async_Submit(transaction(n, (n & 1) ? LCD_ADRESS : EEPROM_ADRESS, 0x20 * n, (n & 1) ? 1 : 2,
+                                                  n >= I2C_ASYNC_QUEUE / 2, 4 + n)));
+    }
+    CHECK(!CMSIS_I2C1_Async_Submit(transaction(I2C_ASYNC_QUEUE, EEPROM_ADRESS, 0, 2, false, 1)));
+    bus_run(100000000, true);
+    CHECK(Done_count == I2C_ASYNC_QUEUE);
+    for (uint8_t n = 0; n < I2C_ASYNC_QUEUE && n < Done_count; n++) {
+        slave_model *s = (n & 1) ? &Lcd : &Eeprom;
+
+        CHECK(Done[n] == &Tr[n]);
+        CHECK(Tr[n].Status == I2C_ASYNC_OK);
+        if (n < I2C_ASYNC_QUEUE / 2) {
+            CHECK(memcmp(s->mem + 0x20 * n, Data[n], 4 + n) == 0);
+        }
+        else {
+            CHECK(memcmp(Data[n], s->mem + 0x20 * n, 4 + n) == 0);
+        }
+    }
+    CHECK(!(I2C1->CR2 & I2C_CR2_ITEVTEN));
+}
+
+/*NACK на данных (защита от записи): STOP, Status NACK, шина свободна*/
+static void test_nack_data(void) {
+    uint32_t recoveries = Bus.recoveries;
+
+    Eeprom.nack_data = true;
+    fill(0, 16, 1);
+    CHECK(run_one(transaction(0, EEPROM_ADRESS, 0x200, 2, false, 16)) == I2C_ASYNC_NACK);
+    Eeprom.nack_data = false;
+    CHECK(Bus.recoveries == recoveries); //Для NACK восстановление не нужно
+    CHECK(run_one(transaction(0, EEPROM_ADRESS, 0x200, 2, false, 16)) == I2C_ASYNC_OK);
+}
+
+/*Ошибка шины посреди данных: восстановление, следующая транзакция проходит*/
+static void test_bus_error(void) {
+    uint32_t recoveries = Bus.recoveries;
+
+    transaction(0, EEPROM_ADRESS, 0x300, 2, true, 32);
+    transaction(1, EEPROM_ADRESS, 0x300, 2, true, 32);
+    Bus.berr_next = true;
+    Done_count = 0;
+    CHECK(CMSIS_I2C1_Async_Submit(&Tr[0]));
+    CHECK(CMSIS_I2C1_Async_Submit(&Tr[1]));
+    bus_run(100000000, true);
+    CHECK(Done_count == 2);
+    CHECK(Tr[0].Status == I2C_ASYNC_ERROR);
+    CHECK(Tr[1].Status == I2C_ASYNC_OK);
+    CHECK(memcmp(Data[1], Eeprom.mem + 0x300, 32) == 0);
+    CHECK(Bus.recoveries == recoveries + 1);
+}
+
+/*Ведомый держит SCL: таймаут в CMSIS_I2C1_Async_Poll, восстановление*/
+static void test_timeout(void) {
+    uint32_t recoveries = Bus.recoveries;
+    uint64_t t0 = Bus.now;
+
+    Bus.stall_next = true;
+    CHECK(run_one(transaction(0, EEPROM_ADRESS, 0x400, 2, false, 8)) == I2C_ASYNC_ERROR);
+    CHECK(Done_at - t0 > I2C_ASYNC_TIMEOUT_MS * 1000000ULL);
+    CHECK(Done_at - t0 < (I2C_ASYNC_TIMEOUT_MS + 2) * 1000000ULL);
+    CHECK(Bus.recoveries == recoveries + 1);
+    fill(0, 8, 9);
+    CHECK(run_one(transaction(0, EEPROM_ADRESS, 0x400, 2, false, 8)) == I2C_ASYNC_OK);
+    CHECK(memcmp(Eeprom.mem + 0x400, Data[0], 8) == 0);
+}
+
+/*Обработчики не ждут: ни STOP предыдущей транзакции, ни восстановления шины (его делает Poll)*/
+static void test_irq_no_wait(void) {
+    CHECK(Bus.recoveries >= 2);
+    CHECK(Bus.irq_recoveries == 0);
+    CHECK(Bus.irq_max_ns <= 10 * POLL_NS);
+}
+
+/*Submit из кода с запрещенными прерываниями не разрешает их*/
+static void test_primask(void) {
+    Host_primask = 1;
+    fill(0, 4, 5);
+    CHECK(CMSIS_I2C1_Async_Submit(transaction(0, EEPROM_ADRESS, 0x480, 2, false, 4)));
+    CHECK(Host_primask == 1);
+    Host_primask = 0;
+    bus_run(100000000, true);
+    CHECK(Tr[0].Status == I2C_ASYNC_OK);
+}
+
+/*Блокирующие функции на той же модели (проверка самой модели)*/
+static void test_polled(void) {
+    uint8_t out[16], in[16];
+
+    for (uint8_t i = 0; i < sizeof(out); i++) {
+        out[i] = (uint8_t)(0xC0 + i);
+    }
+    CHECK(CMSIS_I2C_MemWrite(I2C1, EEPROM_ADRESS, 0x500, 2, out, sizeof(out), 10));
+    bus_run(1000000, false);
+    CHECK(memcmp(Eeprom.mem + 0x500, out, sizeof(out)) == 0);
+    for (uint16_t size = 1; size <= sizeof(in); size *= 2) {
+        memset(in, 0, sizeof(in));
+        CHECK(CMSIS_I2C_MemRead(I2C1, EEPROM_ADRESS, 0x500, 2, in, size, 10));
+        bus_run(1000000, false);
+        CHECK(memcmp(in, out, size) == 0);
+    }
+    CHECK(!CMSIS_I2C_MemRead(I2C1, 0x51, 0x500, 2, in, 1, 10)); //Нет устройства
+    bus_run(1000000, false);
+    CHECK(!Bus.busy);
+    I2C1->SR1 = 0; //Ошибки после блокирующих функций
+    bus_sync();
+}
+
+/*Замер одной транзакции: блокирующая функция против очереди*/
+static void bench_one(const char *name, bool read, uint16_t size) {
+    uint64_t t0, cpu0, polled_ns, bus_ns, async_cpu_ns;
+    uint32_t irqs0, irqs;
+    uint64_t host0;
+    bool ok;
+
+    fill(0, size, 3);
+    t0 = Bus.now;
+    ok = read ? CMSIS_I2C_MemRead(I2C1, EEPROM_ADRESS, 0x600, 2, Data[1], size, 10)
+              : CMSIS_I2C_MemWrite(I2C1, EEPROM_ADRESS, 0x600, 2, Data[0], size, 10);
+    polled_ns = Bus.now - t0;
+    CHECK(ok);
+    bus_run(1000000, false);
+    I2C1->SR1 = 0;
+    bus_sync();
+
+    cpu0 = Bus.cpu_ns;
+    irqs0 = Bus.irqs;
+    host0 = Bus.irq_host_ns;
+    t0 = Bus.now;
+    Done_count = 0;
+    CHECK(CMSIS_I2C1_Async_Submit(transaction(0, EEPROM_ADRESS, 0x600, 2, read, size)));
+    Bus.cpu_ns += IRQ_NS; //Сам вызов Submit
+    bus_run(100000000, false);
+    CHECK(Done_count == 1 && Tr[0].Status == I2C_ASYNC_OK);
+    bus_ns = Done_at - t0;
+    async_cpu_ns = Bus.cpu_ns - cpu0;
+    irqs = Bus.irqs - irqs0;
+    printf("  %-20s шина %6.1f мкс | блокирующая: процессор %6.1f мкс | очередь: %2u прерываний, процессор %4.1f мкс (%4.1f%%), на ПК %3.0f нс/прерывание\n",
+           name, bus_ns / 1e3, polled_ns / 1e3, irqs, async_cpu_ns / 1e3, 100.0 * async_cpu_ns / polled_ns,
+           (double)(Bus.irq_host_ns - host0) / irqs);
+}
+
+static void bench(void) {
+    static const struct {
+        uint32_t ccr;
+        const char *name;
+    } speed[] = {{180, "100 кГц"}, {I2C_CCR_FS | 30, "400 кГц"}};
+
+    for (size_t i = 0; i < sizeof(speed) / sizeof(speed[0]); i++) {
+        I2C1->CCR = speed[i].ccr;
+        printf("I2C1 %s, EEPROM с 2-байтным адресом (опрос %u нс, прерывание %u нс процессора):\n",
+               speed[i].name, POLL_NS, IRQ_NS);
+        bench_one("чтение 1 байта", true, 1);
+        bench_one("чтение 16 байт", true, 16);
+        bench_one("чтение 64 байт", true, 64);
+        bench_one("запись 16 байт", false, 16);
+    }
+    I2C1->CCR = 180;
+}
+
+int main(void) {
+    if (!host_periph_map()) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_init();
+    test_eeprom();
+    test_lcd();
+    test_probe();
+    test_queue();
+    test_nack_data();
+    test_bus_error();
+    test_timeout();
+    test_irq_no_wait();
+    test_primask();
+    test_polled();
+    bench();
+    return TEST_RESULT("test_i2c_async");
+}
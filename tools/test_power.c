@@ -0,0 +1,626 @@
+/**
+ ******************************************************************************
+ *  @file test_power.c
+ *  @brief Тест и замер SEGA_power: нажатие во время USB suspend -> Stop -> remote wakeup
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/SEGA_power.c как есть
+ *  (через host_cmsis.h, с -no-pie и -DHOST_POLL).
+ *
+ *  Модель со временем в нс:
+ *   - геймпад Mega Drive: линии PIN1-PIN9 по SELECT (таблица в SEGA_gamepad.h),
+ *     нажатие и отпускание в заданное время;
+ *   - EXTI: фронт на линии с RTSR и EMR дает событие. __WFE спит до события, событие,
+ *     пришедшее раньше WFE, будит сразу (регистр события ядра);
+ *   - RTC от LSI 40 кГц: LSIRDY через 85 мкс после LSION, RSF через такт RTCCLK,
+ *     запись в режиме CNF занимает 3 такта RTCCLK (RTOFF = 0), будильник ставит ALRF
+ *     и дает событие EXTI17;
+ *   - после Stop ядро на HSI, CMSIS_RCC_SystemClock_72MHz - запуск HSE (2 мс)
+ *     и захват PLL (200 мкс) по datasheet;
+ *   - прошивка вокруг модуля: опрос TIM2 240 Гц длиной 100 мкс (в конце SEGA_Power_Filter
+ *     и отправка отчета), главный цикл (SEGA_Power_Idle), программный таймер сигнала RESUME;
+ *   - хост: после RESUME устройства держит resume 20 мс (TDRSMDN), затем SOF раз в 1 мс,
+ *     в SOF повторяется непринятый отчет. Сам хост будит шину событием USB wakeup (EXTI18)
+ *     и тоже держит resume 20 мс;
+ *   - ток МК по режимам (типовые значения datasheet STM32F103xB, 3,3 В, 25 C): Stop с регулятором
+ *     в режиме пониженного потребления и LSI, HSI 8 МГц (проба и запуск HSE), 72 МГц в цикле
+ *     ожидания флага и 72 МГц в WFI. Остальная плата (SN74HC14, подтяжка D+) не считается.
+ *
+ *  Проверяется: нажатие во время suspend будит хост и уходит первым отчетом после resume,
+ *  даже если кнопку уже отпустили и первая отправка не прошла (точка IN занята);
+ *  после доставки нажатие забывается; без разрешения remote wakeup хост не будят,
+ *  а старое нажатие после resume не уходит. LSI и RTC запускаются при первом входе в Stop,
+ *  дальше вход в Stop только переставляет будильник.
+ *  Замер: задержка нажатие -> начало сигнала RESUME для кнопки, видимой при любом SELECT,
+ *  и для кнопок, видимых только при одном уровне SELECT, по времени нажатия внутри периода пробы;
+ *  Stop -> HSE/PLL -> первый отчет при resume от хоста и от нажатия; время входа в Stop;
+ *  средний ток за 1 с suspend и заряд каждого режима.
+ *
+ ******************************************************************************
+ */
+
+#include <string.h>
+#include "SEGA_power.h"
+#include "usbd_core.h"
+#include "host_cmsis.h"
+#include "test.h"
+
+#define NEVER           UINT64_MAX
+#define US              1000ULL
+#define MS              1000000ULL
+#define HSE_STARTUP_NS  (2 * MS) //tSU(HSE) кварца 8 МГц, типовое
+#define PLL_LOCK_NS     (200 * US) //tLOCK PLL, максимум
+#define LSI_STARTUP_NS  (85 * US) //tSU(LSI), максимум
+#define RTCCLK_NS       (1000000000ULL / SEGA_POWER_LSI_HZ)
+#define POLL_RUN_NS     100 //Опрос регистра в цикле на 72 МГц
+#define POLL_HSI_NS     900 //То же на HSI 8 МГц
+#define PAD_POLL_NS     (100 * US) //Опрос геймпада TIM3
+#define PAD_PERIOD_NS   (1000000000ULL / 240) //Период опроса TIM2
+#define SOF_NS          MS
+#define HOST_RESUME_NS  (20 * MS) //Хост держит resume после RESUME устройства
+#define CNT_MARK        0xFFFF //RTC->CNTL в модели: прошивка пишет 0 при каждом будильнике
+#define PRL_MARK        0xFFFF //RTC->PRLH в модели: прошивка пишет 0 при настройке предделителя
+#define ENTRIES_MAX     64
+#define SCS_MAP         (SCS_BASE & ~0xFFFUL)
+
+/*Режимы МК и ток в них*/
+enum { MODE_STOP, MODE_HSI, MODE_RESTART, MODE_BUSY, MODE_SLEEP, MODES };
+
+static const struct {
+    const char *name;
+    double ma;
+} Mode[MODES] = {
+    {"Stop (LPDS) + LSI и RTC", 0.015},
+    {"HSI 8 МГц, проба", 5.0},
+    {"HSI 8 МГц, запуск HSE и PLL", 5.0},
+    {"72 МГц, ожидание флага", 36.0},
+    {"72 МГц, WFI", 14.4},
+};
+
+/*Устройство USB (в прошивке - usb_device.c и usbd_conf.c)*/
+PCD_HandleTypeDef hpcd_USB_FS;
+USBD_HandleTypeDef hUsbDeviceFS;
+
+/*Модель*/
+static struct {
+    uint64_t now;
+    bool hsi; //Ядро на HSI: после Stop до CMSIS_RCC_SystemClock_72MHz
+    bool stop; //Ядро в Stop
+    bool restart; //Запуск HSE и PLL
+    bool busy; //Цикл ожидания флага
+    uint64_t ns[MODES]; //Время в каждом режиме
+    bool event; //Регистр события ядра
+    uint32_t lines; //Линии PA0-PA5 на прошлой синхронизации
+    /*Геймпад*/
+    uint16_t press;
+    uint64_t press_at;
+    uint64_t release_at;
+    /*RTC*/
+    bool lsi_on;
+    uint64_t lsi_ready_at;
+    uint64_t rtc_busy_until; //Идет запись в домен RTC (RTOFF = 0)
+    uint16_t prll;
+    uint64_t alarm_at;
+    uint32_t alarms;
+    uint32_t prl_writes; //Настроек предделителя
+    /*Хост*/
+    uint64_t host_wake_at; //Хост возобновляет шину сам
+    uint64_t host_woke_at;
+    uint64_t bus_at; //С этого времени идут SOF (NEVER - шина в suspend)
+    uint64_t sof_at;
+    uint64_t wakeup_at; //Начало сигнала RESUME устройства
+    uint32_t wakeups;
+    /*Прошивка вокруг модуля*/
+    bool tim2_on;
+    uint64_t entry_at; //Начало входа в Stop (TIM2 остановлен)
+    uint64_t entry_ns[ENTRIES_MAX]; //Вход в Stop до WFE
+    uint32_t entries;
+    uint64_t pad_at; //Следующий опрос геймпада
+    uint16_t live; //Кнопки последнего опроса
+    bool pending; //Отчет не принят, повтор в SOF
+    uint8_t ep_fail; //Столько следующих отправок точка IN не примет
+    uint32_t sends; //Попыток отправки после resume
+    uint16_t sent; //Последний принятый отчет
+    bool first_seen;
+    uint16_t first; //Первый принятый отчет после resume
+    uint64_t ready_at; //Точка IN приняла первый отчет
+    uint64_t first_at; //Первый отчет ушел хосту (первый кадр после resume)
+    struct CMSIS_Timer_name *timer;
+    uint64_t timer_at;
+} Sim;
+
+static void sim_advance(uint64_t t);
+
+static uint64_t earliest(uint64_t a, uint64_t b) {
+    return a < b ? a : b;
+}
+
+/*---------------------------------- Заглушки прошивки ----------------------------------*/
+
+uint32_t CMSIS_Millis(void) {
+    return (uint32_t)(Sim.now / MS);
+}
+
+void CMSIS_RCC_SystemClock_72MHz(void) {
+    Sim.restart = true;
+    sim_advance(Sim.now + HSE_STARTUP_NS + PLL_LOCK_NS);
+    Sim.restart = false;
+    Sim.hsi = false;
+}
+
+void CMSIS_Timer_Start(struct CMSIS_Timer_name *timer, uint32_t Delay_us, uint32_t Period_us) {
+    timer->active = true;
+    Sim.timer = timer;
+    Sim.timer_at = Sim.now + Delay_us * US;
+}
+
+HAL_StatusTypeDef HAL_PCD_ActivateRemoteWakeup(PCD_HandleTypeDef *hpcd) {
+    Sim.wakeup_at = Sim.now;
+    Sim.wakeups++;
+    Sim.bus_at = Sim.now + HOST_RESUME_NS;
+    Sim.sof_at = Sim.bus_at;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_PCD_DeActivateRemoteWakeup(PCD_HandleTypeDef *hpcd) {
+    return HAL_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_Resume(USBD_HandleTypeDef *pdev) {
+    return USBD_OK;
+}
+
+/*---------------------------------- Модель ----------------------------------*/
+
+/*Линии геймпада: 1 - кнопка нажата (после SN74HC14)*/
+static uint32_t pad_lines(uint16_t buttons, bool select) {
+    uint32_t lines = 0;
+
+    lines |= (buttons & SEGA_UP_Pos) ? SEGA_PIN1 : 0;
+    lines |= (buttons & SEGA_DOWN_Pos) ? SEGA_PIN2 : 0;
+    if (select) {
+        lines |= (buttons & SEGA_LEFT_Pos) ? SEGA_PIN3 : 0;
+        lines |= (buttons & SEGA_RIGHT_Pos) ? SEGA_PIN4 : 0;
+        lines |= (buttons & SEGA_B_Pos) ? SEGA_PIN6 : 0;
+        lines |= (buttons & SEGA_C_Pos) ? SEGA_PIN9 : 0;
+    }
+    else {
+        lines |= (buttons & SEGA_A_Pos) ? SEGA_PIN6 : 0;
+        lines |= (buttons & SEGA_START_Pos) ? SEGA_PIN9 : 0;
+    }
+    return lines;
+}
+
+static uint16_t pad_buttons(void) {
+    return (Sim.now >= Sim.press_at && Sim.now < Sim.release_at) ? Sim.press : 0;
+}
+
+/*Событие EXTI: фронт на линии с RTSR и EMR*/
+static void exti_rise(uint32_t lines) {
+    if (lines & EXTI->RTSR & EXTI->EMR) {
+        Sim.event = true;
+    }
+}
+
+/*Все, что зависит от времени: LSI, запись RTC, будильник, линии геймпада, хост*/
+static void sim_state(void) {
+    uint32_t lines;
+
+    if (Sim.lsi_on && Sim.now >= Sim.lsi_ready_at) {
+        RCC->CSR |= RCC_CSR_LSIRDY;
+    }
+    if (Sim.now >= Sim.rtc_busy_until) {
+        RTC->CRL |= RTC_CRL_RTOFF;
+    }
+    if (Sim.now >= Sim.alarm_at) {
+        Sim.alarm_at = NEVER;
+        Sim.alarms++;
+        RTC->CRL |= RTC_CRL_ALRF;
+        exti_rise(SEGA_POWER_RTC_LINE);
+    }
+    if (Sim.now >= Sim.host_wake_at) {
+        Sim.host_woke_at = Sim.host_wake_at;
+        Sim.host_wake_at = NEVER;
+        USB->ISTR |= USB_ISTR_WKUP;
+        exti_rise(SEGA_POWER_USB_LINE);
+    }
+    lines = pad_lines(pad_buttons(), GPIOA->ODR & GPIO_ODR_ODR6);
+    exti_rise(lines & ~Sim.lines);
+    Sim.lines = lines;
+    GPIOA->IDR = lines;
+}
+
+/*Ближайшее изменение модели после now*/
+static uint64_t sim_next(void) {
+    uint64_t next = NEVER;
+
+    next = earliest(next, Sim.press_at > Sim.now ? Sim.press_at : NEVER);
+    next = earliest(next, Sim.release_at > Sim.now ? Sim.release_at : NEVER);
+    next = earliest(next, Sim.lsi_on && !(RCC->CSR & RCC_CSR_LSIRDY) ? Sim.lsi_ready_at : NEVER);
+    next = earliest(next, !(RTC->CRL & RTC_CRL_RTOFF) ? Sim.rtc_busy_until : NEVER);
+    next = earliest(next, Sim.alarm_at);
+    next = earliest(next, Sim.host_wake_at);
+    return next;
+}
+
+static int sim_mode(void) {
+    if (Sim.stop) {
+        return MODE_STOP;
+    }
+    if (Sim.restart) {
+        return MODE_RESTART;
+    }
+    if (Sim.hsi) {
+        return MODE_HSI;
+    }
+    return Sim.busy ? MODE_BUSY : MODE_SLEEP;
+}
+
+static void sim_advance(uint64_t t) {
+    while (Sim.now < t) {
+        uint64_t next = earliest(sim_next(), t);
+
+        Sim.ns[sim_mode()] += next - Sim.now;
+        Sim.now = next;
+        sim_state();
+    }
+}
+
+/*Записи прошивки: SELECT, LSION, выход из CNF, TIM2*/
+static void sim_sync(void) {
+    if (GPIOA->BSRR) {
+        GPIOA->ODR = (GPIOA->ODR | (GPIOA->BSRR & 0xFFFF)) & ~(GPIOA->BSRR >> 16);
+        GPIOA->BSRR = 0;
+    }
+    GPIOC->BSRR = 0;
+
+    if ((RCC->CSR & RCC_CSR_LSION) && !Sim.lsi_on) {
+        Sim.lsi_on = true;
+        Sim.lsi_ready_at = Sim.now + LSI_STARTUP_NS;
+    }
+    //Запись в режиме CNF уходит в домен RTC после сброса CNF
+    if (!(RTC->CRL & RTC_CRL_CNF) && (RTC->CNTL != CNT_MARK || RTC->PRLH != PRL_MARK)) {
+        Sim.rtc_busy_until = Sim.now + 3 * RTCCLK_NS;
+        RTC->CRL &= ~RTC_CRL_RTOFF;
+        if (RTC->PRLH != PRL_MARK) {
+            Sim.prll = (uint16_t)RTC->PRLL;
+            Sim.prl_writes++;
+            RTC->PRLH = PRL_MARK;
+        }
+        if (RTC->CNTL != CNT_MARK) {
+            Sim.alarm_at = Sim.rtc_busy_until + (uint64_t)(RTC->ALRL - RTC->CNTL) * (Sim.prll + 1) * RTCCLK_NS;
+            RTC->CNTL = CNT_MARK;
+        }
+    }
+
+    if ((TIM2->CR1 & TIM_CR1_CEN) && !Sim.tim2_on) {
+        Sim.pad_at = Sim.now + PAD_PERIOD_NS;
+    }
+    if (!(TIM2->CR1 & TIM_CR1_CEN) && Sim.tim2_on) {
+        Sim.entry_at = Sim.now; //SEGA_Power_Stop начался
+    }
+    Sim.tim2_on = TIM2->CR1 & TIM_CR1_CEN;
+    if (!Sim.tim2_on) {
+        Sim.pad_at = NEVER;
+    }
+    else if (TIM2->EGR & TIM_EGR_UG) {
+        Sim.pad_at = Sim.now; //Опрос прямо сейчас
+    }
+    TIM2->EGR = 0;
+    sim_state();
+}
+
+/*Опрос регистра в цикле ожидания прошивки (host_cmsis.h)*/
+void host_poll(const volatile void *reg, uint32_t bit) {
+    Sim.busy = true;
+    sim_sync();
+    if (reg == &RCC->CSR && (bit & RCC_CSR_LSIRDY) && Sim.lsi_on) {
+        sim_advance(Sim.lsi_ready_at);
+    }
+    else if (reg == &RTC->CRL && (bit & RTC_CRL_RTOFF) && !(RTC->CRL & RTC_CRL_RTOFF)) {
+        sim_advance(Sim.rtc_busy_until);
+    }
+    else if (reg == &RTC->CRL && (bit & RTC_CRL_RSF) && !(RTC->CRL & RTC_CRL_RSF)) {
+        sim_advance(Sim.now + RTCCLK_NS);
+        RTC->CRL |= RTC_CRL_RSF;
+    }
+    sim_advance(Sim.now + (Sim.hsi ? POLL_HSI_NS : POLL_RUN_NS));
+    Sim.busy = false;
+}
+
+/*Сон ядра до события (host_cmsis.h). Stop - если выставлен SLEEPDEEP*/
+void host_wfe(void) {
+    bool stop = SCB->SCR & SCB_SCR_SLEEPDEEP_Msk;
+
+    sim_sync();
+    if (stop && Sim.entry_at != NEVER) {
+        if (Sim.entries < ENTRIES_MAX) {
+            Sim.entry_ns[Sim.entries++] = Sim.now - Sim.entry_at;
+        }
+        Sim.entry_at = NEVER;
+    }
+    Sim.stop = stop;
+    while (!Sim.event) {
+        uint64_t next = sim_next();
+
+        if (next == NEVER) {
+            CHECK(!"сон без источника пробуждения");
+            break;
+        }
+        sim_advance(next);
+    }
+    Sim.event = false;
+    Sim.stop = false;
+    if (stop) {
+        Sim.hsi = true; //Из Stop ядро выходит на HSI
+    }
+}
+
+/*---------------------------------- Прошивка вокруг модуля ----------------------------------*/
+
+/*SEGA_Gamepad_Send: точка IN принимает отчет, только если шина не в suspend*/
+static bool gamepad_send(uint16_t buttons) {
+    if (SEGA_Power_Suspended()) {
+        return false;
+    }
+    Sim.sends++;
+    if (Sim.ep_fail) {
+        Sim.ep_fail--;
+        return false;
+    }
+    if (!Sim.first_seen) {
+        Sim.first_seen = true;
+        Sim.first = buttons;
+        Sim.ready_at = Sim.now;
+        Sim.first_at = Sim.now > Sim.bus_at ? Sim.now : Sim.bus_at;
+    }
+    Sim.sent = buttons;
+    SEGA_Power_Sent();
+    return true;
+}
+
+/*Прерывания прошивки и главный цикл до времени end*/
+static void run(uint64_t end) {
+    while (Sim.now < end) {
+        uint64_t next;
+
+        SEGA_Power_Idle(false); //Конец главного цикла: сон или Stop
+        sim_sync();
+        if (USB->ISTR & USB_ISTR_WKUP) {
+            //Прерывание USB: хост возобновил шину (HAL_PCD_ResumeCallback)
+            USB->ISTR = 0;
+            SEGA_Power_Resume();
+            Sim.bus_at = Sim.host_woke_at + HOST_RESUME_NS;
+            Sim.sof_at = Sim.bus_at;
+            continue;
+        }
+        next = earliest(end, earliest(Sim.pad_at, Sim.timer_at));
+        if (Sim.bus_at != NEVER) {
+            next = earliest(next, Sim.sof_at);
+        }
+        sim_advance(next);
+        if (Sim.now >= Sim.timer_at) {
+            Sim.timer_at = NEVER;
+            Sim.timer->active = false;
+            Sim.timer->Callback(Sim.timer);
+        }
+        else if (Sim.now >= Sim.pad_at) {
+            Sim.pad_at = Sim.now + PAD_PERIOD_NS;
+            sim_advance(Sim.now + PAD_POLL_NS);
+            Sim.live = pad_buttons();
+            Sim.pending = !gamepad_send(SEGA_Power_Filter(Sim.live));
+        }
+        else if (Sim.bus_at != NEVER && Sim.now >= Sim.sof_at) {
+            Sim.sof_at = Sim.now + SOF_NS;
+            if (Sim.pending) {
+                Sim.pending = !gamepad_send(SEGA_Power_Filter(Sim.live));
+            }
+        }
+    }
+}
+
+/*Хост усыпил шину: SOF больше нет, через 3 мс - suspend*/
+static void suspend(void) {
+    Sim.bus_at = NEVER;
+    sim_advance(Sim.now + 3 * MS);
+    SEGA_Power_Suspend();
+    Sim.first_seen = false;
+    Sim.sends = 0;
+    Sim.wakeup_at = NEVER;
+}
+
+/*Нажатие press через delay после suspend, держится hold. Модель идет до end после нажатия*/
+static void press_in_suspend(uint16_t press, uint64_t delay, uint64_t hold, uint64_t end) {
+    suspend();
+    Sim.press = press;
+    Sim.press_at = Sim.now + delay;
+    Sim.release_at = Sim.press_at + hold;
+    run(Sim.press_at + end);
+}
+
+/*---------------------------------- Тесты ----------------------------------*/
+
+static void test_init(void) {
+    RTC->CRL = RTC_CRL_RTOFF;
+    RTC->CNTL = CNT_MARK;
+    RTC->PRLH = PRL_MARK;
+    Sim.entry_at = NEVER;
+    GPIOA->ODR = GPIO_ODR_ODR6; //SELECT в покое
+    Sim.press_at = NEVER;
+    Sim.release_at = NEVER;
+    Sim.alarm_at = NEVER;
+    Sim.host_wake_at = NEVER;
+    Sim.timer_at = NEVER;
+    Sim.wakeup_at = NEVER;
+    Sim.bus_at = 0;
+    hUsbDeviceFS.dev_remote_wakeup = 1;
+    TIM2->CR1 = TIM_CR1_CEN;
+    sim_sync();
+    run(20 * MS);
+    CHECK(Sim.wakeups == 0);
+    CHECK(!SEGA_Power_Suspended());
+}
+
+/*Нажатие держится до принятого отчета, без suspend фильтр ничего не добавляет*/
+static void test_filter(void) {
+    CHECK(SEGA_Power_Filter(SEGA_A_Pos) == SEGA_A_Pos);
+    SEGA_Power_Suspend();
+    CHECK(SEGA_Power_Filter(SEGA_B_Pos) == SEGA_B_Pos);
+    SEGA_Power_Resume();
+    CHECK(SEGA_Power_Filter(0) == SEGA_B_Pos);
+    CHECK(SEGA_Power_Filter(SEGA_C_Pos) == (SEGA_B_Pos | SEGA_C_Pos)); //Отправка не прошла - еще раз
+    SEGA_Power_Sent();
+    CHECK(SEGA_Power_Filter(0) == 0);
+    Sim.bus_at = 0;
+    run(Sim.now + 20 * MS); //Запрос remote wakeup без suspend ничего не делает
+    CHECK(Sim.wakeups == 0);
+}
+
+/*Короткое нажатие в Stop: хост разбужен, нажатие уходит первым отчетом, хотя первая отправка не прошла*/
+static void test_wake_report(void) {
+    uint32_t wakeups = Sim.wakeups;
+
+    Sim.ep_fail = 1;
+    press_in_suspend(SEGA_UP_Pos, 50 * MS, 5 * MS, 100 * MS);
+    CHECK(Sim.wakeups == wakeups + 1);
+    CHECK(Sim.wakeup_at - Sim.press_at < 3 * MS);
+    CHECK(Sim.sends >= 2); //Первая отправка не принята
+    CHECK(Sim.first_seen && Sim.first == SEGA_UP_Pos); //Кнопку отпустили давно, но нажатие дошло
+    CHECK(Sim.sent == 0); //Дальше - как есть
+    CHECK(!SEGA_Power_Suspended());
+}
+
+/*Хост не разрешил remote wakeup: МК просыпается, хост - нет, старое нажатие после resume не уходит*/
+static void test_no_remote_wakeup(void) {
+    uint32_t wakeups = Sim.wakeups;
+
+    hUsbDeviceFS.dev_remote_wakeup = 0;
+    Sim.host_wake_at = Sim.now + 3 * MS + 200 * MS; //Хост сам будит шину
+    press_in_suspend(SEGA_DOWN_Pos, 50 * MS, 5 * MS, 300 * MS);
+    CHECK(Sim.wakeups == wakeups);
+    CHECK(!SEGA_Power_Suspended());
+    CHECK(Sim.first_seen && Sim.first == 0);
+    hUsbDeviceFS.dev_remote_wakeup = 1;
+}
+
+/*LSI и RTC запускаются один раз, дальше вход в Stop только переставляет будильник*/
+static void test_rtc_once(void) {
+    CHECK(Sim.entries >= 3);
+    CHECK(Sim.prl_writes == 1);
+    CHECK(Sim.entry_ns[0] >= LSI_STARTUP_NS + RTCCLK_NS + 2 * 3 * RTCCLK_NS); //LSIRDY, RSF, предделитель, будильник
+    for (uint32_t i = 1; i < Sim.entries; i++) {
+        CHECK(Sim.entry_ns[i] < 3 * RTCCLK_NS + 20 * US); //Только будильник
+    }
+}
+
+/*Задержка нажатие -> RESUME по времени нажатия внутри двух периодов пробы*/
+static void bench_wake(const char *name, uint16_t press, uint64_t limit) {
+    uint64_t min = NEVER, max = 0, sum = 0;
+    uint32_t n = 0, lost = 0;
+
+    for (uint64_t delay = 40 * MS; delay < 40 * MS + 4 * SEGA_POWER_PROBE_MS * MS; delay += MS / 2, n++) {
+        uint32_t wakeups = Sim.wakeups;
+        uint64_t latency;
+
+        press_in_suspend(press, delay, 200 * MS, 200 * MS);
+        if (Sim.wakeups == wakeups) {
+            lost++;
+            continue;
+        }
+        latency = Sim.wakeup_at - Sim.press_at;
+        min = earliest(min, latency);
+        max = latency > max ? latency : max;
+        sum += latency;
+        run(Sim.now + 100 * MS); //Отпустили, шина работает
+    }
+    CHECK(lost == 0);
+    CHECK(max <= limit);
+    printf("  %-32s нажатие -> RESUME: мин %5.2f, сред %5.2f, макс %5.2f мс (%u нажатий)\n",
+           name, min / 1e6, sum / 1e6 / (n - lost), max / 1e6, n);
+}
+
+/*Stop -> HSE/PLL -> первый отчет: resume от хоста и от нажатия*/
+static void bench_resume(void) {
+    uint64_t ready, first, wakeup;
+
+    suspend();
+    Sim.host_wake_at = Sim.now + 500 * MS;
+    run(Sim.host_wake_at + 100 * MS);
+    ready = Sim.ready_at - Sim.host_woke_at;
+    first = Sim.first_at - Sim.host_woke_at;
+    CHECK(Sim.first_seen);
+    CHECK(ready <= HSE_STARTUP_NS + PLL_LOCK_NS + PAD_POLL_NS + 100 * US);
+    CHECK(first == HOST_RESUME_NS); //МК готов раньше, чем хост закончит resume
+    printf("  resume от хоста: вход в Stop %3.0f мкс (первый - %3.0f мкс, запуск LSI и RTC), отчет принят через %.2f мс, "
+           "ушел в первом кадре через %.2f мс\n",
+           Sim.entry_ns[Sim.entries - 1] / 1e3, Sim.entry_ns[0] / 1e3, ready / 1e6, first / 1e6);
+
+    press_in_suspend(SEGA_UP_Pos, 50 * MS, 50 * MS, 100 * MS);
+    wakeup = Sim.wakeup_at - Sim.press_at;
+    first = Sim.first_at - Sim.press_at;
+    CHECK(Sim.first_seen && Sim.first == SEGA_UP_Pos);
+    CHECK(first <= wakeup + HOST_RESUME_NS + SOF_NS);
+    printf("  нажатие UP: RESUME через %.2f мс, отчет ушел в первом кадре через %.2f мс\n", wakeup / 1e6, first / 1e6);
+}
+
+/*Средний ток МК за 1 с suspend: вход, Stop с пробами, пробуждение от хоста*/
+static void bench_current(void) {
+    uint64_t ns[MODES], total = 0;
+    uint64_t start;
+    uint32_t alarms;
+    double uc = 0, stop_uc, stop_ns;
+
+    suspend();
+    memcpy(ns, Sim.ns, sizeof(ns));
+    alarms = Sim.alarms;
+    start = Sim.now;
+    Sim.host_wake_at = Sim.now + 1000 * MS;
+    run(Sim.host_wake_at + HSE_STARTUP_NS + PLL_LOCK_NS);
+    alarms = Sim.alarms - alarms;
+    printf("  ток МК за %.0f мс suspend (%u проб):\n", (Sim.now - start) / 1e6, alarms);
+    for (int m = 0; m < MODES; m++) {
+        ns[m] = Sim.ns[m] - ns[m];
+        total += ns[m];
+        uc += ns[m] / 1e6 * Mode[m].ma;
+        printf("    %7.2f мс x %6.3f мА = %8.2f мкКл  %s\n", ns[m] / 1e6, Mode[m].ma, ns[m] / 1e6 * Mode[m].ma, Mode[m].name);
+    }
+    stop_ns = ns[MODE_STOP] + ns[MODE_HSI];
+    stop_uc = ns[MODE_STOP] / 1e6 * Mode[MODE_STOP].ma + ns[MODE_HSI] / 1e6 * Mode[MODE_HSI].ma;
+    printf("    средний ток %.0f мкА, в Stop с пробами %.1f мкА (проба - %.0f мкс на HSI)\n",
+           uc / total * 1e9, stop_uc / stop_ns * 1e9, ns[MODE_HSI] / 1e3 / alarms);
+    CHECK(uc / total * 1e9 < 2500); //Бюджет USB suspend на все устройство
+    CHECK(stop_uc / stop_ns * 1e9 < 50);
+}
+
+static void bench(void) {
+    printf("Remote wakeup из Stop (HSE %.1f мс + PLL %.1f мс, опрос %.1f мс, проба каждые %u мс):\n",
+           HSE_STARTUP_NS / 1e6, PLL_LOCK_NS / 1e6, PAD_POLL_NS / 1e6, SEGA_POWER_PROBE_MS);
+    bench_wake("UP (видна при любом SELECT)", SEGA_UP_Pos, HSE_STARTUP_NS + PLL_LOCK_NS + PAD_POLL_NS + 100 * US);
+    bench_wake("B (видна при SELECT в покое)", SEGA_B_Pos,
+               SEGA_POWER_PROBE_MS * MS + HSE_STARTUP_NS + PLL_LOCK_NS + PAD_POLL_NS + 500 * US);
+    bench_wake("A (видна только при пробе)", SEGA_A_Pos,
+               SEGA_POWER_PROBE_MS * MS + HSE_STARTUP_NS + PLL_LOCK_NS + PAD_POLL_NS + 500 * US);
+    bench_resume();
+    bench_current();
+}
+
+int main(void) {
+    if (!host_periph_map()
+        || mmap((void *)SCS_MAP, 0x1000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0)
+           != (void *)SCS_MAP) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_init();
+    test_filter();
+    test_wake_report();
+    test_no_remote_wakeup();
+    test_rtc_once();
+    bench();
+    return TEST_RESULT("test_power");
+}
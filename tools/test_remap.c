@@ -0,0 +1,236 @@
+/**
+ ******************************************************************************
+ *  @file test_remap.c
+ *  @brief Тест и замер SEGA_remap против побитового цикла
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/SEGA_remap.c как есть.
+ *  SEGA_Config_Get/SEGA_Config_Version подменены: настройки - массив Config,
+ *  версия - Config_version.
+ *
+ *  Для каждого переназначения (тождественное, обмен, отключение, слияние
+ *  и случайные) SEGA_Remap сравнивается с побитовым циклом на всех 2^14 сочетаниях.
+ *  Замер: нс на вызов на ПК для таблиц и для цикла при разном числе нажатых кнопок.
+ *
+ ******************************************************************************
+ */
+
+#include <time.h>
+#include "SEGA_remap.h"
+#include "SEGA_config.h"
+#include "test.h"
+
+#define ALL_BUTTONS    (1 << SEGA_REMAP_BITS)
+#define BENCH_CALLS    (16 * 1024 * 1024)
+#define RANDOM_MAPS    200
+
+static uint16_t Config[SEGA_CONFIG_KEYS];
+static uint32_t Config_version;
+static uint32_t Random = 2463534242u;
+static volatile uint16_t Sink;
+
+/*Подмена хранилища настроек*/
+uint16_t SEGA_Config_Get(uint8_t key) {
+    return (key < SEGA_CONFIG_KEYS) ? Config[key] : 0;
+}
+
+uint32_t SEGA_Config_Version(void) {
+    return Config_version;
+}
+
+static uint32_t random_next(void) {
+    Random ^= Random << 13;
+    Random ^= Random >> 17;
+    Random ^= Random << 5;
+    return Random;
+}
+
+/*Куда уходит бит bit: номер бита или SEGA_REMAP_OFF*/
+static uint8_t map_get(uint8_t bit) {
+    return (Config[SEGA_CONFIG_REMAP_0 + bit / 4] >> ((bit % 4) * 4)) & 0xF;
+}
+
+static void map_set(uint8_t bit, uint8_t target) {
+    uint16_t *word = &Config[SEGA_CONFIG_REMAP_0 + bit / 4];
+
+    *word = (uint16_t)((*word & ~(0xF << ((bit % 4) * 4))) | (target << ((bit % 4) * 4)));
+}
+
+/*Тождественное переназначение, как по умолчанию в SEGA_config*/
+static void map_identity(void) {
+    for (uint8_t bit = 0; bit < 16; bit++) {
+        map_set(bit, bit);
+    }
+}
+
+/*Новые настройки вступают в силу в главном цикле*/
+static void map_apply(void) {
+    Config_version++;
+    SEGA_Remap_Process();
+}
+
+/*Побитовый цикл: то, что заменяют таблицы*/
+__attribute__((noinline)) static uint16_t remap_naive(uint16_t buttons) {
+    uint16_t out = 0;
+    uint8_t target;
+
+    for (uint8_t bit = 0; bit < SEGA_REMAP_BITS; bit++) {
+        target = map_get(bit);
+        if ((buttons & (1 << bit)) && target < SEGA_REMAP_BITS) {
+            out |= (uint16_t)(1 << target);
+        }
+    }
+    return out;
+}
+
+/*Побитовый цикл по заранее разобранным настройкам: честный соперник таблицам*/
+static int8_t Naive_target[SEGA_REMAP_BITS];
+
+static void naive_prepare(void) {
+    for (uint8_t bit = 0; bit < SEGA_REMAP_BITS; bit++) {
+        Naive_target[bit] = (map_get(bit) < SEGA_REMAP_BITS) ? (int8_t)map_get(bit) : -1;
+    }
+}
+
+__attribute__((noinline)) static uint16_t remap_loop(uint16_t buttons) {
+    uint16_t out = 0;
+
+    for (uint8_t bit = 0; bit < SEGA_REMAP_BITS; bit++) {
+        if ((buttons & (1 << bit)) && Naive_target[bit] >= 0) {
+            out |= (uint16_t)(1 << Naive_target[bit]);
+        }
+    }
+    return out;
+}
+
+/*Все сочетания кнопок: таблицы == цикл. Биты 14-15 отбрасываются*/
+static void check_all(void) {
+    size_t failed = 0;
+
+    for (uint32_t b = 0; b < 0x10000; b++) {
+        failed += SEGA_Remap((uint16_t)b) != remap_naive((uint16_t)(b & (ALL_BUTTONS - 1)));
+    }
+    CHECK(failed == 0);
+}
+
+static void test_identity(void) {
+    map_identity();
+    map_apply();
+    for (uint32_t b = 0; b < ALL_BUTTONS; b++) {
+        CHECK(SEGA_Remap((uint16_t)b) == b);
+    }
+    check_all();
+}
+
+/*Пример из SEGA_remap.h: A <-> B через "cfg 3 43928"*/
+static void test_swap_ab(void) {
+    map_identity();
+    Config[SEGA_CONFIG_REMAP_2] = 43928;
+    map_apply();
+    CHECK(SEGA_Remap(SEGA_A_Pos) == SEGA_B_Pos);
+    CHECK(SEGA_Remap(SEGA_B_Pos) == SEGA_A_Pos);
+    CHECK(SEGA_Remap(SEGA_A_Pos | SEGA_START_Pos) == (SEGA_B_Pos | SEGA_START_Pos));
+    CHECK(SEGA_Remap(SEGA_C_Pos | SEGA_UP_Pos) == (SEGA_C_Pos | SEGA_UP_Pos));
+    check_all();
+}
+
+/*Отключение и слияние: MODE отключен, X/Y/Z работают как A/B/C*/
+static void test_off_and_merge(void) {
+    map_identity();
+    map_set(4, SEGA_REMAP_OFF); //MODE
+    map_set(8, 11); //X -> A
+    map_set(7, 10); //Y -> B
+    map_set(6, 9); //Z -> C
+    map_apply();
+    CHECK(SEGA_Remap(SEGA_MODE_Pos) == 0);
+    CHECK(SEGA_Remap(SEGA_X_Pos) == SEGA_A_Pos);
+    CHECK(SEGA_Remap(SEGA_X_Pos | SEGA_A_Pos) == SEGA_A_Pos);
+    CHECK(SEGA_Remap(SEGA_Y_Pos | SEGA_Z_Pos | SEGA_MODE_Pos) == (SEGA_B_Pos | SEGA_C_Pos));
+    check_all();
+}
+
+/*Случайные переназначения, в том числе номера бит 14 и 15 (не кнопки) и отключение*/
+static void test_random(void) {
+    for (int n = 0; n < RANDOM_MAPS; n++) {
+        for (uint8_t k = 0; k < 4; k++) {
+            Config[SEGA_CONFIG_REMAP_0 + k] = (uint16_t)random_next();
+        }
+        map_apply();
+        check_all();
+    }
+}
+
+/*Без изменения версии настроек таблицы не пересчитываются*/
+static void test_rebuild_on_version(void) {
+    map_identity();
+    map_apply();
+    Config[SEGA_CONFIG_REMAP_2] = 43928;
+    SEGA_Remap_Process();
+    CHECK(SEGA_Remap(SEGA_A_Pos) == SEGA_A_Pos); //Версия та же: старые таблицы
+    map_apply();
+    CHECK(SEGA_Remap(SEGA_A_Pos) == SEGA_B_Pos);
+    SEGA_Remap_Init(); //Повторное построение по тем же настройкам ничего не меняет
+    CHECK(SEGA_Remap(SEGA_A_Pos) == SEGA_B_Pos);
+}
+
+/*нс на вызов для входов inputs (маска по числу нажатых кнопок)*/
+static double bench_one(uint16_t (*remap)(uint16_t), const uint16_t *inputs) {
+    struct timespec t0, t1;
+    uint16_t acc = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t i = 0; i < BENCH_CALLS; i++) {
+        acc ^= remap(inputs[i & 1023]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    Sink = acc;
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BENCH_CALLS;
+}
+
+/*Замер: таблицы против цикла при 0, 3 и всех нажатых кнопках и случайных*/
+static void bench(void) {
+    static uint16_t inputs[1024];
+    static const char *name[] = {"ничего не нажато", "3 кнопки", "все 14", "случайные"};
+
+    map_identity();
+    map_set(11, 10); //A <-> B, чтоб переназначение не было тождественным
+    map_set(10, 11);
+    map_apply();
+    naive_prepare();
+    printf("SEGA_Remap (таблицы) против побитового цикла, нс на вызов на ПК:\n");
+    for (int kind = 0; kind < 4; kind++) {
+        for (int i = 0; i < 1024; i++) {
+            switch (kind) {
+            case 0:
+                inputs[i] = 0;
+                break;
+            case 1:
+                inputs[i] = SEGA_A_Pos | SEGA_UP_Pos | SEGA_START_Pos;
+                break;
+            case 2:
+                inputs[i] = ALL_BUTTONS - 1;
+                break;
+            default:
+                inputs[i] = (uint16_t)(random_next() & (ALL_BUTTONS - 1));
+                break;
+            }
+            CHECK(SEGA_Remap(inputs[i]) == remap_loop(inputs[i]));
+        }
+        printf("  таблицы %5.2f, цикл %5.2f - %s\n", bench_one(SEGA_Remap, inputs), bench_one(remap_loop, inputs), name[kind]);
+    }
+}
+
+int main(void) {
+    SEGA_Remap_Init();
+    test_identity();
+    test_swap_ab();
+    test_off_and_merge();
+    test_random();
+    test_rebuild_on_version();
+    bench();
+    return TEST_RESULT("test_remap");
+}
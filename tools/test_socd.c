@@ -0,0 +1,163 @@
+/**
+ ******************************************************************************
+ *  @file test_socd.c
+ *  @brief Тест SEGA_socd: каждое правило SOCD на обеих осях
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/SEGA_socd.c как есть.
+ *  SEGA_Config_Get подменен: правило задается переменной Socd_policy.
+ *  Каждый вызов SEGA_SOCD_Filter - один опрос; результат проверяется в том же
+ *  вызове, в котором изменились кнопки (без кадра задержки).
+ *  Оси X/Y и положение крестовины отчета считаются только из результата: проверяется,
+ *  что при любом правиле и любой смене кнопок на оси остается не больше одного
+ *  направления, а повтор с теми же кнопками (отчет из SOF) результат не меняет.
+ *
+ ******************************************************************************
+ */
+
+#include "SEGA_socd.h"
+#include "SEGA_config.h"
+#include "test.h"
+
+#define UP    SEGA_UP_Pos
+#define DOWN  SEGA_DOWN_Pos
+#define LEFT  SEGA_LEFT_Pos
+#define RIGHT SEGA_RIGHT_Pos
+#define OTHER (SEGA_A_Pos | SEGA_START_Pos | SEGA_R_Pos) //Не крестовина: проходит как есть
+
+static uint16_t Socd_policy;
+
+/*Подмена настройки*/
+uint16_t SEGA_Config_Get(uint8_t key) {
+    return (key == SEGA_CONFIG_SOCD) ? Socd_policy : 0;
+}
+
+/*Новое правило и сброс состояния осей: опрос со всеми отпущенными кнопками*/
+static void socd_start(uint16_t policy) {
+    Socd_policy = policy;
+    SEGA_SOCD_Filter(0);
+}
+
+/*Опрос: кнопки -> ожидаемый результат*/
+#define POLL(in, out) CHECK(SEGA_SOCD_Filter(in) == (out))
+
+/*Конфликт на одной оси: neg после pos, pos после neg и оба в одном опросе.
+  pos_then_neg, neg_then_pos, same_poll - ожидаемые биты оси в каждом случае*/
+static void socd_axis(uint16_t pos, uint16_t neg, uint16_t pos_then_neg, uint16_t neg_then_pos, uint16_t same_poll) {
+    //positive, затем negative
+    SEGA_SOCD_Filter(0);
+    POLL(pos | OTHER, pos | OTHER);
+    POLL(pos | neg | OTHER, pos_then_neg | OTHER);
+    POLL(pos | neg, pos_then_neg); //Удержание: решение не меняется
+    POLL(pos, pos); //negative отпущено: сразу оставшееся
+    //negative, затем positive
+    SEGA_SOCD_Filter(0);
+    POLL(neg, neg);
+    POLL(neg | pos, neg_then_pos);
+    POLL(neg | pos | OTHER, neg_then_pos | OTHER);
+    POLL(neg, neg); //positive отпущено
+    //Оба в одном опросе: порядок неизвестен
+    SEGA_SOCD_Filter(0);
+    POLL(pos | neg, same_poll);
+    POLL(neg, neg);
+    //Ось без конфликта и отпускание
+    SEGA_SOCD_Filter(0);
+    POLL(neg | OTHER, neg | OTHER);
+    POLL(0, 0);
+}
+
+/*SEGA_SOCD_NEUTRAL: оба направления гасятся*/
+static void test_neutral(void) {
+    socd_start(SEGA_SOCD_NEUTRAL);
+    socd_axis(UP, DOWN, 0, 0, 0);
+    socd_axis(LEFT, RIGHT, 0, 0, 0);
+    //Обе оси сразу: диагональ без конфликта проходит, конфликт гасит только свою ось
+    SEGA_SOCD_Filter(0);
+    POLL(UP | LEFT, UP | LEFT);
+    POLL(UP | DOWN | LEFT, LEFT);
+    POLL(UP | DOWN | LEFT | RIGHT | OTHER, OTHER);
+}
+
+/*SEGA_SOCD_LAST: побеждает нажатое последним*/
+static void test_last(void) {
+    socd_start(SEGA_SOCD_LAST);
+    socd_axis(UP, DOWN, DOWN, UP, 0);
+    socd_axis(LEFT, RIGHT, RIGHT, LEFT, 0);
+    //Повторное нажатие первого направления снова его делает последним
+    SEGA_SOCD_Filter(0);
+    POLL(UP, UP);
+    POLL(UP | DOWN, DOWN);
+    POLL(DOWN, DOWN);
+    POLL(UP | DOWN, UP);
+    //Оси независимы
+    SEGA_SOCD_Filter(0);
+    POLL(UP | RIGHT, UP | RIGHT);
+    POLL(UP | DOWN | RIGHT | LEFT, DOWN | LEFT);
+}
+
+/*SEGA_SOCD_FIRST: побеждает нажатое первым*/
+static void test_first(void) {
+    socd_start(SEGA_SOCD_FIRST);
+    socd_axis(UP, DOWN, UP, DOWN, 0);
+    socd_axis(LEFT, RIGHT, LEFT, RIGHT, 0);
+    //Первое отпущено и нажато снова: первым теперь стало другое
+    SEGA_SOCD_Filter(0);
+    POLL(UP, UP);
+    POLL(UP | DOWN, UP);
+    POLL(DOWN, DOWN);
+    POLL(UP | DOWN, DOWN);
+    //Оси независимы
+    SEGA_SOCD_Filter(0);
+    POLL(DOWN | LEFT, DOWN | LEFT);
+    POLL(UP | DOWN | RIGHT | LEFT, DOWN | LEFT);
+}
+
+/*SEGA_SOCD_UP: UP+DOWN = UP, LEFT+RIGHT = нейтраль*/
+static void test_up(void) {
+    socd_start(SEGA_SOCD_UP);
+    socd_axis(UP, DOWN, UP, UP, UP);
+    socd_axis(LEFT, RIGHT, 0, 0, 0);
+    SEGA_SOCD_Filter(0);
+    POLL(UP | DOWN | LEFT | RIGHT | OTHER, UP | OTHER);
+}
+
+/*Неизвестное значение настройки - как SEGA_SOCD_NEUTRAL*/
+static void test_unknown(void) {
+    socd_start(7);
+    SEGA_SOCD_Filter(0);
+    POLL(UP, UP);
+    POLL(UP | DOWN, 0);
+}
+
+/*Любое правило, любые две подряд комбинации крестовины: одно направление на оси, повтор - тот же результат*/
+static void test_single_direction(void) {
+    for (uint16_t policy = 0; policy <= SEGA_SOCD_UP + 1; policy++) {
+        for (uint16_t a = 0; a < 16; a++) {
+            for (uint16_t b = 0; b < 16; b++) {
+                uint16_t out;
+
+                socd_start(policy);
+                SEGA_SOCD_Filter(a);
+                out = SEGA_SOCD_Filter(b | OTHER);
+                CHECK((out & (UP | DOWN)) != (UP | DOWN));
+                CHECK((out & (LEFT | RIGHT)) != (LEFT | RIGHT));
+                CHECK((out & OTHER) == OTHER);
+                CHECK(SEGA_SOCD_Filter(b | OTHER) == out);
+            }
+        }
+    }
+}
+
+int main(void) {
+    test_neutral();
+    test_last();
+    test_first();
+    test_up();
+    test_unknown();
+    test_single_direction();
+    return TEST_RESULT("test_socd");
+}
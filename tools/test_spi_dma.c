@@ -0,0 +1,775 @@
+/**
+ ******************************************************************************
+ *  @file test_spi_dma.c
+ *  @brief Тест и замер SPI1 через DMA (CMSIS_SPI1_DMA_*) против блокирующей передачи
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/stm32f103xx_CMSIS.c как есть
+ *  (через host_cmsis.h, с -no-pie и -DHOST_POLL).
+ *
+ *  Модель SPI1 (ведущий, 8 бит) со временем в тактах PCLK2 = ядра 72 МГц:
+ *  буфер передачи и сдвиговый регистр, байт - 8 тактов SCK по делителю BR,
+ *  RXNE, OVR, BSY. Каналы DMA1 2 (SPI1_RX) и 3 (SPI1_TX) с MINC, CIRC, HT и TC,
+ *  прерывания каналов по уровню флагов.
+ *  Два ведомых: дисплей (NSS на PA4, выбран при 0) и память (NSS на PB12, выбран при 1).
+ *  Ведомый пишет принятое в журнал и отвечает seed ^ номер байта; без выбранного
+ *  ведомого MISO подтянута к 1.
+ *
+ *  Чтение DR модель не видит, поэтому:
+ *   - в блокирующем коде RXNE и OVR снимаются на опросе после того, в котором их увидели;
+ *   - перед включением RXDMAEN прошивка читает DR и SR (CMSIS_SPI1_DMA_Flush),
+ *     и включение RXDMAEN снимает RXNE и OVR.
+ *  Запись в BSRR модель видит при синхронизации, поэтому ведомые на разных портах.
+ *
+ *  Время процессора: опрос регистра в цикле - POLL_CYCLES, прерывание (вход, обработчик,
+ *  выход) и вызов CMSIS_SPI1_DMA_Submit - IRQ_CYCLES. Блокирующая функция занимает
+ *  процессор все время передачи.
+ *
+ *  Проверяется: передача, прием и обмен через DMA от 1 байта, NSS только вокруг
+ *  своей транзакции и не посреди байта, очередь и порядок Callback, ошибка DMA,
+ *  поточный режим (половина буфера не рвется, очередь ждет остановки потока),
+ *  блокирующие CMSIS_SPI_Data_Transmit_8BIT/Receive_8BIT на той же модели.
+ *  Замер на fPCLK/2, fPCLK/4 и fPCLK/16: время процессора на передачу,
+ *  прерывания, нагрузка в поточном режиме.
+ *
+ ******************************************************************************
+ */
+
+#include <string.h>
+#include <time.h>
+#include "host_cmsis.h"
+#include "test.h"
+
+#define RX_TAG      0x10000 //Принятое, выложенное моделью в DR (прошивка пишет не больше 16 бит)
+#define CPU_MHZ     72
+#define POLL_CYCLES 7 //Опрос регистра в цикле, ~100 нс
+#define IRQ_CYCLES  72 //Вход, обработчик и выход, ~1 мкс
+#define LCD_PIN     4 //PA4, выбран при 0
+#define FLASH_PIN   12 //PB12, выбран при 1
+#define LOG_SIZE    65536
+#define HALF_MAX    1024
+
+/*Обработчики прерываний из stm32f103xx_CMSIS.c (в заголовке их нет)*/
+void DMA1_Channel2_IRQHandler(void);
+void DMA1_Channel3_IRQHandler(void);
+
+/*Ведомый SPI*/
+typedef struct {
+    GPIO_TypeDef *GPIO;
+    uint8_t pin;
+    bool logic; //Уровень NSS, при котором выбран
+    uint8_t seed;
+    uint8_t log[LOG_SIZE]; //Принятые байты
+    uint32_t count;
+} slave_model;
+
+static slave_model Lcd = { .pin = LCD_PIN, .logic = false, .seed = 0xA5 };
+static slave_model Flash = { .pin = FLASH_PIN, .logic = true, .seed = 0x3C };
+
+/*Канал DMA1*/
+typedef struct {
+    DMA_Channel_TypeDef *ch;
+    uint32_t shift; //Сдвиг флагов канала в ISR
+    bool on;
+    uintptr_t base; //CMAR и CNDTR на момент включения (для CIRC)
+    uint16_t total;
+    uintptr_t mem;
+} dma_model;
+
+/*Модель SPI1 и шины*/
+static struct {
+    uint64_t now; //Такты 72 МГц
+    bool tx_full; //Байт в буфере передачи
+    uint8_t tx_byte;
+    bool shifting; //Байт в сдвиговом регистре
+    uint64_t shift_at; //Байт закончится в это время
+    uint8_t shift_byte;
+    slave_model *shift_slave; //Выбран в начале байта
+    bool shift_cut; //NSS сменился посреди байта
+    bool rxne;
+    bool ovr;
+    uint8_t rx_byte;
+    bool rx_seen; //Блокирующий код увидел RXNE или OVR
+    bool rxdmaen;
+    bool te_next; //Ошибка DMA приема на следующем байте
+    dma_model rx;
+    dma_model tx;
+    uint32_t unselected; //Байты без выбранного ведомого
+    uint32_t collisions; //Байты при двух выбранных ведомых
+    uint32_t nss_cut; //Байты, посреди которых сменился NSS
+    uint32_t tx_lost; //Записи в DR при TXE = 0
+    uint64_t cpu; //Время процессора по модели, такты
+    uint32_t irqs;
+    uint64_t irq_host_ns; //Время в обработчиках на ПК
+} Spi = { .rx = { .shift = 4 }, .tx = { .shift = 8 } };
+
+/*Транзакции теста*/
+static struct SPI_Transaction_name Tr[SPI_DMA_QUEUE + 1];
+static uint8_t Tx_data[SPI_DMA_QUEUE + 1][2048]; //Статические: адрес помещается в CMAR
+static uint8_t Rx_data[SPI_DMA_QUEUE + 1][2048];
+static struct SPI_Transaction_name *Done[64]; //Порядок вызова Callback
+static uint32_t Done_count;
+static uint64_t Done_at; //Время последнего Callback
+
+/*Поток: два полукадра, в каждом номер кадра*/
+static uint8_t Stream_buffer[2 * HALF_MAX];
+static uint16_t Stream_half;
+static uint8_t Stream_frame; //Номер следующего кадра
+static uint32_t Stream_calls;
+
+static double host_ns(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void transaction_done(struct SPI_Transaction_name *transaction) {
+    if (Done_count < sizeof(Done) / sizeof(Done[0])) {
+        Done[Done_count++] = transaction;
+    }
+    Done_at = Spi.now;
+}
+
+/*Callback потока: половина ушла в линию, кладем в нее следующий кадр*/
+static void stream_refill(uint8_t *half) {
+    memset(half, Stream_frame++, Stream_half);
+    Stream_calls++;
+}
+
+/*---------------------------------- Ведомые ----------------------------------*/
+
+static bool slave_selected(const slave_model *s) {
+    return ((s->GPIO->ODR >> s->pin) & 1) == s->logic;
+}
+
+/*Кто выбран сейчас. NULL - никто (или оба)*/
+static slave_model *slave_find(void) {
+    bool lcd = slave_selected(&Lcd);
+    bool flash = slave_selected(&Flash);
+
+    if (lcd && flash) {
+        return NULL;
+    }
+    return lcd ? &Lcd : flash ? &Flash : NULL;
+}
+
+/*Байт ведомому. retval ответ ведомого*/
+static uint8_t slave_byte(slave_model *s, uint8_t byte) {
+    uint8_t reply = (uint8_t)(s->seed ^ s->count);
+
+    s->log[s->count % LOG_SIZE] = byte;
+    s->count++;
+    return reply;
+}
+
+/*Что ответит ведомый на n-й от начала байт*/
+static uint8_t slave_reply(const slave_model *s, uint32_t n) {
+    return (uint8_t)(s->seed ^ n);
+}
+
+/*---------------------------------- Модель SPI1 ----------------------------------*/
+
+/*Байт: 8 тактов SCK, SCK = fPCLK / (2 << BR)*/
+static uint64_t byte_cycles(void) {
+    return 8ULL * (2U << ((SPI1->CR1 & SPI_CR1_BR) >> SPI_CR1_BR_Pos));
+}
+
+/*Счетчик микросекунд TIM4 + TIM1 (CMSIS_Micros, CMSIS_Millis) по времени модели*/
+static void timebase_update(void) {
+    uint32_t us = (uint32_t)(Spi.now / CPU_MHZ);
+
+    if (!(us & 0xFFFF)) {
+        us++; //CMSIS_Micros перечитывает при младших 16 битах = 0
+    }
+    TIM4->CNT = us & 0xFFFF;
+    TIM1->CNT = us >> 16;
+}
+
+/*Записи в BSRR порта: ножки NSS*/
+static void gpio_sync(GPIO_TypeDef *GPIO) {
+    uint32_t bsrr = GPIO->BSRR;
+
+    if (bsrr) {
+        GPIO->BSRR = 0;
+        GPIO->ODR = (GPIO->ODR & ~(bsrr >> 16)) | (bsrr & 0xFFFF);
+    }
+}
+
+static void spi_reset(void) {
+    Spi.tx_full = Spi.shifting = Spi.rxne = Spi.ovr = Spi.rx_seen = Spi.rxdmaen = Spi.te_next = false;
+    Spi.rx.ch = DMA1_Channel2;
+    Spi.tx.ch = DMA1_Channel3;
+    Spi.rx.on = Spi.tx.on = false;
+    SPI1->DR = RX_TAG;
+    Lcd.GPIO = GPIOA;
+    Flash.GPIO = GPIOB;
+    GPIOA->ODR = 1 << LCD_PIN; //Оба ведомых не выбраны
+    GPIOB->ODR = 0;
+}
+
+/*Канал включили: адрес памяти и счетчик защелкиваются*/
+static void dma_latch(dma_model *d) {
+    bool on = d->ch->CCR & DMA_CCR_EN;
+
+    if (on && !d->on) {
+        d->base = d->mem = d->ch->CMAR;
+        d->total = (uint16_t)d->ch->CNDTR;
+    }
+    d->on = on;
+}
+
+/*Канал перенес байт*/
+static void dma_step(dma_model *d) {
+    if (d->ch->CCR & DMA_CCR_MINC) {
+        d->mem++;
+    }
+    d->ch->CNDTR--;
+    if (d->ch->CNDTR == d->total / 2U) {
+        DMA1->ISR |= (DMA_ISR_HTIF1 | DMA_ISR_GIF1) << d->shift;
+    }
+    if (!d->ch->CNDTR) {
+        DMA1->ISR |= (DMA_ISR_TCIF1 | DMA_ISR_GIF1) << d->shift;
+        if (d->ch->CCR & DMA_CCR_CIRC) {
+            d->ch->CNDTR = d->total;
+            d->mem = d->base;
+        }
+    }
+}
+
+static void shift_start(void) {
+    Spi.shifting = true;
+    Spi.tx_full = false;
+    Spi.shift_byte = Spi.tx_byte;
+    Spi.shift_at = Spi.now + byte_cycles();
+    Spi.shift_slave = slave_find();
+    Spi.shift_cut = false;
+    if (slave_selected(&Lcd) && slave_selected(&Flash)) {
+        Spi.collisions++;
+    }
+    else if (!Spi.shift_slave) {
+        Spi.unselected++;
+    }
+}
+
+/*Все, что следует из регистров прямо сейчас: записи прошивки, DMA, следующий байт*/
+static void spi_sync(void) {
+    uint32_t cr2;
+
+    //Флаги DMA сбрасываются записью в IFCR, CGIF - все флаги канала
+    for (uint32_t ch = 0; ch < 28; ch += 4) {
+        if (DMA1->IFCR & (DMA_IFCR_CGIF1 << ch)) {
+            DMA1->IFCR |= 0xF << ch;
+        }
+    }
+    DMA1->ISR &= ~DMA1->IFCR;
+    DMA1->IFCR = 0;
+
+    gpio_sync(GPIOA);
+    gpio_sync(GPIOB);
+    if (Spi.shifting && slave_find() != Spi.shift_slave) {
+        Spi.shift_cut = true;
+    }
+
+    dma_latch(&Spi.rx);
+    dma_latch(&Spi.tx);
+    cr2 = SPI1->CR2;
+    if ((cr2 & SPI_CR2_RXDMAEN) && !Spi.rxdmaen) {
+        Spi.rxne = Spi.ovr = false; //CMSIS_SPI1_DMA_Flush
+    }
+    Spi.rxdmaen = cr2 & SPI_CR2_RXDMAEN;
+
+    //Запись в DR
+    if (!(SPI1->DR & RX_TAG)) {
+        if (Spi.tx_full) {
+            Spi.tx_lost++;
+        }
+        Spi.tx_full = true;
+        Spi.tx_byte = (uint8_t)SPI1->DR;
+        SPI1->DR = RX_TAG | Spi.rx_byte;
+    }
+
+    for (bool moved = true; moved;) {
+        moved = false;
+        //DMA приема (приоритет выше передачи)
+        if ((cr2 & SPI_CR2_RXDMAEN) && Spi.rxne && Spi.rx.on && Spi.rx.ch->CNDTR) {
+            if (Spi.te_next) {
+                //Ошибка шины: флаг TEIF, канал выключается сам
+                Spi.te_next = false;
+                DMA1->ISR |= DMA_ISR_TEIF2 | DMA_ISR_GIF2;
+                CLEAR_BIT(Spi.rx.ch->CCR, DMA_CCR_EN);
+                Spi.rx.on = false;
+            }
+            else {
+                *(uint8_t *)Spi.rx.mem = Spi.rx_byte;
+                Spi.rxne = false;
+                dma_step(&Spi.rx);
+            }
+            moved = true;
+        }
+        //DMA передачи пишет в DR, пока TXE
+        if ((cr2 & SPI_CR2_TXDMAEN) && !Spi.tx_full && Spi.tx.on && Spi.tx.ch->CNDTR) {
+            Spi.tx_full = true;
+            Spi.tx_byte = *(const uint8_t *)Spi.tx.mem;
+            dma_step(&Spi.tx);
+            moved = true;
+        }
+        if (Spi.tx_full && !Spi.shifting && (SPI1->CR1 & SPI_CR1_SPE)) {
+            shift_start();
+            moved = true;
+        }
+    }
+
+    SPI1->SR = (Spi.tx_full ? 0 : SPI_SR_TXE) | (Spi.rxne ? SPI_SR_RXNE : 0) | (Spi.ovr ? SPI_SR_OVR : 0)
+               | (Spi.shifting || Spi.tx_full ? SPI_SR_BSY : 0);
+}
+
+/*Байт ушел в линию в момент Spi.now*/
+static void shift_end(void) {
+    uint8_t reply = 0xFF;
+
+    Spi.shifting = false;
+    if (Spi.shift_cut || slave_find() != Spi.shift_slave) {
+        Spi.nss_cut++;
+    }
+    if (Spi.shift_slave) {
+        reply = slave_byte(Spi.shift_slave, Spi.shift_byte);
+    }
+    if (Spi.rxne) {
+        Spi.ovr = true; //Принятое после переполнения теряется
+    }
+    else {
+        Spi.rxne = true;
+        Spi.rx_byte = reply;
+        SPI1->DR = RX_TAG | reply;
+    }
+    spi_sync();
+}
+
+/*Время модели идет до t*/
+static void bus_advance(uint64_t t) {
+    while (Spi.shifting && Spi.shift_at <= t) {
+        Spi.now = Spi.shift_at;
+        shift_end();
+    }
+    Spi.now = t;
+    timebase_update();
+}
+
+/*Опрос регистра в цикле ожидания прошивки (host_cmsis.h)*/
+void host_poll(const volatile void *reg, uint32_t bit) {
+    if (Spi.rx_seen) {
+        Spi.rx_seen = false;
+        Spi.rxne = Spi.ovr = false; //Между опросами прочитаны DR и SR
+    }
+    spi_sync();
+    Spi.cpu += POLL_CYCLES;
+    bus_advance(Spi.now + POLL_CYCLES);
+    if (reg == &SPI1->SR) {
+        Spi.rx_seen = (bit & (SPI_SR_RXNE | SPI_SR_OVR)) && (SPI1->SR & bit);
+    }
+}
+
+/*Вызов обработчика, как NVIC, и время процессора на него*/
+static void call_irq(void (*IRQHandler)(void)) {
+    double t0 = host_ns();
+
+    IRQHandler();
+    Spi.irq_host_ns += (uint64_t)(host_ns() - t0);
+    Spi.irqs++;
+    spi_sync();
+    Spi.cpu += IRQ_CYCLES;
+    bus_advance(Spi.now + IRQ_CYCLES);
+}
+
+/*Запрос прерывания по уровню флагов. retval true - обработчик вызван*/
+static bool bus_irq(void) {
+    uint32_t isr = DMA1->ISR;
+    uint32_t ccr2 = DMA1_Channel2->CCR;
+    uint32_t ccr3 = DMA1_Channel3->CCR;
+
+    if (((ccr2 & DMA_CCR_TCIE) && (isr & DMA_ISR_TCIF2)) || ((ccr2 & DMA_CCR_TEIE) && (isr & DMA_ISR_TEIF2))) {
+        call_irq(DMA1_Channel2_IRQHandler);
+        return true;
+    }
+    if (((ccr3 & DMA_CCR_TCIE) && (isr & DMA_ISR_TCIF3)) || ((ccr3 & DMA_CCR_HTIE) && (isr & DMA_ISR_HTIF3))
+        || ((ccr3 & DMA_CCR_TEIE) && (isr & DMA_ISR_TEIF3))) {
+        call_irq(DMA1_Channel3_IRQHandler);
+        return true;
+    }
+    return false;
+}
+
+/*Прерывания и шина, пока очередь не опустеет и SPI не встанет (или limit тактов)*/
+static void bus_run(uint64_t limit) {
+    uint64_t end = Spi.now + limit;
+
+    while (Spi.now < end) {
+        uint64_t next = end;
+
+        spi_sync();
+        if (bus_irq()) {
+            continue;
+        }
+        if (!CMSIS_SPI1_DMA_Busy() && !Spi.shifting && !Spi.tx_full) {
+            return;
+        }
+        if (Spi.shifting && Spi.shift_at < next) {
+            next = Spi.shift_at;
+        }
+        bus_advance(next);
+    }
+}
+
+/*---------------------------------- Тесты ----------------------------------*/
+
+static struct SPI_Transaction_name *transaction(uint8_t n, slave_model *s, bool tx, bool rx, uint16_t size) {
+    struct SPI_Transaction_name *t = &Tr[n];
+
+    *t = (struct SPI_Transaction_name) { .GPIO = s->GPIO, .NSS_pin = s->pin, .NSS_logic = s->logic,
+                                         .tx_data = tx ? Tx_data[n] : NULL, .rx_data = rx ? Rx_data[n] : NULL,
+                                         .Size_data = size, .Callback = transaction_done };
+    return t;
+}
+
+static void fill(uint8_t n, uint16_t size, uint8_t seed) {
+    for (uint16_t i = 0; i < size; i++) {
+        Tx_data[n][i] = (uint8_t)(seed + i * 7);
+    }
+}
+
+/*Ответы ведомого с n-го байта совпали с принятым*/
+static bool replies_match(const slave_model *s, uint32_t n, const uint8_t *data, uint16_t size) {
+    for (uint16_t i = 0; i < size; i++) {
+        if (data[i] != slave_reply(s, n + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*Журнал ведомого с n-го байта совпал с переданным*/
+static bool log_match(const slave_model *s, uint32_t n, const uint8_t *data, uint16_t size) {
+    for (uint16_t i = 0; i < size; i++) {
+        if (s->log[(n + i) % LOG_SIZE] != data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*Линия в порядке: ни одного байта без ведомого, при двух ведомых или с NSS посреди байта*/
+static bool line_clean(void) {
+    return !Spi.unselected && !Spi.collisions && !Spi.nss_cut && !Spi.tx_lost;
+}
+
+/*Одна транзакция от постановки до Callback. retval Status*/
+static uint8_t run_one(struct SPI_Transaction_name *t) {
+    Done_count = 0;
+    CHECK(CMSIS_SPI1_DMA_Submit(t));
+    bus_run(100000000);
+    CHECK(Done_count == 1 && Done[0] == t);
+    CHECK(!CMSIS_SPI1_DMA_Busy());
+    CHECK(!slave_selected(&Lcd) && !slave_selected(&Flash)); //NSS отпущен
+    return t->Status;
+}
+
+static void test_init(void) {
+    spi_reset();
+    CMSIS_SPI1_init();
+    CMSIS_SPI1_DMA_Init();
+    CHECK(DMA1_Channel2->CPAR == (uint32_t)(uintptr_t)&SPI1->DR);
+    CHECK(DMA1_Channel3->CPAR == (uint32_t)(uintptr_t)&SPI1->DR);
+    CHECK((DMA1_Channel2->CCR & (DMA_CCR_DIR | DMA_CCR_TCIE | DMA_CCR_TEIE)) == (DMA_CCR_TCIE | DMA_CCR_TEIE));
+    CHECK((DMA1_Channel3->CCR & (DMA_CCR_DIR | DMA_CCR_TCIE | DMA_CCR_HTIE)) == DMA_CCR_DIR);
+    //Прием важнее передачи: иначе OVR
+    CHECK((DMA1_Channel2->CCR & DMA_CCR_PL) > (DMA1_Channel3->CCR & DMA_CCR_PL));
+    CHECK((SPI1->CR1 & (SPI_CR1_SPE | SPI_CR1_MSTR)) == (SPI_CR1_SPE | SPI_CR1_MSTR));
+    CHECK(byte_cycles() == 128); //fPCLK/16
+}
+
+/*Передача, прием и обмен от 1 байта*/
+static void test_transfer(void) {
+    static const uint16_t size[] = {1, 2, 3, 64, 2048};
+
+    for (size_t i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        uint32_t lcd = Lcd.count;
+        uint32_t flash = Flash.count;
+
+        fill(0, size[i], (uint8_t)i);
+        CHECK(run_one(transaction(0, &Lcd, true, false, size[i])) == SPI_DMA_OK);
+        CHECK(Lcd.count == lcd + size[i]);
+        CHECK(log_match(&Lcd, lcd, Tx_data[0], size[i]));
+
+        //Только прием: передаются 0xFF
+        memset(Rx_data[1], 0, sizeof(Rx_data[1]));
+        CHECK(run_one(transaction(1, &Flash, false, true, size[i])) == SPI_DMA_OK);
+        CHECK(Flash.count == flash + size[i]);
+        CHECK(replies_match(&Flash, flash, Rx_data[1], size[i]));
+        if (size[i] < sizeof(Rx_data[1])) {
+            CHECK(Rx_data[1][size[i]] == 0); //Лишнего не принято
+        }
+        memset(Tx_data[2], 0xFF, size[i]);
+        CHECK(log_match(&Flash, flash, Tx_data[2], size[i]));
+
+        //Обмен
+        lcd = Lcd.count;
+        fill(2, size[i], (uint8_t)(0x80 + i));
+        CHECK(run_one(transaction(2, &Lcd, true, true, size[i])) == SPI_DMA_OK);
+        CHECK(log_match(&Lcd, lcd, Tx_data[2], size[i]));
+        CHECK(replies_match(&Lcd, lcd, Rx_data[2], size[i]));
+    }
+    CHECK(!CMSIS_SPI1_DMA_Submit(transaction(0, &Lcd, true, false, 0))); //Size_data = 0
+    CHECK(line_clean());
+}
+
+/*Очередь: SPI_DMA_QUEUE транзакций двум ведомым, Callback по порядку, лишняя не принимается*/
+static void test_queue(void) {
+    uint32_t lcd = Lcd.count;
+    uint32_t flash = Flash.count;
+
+    Done_count = 0;
+    for (uint8_t n = 0; n < SPI_DMA_QUEUE; n++) {
+        fill(n, 10 + n, n);
+        CHECK(CMSIS_SPI1_DMA_Submit(transaction(n, (n & 1) ? &Flash : &Lcd, true, n >= SPI_DMA_QUEUE / 2, 10 + n)));
+    }
+    CHECK(!CMSIS_SPI1_DMA_Submit(transaction(SPI_DMA_QUEUE, &Lcd, true, false, 1)));
+    bus_run(100000000);
+    CHECK(Done_count == SPI_DMA_QUEUE);
+    for (uint8_t n = 0; n < SPI_DMA_QUEUE && n < Done_count; n++) {
+        slave_model *s = (n & 1) ? &Flash : &Lcd;
+        uint32_t *count = (n & 1) ? &flash : &lcd;
+
+        CHECK(Done[n] == &Tr[n]);
+        CHECK(Tr[n].Status == SPI_DMA_OK);
+        CHECK(log_match(s, *count, Tx_data[n], 10 + n));
+        if (n >= SPI_DMA_QUEUE / 2) {
+            CHECK(replies_match(s, *count, Rx_data[n], 10 + n));
+        }
+        *count += 10 + n;
+    }
+    CHECK(Lcd.count == lcd && Flash.count == flash);
+    CHECK(line_clean());
+}
+
+/*Submit и поток из кода с запрещенными прерываниями не разрешают их*/
+static void test_primask(void) {
+    Done_count = 0;
+    Host_primask = 1;
+    for (uint8_t n = 0; n < SPI_DMA_QUEUE; n++) {
+        fill(n, 4, n);
+        CHECK(CMSIS_SPI1_DMA_Submit(transaction(n, &Lcd, true, false, 4)));
+        CHECK(Host_primask == 1);
+    }
+    CHECK(!CMSIS_SPI1_DMA_Submit(transaction(SPI_DMA_QUEUE, &Lcd, true, false, 1))); //Очередь заполнена
+    CHECK(Host_primask == 1);
+    CHECK(!CMSIS_SPI1_DMA_Stream_Start(Lcd.GPIO, Lcd.pin, Lcd.logic, Stream_buffer, Stream_half, stream_refill));
+    CHECK(Host_primask == 1);
+    Host_primask = 0;
+    bus_run(100000000);
+    CHECK(Done_count == SPI_DMA_QUEUE);
+
+    Host_primask = 1;
+    CHECK(CMSIS_SPI1_DMA_Stream_Start(Lcd.GPIO, Lcd.pin, Lcd.logic, Stream_buffer, Stream_half, stream_refill));
+    CHECK(Host_primask == 1);
+    CMSIS_SPI1_DMA_Stream_Stop();
+    CHECK(Host_primask == 1);
+    Host_primask = 0;
+    spi_sync();
+    CHECK(!slave_selected(&Lcd));
+    CHECK(line_clean());
+}
+
+/*Ошибка DMA приема: Status ERROR, NSS отпущен, следующая транзакция проходит*/
+static void test_dma_error(void) {
+    uint32_t flash;
+
+    transaction(0, &Lcd, true, true, 32);
+    transaction(1, &Flash, false, true, 32);
+    Spi.te_next = true;
+    Done_count = 0;
+    CHECK(CMSIS_SPI1_DMA_Submit(&Tr[0]));
+    CHECK(CMSIS_SPI1_DMA_Submit(&Tr[1]));
+    flash = Flash.count;
+    bus_run(100000000);
+    CHECK(Done_count == 2);
+    CHECK(Tr[0].Status == SPI_DMA_ERROR);
+    CHECK(Tr[1].Status == SPI_DMA_OK);
+    CHECK(replies_match(&Flash, flash, Rx_data[1], 32));
+    CHECK(!slave_selected(&Lcd) && !slave_selected(&Flash));
+    CHECK(line_clean());
+}
+
+/*Поток: полукадры целые и по порядку, очередь ждет остановки потока*/
+static void test_stream(void) {
+    uint32_t lcd = Lcd.count;
+    uint32_t flash = Flash.count;
+    uint32_t sent, halves;
+
+    Stream_half = 64;
+    Stream_frame = 0;
+    Stream_calls = 0;
+    memset(Stream_buffer, Stream_frame++, Stream_half);
+    memset(Stream_buffer + Stream_half, Stream_frame++, Stream_half);
+
+    //Пока идет транзакция, поток не запускается
+    CHECK(CMSIS_SPI1_DMA_Submit(transaction(0, &Flash, false, true, 16)));
+    CHECK(!CMSIS_SPI1_DMA_Stream_Start(Lcd.GPIO, Lcd.pin, Lcd.logic, Stream_buffer, Stream_half, stream_refill));
+    bus_run(100000000);
+    flash = Flash.count;
+
+    CHECK(CMSIS_SPI1_DMA_Stream_Start(Lcd.GPIO, Lcd.pin, Lcd.logic, Stream_buffer, Stream_half, stream_refill));
+    CHECK(!CMSIS_SPI1_DMA_Stream_Start(Flash.GPIO, Flash.pin, Flash.logic, Stream_buffer, Stream_half, NULL));
+    Done_count = 0;
+    CHECK(CMSIS_SPI1_DMA_Submit(transaction(1, &Flash, false, true, 8)));
+    bus_run(byte_cycles() * Stream_half * 20 + byte_cycles() / 3);
+    CHECK(Done_count == 0 && Flash.count == flash); //Ждет
+    CHECK(slave_selected(&Lcd));
+    CHECK(Stream_calls >= 19);
+
+    CMSIS_SPI1_DMA_Stream_Stop();
+    spi_sync();
+    CHECK(!slave_selected(&Lcd));
+    bus_run(100000000);
+    CHECK(Done_count == 1 && Tr[1].Status == SPI_DMA_OK);
+    CHECK(Flash.count == flash + 8);
+    CHECK(replies_match(&Flash, flash, Rx_data[1], 8));
+
+    //Каждый полукадр - один кадр целиком, кадры подряд; последний мог оборваться остановкой
+    sent = Lcd.count - lcd;
+    halves = sent / Stream_half;
+    CHECK(halves >= 20);
+    for (uint32_t i = 0; i < sent; i++) {
+        if (Lcd.log[(lcd + i) % LOG_SIZE] != (uint8_t)(i / Stream_half)) {
+            CHECK(Lcd.log[(lcd + i) % LOG_SIZE] == (uint8_t)(i / Stream_half));
+            break;
+        }
+    }
+    CHECK(line_clean());
+    CMSIS_SPI1_DMA_Stream_Stop(); //Повторная остановка ничего не делает
+    spi_sync();
+    CHECK(!slave_selected(&Lcd));
+}
+
+/*Блокирующие функции на той же модели (проверка самой модели)*/
+static void test_polled(void) {
+    uint8_t in[16];
+    uint32_t lcd = Lcd.count;
+    uint32_t flash = Flash.count;
+
+    fill(0, 64, 0x11);
+    GPIOA->BSRR = GPIO_BSRR_BR4;
+    CHECK(CMSIS_SPI_Data_Transmit_8BIT(SPI1, Tx_data[0], 64, 10));
+    GPIOA->BSRR = GPIO_BSRR_BS4;
+    CHECK(Lcd.count == lcd + 64);
+    CHECK(log_match(&Lcd, lcd, Tx_data[0], 64));
+    CHECK(SPI1->SR & SPI_SR_OVR); //Принятое никто не читал
+
+    GPIOB->BSRR = GPIO_BSRR_BS12;
+    CHECK(CMSIS_SPI_Data_Receive_8BIT(SPI1, in, sizeof(in), 10));
+    GPIOB->BSRR = GPIO_BSRR_BR12;
+    spi_sync();
+    CHECK(Flash.count == flash + sizeof(in));
+    CHECK(replies_match(&Flash, flash, in, sizeof(in)));
+
+    //После блокирующей передачи (RXNE и OVR висят) прием через DMA - с первого байта
+    flash = Flash.count;
+    CHECK(run_one(transaction(1, &Flash, false, true, 4)) == SPI_DMA_OK);
+    CHECK(replies_match(&Flash, flash, Rx_data[1], 4));
+    CHECK(line_clean());
+}
+
+/*Замер одной передачи: блокирующая функция против очереди*/
+static void bench_one(uint16_t size) {
+    uint64_t t0, cpu0, host0, polled, bus, dma_cpu;
+    uint32_t irqs0, irqs;
+    bool ok;
+
+    fill(0, size, 5);
+    spi_sync();
+    t0 = Spi.now;
+    GPIOA->BSRR = GPIO_BSRR_BR4;
+    ok = CMSIS_SPI_Data_Transmit_8BIT(SPI1, Tx_data[0], size, 10);
+    GPIOA->BSRR = GPIO_BSRR_BS4;
+    polled = Spi.now - t0;
+    CHECK(ok);
+
+    cpu0 = Spi.cpu;
+    irqs0 = Spi.irqs;
+    host0 = Spi.irq_host_ns;
+    t0 = Spi.now;
+    Done_count = 0;
+    CHECK(CMSIS_SPI1_DMA_Submit(transaction(0, &Lcd, true, false, size)));
+    Spi.cpu += IRQ_CYCLES; //Сам вызов Submit
+    bus_run(100000000);
+    CHECK(Done_count == 1 && Tr[0].Status == SPI_DMA_OK);
+    bus = Done_at - t0;
+    dma_cpu = Spi.cpu - cpu0;
+    irqs = Spi.irqs - irqs0;
+    printf("  %4u байт: шина %7.1f мкс | блокирующая: процессор %7.1f мкс | DMA: %u прерываний, процессор %4.1f мкс (%5.2f%%), на ПК %3.0f нс/прерывание\n",
+           size, (double)bus / CPU_MHZ, (double)polled / CPU_MHZ, irqs, (double)dma_cpu / CPU_MHZ,
+           100.0 * dma_cpu / polled, (double)(Spi.irq_host_ns - host0) / irqs);
+}
+
+/*Замер потока: нагрузка на процессор за 100 мс (без заполнения половины в Callback)*/
+static void bench_stream(uint16_t half) {
+    const uint64_t time = 100000ULL * CPU_MHZ;
+    uint64_t t0, cpu0;
+    uint32_t irqs0, calls0, lcd0;
+
+    Stream_half = half;
+    cpu0 = Spi.cpu;
+    irqs0 = Spi.irqs;
+    calls0 = Stream_calls;
+    lcd0 = Lcd.count;
+    t0 = Spi.now;
+    CHECK(CMSIS_SPI1_DMA_Stream_Start(Lcd.GPIO, Lcd.pin, Lcd.logic, Stream_buffer, half, stream_refill));
+    Spi.cpu += IRQ_CYCLES;
+    bus_run(time);
+    CMSIS_SPI1_DMA_Stream_Stop();
+    printf("  поток 2 x %u байт: %6.0f полукадров/с, %6.0f прерываний/с, %5.2f Мбит/с, процессор %5.2f%% (блокирующая - 100%%)\n",
+           half, (Stream_calls - calls0) * 1e6 * CPU_MHZ / (Spi.now - t0), (Spi.irqs - irqs0) * 1e6 * CPU_MHZ / (Spi.now - t0),
+           (Lcd.count - lcd0) * 8.0 * CPU_MHZ / (Spi.now - t0), 100.0 * (Spi.cpu - cpu0) / (Spi.now - t0));
+}
+
+static void bench(void) {
+    static const struct {
+        uint32_t br;
+        const char *name;
+    } speed[] = {{0b000, "fPCLK/2 = 36 Мбит/с (самый быстрый делитель)"},
+                 {0b001, "fPCLK/4 = 18 Мбит/с (предел SPI1 по datasheet)"},
+                 {0b011, "fPCLK/16 = 4.5 Мбит/с (CMSIS_SPI1_init)"}};
+    static const uint16_t size[] = {16, 128, 1024};
+
+    for (size_t i = 0; i < sizeof(speed) / sizeof(speed[0]); i++) {
+        MODIFY_REG(SPI1->CR1, SPI_CR1_BR, speed[i].br << SPI_CR1_BR_Pos);
+        printf("SPI1 %s (опрос %u, прерывание %u тактов процессора):\n", speed[i].name, POLL_CYCLES, IRQ_CYCLES);
+        for (size_t j = 0; j < sizeof(size) / sizeof(size[0]); j++) {
+            bench_one(size[j]);
+        }
+        bench_stream(HALF_MAX); //Кадр 128x64 монохромного дисплея
+    }
+    MODIFY_REG(SPI1->CR1, SPI_CR1_BR, 0b011 << SPI_CR1_BR_Pos);
+    CHECK(line_clean());
+}
+
+int main(void) {
+    if (!host_periph_map()) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_init();
+    test_transfer();
+    test_queue();
+    test_dma_error();
+    test_stream();
+    test_primask();
+    test_polled();
+    bench();
+    return TEST_RESULT("test_spi_dma");
+}
@@ -0,0 +1,102 @@
+/**
+ ******************************************************************************
+ *  @file test_tas_codec.c
+ *  @brief Тест формата записи SEGA_tas: кодирование и декодирование туда и обратно
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "tas_codec.h"
+#include "test.h"
+
+#define EVENTS 10000
+
+static tas_event In[EVENTS];
+static tas_event Out[EVENTS];
+static uint8_t Buf[EVENTS * TAS_RECORD_MAX];
+
+/*varint: границы 7, 14, 21, 28 бит и 32 бита целиком*/
+static void test_varint(void) {
+    static const uint32_t values[] = { 0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 0x1FFFFF, 0x200000, 0xFFFFFFFF };
+    static const size_t sizes[] = { 1, 1, 1, 2, 2, 3, 3, 4, 5 };
+    uint8_t buf[TAS_VARINT_MAX];
+    uint32_t value;
+    size_t pos;
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        CHECK(tas_varint_put(buf, values[i]) == sizes[i]);
+        pos = 0;
+        CHECK(tas_varint_get(buf, sizes[i], &pos, &value) == 0);
+        CHECK(value == values[i] && pos == sizes[i]);
+        pos = 0;
+        CHECK(tas_varint_get(buf, sizes[i] - 1, &pos, &value) == -1); //Оборвано
+    }
+}
+
+/*Пример из SEGA_tas.h: A в кадре 10, отпущена в кадре 12, START в кадре 300*/
+static void test_known_bytes(void) {
+    const tas_event events[] = { { 10, 0x0800 }, { 12, 0x0000 }, { 300, 0x0020 } };
+    const uint8_t expected[] = { 10, 0x80, 0x10, 2, 0x80, 0x10, 0xA0, 0x02, 0x20 };
+
+    CHECK(tas_encode(events, 3, Buf, sizeof(Buf)) == sizeof(expected));
+    CHECK(!memcmp(Buf, expected, sizeof(expected)));
+}
+
+/*Случайная трасса: опрос каждый кадр, туда и обратно*/
+static void test_round_trip(void) {
+    uint32_t seed = 12345, frame = 0;
+    uint16_t state = 0;
+    size_t bytes, n, changes = 0;
+
+    for (size_t i = 0; i < EVENTS; i++) {
+        seed = seed * 1103515245 + 12345;
+        frame += 1 + ((seed >> 16) % 7 == 0 ? (seed >> 8) % 5000 : 0);
+        if ((seed >> 20) % 3 == 0) {
+            state ^= (uint16_t)(1 << ((seed >> 24) % 14));
+        }
+        In[i].frame = frame;
+        In[i].buttons = state;
+    }
+    bytes = tas_encode(In, EVENTS, Buf, sizeof(Buf));
+    CHECK(bytes > 0);
+    n = tas_decode(Buf, bytes, Out, EVENTS);
+    state = 0;
+    for (size_t i = 0; i < EVENTS; i++) {
+        if (In[i].buttons != state) {
+            state = In[i].buttons;
+            CHECK(changes < n && Out[changes].frame == In[i].frame && Out[changes].buttons == state);
+            changes++;
+        }
+    }
+    CHECK(n == changes);
+}
+
+/*Дамп Flash: за записью стертые байты 0xFF, декодер на них останавливается*/
+static void test_erased_tail(void) {
+    const tas_event events[] = { { 5, 0x0001 }, { 6, 0x0003 } };
+    size_t bytes = tas_encode(events, 2, Buf, sizeof(Buf));
+
+    memset(Buf + bytes, 0xFF, 64);
+    CHECK(tas_decode(Buf, bytes + 64, Out, EVENTS) == 2);
+    CHECK(Out[1].frame == 6 && Out[1].buttons == 0x0003);
+}
+
+/*Не хватает места - 0*/
+static void test_no_room(void) {
+    const tas_event events[] = { { 5, 0x0001 } };
+
+    CHECK(tas_encode(events, 1, Buf, 1) == 0);
+}
+
+int main(void) {
+    test_varint();
+    test_known_bytes();
+    test_round_trip();
+    test_erased_tail();
+    test_no_room();
+    return TEST_RESULT("test_tas_codec");
+}
@@ -0,0 +1,405 @@
+/**
+ ******************************************************************************
+ *  @file test_telemetry.c
+ *  @brief Тест и замер пропускной способности SEGA_telemetry
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/SEGA_telemetry.c как есть
+ *  (через host_cmsis.h) и декодером telemetry_codec.c.
+ *
+ *  Модель железа:
+ *   - CMSIS_Micros - часы теста, начинаются за 5 с до переполнения 32 бит;
+ *   - USART1 + DMA - линия SEGA_TELEMETRY_BAUDRATE 8N1 (10 бит на байт). Байты пакета
+ *     забираются из буфера прошивки только в конце передачи, так что изменение
+ *     буфера во время DMA испортит поток и будет найдено декодером;
+ *   - опрос геймпада (TIM3) вызывает SEGA_Telemetry_Push с заданным периодом,
+ *     главный цикл вызывает SEGA_Telemetry_Process каждые MAIN_LOOP_NS.
+ *
+ *  Проверяется, что декодер восстанавливает каждое изменение с точным временем,
+ *  переполнение очереди и долгая тишина, порча потока и копия в COM-порт.
+ *  Замер: при каждом периоде опроса (каждый опрос - изменение кнопок) - байт в
+ *  секунду, загрузка линии и потерянные изменения. 1 кГц должна проходить без потерь.
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "SEGA_telemetry.h"
+#include "usbd_cdc_acm.h"
+#include "telemetry_codec.h"
+#include "host_cmsis.h"
+#include "test.h"
+
+#define MAIN_LOOP_NS  10000ULL //Период главного цикла в модели, нс
+#define EVENTS_MAX    (64 * 1024)
+#define CAPTURE_SIZE  (1024 * 1024)
+#define CLOCK_START   (0x100000000ULL - 5000000ULL) //мкс: переполнение CMSIS_Micros через 5 с
+#define BUTTONS_MASK  0x3FFF //Биты Buttons, см. SEGA_gamepad.h
+
+/*Модель железа*/
+struct USART_DMA_TX_name husart1_dma_tx;
+static uint64_t Host_ns = CLOCK_START * 1000ULL;
+static uint32_t Line_baudrate;
+static const uint8_t *Line_data; //Буфер прошивки, который сейчас "передается"
+static uint16_t Line_size;
+static uint64_t Line_end_ns; //Конец передачи
+static uint64_t Line_busy_ns; //Сколько линия была занята
+static uint8_t Usart_capture[CAPTURE_SIZE];
+static size_t Usart_len;
+static bool Cdc_connected;
+static uint8_t Cdc_capture[CAPTURE_SIZE];
+static size_t Cdc_len;
+
+/*Ожидаемые события: с момента time кнопки равны buttons*/
+typedef struct {
+    uint32_t time;
+    uint16_t buttons;
+} expected_event;
+
+static expected_event Expected[EVENTS_MAX];
+static size_t Expected_count;
+static uint16_t Live; //Последнее значение, отданное SEGA_Telemetry_Push
+static uint32_t Random = 12345;
+
+/*Подмена периферии*/
+uint32_t CMSIS_Micros(void) {
+    return (uint32_t)(Host_ns / 1000);
+}
+
+void CMSIS_USART1_Init(void) {
+}
+
+void CMSIS_USART_Set_Baudrate(USART_TypeDef *USART, uint32_t Baudrate) {
+    (void)USART;
+    Line_baudrate = Baudrate;
+}
+
+void CMSIS_USART_DMA_TX_Init(struct USART_DMA_TX_name *husart_dma) {
+    (void)husart_dma;
+}
+
+bool CMSIS_USART_DMA_TX_Busy(struct USART_DMA_TX_name *husart_dma) {
+    (void)husart_dma;
+    if (Line_size && Host_ns >= Line_end_ns) {
+        CHECK(Usart_len + Line_size <= CAPTURE_SIZE);
+        memcpy(Usart_capture + Usart_len, Line_data, Line_size);
+        Usart_len += Line_size;
+        Line_size = 0;
+    }
+    return Line_size != 0;
+}
+
+bool CMSIS_USART_Transmit_DMA(struct USART_DMA_TX_name *husart_dma, const uint8_t *data, uint16_t Size) {
+    uint64_t duration = (uint64_t)Size * 10 * 1000000000ULL / Line_baudrate;
+
+    CHECK(!CMSIS_USART_DMA_TX_Busy(husart_dma)); //Прошивка не ставит второй пакет в очередь DMA
+    Line_data = data;
+    Line_size = Size;
+    Line_end_ns = Host_ns + duration;
+    Line_busy_ns += duration;
+    return true;
+}
+
+bool USBD_CDC_ACM_Busy(void) {
+    return false;
+}
+
+bool USBD_CDC_ACM_Connected(void) {
+    return Cdc_connected;
+}
+
+uint8_t USBD_CDC_ACM_Transmit(const uint8_t *buf, uint16_t len) {
+    CHECK(Cdc_len + len <= CAPTURE_SIZE);
+    memcpy(Cdc_capture + Cdc_len, buf, len);
+    Cdc_len += len;
+    return USBD_OK;
+}
+
+/*Новое состояние кнопок: меняется хотя бы один бит*/
+static uint16_t next_buttons(void) {
+    uint16_t mask;
+
+    do {
+        Random ^= Random << 13;
+        Random ^= Random >> 17;
+        Random ^= Random << 5;
+        mask = (uint16_t)(Random & BUTTONS_MASK);
+    } while (!mask);
+    return Live ^ mask;
+}
+
+/*Опрос геймпада (прерывание TIM3)*/
+static void poll(uint16_t buttons) {
+    if (buttons != Live) {
+        CHECK(Expected_count < EVENTS_MAX);
+        Expected[Expected_count].time = CMSIS_Micros();
+        Expected[Expected_count].buttons = buttons;
+        Expected_count++;
+    }
+    Live = buttons;
+    SEGA_Telemetry_Push(buttons);
+}
+
+/*Главный цикл в течение us микросекунд*/
+static void run(uint64_t us) {
+    uint64_t end = Host_ns + us * 1000;
+
+    while (Host_ns < end) {
+        SEGA_Telemetry_Process();
+        Host_ns += MAIN_LOOP_NS;
+    }
+}
+
+/*Новый сеанс: пустой поток, первый кадр - полное состояние Live.
+  retval - время этого кадра, от него декодер считает время*/
+static uint32_t session_start(bool cdc) {
+    uint32_t start;
+
+    Usart_len = 0;
+    Cdc_len = 0;
+    Line_busy_ns = 0;
+    Expected_count = 0;
+    Cdc_connected = cdc;
+    SEGA_Telemetry_CDC(cdc);
+    SEGA_Telemetry_Init();
+    Expected[Expected_count].time = CMSIS_Micros();
+    Expected[Expected_count].buttons = Live;
+    Expected_count++;
+    start = CMSIS_Micros();
+    SEGA_Telemetry_Process();
+    Host_ns += MAIN_LOOP_NS; //Изменения - уже после полного состояния
+    return start;
+}
+
+/*Дождаться отправки всего, что есть в очереди*/
+static void session_drain(void) {
+    run(20000);
+    while (CMSIS_USART_DMA_TX_Busy(&husart1_dma_tx)) {
+        Host_ns += MAIN_LOOP_NS;
+    }
+}
+
+/*Итог разбора сеанса*/
+typedef struct {
+    size_t frames;
+    size_t states;
+    size_t deltas; //Кадры 0x5A с изменениями
+    size_t keepalive; //Кадры 0x5A без изменений
+    size_t mismatches; //Кнопки не совпали с ожидаемыми в это время
+    size_t exact; //Изменение со своим точным временем
+    uint16_t last; //Кнопки после последнего кадра
+    uint32_t max_dt;
+} session_result;
+
+/*Разбор потока и сверка с Expected. Время кадров - от start*/
+static session_result session_check(const uint8_t *data, size_t len, uint32_t start) {
+    session_result r = {0};
+    telemetry_decoder d;
+    telemetry_event event;
+    size_t e = 0;
+    uint32_t time;
+
+    telemetry_init(&d);
+    for (size_t i = 0; i < len; i++) {
+        if (!telemetry_feed(&d, data[i], &event)) {
+            continue;
+        }
+        r.frames++;
+        if (event.type == TELEMETRY_STATE) {
+            r.states++;
+        }
+        else if (event.changed) {
+            r.deltas++;
+        }
+        else {
+            r.keepalive++;
+        }
+        if (event.dt > r.max_dt) {
+            r.max_dt = event.dt;
+        }
+        //Ожидаемое состояние на момент кадра: последнее событие не позже его времени
+        time = start + (uint32_t)event.time;
+        while (e + 1 < Expected_count && (int32_t)(Expected[e + 1].time - time) <= 0) {
+            e++;
+        }
+        if (event.buttons != Expected[e].buttons) {
+            r.mismatches++;
+        }
+        if (Expected[e].time == time && event.changed) {
+            r.exact++;
+        }
+        r.last = event.buttons;
+    }
+    CHECK(d.errors == 0);
+    CHECK(d.skipped == 0);
+    return r;
+}
+
+/*Каждый опрос - изменение, 1 кГц: без потерь, время каждого изменения точное*/
+static void test_1khz(void) {
+    uint32_t start = session_start(false);
+    session_result r;
+
+    for (int i = 0; i < 10000; i++) { //10 с, переполнение CMSIS_Micros внутри
+        poll(next_buttons());
+        run(1000);
+    }
+    session_drain();
+    r = session_check(Usart_capture, Usart_len, start);
+    CHECK(Line_baudrate == SEGA_TELEMETRY_BAUDRATE);
+    CHECK(r.states == 1);
+    CHECK(r.deltas == Expected_count - 1);
+    CHECK(r.exact == Expected_count - 1);
+    CHECK(r.mismatches == 0);
+    CHECK(r.last == Live);
+}
+
+/*Пачка изменений без главного цикла: очередь переполняется, затем полное состояние*/
+static void test_overflow(void) {
+    uint32_t start = session_start(false);
+    session_result r;
+
+    session_drain();
+    for (int i = 0; i < SEGA_TELEMETRY_QUEUE + 36; i++) {
+        poll(next_buttons());
+        Host_ns += 20000; //Опрос каждые 20 мкс, главный цикл стоит
+    }
+    session_drain();
+    r = session_check(Usart_capture, Usart_len, start);
+    CHECK(r.states == 2); //Первое и после переполнения
+    CHECK(r.deltas == SEGA_TELEMETRY_QUEUE);
+    CHECK(r.exact == SEGA_TELEMETRY_QUEUE);
+    CHECK(r.mismatches == 0);
+    CHECK(r.last == Live);
+}
+
+/*Долгая тишина: кадр без изменений каждые SEGA_TELEMETRY_KEEPALIVE_MS*/
+static void test_keepalive(void) {
+    uint32_t start = session_start(false);
+    session_result r;
+
+    poll(next_buttons());
+    for (int i = 0; i < 25; i++) {
+        Host_ns += 999000000ULL; //Главный цикл раз в 1 мс модели достаточно для тишины
+        run(1000);
+    }
+    session_drain();
+    r = session_check(Usart_capture, Usart_len, start);
+    CHECK(r.states == 1);
+    CHECK(r.deltas == 1);
+    CHECK(r.keepalive == 2); //25 с: после 10 и 20 с
+    CHECK(r.max_dt >= SEGA_TELEMETRY_KEEPALIVE_MS * 1000UL);
+    CHECK(r.max_dt < SEGA_TELEMETRY_KEEPALIVE_MS * 1000UL + 1000000UL);
+    CHECK(r.mismatches == 0);
+}
+
+/*Копия в COM-порт совпадает с USART байт в байт*/
+static void test_cdc(void) {
+    uint32_t start = session_start(true);
+    session_result r;
+
+    for (int i = 0; i < 2000; i++) {
+        poll(next_buttons());
+        run(1000);
+    }
+    session_drain();
+    run(1000); //Последний пакет уходит в COM-порт после USART
+    CHECK(Cdc_len == Usart_len);
+    CHECK(memcmp(Cdc_capture, Usart_capture, Usart_len) == 0);
+    r = session_check(Cdc_capture, Cdc_len, start);
+    CHECK(r.exact == Expected_count - 1);
+    CHECK(r.mismatches == 0);
+    SEGA_Telemetry_CDC(false);
+}
+
+/*Порча потока: мусор до начала и испорченный байт. Декодер отбрасывает кадр и идет дальше*/
+static void test_decoder_resync(void) {
+    static uint8_t stream[4096];
+    const uint8_t garbage[] = {0x00, 0x5A, 0x81, 0xFF, 0x5B};
+    telemetry_decoder d;
+    telemetry_event event;
+    size_t len, frames = 0;
+    uint16_t last = 0;
+
+    session_start(false);
+    for (int i = 0; i < 100; i++) {
+        poll(next_buttons());
+        run(1000);
+    }
+    session_drain();
+    CHECK(sizeof(garbage) + Usart_len <= sizeof(stream));
+    memcpy(stream, garbage, sizeof(garbage));
+    memcpy(stream + sizeof(garbage), Usart_capture, Usart_len);
+    len = sizeof(garbage) + Usart_len;
+
+    telemetry_init(&d);
+    for (size_t i = 0; i < len; i++) {
+        if (telemetry_feed(&d, stream[i], &event)) {
+            frames++;
+            last = event.buttons;
+        }
+    }
+    CHECK(frames == Expected_count); //Мусор не дал лишних кадров и не съел настоящие
+    CHECK(last == Live);
+
+    stream[sizeof(garbage) + Usart_len / 2] ^= 0x10;
+    telemetry_init(&d);
+    frames = 0;
+    for (size_t i = 0; i < len; i++) {
+        frames += telemetry_feed(&d, stream[i], &event);
+    }
+    CHECK(d.errors >= 1);
+    CHECK(frames < Expected_count);
+    CHECK(frames >= Expected_count - 3); //Потерян испорченный кадр и не больше пары соседних
+}
+
+/*Замер: байт в секунду и загрузка линии при разной частоте изменений*/
+static void bench(void) {
+    static const uint32_t period[] = {1000, 500, 250, 125, 100, 80, 64, 50};
+    uint32_t start;
+    session_result r;
+    size_t changes;
+    double seconds = 2.0;
+
+    printf("SEGA_telemetry, %u бод, очередь %u событий, каждый опрос - изменение кнопок:\n",
+           SEGA_TELEMETRY_BAUDRATE, SEGA_TELEMETRY_QUEUE);
+    for (size_t p = 0; p < sizeof(period) / sizeof(period[0]); p++) {
+        start = session_start(false);
+        for (uint32_t t = 0; t < (uint32_t)(seconds * 1000000); t += period[p]) {
+            poll(next_buttons());
+            run(period[p]);
+        }
+        session_drain();
+        r = session_check(Usart_capture, Usart_len, start);
+        changes = Expected_count - 1;
+        printf("  опрос %4u мкс (%5.0f изм/с): %4.2f байт/кадр, %6.0f байт/с, линия занята %5.1f%%, потеряно %zu из %zu\n",
+               period[p], changes / seconds, (double)Usart_len / r.frames, Usart_len / seconds,
+               100.0 * Line_busy_ns / (seconds * 1e9), changes - r.exact, changes);
+        CHECK(r.mismatches == 0); //И с потерями ПК видит верное состояние после полного кадра
+        CHECK(r.last == Live);
+        if (period[p] >= 1000) {
+            CHECK(r.exact == changes);
+            CHECK(r.states == 1);
+        }
+    }
+}
+
+int main(void) {
+    if (!host_periph_map()) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_1khz();
+    test_overflow();
+    test_keepalive();
+    test_cdc();
+    test_decoder_resync();
+    bench();
+    return TEST_RESULT("test_telemetry");
+}
@@ -0,0 +1,371 @@
+/**
+ ******************************************************************************
+ *  @file test_usart_rx.c
+ *  @brief Тест и замер приема USART через кольцевой DMA и IDLE (CMSIS_USART_DMA_RX_Init)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/stm32f103xx_CMSIS.c как есть
+ *  (через host_cmsis.h, с -no-pie).
+ *
+ *  Модель USART: за время байта на линии (10 бит) принятый байт попадает в DR.
+ *  При включенном DMAR его забирает канал DMA1 в кольцевой буфер: CNDTR уменьшается,
+ *  на половине буфера - HTIF, на конце - TCIF и CNDTR снова USART_DMA_RX_SIZE.
+ *  Без DMAR выставляется RXNE, и прерывание USART забирает байт само.
+ *  Через байт тишины после приема выставляется IDLE.
+ *  Прерывание вызывается через latency байт после флага (задержка обработки),
+ *  флаги DMA сбрасываются записью в IFCR, IDLE и RXNE - чтением DR (это делает модель).
+ *
+ *  Проверяется: настройка, кадры любой длины по порядку и с границами, кадр через
+ *  конец буфера, кадр ровно до половины или конца буфера, нет потерь при задержке
+ *  обработки до USART_DMA_RX_SIZE / 2 байт, старый прием по байту не выходит за rx_buffer.
+ *  Замер на 2 Мбод: прерываний/с через DMA и по байту, время обработчика на ПК.
+ *
+ ******************************************************************************
+ */
+
+#include <string.h>
+#include <time.h>
+#include "host_cmsis.h"
+#include "test.h"
+
+#define BAUDRATE    2000000
+#define STREAM_SIZE (1024 * 1024)
+#define FRAMES_MAX  (64 * 1024)
+
+/*Обработчики прерываний из stm32f103xx_CMSIS.c (в заголовке их нет)*/
+void USART1_IRQHandler(void);
+void USART2_IRQHandler(void);
+void DMA1_Channel5_IRQHandler(void);
+void DMA1_Channel6_IRQHandler(void);
+extern struct USART_name husart2; //Старый прием по байту
+
+/*Модель приемника: USART и его канал DMA*/
+typedef struct {
+    USART_TypeDef *USART;
+    DMA_Channel_TypeDef *Channel;
+    uint8_t number;
+    void (*USART_IRQHandler)(void);
+    void (*DMA_IRQHandler)(void);
+    uint32_t latency; //Через сколько байт после флага вызывается прерывание
+    uint64_t now; //Время в байтах на линии
+    uint64_t dma_since; //Флаг DMA выставлен в это время
+    uint64_t usart_since; //Флаг USART выставлен в это время
+    bool dma_pending;
+    bool usart_pending;
+    bool line_busy; //С прошлого IDLE был прием
+    uint32_t irqs;
+    uint64_t irq_ns; //Время в обработчиках на ПК
+} rx_model;
+
+static rx_model Rx1 = { .USART = USART1, .Channel = DMA1_Channel5, .number = 5,
+                        .USART_IRQHandler = USART1_IRQHandler, .DMA_IRQHandler = DMA1_Channel5_IRQHandler };
+static rx_model Rx2 = { .USART = USART2, .Channel = DMA1_Channel6, .number = 6,
+                        .USART_IRQHandler = USART2_IRQHandler, .DMA_IRQHandler = DMA1_Channel6_IRQHandler };
+
+/*Что ушло в линию и что получил callback*/
+static uint8_t Sent[STREAM_SIZE];
+static size_t Sent_len;
+static size_t Sent_frame[FRAMES_MAX]; //Конец кадра: смещение в Sent
+static size_t Sent_frames;
+static uint8_t Received[STREAM_SIZE];
+static size_t Received_len;
+static size_t Received_frame[FRAMES_MAX];
+static size_t Received_frames;
+static uint32_t Callbacks;
+static uint32_t Random = 2463534242u;
+
+static double now_ns(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static uint32_t random_next(void) {
+    Random ^= Random << 13;
+    Random ^= Random >> 17;
+    Random ^= Random << 5;
+    return Random;
+}
+
+/*Получатель данных, как у CMSIS_USART_DMA_RX_Init*/
+static void rx_callback(const uint8_t *data, uint16_t Size, bool Frame_end) {
+    Callbacks++;
+    CHECK(Size || Frame_end); //Пустой вызов - только конец кадра
+    CHECK(Size <= USART_DMA_RX_SIZE);
+    if (Received_len + Size <= STREAM_SIZE) {
+        memcpy(Received + Received_len, data, Size);
+        Received_len += Size;
+    }
+    if (Frame_end && Received_frames < FRAMES_MAX) {
+        Received_frame[Received_frames++] = Received_len;
+    }
+}
+
+static void stream_reset(void) {
+    Sent_len = Sent_frames = 0;
+    Received_len = Received_frames = 0;
+    Callbacks = 0;
+}
+
+/*Принятое совпадает с отправленным, границы кадров на месте*/
+static void stream_check(void) {
+    CHECK(Received_len == Sent_len);
+    CHECK(memcmp(Received, Sent, Sent_len) == 0);
+    CHECK(Received_frames == Sent_frames);
+    CHECK(memcmp(Received_frame, Sent_frame, Sent_frames * sizeof(Sent_frame[0])) == 0);
+}
+
+/*Вызов обработчика прерывания, как NVIC*/
+static void call_irq(rx_model *m, void (*IRQHandler)(void)) {
+    double t0 = now_ns();
+
+    IRQHandler();
+    m->irq_ns += (uint64_t)(now_ns() - t0);
+    m->irqs++;
+}
+
+/*Прерывания, которые пора обработать (по порядку флагов)*/
+static void service(rx_model *m) {
+    uint32_t shift = (m->number - 1) * 4;
+
+    while (true) {
+        bool dma = m->dma_pending && m->now - m->dma_since >= m->latency;
+        bool usart = m->usart_pending && m->now - m->usart_since >= m->latency;
+
+        if (dma && (!usart || m->dma_since <= m->usart_since)) {
+            m->dma_pending = false;
+            DMA1->IFCR = 0;
+            call_irq(m, m->DMA_IRQHandler);
+            if (DMA1->IFCR & (DMA_IFCR_CGIF1 << shift)) {
+                DMA1->IFCR |= 0xF << shift; //CGIF сбрасывает все флаги канала
+            }
+            DMA1->ISR &= ~DMA1->IFCR;
+            CHECK(!(DMA1->ISR & ((DMA_ISR_HTIF1 | DMA_ISR_TCIF1) << shift))); //Обработчик сбросил флаги
+        }
+        else if (usart) {
+            m->usart_pending = false;
+            call_irq(m, m->USART_IRQHandler);
+            CLEAR_BIT(m->USART->SR, USART_SR_IDLE | USART_SR_RXNE); //Обработчик прочитал DR
+        }
+        else {
+            return;
+        }
+    }
+}
+
+static void dma_flag(rx_model *m, uint32_t flag) {
+    uint32_t shift = (m->number - 1) * 4;
+
+    DMA1->ISR |= (flag | DMA_ISR_GIF1) << shift;
+    if (!m->dma_pending) {
+        m->dma_pending = true;
+        m->dma_since = m->now;
+    }
+}
+
+static void usart_flag(rx_model *m, uint32_t flag, uint32_t enable) {
+    SET_BIT(m->USART->SR, flag);
+    if (READ_BIT(m->USART->CR1, enable) && !m->usart_pending) {
+        m->usart_pending = true;
+        m->usart_since = m->now;
+    }
+}
+
+/*Байт на линии*/
+static void rx_byte(rx_model *m, uint8_t byte) {
+    DMA_Channel_TypeDef *ch = m->Channel;
+
+    m->now++;
+    m->line_busy = true;
+    m->USART->DR = byte;
+    if (Sent_len < STREAM_SIZE) {
+        Sent[Sent_len++] = byte;
+    }
+    if (READ_BIT(m->USART->CR3, USART_CR3_DMAR) && READ_BIT(ch->CCR, DMA_CCR_EN)) {
+        ((uint8_t *)(uintptr_t)ch->CMAR)[USART_DMA_RX_SIZE - ch->CNDTR] = byte;
+        ch->CNDTR--;
+        if (ch->CNDTR == USART_DMA_RX_SIZE / 2 && READ_BIT(ch->CCR, DMA_CCR_HTIE)) {
+            dma_flag(m, DMA_ISR_HTIF1);
+        }
+        if (ch->CNDTR == 0) {
+            ch->CNDTR = USART_DMA_RX_SIZE; //Circular: снова с начала буфера
+            if (READ_BIT(ch->CCR, DMA_CCR_TCIE)) {
+                dma_flag(m, DMA_ISR_TCIF1);
+            }
+        }
+    }
+    else {
+        usart_flag(m, USART_SR_RXNE, USART_CR1_RXNEIE);
+    }
+    service(m);
+}
+
+/*Тишина на линии n байт: IDLE после первого*/
+static void rx_gap(rx_model *m, uint32_t n) {
+    while (n--) {
+        m->now++;
+        if (m->line_busy) {
+            m->line_busy = false;
+            usart_flag(m, USART_SR_IDLE, USART_CR1_IDLEIE);
+        }
+        service(m);
+    }
+}
+
+/*Кадр size байт и тишина после него*/
+static void rx_frame(rx_model *m, uint32_t size, uint32_t gap) {
+    for (uint32_t i = 0; i < size; i++) {
+        rx_byte(m, (uint8_t)random_next());
+    }
+    if (Sent_frames < FRAMES_MAX) {
+        Sent_frame[Sent_frames++] = Sent_len;
+    }
+    rx_gap(m, gap);
+}
+
+/*Настройка: канал в Circular на кольцевой буфер, USART без прерывания на байт*/
+static void test_init(void) {
+    CMSIS_USART1_Init();
+    CMSIS_USART_Set_Baudrate(USART1, BAUDRATE);
+    CHECK(READ_BIT(USART1->CR1, USART_CR1_RXNEIE));
+    CMSIS_USART_DMA_RX_Init(&husart1_dma_rx, rx_callback);
+    CHECK(husart1_dma_rx.active);
+    CHECK(DMA1_Channel5->CPAR == (uint32_t)(uintptr_t)&USART1->DR);
+    CHECK(DMA1_Channel5->CMAR == (uint32_t)(uintptr_t)husart1_dma_rx.buffer);
+    CHECK(DMA1_Channel5->CNDTR == USART_DMA_RX_SIZE);
+    CHECK(READ_BIT(DMA1_Channel5->CCR, DMA_CCR_CIRC | DMA_CCR_MINC | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN)
+          == (DMA_CCR_CIRC | DMA_CCR_MINC | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN));
+    CHECK(!READ_BIT(DMA1_Channel5->CCR, DMA_CCR_DIR));
+    CHECK(!READ_BIT(USART1->CR1, USART_CR1_RXNEIE));
+    CHECK(READ_BIT(USART1->CR1, USART_CR1_IDLEIE));
+    CHECK(READ_BIT(USART1->CR3, USART_CR3_DMAR));
+}
+
+/*Кадры от 1 байта до длиннее буфера: одно прерывание IDLE на кадр плюс HT/TC*/
+static void test_frames(void) {
+    static const uint16_t size[] = {1, 2, 7, 100, 127, 128, 129, 255, 256, 257, 300, 1000, 3};
+    uint32_t halves = 0, irqs;
+
+    stream_reset();
+    Rx1.latency = 0;
+    irqs = Rx1.irqs;
+    for (size_t i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        rx_frame(&Rx1, size[i], 2);
+        halves = (uint32_t)(Sent_len / (USART_DMA_RX_SIZE / 2));
+    }
+    stream_check();
+    CHECK(Rx1.irqs - irqs == sizeof(size) / sizeof(size[0]) + halves);
+}
+
+/*Кадр через конец буфера: TC обработан уже после конца кадра, callback дважды*/
+static void test_wrap(void) {
+    uint32_t callbacks;
+
+    stream_reset();
+    Rx1.latency = 0;
+    rx_frame(&Rx1, USART_DMA_RX_SIZE - husart1_dma_rx.read_pos - 6, 2); //До конца буфера 6 байт
+    CHECK(husart1_dma_rx.read_pos == USART_DMA_RX_SIZE - 6);
+    Rx1.latency = 30;
+    callbacks = Callbacks;
+    rx_frame(&Rx1, 20, 40);
+    CHECK(Callbacks - callbacks == 3); //6 байт, 14 байт, конец кадра
+    CHECK(husart1_dma_rx.read_pos == 14);
+    stream_check();
+}
+
+/*Кадр кончился ровно на половине или конце буфера: HT/TC отдали данные, IDLE - конец кадра*/
+static void test_boundary(void) {
+    stream_reset();
+    Rx1.latency = 0;
+    rx_frame(&Rx1, USART_DMA_RX_SIZE - husart1_dma_rx.read_pos, 2);
+    CHECK(husart1_dma_rx.read_pos == 0);
+    rx_frame(&Rx1, USART_DMA_RX_SIZE / 2, 2);
+    CHECK(husart1_dma_rx.read_pos == USART_DMA_RX_SIZE / 2);
+    stream_check();
+}
+
+/*Без тишины и с задержкой обработки меньше половины буфера ничего не теряется*/
+static void test_no_loss(void) {
+    static const uint32_t latency[] = {0, 1, 50, USART_DMA_RX_SIZE / 2 - 1};
+
+    for (size_t i = 0; i < sizeof(latency) / sizeof(latency[0]); i++) {
+        stream_reset();
+        Rx1.latency = latency[i];
+        rx_frame(&Rx1, 64 * 1024, latency[i] + 2); //Один длинный кадр
+        for (int n = 0; n < 2000; n++) {
+            rx_frame(&Rx1, 1 + random_next() % 600, latency[i] + 2);
+        }
+        stream_check();
+    }
+}
+
+/*Старый прием по байту (USART2 без DMA): лишние байты отбрасываются*/
+static void test_legacy(void) {
+    uint16_t size = sizeof(husart2.rx_buffer);
+
+    CMSIS_USART2_Init();
+    CHECK(!husart2_dma_rx.active);
+    stream_reset();
+    Rx2.latency = 0;
+    rx_frame(&Rx2, size + 10, 2);
+    CHECK(husart2.rx_len == size);
+    CHECK(memcmp(husart2.rx_buffer, Sent, size) == 0);
+    CHECK(husart2.rx_counter == 0);
+    rx_frame(&Rx2, 5, 2);
+    CHECK(husart2.rx_len == 5);
+    CHECK(memcmp(husart2.rx_buffer, Sent + size + 10, 5) == 0);
+    CHECK(Received_len == 0); //В callback USART1 ничего не попало
+}
+
+/*Замер на 2 Мбод: 1 с линии кадрами длины size с байтом тишины между ними*/
+static void bench_size(rx_model *m, uint16_t size) {
+    const uint32_t bytes = BAUDRATE / 10;
+    uint32_t irqs = m->irqs;
+    uint64_t start = m->now;
+
+    stream_reset();
+    m->latency = 0;
+    m->irq_ns = 0;
+    while (m->now - start + size + 1 <= bytes) {
+        rx_frame(m, size, 1);
+    }
+    irqs = m->irqs - irqs;
+    printf("  %s, кадр %4u байт: %6u прерываний/с, на ПК %4.1f нс на прерывание\n",
+           (m == &Rx1) ? "DMA      " : "по байту ", size, irqs, (double)m->irq_ns / irqs);
+    if (m == &Rx1) {
+        stream_check();
+    }
+}
+
+static void bench(void) {
+    static const uint16_t size[] = {1, 8, 64, 256, 1024};
+
+    printf("Прием USART %u бод, кольцевой буфер DMA %u байт:\n", BAUDRATE, USART_DMA_RX_SIZE);
+    for (size_t i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        bench_size(&Rx1, size[i]);
+        bench_size(&Rx2, size[i]);
+    }
+    printf("  время байта %.1f мкс, запас на обработку HT/TC %u байт (%.0f мкс)\n",
+           10e6 / BAUDRATE, USART_DMA_RX_SIZE / 2 - 1, (USART_DMA_RX_SIZE / 2 - 1) * 10e6 / BAUDRATE);
+}
+
+int main(void) {
+    if (!host_periph_map()) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_init();
+    test_frames();
+    test_wrap();
+    test_boundary();
+    test_no_loss();
+    test_legacy();
+    bench();
+    return TEST_RESULT("test_usart_rx");
+}
@@ -0,0 +1,299 @@
+/**
+ ******************************************************************************
+ *  @file test_usart_tx.c
+ *  @brief Тест и замер передачи USART через DMA (CMSIS_USART_Transmit_DMA)
+ *  @author Волков Олег
+ *  @date 18.10.2026
+ *
+ ******************************************************************************
+ * @attention
+ *
+ *  Собирается вместе с SEGA_USB_GamePad/Core/Src/stm32f103xx_CMSIS.c как есть
+ *  (через host_cmsis.h, с -no-pie).
+ *
+ *  Модель: каналы DMA1 4 (USART1_TX) и 7 (USART2_TX) забирают из памяти по байту
+ *  за время байта на линии (10 бит, скорость по USART->BRR). Когда CNDTR доходит
+ *  до 0, модель выставляет TCIF и вызывает обработчик прерывания канала, как NVIC.
+ *  Новую передачу модель видит по включенному каналу с CNDTR > 0.
+ *  Промежутка между кадрами в модели нет: прерывание успевает за время байта.
+ *
+ *  Проверяется: порядок и содержимое кадров, очередь на USART_DMA_TX_QUEUE кадров,
+ *  пропуск кадра при ошибке DMA, USART2 на общем с I2C1 канале 7.
+ *  Замер на 2 Мбод: байт/с и прерываний/с при разной длине кадра, время вызова
+ *  CMSIS_USART_Transmit_DMA и обработчика на ПК (от длины кадра не зависит).
+ *  CMSIS_USART_Transmit для сравнения занимает процессор все время передачи.
+ *
+ ******************************************************************************
+ */
+
+#include <string.h>
+#include <time.h>
+#include "host_cmsis.h"
+#include "test.h"
+
+#define BAUDRATE     2000000
+#define CAPTURE_SIZE (1024 * 1024)
+#define FRAME_MAX    1024
+
+/*Обработчики прерываний из stm32f103xx_CMSIS.c (в заголовке их нет)*/
+void DMA1_Channel4_IRQHandler(void);
+void DMA1_Channel7_IRQHandler(void);
+
+/*Модель одного канала DMA на передачу*/
+typedef struct {
+    DMA_Channel_TypeDef *Channel;
+    uint8_t number;
+    void (*IRQHandler)(void);
+    const uint8_t *next; //Следующий байт из памяти
+    bool running;
+    bool error_pending; //Следующий байт завершится ошибкой передачи
+    uint8_t capture[CAPTURE_SIZE]; //Что ушло в линию
+    size_t len;
+    uint32_t irqs;
+} dma_tx_model;
+
+static dma_tx_model Tx1 = { .Channel = DMA1_Channel4, .number = 4, .IRQHandler = DMA1_Channel4_IRQHandler };
+static dma_tx_model Tx2 = { .Channel = DMA1_Channel7, .number = 7, .IRQHandler = DMA1_Channel7_IRQHandler };
+
+static uint8_t Frames[USART_DMA_TX_QUEUE * 2][FRAME_MAX]; //Статические: адрес помещается в CMAR
+static uint64_t Irq_ns; //Время в обработчике прерывания на ПК
+
+static double now_ns(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/*Прерывание канала: флаг в DMA1->ISR, обработчик, сброс флагов записью в IFCR*/
+static void dma_irq(dma_tx_model *m, uint32_t flag) {
+    uint32_t shift = (m->number - 1) * 4;
+    double t0;
+
+    DMA1->ISR |= (flag | DMA_ISR_GIF1) << shift;
+    DMA1->IFCR = 0;
+    t0 = now_ns();
+    m->IRQHandler();
+    Irq_ns += (uint64_t)(now_ns() - t0);
+    m->irqs++;
+    for (uint32_t ch = 0; ch < 28; ch += 4) {
+        if (DMA1->IFCR & (DMA_IFCR_CGIF1 << ch)) { //CGIF сбрасывает все флаги канала
+            DMA1->IFCR |= 0xF << ch;
+        }
+    }
+    DMA1->ISR &= ~DMA1->IFCR;
+    CHECK(!(DMA1->ISR & (0xF << shift))); //Обработчик сбросил флаги канала
+}
+
+/*Канал включили с новым кадром*/
+static void dma_latch(dma_tx_model *m) {
+    if (!m->running && READ_BIT(m->Channel->CCR, DMA_CCR_EN) && m->Channel->CNDTR) {
+        m->next = (const uint8_t *)(uintptr_t)m->Channel->CMAR;
+        m->running = true;
+    }
+}
+
+/*Время одного байта на линии*/
+static void dma_byte(dma_tx_model *m) {
+    dma_latch(m);
+    if (!m->running) {
+        return;
+    }
+    if (m->error_pending) {
+        m->error_pending = false;
+        m->running = false;
+        dma_irq(m, DMA_ISR_TEIF1);
+        dma_latch(m);
+        return;
+    }
+    CHECK(m->len < CAPTURE_SIZE);
+    m->capture[m->len++] = *m->next++;
+    if (--m->Channel->CNDTR == 0) {
+        m->running = false;
+        dma_irq(m, DMA_ISR_TCIF1);
+        dma_latch(m);
+    }
+}
+
+/*Линия в течение n байт*/
+static void run(dma_tx_model *m, uint32_t n) {
+    while (n--) {
+        dma_byte(m);
+    }
+}
+
+static void run_idle(dma_tx_model *m, struct USART_DMA_TX_name *husart_dma) {
+    for (uint32_t i = 0; CMSIS_USART_DMA_TX_Busy(husart_dma) && i < CAPTURE_SIZE; i++) {
+        dma_byte(m);
+    }
+    CHECK(!CMSIS_USART_DMA_TX_Busy(husart_dma));
+}
+
+/*Кадр n: длина size, байты зависят от номера*/
+static const uint8_t *frame(uint8_t n, uint16_t size) {
+    for (uint16_t i = 0; i < size; i++) {
+        Frames[n][i] = (uint8_t)(n * 31 + i);
+    }
+    return Frames[n];
+}
+
+static bool frame_equal(const uint8_t *data, uint8_t n, uint16_t size) {
+    for (uint16_t i = 0; i < size; i++) {
+        if (data[i] != (uint8_t)(n * 31 + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*Настройка: скорость, канал, USART запрашивает DMA*/
+static void test_init(void) {
+    CMSIS_USART1_Init();
+    CMSIS_USART_Set_Baudrate(USART1, BAUDRATE);
+    CMSIS_USART_DMA_TX_Init(&husart1_dma_tx);
+    CHECK(USART1->BRR == 36); //72 МГц / 2 Мбод
+    CHECK(READ_BIT(USART1->CR3, USART_CR3_DMAT));
+    CHECK(DMA1_Channel4->CPAR == (uint32_t)(uintptr_t)&USART1->DR);
+    CHECK(READ_BIT(DMA1_Channel4->CCR, DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_TCIE | DMA_CCR_TEIE)
+          == (DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_TCIE | DMA_CCR_TEIE));
+    CHECK(!READ_BIT(DMA1_Channel4->CCR, DMA_CCR_CIRC | DMA_CCR_EN));
+    CHECK(!CMSIS_USART_DMA_TX_Busy(&husart1_dma_tx));
+}
+
+/*Кадры уходят по порядку и целиком; очередь держит USART_DMA_TX_QUEUE кадров*/
+static void test_queue(void) {
+    uint16_t size[USART_DMA_TX_QUEUE + 1];
+    size_t pos = 0;
+
+    Tx1.len = 0;
+    CHECK(CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(0, 1), 0)); //Пустой кадр: ничего не делает
+    CHECK(!CMSIS_USART_DMA_TX_Busy(&husart1_dma_tx));
+    for (uint8_t n = 0; n < USART_DMA_TX_QUEUE; n++) {
+        size[n] = (uint16_t)(1 + n * 37);
+        CHECK(CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(n, size[n]), size[n]));
+    }
+    CHECK(CMSIS_USART_DMA_TX_Busy(&husart1_dma_tx));
+    CHECK(!CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(USART_DMA_TX_QUEUE, 5), 5)); //Очередь полна
+
+    run(&Tx1, size[0]); //Первый кадр ушел: место освободилось
+    size[USART_DMA_TX_QUEUE] = 5;
+    CHECK(CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(USART_DMA_TX_QUEUE, 5), 5));
+    run_idle(&Tx1, &husart1_dma_tx);
+    CHECK(!READ_BIT(DMA1_Channel4->CCR, DMA_CCR_EN)); //Канал выключен, когда очередь пуста
+
+    for (uint8_t n = 0; n <= USART_DMA_TX_QUEUE; n++) {
+        CHECK(pos + size[n] <= Tx1.len && frame_equal(Tx1.capture + pos, n, size[n]));
+        pos += size[n];
+    }
+    CHECK(pos == Tx1.len);
+    CHECK(Tx1.irqs == USART_DMA_TX_QUEUE + 1); //Одно прерывание на кадр
+}
+
+/*Вызов при запрещенных прерываниях (из обработчика под __disable_irq) их не разрешает*/
+static void test_primask(void) {
+    Tx1.len = 0;
+    Host_primask = 1;
+    CHECK(CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(4, 3), 3));
+    CHECK(Host_primask == 1);
+    for (uint8_t n = 0; n < USART_DMA_TX_QUEUE; n++) {
+        CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(4, 3), 3);
+    }
+    CHECK(Host_primask == 1); //И когда очередь полна
+    Host_primask = 0;
+    CHECK(CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(4, 3), 3) == false);
+    CHECK(Host_primask == 0);
+    run_idle(&Tx1, &husart1_dma_tx);
+    CHECK(Tx1.len == 3 * USART_DMA_TX_QUEUE);
+}
+
+/*Ошибка DMA: кадр пропускается, следующие уходят*/
+static void test_error(void) {
+    Tx1.len = 0;
+    CHECK(CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(1, 10), 10));
+    CHECK(CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(2, 10), 10));
+    CHECK(CMSIS_USART_Transmit_DMA(&husart1_dma_tx, frame(3, 10), 10));
+    run(&Tx1, 4);
+    Tx1.error_pending = true; //Ошибка на 5-м байте кадра 1
+    run(&Tx1, 10 + 1);
+    run_idle(&Tx1, &husart1_dma_tx);
+    CHECK(Tx1.len == 4 + 10 + 10);
+    CHECK(frame_equal(Tx1.capture + 4, 2, 10));
+    CHECK(frame_equal(Tx1.capture + 14, 3, 10));
+}
+
+/*USART2 на канале 7, который делит с приемом I2C1*/
+static void test_usart2(void) {
+    CMSIS_USART2_Init();
+    CMSIS_USART_Set_Baudrate(USART2, BAUDRATE);
+    CMSIS_USART_DMA_TX_Init(&husart2_dma_tx);
+    CHECK(USART2->BRR == 18); //36 МГц / 2 Мбод
+    CHECK(DMA1_Channel7->CPAR == (uint32_t)(uintptr_t)&USART2->DR);
+    Tx2.len = 0;
+    for (uint8_t n = 0; n < 3; n++) {
+        CHECK(CMSIS_USART_Transmit_DMA(&husart2_dma_tx, frame(8 + n, 100), 100));
+    }
+    run_idle(&Tx2, &husart2_dma_tx);
+    CHECK(Tx2.len == 300);
+    for (uint8_t n = 0; n < 3; n++) {
+        CHECK(frame_equal(Tx2.capture + n * 100, 8 + n, 100));
+    }
+    CHECK(Tx2.irqs == 3);
+}
+
+/*Замер на 2 Мбод: главный цикл держит очередь полной кадрами длины size*/
+static void bench_size(uint16_t size) {
+    const uint32_t bytes = BAUDRATE / 10; //1 с линии
+    uint32_t calls = 0, irqs = Tx1.irqs;
+    double call_ns = 0, t0;
+    size_t len;
+    uint8_t n = 0;
+
+    Tx1.len = 0;
+    Irq_ns = 0;
+    for (uint8_t i = 0; i < USART_DMA_TX_QUEUE * 2; i++) {
+        frame(i, size);
+    }
+    for (uint32_t t = 0; t < bytes; t++) {
+        for (;;) {
+            t0 = now_ns();
+            if (!CMSIS_USART_Transmit_DMA(&husart1_dma_tx, Frames[n % (USART_DMA_TX_QUEUE * 2)], size)) {
+                break;
+            }
+            call_ns += now_ns() - t0;
+            calls++;
+            n++;
+        }
+        dma_byte(&Tx1);
+    }
+    len = Tx1.len;
+    run_idle(&Tx1, &husart1_dma_tx);
+    irqs = Tx1.irqs - irqs;
+    printf("  кадр %4u байт: %6zu байт/с (линия %5.1f%%), %6u прерываний/с; на ПК: вызов %4.1f нс, прерывание %4.1f нс\n",
+           size, len, 100.0 * len / bytes, irqs, call_ns / calls, (double)Irq_ns / irqs);
+    CHECK(len == bytes); //Линия не простаивает
+}
+
+static void bench(void) {
+    static const uint16_t size[] = {1, 8, 64, 256, FRAME_MAX};
+
+    printf("CMSIS_USART_Transmit_DMA, USART1 %u бод, очередь %u кадров:\n", BAUDRATE, USART_DMA_TX_QUEUE);
+    for (size_t i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        bench_size(size[i]);
+    }
+    printf("  CMSIS_USART_Transmit: ожидание TXE на каждом байте, %.1f мкс процессора на байт\n", 10e6 / BAUDRATE);
+}
+
+int main(void) {
+    if (!host_periph_map()) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_init();
+    test_queue();
+    test_primask();
+    test_error();
+    test_usart2();
+    bench();
+    return TEST_RESULT("test_usart_tx");
+}